@@ -1295,8 +1295,6 @@ static fsw_status_t fsw_btrfs_volume_mount(struct fsw_volume *volg) {
     fsw_status_t err;
     int i;
 
-    init_crc32c_table();
-
     err = btrfs_read_superblock (volg, &sblock);
     if (err)
         return err;
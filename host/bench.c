@@ -0,0 +1,226 @@
+/*
+ * host/bench.c
+ * Run rEFInd's start-up on the build host and report how long it took
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// refind-bench calls efi_main() with the mock firmware, its first directory
+// argument serving as the ESP that rEFInd was loaded from and any others as
+// further volumes. The run ends when rEFInd starts an OS loader or tool,
+// resets the computer, returns, or waits for a key when none are left to
+// type. Then the phases recorded by the boot trace (as if boot_trace were
+// set) are totalled and reported, along with what the firmware counted and
+// rEFInd's own allocation counts.
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "host.h"
+#include "../refind/global.h"
+#include "../refind/lib.h"
+#include "../refind/trace.h"
+#include "../libeg/libeg.h"
+
+EFI_STATUS EFIAPI efi_main(EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable);
+
+// Where rEFInd is, relative to the ESP
+#define SELF_PATH       L"\\EFI\\refind\\refind_x64.efi"
+#define TRACE_PATH      L"\\EFI\\refind\\" TRACE_FILENAME
+
+#define MAX_PHASES      64
+#define MAX_NESTING     32
+
+typedef struct {
+   char     Name[64];
+   UINTN    Count;
+   UINT64   Total;      // microseconds
+} PHASE;
+
+static PHASE  Phases[MAX_PHASES];
+static UINTN  PhaseCount = 0;
+
+static PHASE *FindPhase(IN const char *Name) {
+   UINTN i;
+
+   for (i = 0; i < PhaseCount; i++) {
+      if (strcmp(Phases[i].Name, Name) == 0)
+         return &Phases[i];
+   }
+   if (PhaseCount == MAX_PHASES)
+      return NULL;
+   snprintf(Phases[PhaseCount].Name, sizeof(Phases[PhaseCount].Name), "%s", Name);
+   return &Phases[PhaseCount++];
+} // static PHASE *FindPhase()
+
+// Total up the phases in a trace written by TraceSave(). Each event is on a
+// line of its own, in the order recorded.
+static VOID ReadTrace(IN char *Trace) {
+   char    *Line, *Saved = NULL, Name[64], Phase;
+   UINT64  Timestamp;
+   struct {
+      PHASE   *Phase;
+      UINT64  Start;
+   } Open[MAX_NESTING];
+   UINTN   Depth = 0;
+
+   for (Line = strtok_r(Trace, "\n", &Saved); Line != NULL; Line = strtok_r(NULL, "\n", &Saved)) {
+      if (sscanf(Line, "{\"name\":\"%63[^\"]\",\"ph\":\"%c\",\"ts\":%llu", Name, &Phase,
+                 (unsigned long long *) &Timestamp) != 3)
+         continue;
+      if (Phase == 'B') {
+         if (Depth < MAX_NESTING) {
+            Open[Depth].Phase = FindPhase(Name);
+            Open[Depth].Start = Timestamp;
+         }
+         Depth++;
+      } else if ((Phase == 'E') && (Depth > 0)) {
+         Depth--;
+         if ((Depth < MAX_NESTING) && (Open[Depth].Phase != NULL) && (strcmp(Open[Depth].Phase->Name, Name) == 0)) {
+            Open[Depth].Phase->Count++;
+            Open[Depth].Phase->Total += Timestamp - Open[Depth].Start;
+         }
+      }
+   } // for
+} // static VOID ReadTrace()
+
+static VOID Usage(IN const char *Program) {
+   fprintf(stderr, "Usage: %s [-r WIDTHxHEIGHT] [-k KEY[,KEY...]] [-o SCREEN.ppm] [-v] ESP [VOLUME...]\n\n"
+           "Runs rEFInd's start-up with ESP (a directory) as the volume it was loaded from,\n"
+           "and VOLUMEs as further volumes, then reports how long each phase took.\n\n"
+           "  -r  screen resolution (default 1024x768)\n"
+           "  -k  keys to type: names such as enter, esc, up, down, f2, pageup, or single\n"
+           "      characters (default enter)\n"
+           "  -o  save the screen as it was at the end of the run\n"
+           "  -v  copy text written to the console to standard error\n", Program);
+   exit(2);
+} // static VOID Usage()
+
+int main(int argc, char *argv[]) {
+   const char       *Keys = "enter", *ScreenFile = NULL, *Reasons[] = { "returned", "launched", "reset", "idle" };
+   unsigned         Width = 1024, Height = 768;
+   int              Option, Reason, i;
+   EFI_HANDLE       Esp = NULL, Volume;
+   EFI_STATUS       Status = EFI_SUCCESS;
+   struct timespec  Start, End;
+   UINT64           Elapsed;
+   HOST_STATS       Stats;
+   EG_PNG_MEMORY_STATS PngStats;
+   VOID             *Trace;
+   UINTN            TraceSize, p;
+   char             *Launched;
+
+   while ((Option = getopt(argc, argv, "r:k:o:v")) != -1) {
+      switch (Option) {
+         case 'r':
+            if ((sscanf(optarg, "%ux%u", &Width, &Height) != 2) || (Width == 0) || (Height == 0))
+               Usage(argv[0]);
+            break;
+         case 'k':
+            Keys = optarg;
+            break;
+         case 'o':
+            ScreenFile = optarg;
+            break;
+         case 'v':
+            HostVerbose = TRUE;
+            break;
+         default:
+            Usage(argv[0]);
+      }
+   } // while
+   if (optind >= argc)
+      Usage(argv[0]);
+
+   HostFirmwareInit();
+   HostGopInit(Width, Height);
+   if (!HostSetKeys(Keys)) {
+      fprintf(stderr, "Unknown key in \"%s\"\n", Keys);
+      return 2;
+   }
+   for (i = optind; i < argc; i++) {
+      Volume = HostAddVolume(argv[i]);
+      if (Volume == NULL) {
+         fprintf(stderr, "%s isn't a directory\n", argv[i]);
+         return 2;
+      }
+      if (Esp == NULL)
+         Esp = Volume;
+   }
+   HostSetSelf(Esp, SELF_PATH);
+
+   clock_gettime(CLOCK_MONOTONIC, &Start);
+   Reason = setjmp(HostExitJump);
+   if (Reason == 0)
+      Status = efi_main(HostImageHandle, &HostSystemTable);
+   clock_gettime(CLOCK_MONOTONIC, &End);
+   Elapsed = (UINT64) (End.tv_sec - Start.tv_sec) * 1000000 + (End.tv_nsec - Start.tv_nsec) / 1000;
+   Stats = HostStats;
+   if (ScreenFile != NULL && !HostGopSave(ScreenFile))
+      fprintf(stderr, "Couldn't save the screen to %s\n", ScreenFile);
+
+   printf("Run ended: %s", Reasons[Reason]);
+   if (Reason == HOST_EXIT_LAUNCH) {
+      Launched = HostToUtf8(HostLaunchedPath);
+      printf(" %s", Launched);
+      free(Launched);
+   } else if (Reason == HOST_EXIT_RETURN) {
+      printf(" (status %ld)", (long) Status);
+   }
+   printf("\nElapsed: %llu us, and %llu us of waiting skipped\n\n",
+          (unsigned long long) Elapsed,
+          (unsigned long long) Stats.SkippedUs);
+
+   // The events are still in memory, whatever the configuration said.
+   GlobalConfig.BootTrace = TRUE;
+   TraceSave();
+   if (!EFI_ERROR(HostReadFile(Esp, TRACE_PATH, &Trace, &TraceSize))) {
+      ((char *) Trace)[TraceSize] = '\0';
+      ReadTrace(Trace);
+      free(Trace);
+   }
+   if (PhaseCount == 0) {
+      printf("No phases were traced.\n\n");
+   } else {
+      printf("%-24s %8s %12s\n", "Phase", "Count", "Total (us)");
+      for (p = 0; p < PhaseCount; p++)
+         printf("%-24s %8lu %12llu\n", Phases[p].Name, (unsigned long) Phases[p].Count,
+                (unsigned long long) Phases[p].Total);
+      printf("\n");
+   }
+
+   printf("Pool allocations:    %lu (%lu freed; %lu bytes, peak %lu live)\n", (unsigned long) Stats.PoolAllocations,
+          (unsigned long) Stats.PoolFrees, (unsigned long) Stats.PoolBytes, (unsigned long) Stats.PoolPeak);
+   printf("Page allocations:    %lu\n", (unsigned long) Stats.PageAllocations);
+   printf("Arena allocations:   %lu (in %lu blocks)\n", (unsigned long) AllocationCounts.ArenaAllocations,
+          (unsigned long) AllocationCounts.ArenaBlocks);
+   printf("List additions:      %lu (%lu allocations)\n", (unsigned long) AllocationCounts.ListAdditions,
+          (unsigned long) AllocationCounts.ListAllocations);
+   egGetPNGMemoryStats(&PngStats);
+   printf("PNG decodes:         %lu (%lu allocations, %lu grown in place, peak %lu bytes)\n",
+          (unsigned long) PngStats.Decodes, (unsigned long) PngStats.Allocations,
+          (unsigned long) PngStats.GrownInPlace, (unsigned long) PngStats.PeakBytes);
+   printf("Files opened:        %lu\n", (unsigned long) Stats.FileOpens);
+   printf("File reads:          %lu (%lu bytes)\n", (unsigned long) Stats.FileReads,
+          (unsigned long) Stats.FileReadBytes);
+   printf("Block reads:         %lu\n", (unsigned long) Stats.BlockReads);
+   printf("Blt calls:           %lu (%lu pixels)\n", (unsigned long) Stats.BltCalls, (unsigned long) Stats.BltPixels);
+   printf("Console characters:  %lu\n", (unsigned long) Stats.TextChars);
+   return 0;
+} // int main()
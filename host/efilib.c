@@ -0,0 +1,924 @@
+/*
+ * host/efilib.c
+ * The parts of the GNU-EFI library that rEFInd uses, for the host build
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// These behave as GNU-EFI's versions do, as far as rEFInd can tell:
+// memory comes from the boot services' pool (so the mock firmware counts
+// it), Print() writes to ST->ConOut with "\n" expanded to "\r\n", %x and %X
+// print upper-case digits, and numbers are 32 bits wide unless the 'l' flag
+// is given.
+
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+
+EFI_SYSTEM_TABLE        *ST = NULL;
+EFI_BOOT_SERVICES       *BS = NULL;
+EFI_RUNTIME_SERVICES    *RT = NULL;
+EFI_HANDLE              LibImageHandle = NULL;
+
+EFI_DEVICE_PATH EndDevicePath[] = {
+   { END_DEVICE_PATH_TYPE, END_ENTIRE_DEVICE_PATH_SUBTYPE, { END_DEVICE_PATH_LENGTH, 0 } }
+};
+
+EFI_GUID gEfiBlockIoProtocolGuid =
+   { 0x964e5b21, 0x6459, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiDiskIoProtocolGuid =
+   { 0xce345171, 0xba0b, 0x11d2, { 0x8e, 0x4f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiSimpleFileSystemProtocolGuid = SIMPLE_FILE_SYSTEM_PROTOCOL;
+EFI_GUID gEfiLoadedImageProtocolGuid = EFI_LOADED_IMAGE_PROTOCOL_GUID;
+EFI_GUID gEfiDevicePathProtocolGuid =
+   { 0x09576e91, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiSimpleTextInProtocolGuid =
+   { 0x387477c1, 0x69c7, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiSimpleTextOutProtocolGuid =
+   { 0x387477c2, 0x69c7, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiGraphicsOutputProtocolGuid = EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID;
+EFI_GUID gEfiSimplePointerProtocolGuid = EFI_SIMPLE_POINTER_PROTOCOL_GUID;
+EFI_GUID gEfiLoadFileProtocolGuid =
+   { 0x56ec3091, 0x954c, 0x11d2, { 0x8e, 0x3f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } };
+EFI_GUID gEfiLoadFile2ProtocolGuid =
+   { 0x4006c0c1, 0xfcb3, 0x403e, { 0x99, 0x6d, 0x4a, 0x6c, 0x87, 0x24, 0xe0, 0x6d } };
+EFI_GUID gEfiGlobalVariableGuid = EFI_GLOBAL_VARIABLE;
+EFI_GUID gEfiFileInfoGuid = EFI_FILE_INFO_ID;
+EFI_GUID gEfiFileSystemInfoGuid = EFI_FILE_SYSTEM_INFO_ID;
+EFI_GUID gEfiFileSystemVolumeLabelInfoIdGuid = EFI_FILE_SYSTEM_VOLUME_LABEL_INFO_ID;
+
+VOID InitializeLib(IN EFI_HANDLE ImageHandle, IN EFI_SYSTEM_TABLE *SystemTable) {
+   LibImageHandle = ImageHandle;
+   ST = SystemTable;
+   BS = SystemTable->BootServices;
+   RT = SystemTable->RuntimeServices;
+} // VOID InitializeLib()
+
+//
+// Memory
+//
+
+VOID *AllocatePool(IN UINTN Size) {
+   VOID *Buffer = NULL;
+
+   if (EFI_ERROR(BS->AllocatePool(EfiLoaderData, Size, &Buffer)))
+      return NULL;
+   return Buffer;
+} // VOID *AllocatePool()
+
+VOID *AllocateZeroPool(IN UINTN Size) {
+   VOID *Buffer = AllocatePool(Size);
+
+   if (Buffer != NULL)
+      ZeroMem(Buffer, Size);
+   return Buffer;
+} // VOID *AllocateZeroPool()
+
+VOID *ReallocatePool(IN VOID *OldPool, IN UINTN OldSize, IN UINTN NewSize) {
+   VOID *NewPool = NULL;
+
+   if (NewSize > 0) {
+      NewPool = AllocatePool(NewSize);
+      if ((NewPool != NULL) && (OldPool != NULL))
+         CopyMem(NewPool, OldPool, (OldSize < NewSize) ? OldSize : NewSize);
+   }
+   if (OldPool != NULL)
+      FreePool(OldPool);
+   return NewPool;
+} // VOID *ReallocatePool()
+
+VOID FreePool(IN VOID *p) {
+   BS->FreePool(p);
+} // VOID FreePool()
+
+VOID ZeroMem(IN VOID *Buffer, IN UINTN Size) {
+   memset(Buffer, 0, Size);
+} // VOID ZeroMem()
+
+VOID SetMem(IN VOID *Buffer, IN UINTN Size, IN UINT8 Value) {
+   memset(Buffer, Value, Size);
+} // VOID SetMem()
+
+VOID CopyMem(IN VOID *Dest, IN CONST VOID *Src, IN UINTN len) {
+   memmove(Dest, Src, len);
+} // VOID CopyMem()
+
+INTN CompareMem(IN CONST VOID *Dest, IN CONST VOID *Src, IN UINTN len) {
+   return (len == 0) ? 0 : memcmp(Dest, Src, len);
+} // INTN CompareMem()
+
+INTN CompareGuid(IN EFI_GUID *Guid1, IN EFI_GUID *Guid2) {
+   return CompareMem(Guid1, Guid2, sizeof(EFI_GUID)) ? 1 : 0;
+} // INTN CompareGuid()
+
+//
+// Strings
+//
+
+static CHAR16 ToUpper(IN CHAR16 c) {
+   return ((c >= L'a') && (c <= L'z')) ? c - (L'a' - L'A') : c;
+} // static CHAR16 ToUpper()
+
+INTN StrCmp(IN CONST CHAR16 *s1, IN CONST CHAR16 *s2) {
+   while (*s1 && (*s1 == *s2)) {
+      s1++;
+      s2++;
+   }
+   return (INTN) *s1 - (INTN) *s2;
+} // INTN StrCmp()
+
+INTN StrnCmp(IN CONST CHAR16 *s1, IN CONST CHAR16 *s2, IN UINTN len) {
+   while (len > 0) {
+      if ((*s1 != *s2) || (*s1 == 0))
+         return (INTN) *s1 - (INTN) *s2;
+      s1++;
+      s2++;
+      len--;
+   }
+   return 0;
+} // INTN StrnCmp()
+
+INTN StriCmp(IN CONST CHAR16 *s1, IN CONST CHAR16 *s2) {
+   while (*s1 && (ToUpper(*s1) == ToUpper(*s2))) {
+      s1++;
+      s2++;
+   }
+   return (INTN) ToUpper(*s1) - (INTN) ToUpper(*s2);
+} // INTN StriCmp()
+
+VOID StrLwr(IN CHAR16 *Str) {
+   for (; *Str; Str++) {
+      if ((*Str >= L'A') && (*Str <= L'Z'))
+         *Str += L'a' - L'A';
+   }
+} // VOID StrLwr()
+
+VOID StrUpr(IN CHAR16 *Str) {
+   for (; *Str; Str++)
+      *Str = ToUpper(*Str);
+} // VOID StrUpr()
+
+VOID StrCpy(IN CHAR16 *Dest, IN CONST CHAR16 *Src) {
+   while ((*Dest++ = *Src++) != 0)
+      ;
+} // VOID StrCpy()
+
+VOID StrnCpy(IN CHAR16 *Dest, IN CONST CHAR16 *Src, IN UINTN Len) {
+   UINTN i;
+
+   for (i = 0; (i < Len) && Src[i]; i++)
+      Dest[i] = Src[i];
+   if (i < Len)
+      Dest[i] = 0;
+} // VOID StrnCpy()
+
+VOID StrCat(IN CHAR16 *Dest, IN CONST CHAR16 *Src) {
+   StrCpy(Dest + StrLen(Dest), Src);
+} // VOID StrCat()
+
+VOID StrnCat(IN CHAR16 *Dest, IN CONST CHAR16 *Src, IN UINTN Len) {
+   Dest += StrLen(Dest);
+   StrnCpy(Dest, Src, Len);
+   Dest[Len] = 0;
+} // VOID StrnCat()
+
+UINTN StrLen(IN CONST CHAR16 *s1) {
+   UINTN Length = 0;
+
+   while (s1[Length])
+      Length++;
+   return Length;
+} // UINTN StrLen()
+
+UINTN StrSize(IN CONST CHAR16 *s1) {
+   return (StrLen(s1) + 1) * sizeof(CHAR16);
+} // UINTN StrSize()
+
+CHAR16 *StrDuplicate(IN CONST CHAR16 *Src) {
+   UINTN  Size = StrSize(Src);
+   CHAR16 *Dest = AllocatePool(Size);
+
+   if (Dest != NULL)
+      CopyMem(Dest, Src, Size);
+   return Dest;
+} // CHAR16 *StrDuplicate()
+
+UINTN strlena(IN CONST CHAR8 *s1) {
+   return strlen((const char *) s1);
+} // UINTN strlena()
+
+UINTN strcmpa(IN CONST CHAR8 *s1, IN CONST CHAR8 *s2) {
+   return strcmp((const char *) s1, (const char *) s2);
+} // UINTN strcmpa()
+
+UINTN strncmpa(IN CONST CHAR8 *s1, IN CONST CHAR8 *s2, IN UINTN len) {
+   return strncmp((const char *) s1, (const char *) s2, len);
+} // UINTN strncmpa()
+
+UINTN xtoi(IN CONST CHAR16 *str) {
+   UINTN  Value = 0;
+   CHAR16 c;
+
+   while (*str == L' ')
+      str++;
+   for (; (c = ToUpper(*str)) != 0; str++) {
+      if ((c >= L'0') && (c <= L'9'))
+         Value = (Value << 4) | (c - L'0');
+      else if ((c >= L'A') && (c <= L'F'))
+         Value = (Value << 4) | (c - L'A' + 10);
+      else
+         break;
+   }
+   return Value;
+} // UINTN xtoi()
+
+UINTN Atoi(IN CONST CHAR16 *str) {
+   UINTN Value = 0;
+
+   while (*str == L' ')
+      str++;
+   for (; (*str >= L'0') && (*str <= L'9'); str++)
+      Value = Value * 10 + (*str - L'0');
+   return Value;
+} // UINTN Atoi()
+
+// Match String against Pattern, which may hold '*', '?', and '[...]'
+// (including ranges such as "a-z"), ignoring case.
+BOOLEAN MetaiMatch(IN CHAR16 *String, IN CHAR16 *Pattern) {
+   CHAR16  c, p, l;
+   BOOLEAN Found;
+
+   for (;;) {
+      p = *Pattern++;
+      switch (p) {
+         case 0:
+            return (*String == 0);
+
+         case L'*':
+            while (*String) {
+               if (MetaiMatch(String, Pattern))
+                  return TRUE;
+               String++;
+            }
+            return MetaiMatch(String, Pattern);
+
+         case L'?':
+            if (*String == 0)
+               return FALSE;
+            String++;
+            break;
+
+         case L'[':
+            c = ToUpper(*String);
+            if (c == 0)
+               return FALSE;
+            l = 0;
+            Found = FALSE;
+            while ((p = ToUpper(*Pattern++)) != L']') {
+               if (p == 0)
+                  return FALSE;
+               if ((p == L'-') && (l != 0) && (*Pattern != L']')) {
+                  p = ToUpper(*Pattern++);
+                  if ((c >= l) && (c <= p))
+                     Found = TRUE;
+               } else if (c == p) {
+                  Found = TRUE;
+               }
+               l = p;
+            }
+            if (!Found)
+               return FALSE;
+            String++;
+            break;
+
+         default:
+            if (ToUpper(*String) != ToUpper(p))
+               return FALSE;
+            String++;
+            break;
+      } // switch
+   } // for
+} // BOOLEAN MetaiMatch()
+
+// The names GNU-EFI gives the status codes, by number
+static CHAR16 *ErrorNames[] = {
+   L"Success", L"Load Error", L"Invalid Parameter", L"Unsupported", L"Bad Buffer Size",
+   L"Buffer Too Small", L"Not Ready", L"Device Error", L"Write Protected", L"Out of Resources",
+   L"Volume Corrupt", L"Volume Full", L"No Media", L"Media changed", L"Not Found",
+   L"Access Denied", L"No Response", L"No mapping", L"Time out", L"Not started",
+   L"Already started", L"Aborted", L"ICMP Error", L"TFTP Error", L"Protocol Error",
+   L"Incompatible Version", L"Security Violation", L"CRC Error", L"End of Media", NULL,
+   NULL, L"End of File", L"Invalid Language", L"Compromised Data"
+};
+
+VOID StatusToString(OUT CHAR16 *Buffer, IN EFI_STATUS Status) {
+   UINTN Code = Status & ~EFI_ERROR_MASK;
+
+   if ((Code < sizeof(ErrorNames) / sizeof(ErrorNames[0])) && (ErrorNames[Code] != NULL) &&
+       ((Code == 0) || EFI_ERROR(Status)))
+      StrCpy(Buffer, ErrorNames[Code]);
+   else
+      SPrint(Buffer, 0, L"%X", Status);
+} // VOID StatusToString()
+
+//
+// Conversions to and from UTF-8, for host file names and output
+//
+
+// Returns a malloc()ed UTF-8 copy of String.
+char *HostToUtf8(IN CONST CHAR16 *String) {
+   UINTN i, Length = 0;
+   char  *Result = malloc(StrLen(String) * 3 + 1);
+
+   for (i = 0; String[i]; i++) {
+      if (String[i] < 0x80) {
+         Result[Length++] = (char) String[i];
+      } else if (String[i] < 0x800) {
+         Result[Length++] = (char) (0xC0 | (String[i] >> 6));
+         Result[Length++] = (char) (0x80 | (String[i] & 0x3F));
+      } else {
+         Result[Length++] = (char) (0xE0 | (String[i] >> 12));
+         Result[Length++] = (char) (0x80 | ((String[i] >> 6) & 0x3F));
+         Result[Length++] = (char) (0x80 | (String[i] & 0x3F));
+      }
+   }
+   Result[Length] = 0;
+   return Result;
+} // char *HostToUtf8()
+
+// Returns a malloc()ed UCS-2 copy of String; characters outside the basic
+// multilingual plane become '?'.
+CHAR16 *HostFromUtf8(IN const char *String) {
+   const unsigned char *s = (const unsigned char *) String;
+   UINTN  Length = 0;
+   UINT32 c;
+   CHAR16 *Result = malloc((strlen(String) + 1) * sizeof(CHAR16));
+
+   while (*s) {
+      if (*s < 0x80) {
+         c = *s++;
+      } else if (((*s & 0xE0) == 0xC0) && s[1]) {
+         c = ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+         s += 2;
+      } else if (((*s & 0xF0) == 0xE0) && s[1] && s[2]) {
+         c = ((s[0] & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+         s += 3;
+      } else {
+         c = L'?';
+         for (s++; (*s & 0xC0) == 0x80; s++)
+            ;
+      }
+      Result[Length++] = (CHAR16) c;
+   }
+   Result[Length] = 0;
+   return Result;
+} // CHAR16 *HostFromUtf8()
+
+//
+// Printing
+//
+
+// Output being built by the formatter
+typedef struct {
+   CHAR16   *Buffer;
+   UINTN    Length;
+   UINTN    Size;       // characters that Buffer can hold, including the final 0
+   BOOLEAN  Grow;       // TRUE if Buffer is pool memory that may be enlarged
+} PRINT_STATE;
+
+static VOID PutChar(IN OUT PRINT_STATE *ps, IN CHAR16 c) {
+   CHAR16 *NewBuffer;
+
+   if ((ps->Length + 1 >= ps->Size) && ps->Grow) {
+      NewBuffer = ReallocatePool(ps->Buffer, ps->Size * sizeof(CHAR16), ps->Size * 2 * sizeof(CHAR16));
+      if (NewBuffer != NULL) {
+         ps->Buffer = NewBuffer;
+         ps->Size *= 2;
+      } else {
+         ps->Grow = FALSE;
+         ps->Buffer = NULL;
+         ps->Size = 0;
+      }
+   }
+   if (ps->Length + 1 < ps->Size)
+      ps->Buffer[ps->Length++] = c;
+} // static VOID PutChar()
+
+// Put String, padded to Width with Pad (on the right if LeftAlign) and cut
+// to Precision characters (unless that's -1).
+static VOID PutField(IN OUT PRINT_STATE *ps, IN CONST CHAR16 *String, IN UINTN Width, IN INTN Precision,
+                     IN CHAR16 Pad, IN BOOLEAN LeftAlign) {
+   UINTN Length = StrLen(String), i;
+
+   if ((Precision >= 0) && (Length > (UINTN) Precision))
+      Length = Precision;
+   if (!LeftAlign) {
+      for (i = Length; i < Width; i++)
+         PutChar(ps, Pad);
+   }
+   for (i = 0; i < Length; i++)
+      PutChar(ps, String[i]);
+   if (LeftAlign) {
+      for (i = Length; i < Width; i++)
+         PutChar(ps, L' ');
+   }
+} // static VOID PutField()
+
+static VOID NumberToString(OUT CHAR16 *Buffer, IN UINT64 Value, IN UINTN Base, IN BOOLEAN Negative,
+                           IN BOOLEAN Comma) {
+   CHAR16 Digits[32];
+   UINTN  Count = 0, Length = 0;
+
+   do {
+      if (Comma && (Count > 0) && (Count % 3 == 0))
+         Digits[Length++] = L',';
+      Digits[Length++] = L"0123456789ABCDEF"[Value % Base];
+      Value /= Base;
+      Count++;
+   } while (Value != 0);
+   if (Negative)
+      *Buffer++ = L'-';
+   while (Length > 0)
+      *Buffer++ = Digits[--Length];
+   *Buffer = 0;
+} // static VOID NumberToString()
+
+static VOID Format(IN OUT PRINT_STATE *ps, IN CONST CHAR16 *fmt, IN va_list args) {
+   CHAR16   Item[64], *String;
+   CHAR8    *AsciiString;
+   UINTN    Width, i;
+   INTN     Precision;
+   INT64    Signed;
+   UINT64   Value;
+   CHAR16   Pad;
+   BOOLEAN  LeftAlign, Long, Comma;
+   EFI_GUID *Guid;
+   EFI_TIME *Time;
+
+   for (; *fmt; fmt++) {
+      if (*fmt != L'%') {
+         PutChar(ps, *fmt);
+         continue;
+      }
+
+      Width = 0;
+      Precision = -1;
+      Pad = L' ';
+      LeftAlign = Long = Comma = FALSE;
+      for (fmt++; ; fmt++) {
+         if (*fmt == L'-') {
+            LeftAlign = TRUE;
+         } else if (*fmt == L',') {
+            Comma = TRUE;
+         } else if ((*fmt == L'0') && (Width == 0)) {
+            Pad = L'0';
+         } else if (*fmt == L'*') {
+            Width = va_arg(args, UINTN);
+         } else if ((*fmt >= L'1') && (*fmt <= L'9')) {
+            for (; (*fmt >= L'0') && (*fmt <= L'9'); fmt++)
+               Width = Width * 10 + (*fmt - L'0');
+            fmt--;
+         } else if (*fmt == L'.') {
+            Precision = 0;
+            if (fmt[1] == L'*') {
+               Precision = va_arg(args, UINTN);
+               fmt++;
+            } else {
+               for (; (fmt[1] >= L'0') && (fmt[1] <= L'9'); fmt++)
+                  Precision = Precision * 10 + (fmt[1] - L'0');
+            }
+         } else if (*fmt == L'l') {
+            Long = TRUE;
+         } else {
+            break;
+         }
+      } // for
+
+      switch (*fmt) {
+         case 0:
+            return;
+
+         case L'a':
+            AsciiString = va_arg(args, CHAR8 *);
+            if (AsciiString == NULL)
+               AsciiString = (CHAR8 *) "(null)";
+            for (i = 0; AsciiString[i] && ((Precision < 0) || (i < (UINTN) Precision)); i++)
+               PutChar(ps, AsciiString[i]);
+            break;
+
+         case L's':
+            String = va_arg(args, CHAR16 *);
+            PutField(ps, (String == NULL) ? L"(null)" : String, Width, Precision, L' ', LeftAlign);
+            break;
+
+         case L'c':
+            PutChar(ps, (CHAR16) va_arg(args, UINTN));
+            break;
+
+         case L'd':
+         case L'i':
+            Signed = Long ? va_arg(args, INT64) : (INT32) va_arg(args, UINTN);
+            NumberToString(Item, (Signed < 0) ? -(UINT64) Signed : (UINT64) Signed, 10, Signed < 0, Comma);
+            PutField(ps, Item, Width, -1, Pad, LeftAlign);
+            break;
+
+         case L'u':
+            Value = Long ? va_arg(args, UINT64) : (UINT32) va_arg(args, UINTN);
+            NumberToString(Item, Value, 10, FALSE, Comma);
+            PutField(ps, Item, Width, -1, Pad, LeftAlign);
+            break;
+
+         case L'p':
+            Long = TRUE;
+            Width = sizeof(VOID *) * 2;
+            Pad = L'0';
+            // fall through
+         case L'X':
+            if (*fmt == L'X') {
+               Width = Long ? 16 : 8;
+               Pad = L'0';
+            }
+            // fall through
+         case L'x':
+            Value = Long ? va_arg(args, UINT64) : (UINT32) va_arg(args, UINTN);
+            NumberToString(Item, Value, 16, FALSE, FALSE);
+            PutField(ps, Item, Width, -1, Pad, LeftAlign);
+            break;
+
+         case L'r':
+            StatusToString(Item, va_arg(args, EFI_STATUS));
+            PutField(ps, Item, Width, -1, L' ', LeftAlign);
+            break;
+
+         case L'g':
+            Guid = va_arg(args, EFI_GUID *);
+            if (Guid == NULL) {
+               PutField(ps, L"(null)", Width, -1, L' ', LeftAlign);
+               break;
+            }
+            SPrint(Item, sizeof(Item), L"%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+                   Guid->Data1, Guid->Data2, Guid->Data3, Guid->Data4[0], Guid->Data4[1], Guid->Data4[2],
+                   Guid->Data4[3], Guid->Data4[4], Guid->Data4[5], Guid->Data4[6], Guid->Data4[7]);
+            PutField(ps, Item, Width, -1, L' ', LeftAlign);
+            break;
+
+         case L't':
+            Time = va_arg(args, EFI_TIME *);
+            SPrint(Item, sizeof(Item), L"%02d/%02d/%02d  %02d:%02d", Time->Month, Time->Day, Time->Year % 100,
+                   Time->Hour, Time->Minute);
+            PutField(ps, Item, Width, -1, L' ', LeftAlign);
+            break;
+
+         case L'N':
+         case L'H':
+         case L'E':
+         case L'B':
+         case L'V':
+            // colour changes, which the host's output doesn't show
+            break;
+
+         default:
+            PutChar(ps, *fmt);
+            break;
+      } // switch
+   } // for
+} // static VOID Format()
+
+UINTN VSPrint(OUT CHAR16 *Str, IN UINTN StrSize, IN CONST CHAR16 *fmt, va_list args) {
+   PRINT_STATE ps;
+
+   ps.Buffer = Str;
+   ps.Length = 0;
+   ps.Size = (StrSize == 0) ? (UINTN) -1 / 2 : StrSize / sizeof(CHAR16);
+   ps.Grow = FALSE;
+   if (ps.Size == 0)
+      return 0;
+   Format(&ps, fmt, args);
+   Str[ps.Length] = 0;
+   return ps.Length;
+} // UINTN VSPrint()
+
+UINTN SPrint(OUT CHAR16 *Str, IN UINTN StrSize, IN CONST CHAR16 *fmt, ...) {
+   va_list args;
+   UINTN   Length;
+
+   va_start(args, fmt);
+   Length = VSPrint(Str, StrSize, fmt, args);
+   va_end(args);
+   return Length;
+} // UINTN SPrint()
+
+CHAR16 *VPoolPrint(IN CONST CHAR16 *fmt, va_list args) {
+   PRINT_STATE ps;
+
+   ps.Size = 64;
+   ps.Buffer = AllocatePool(ps.Size * sizeof(CHAR16));
+   ps.Length = 0;
+   ps.Grow = TRUE;
+   if (ps.Buffer == NULL)
+      return NULL;
+   Format(&ps, fmt, args);
+   if (ps.Buffer != NULL)
+      ps.Buffer[ps.Length] = 0;
+   return ps.Buffer;
+} // CHAR16 *VPoolPrint()
+
+CHAR16 *PoolPrint(IN CONST CHAR16 *fmt, ...) {
+   va_list args;
+   CHAR16  *Result;
+
+   va_start(args, fmt);
+   Result = VPoolPrint(fmt, args);
+   va_end(args);
+   return Result;
+} // CHAR16 *PoolPrint()
+
+UINTN Print(IN CONST CHAR16 *fmt, ...) {
+   va_list args;
+   CHAR16  *Text, *Output;
+   UINTN   i, Length = 0;
+
+   va_start(args, fmt);
+   Text = VPoolPrint(fmt, args);
+   va_end(args);
+   if (Text == NULL)
+      return 0;
+
+   Output = AllocatePool(StrSize(Text) * 2);
+   if (Output != NULL) {
+      for (i = 0; Text[i]; i++) {
+         if ((Text[i] == L'\n') && ((i == 0) || (Text[i - 1] != L'\r')))
+            Output[Length++] = L'\r';
+         Output[Length++] = Text[i];
+      }
+      Output[Length] = 0;
+      ST->ConOut->OutputString(ST->ConOut, Output);
+      FreePool(Output);
+   }
+   Length = StrLen(Text);
+   FreePool(Text);
+   return Length;
+} // UINTN Print()
+
+//
+// Device paths
+//
+
+EFI_DEVICE_PATH *DevicePathFromHandle(IN EFI_HANDLE Handle) {
+   EFI_DEVICE_PATH *DevicePath = NULL;
+
+   if (EFI_ERROR(BS->HandleProtocol(Handle, &DevicePathProtocol, (VOID **) &DevicePath)))
+      return NULL;
+   return DevicePath;
+} // EFI_DEVICE_PATH *DevicePathFromHandle()
+
+UINTN DevicePathSize(IN EFI_DEVICE_PATH *DevPath) {
+   EFI_DEVICE_PATH *Start = DevPath;
+
+   while (!IsDevicePathEnd(DevPath))
+      DevPath = NextDevicePathNode(DevPath);
+   return ((UINT8 *) DevPath - (UINT8 *) Start) + sizeof(EFI_DEVICE_PATH);
+} // UINTN DevicePathSize()
+
+EFI_DEVICE_PATH *DuplicateDevicePath(IN EFI_DEVICE_PATH *DevPath) {
+   EFI_DEVICE_PATH *NewPath;
+   UINTN           Size;
+
+   if (DevPath == NULL)
+      return NULL;
+   Size = DevicePathSize(DevPath);
+   NewPath = AllocatePool(Size);
+   if (NewPath != NULL)
+      CopyMem(NewPath, DevPath, Size);
+   return NewPath;
+} // EFI_DEVICE_PATH *DuplicateDevicePath()
+
+// Joins two single-instance paths.
+EFI_DEVICE_PATH *AppendDevicePath(IN EFI_DEVICE_PATH *Src1, IN EFI_DEVICE_PATH *Src2) {
+   EFI_DEVICE_PATH *NewPath;
+   UINTN           Size1, Size2;
+
+   if (Src1 == NULL)
+      return DuplicateDevicePath((Src2 == NULL) ? EndDevicePath : Src2);
+   if (Src2 == NULL)
+      return DuplicateDevicePath(Src1);
+   Size1 = DevicePathSize(Src1) - sizeof(EFI_DEVICE_PATH);
+   Size2 = DevicePathSize(Src2);
+   NewPath = AllocatePool(Size1 + Size2);
+   if (NewPath != NULL) {
+      CopyMem(NewPath, Src1, Size1);
+      CopyMem((UINT8 *) NewPath + Size1, Src2, Size2);
+   }
+   return NewPath;
+} // EFI_DEVICE_PATH *AppendDevicePath()
+
+EFI_DEVICE_PATH *AppendDevicePathNode(IN EFI_DEVICE_PATH *Src1, IN EFI_DEVICE_PATH *Src2) {
+   EFI_DEVICE_PATH *Node, *NewPath;
+   UINTN           Length;
+
+   if (Src2 == NULL)
+      return DuplicateDevicePath(Src1);
+   Length = DevicePathNodeLength(Src2);
+   Node = AllocatePool(Length + sizeof(EFI_DEVICE_PATH));
+   if (Node == NULL)
+      return NULL;
+   CopyMem(Node, Src2, Length);
+   SetDevicePathEndNode(NextDevicePathNode(Node));
+   NewPath = AppendDevicePath(Src1, Node);
+   FreePool(Node);
+   return NewPath;
+} // EFI_DEVICE_PATH *AppendDevicePathNode()
+
+EFI_DEVICE_PATH *FileDevicePath(IN EFI_HANDLE Device OPTIONAL, IN CHAR16 *FileName) {
+   UINTN                Size = StrSize(FileName);
+   FILEPATH_DEVICE_PATH *FilePath;
+   EFI_DEVICE_PATH      *Result, *DevicePath;
+
+   FilePath = AllocateZeroPool(SIZE_OF_FILEPATH_DEVICE_PATH + Size + sizeof(EFI_DEVICE_PATH));
+   if (FilePath == NULL)
+      return NULL;
+   FilePath->Header.Type = MEDIA_DEVICE_PATH;
+   FilePath->Header.SubType = MEDIA_FILEPATH_DP;
+   SetDevicePathNodeLength(&FilePath->Header, SIZE_OF_FILEPATH_DEVICE_PATH + Size);
+   CopyMem(FilePath->PathName, FileName, Size);
+   SetDevicePathEndNode(NextDevicePathNode(&FilePath->Header));
+   Result = &FilePath->Header;
+
+   if (Device != NULL) {
+      DevicePath = DevicePathFromHandle(Device);
+      if (DevicePath != NULL) {
+         Result = AppendDevicePath(DevicePath, &FilePath->Header);
+         FreePool(FilePath);
+      }
+   }
+   return Result;
+} // EFI_DEVICE_PATH *FileDevicePath()
+
+// Describe one node as GNU-EFI does (for the node types the mock uses, and
+// those rEFInd inspects).
+static VOID NodeToStr(IN OUT PRINT_STATE *ps, IN EFI_DEVICE_PATH *Node) {
+   CHAR16                *Text = NULL;
+   HARDDRIVE_DEVICE_PATH *Hd;
+   PCI_DEVICE_PATH       *Pci;
+   ACPI_HID_DEVICE_PATH  *Acpi;
+   SATA_DEVICE_PATH      *Sata;
+   FILEPATH_DEVICE_PATH  *FilePath;
+
+   switch ((DevicePathType(Node) << 8) | DevicePathSubType(Node)) {
+      case (HARDWARE_DEVICE_PATH << 8) | HW_PCI_DP:
+         Pci = (PCI_DEVICE_PATH *) Node;
+         Text = PoolPrint(L"Pci(%x|%x)", Pci->Device, Pci->Function);
+         break;
+      case (ACPI_DEVICE_PATH << 8) | ACPI_DP:
+         Acpi = (ACPI_HID_DEVICE_PATH *) Node;
+         Text = PoolPrint(L"Acpi(PNP%04x,%x)", Acpi->HID >> 16, Acpi->UID);
+         break;
+      case (MESSAGING_DEVICE_PATH << 8) | MSG_SATA_DP:
+         Sata = (SATA_DEVICE_PATH *) Node;
+         Text = PoolPrint(L"Sata(%x,%x,%x)", Sata->HBAPortNumber, Sata->PortMultiplierPortNumber, Sata->Lun);
+         break;
+      case (MEDIA_DEVICE_PATH << 8) | MEDIA_HARDDRIVE_DP:
+         Hd = (HARDDRIVE_DEVICE_PATH *) Node;
+         if (Hd->SignatureType == SIGNATURE_TYPE_GUID)
+            Text = PoolPrint(L"HD(Part%d,Sig%g)", Hd->PartitionNumber, (EFI_GUID *) Hd->Signature);
+         else
+            Text = PoolPrint(L"HD(Part%d,MBRType=%02x,SigType=%02x)", Hd->PartitionNumber, Hd->MBRType,
+                             Hd->SignatureType);
+         break;
+      case (MEDIA_DEVICE_PATH << 8) | MEDIA_FILEPATH_DP:
+         FilePath = (FILEPATH_DEVICE_PATH *) Node;
+         Text = StrDuplicate(FilePath->PathName);
+         break;
+      case (END_DEVICE_PATH_TYPE << 8) | END_INSTANCE_DEVICE_PATH_SUBTYPE:
+         Text = StrDuplicate(L",");
+         break;
+      default:
+         Text = PoolPrint(L"?(%x,%x)", DevicePathType(Node), DevicePathSubType(Node));
+         break;
+   } // switch
+
+   if (Text != NULL) {
+      PutField(ps, Text, 0, -1, L' ', FALSE);
+      FreePool(Text);
+   }
+} // static VOID NodeToStr()
+
+#define IsFilePathNode(a) ((DevicePathType(a) == MEDIA_DEVICE_PATH) && (DevicePathSubType(a) == MEDIA_FILEPATH_DP))
+
+CHAR16 *DevicePathToStr(EFI_DEVICE_PATH *DevPath) {
+   PRINT_STATE     ps;
+   EFI_DEVICE_PATH *Node, *Previous = NULL;
+
+   ps.Size = 64;
+   ps.Buffer = AllocatePool(ps.Size * sizeof(CHAR16));
+   ps.Length = 0;
+   ps.Grow = TRUE;
+   if (ps.Buffer == NULL)
+      return NULL;
+   for (Node = DevPath; (Node != NULL) && !IsDevicePathEnd(Node); Node = NextDevicePathNode(Node)) {
+      // Nodes are separated by slashes, except for adjacent file path
+      // nodes, which are simply joined.
+      if ((Previous != NULL) && !IsDevicePathEndType(Node) &&
+          !(IsFilePathNode(Previous) && IsFilePathNode(Node)))
+         PutChar(&ps, L'/');
+      NodeToStr(&ps, Node);
+      Previous = Node;
+      if (DevicePathNodeLength(Node) < sizeof(EFI_DEVICE_PATH))
+         break;
+   }
+   if (ps.Buffer != NULL)
+      ps.Buffer[ps.Length] = 0;
+   return ps.Buffer;
+} // CHAR16 *DevicePathToStr()
+
+//
+// Protocols and files
+//
+
+EFI_STATUS LibLocateProtocol(IN EFI_GUID *ProtocolGuid, OUT VOID **Interface) {
+   return BS->LocateProtocol(ProtocolGuid, NULL, Interface);
+} // EFI_STATUS LibLocateProtocol()
+
+EFI_STATUS LibLocateHandle(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol OPTIONAL,
+                           IN VOID *SearchKey OPTIONAL, IN OUT UINTN *NoHandles, OUT EFI_HANDLE **Buffer) {
+   EFI_STATUS Status;
+   UINTN      BufferSize = 0;
+
+   *NoHandles = 0;
+   *Buffer = NULL;
+   Status = BS->LocateHandle(SearchType, Protocol, SearchKey, &BufferSize, NULL);
+   if (Status != EFI_BUFFER_TOO_SMALL)
+      return Status;
+   *Buffer = AllocatePool(BufferSize);
+   if (*Buffer == NULL)
+      return EFI_OUT_OF_RESOURCES;
+   Status = BS->LocateHandle(SearchType, Protocol, SearchKey, &BufferSize, *Buffer);
+   if (EFI_ERROR(Status)) {
+      FreePool(*Buffer);
+      *Buffer = NULL;
+   } else {
+      *NoHandles = BufferSize / sizeof(EFI_HANDLE);
+   }
+   return Status;
+} // EFI_STATUS LibLocateHandle()
+
+EFI_FILE_HANDLE LibOpenRoot(IN EFI_HANDLE DeviceHandle) {
+   EFI_FILE_IO_INTERFACE *Volume;
+   EFI_FILE_HANDLE       Root = NULL;
+
+   if (EFI_ERROR(BS->HandleProtocol(DeviceHandle, &FileSystemProtocol, (VOID **) &Volume)))
+      return NULL;
+   if (EFI_ERROR(Volume->OpenVolume(Volume, &Root)))
+      return NULL;
+   return Root;
+} // EFI_FILE_HANDLE LibOpenRoot()
+
+// Fetch information of type InfoType about FHand into a new pool buffer.
+static VOID *GetFileInfo(IN EFI_FILE_HANDLE FHand, IN EFI_GUID *InfoType) {
+   EFI_STATUS Status;
+   VOID       *Buffer;
+   UINTN      BufferSize = 256;
+
+   Buffer = AllocatePool(BufferSize);
+   if (Buffer == NULL)
+      return NULL;
+   Status = FHand->GetInfo(FHand, InfoType, &BufferSize, Buffer);
+   if (Status == EFI_BUFFER_TOO_SMALL) {
+      FreePool(Buffer);
+      Buffer = AllocatePool(BufferSize);
+      if (Buffer == NULL)
+         return NULL;
+      Status = FHand->GetInfo(FHand, InfoType, &BufferSize, Buffer);
+   }
+   if (EFI_ERROR(Status)) {
+      FreePool(Buffer);
+      return NULL;
+   }
+   return Buffer;
+} // static VOID *GetFileInfo()
+
+EFI_FILE_INFO *LibFileInfo(IN EFI_FILE_HANDLE FHand) {
+   return GetFileInfo(FHand, &GenericFileInfo);
+} // EFI_FILE_INFO *LibFileInfo()
+
+EFI_FILE_SYSTEM_INFO *LibFileSystemInfo(IN EFI_FILE_HANDLE FHand) {
+   return GetFileInfo(FHand, &FileSystemInfo);
+} // EFI_FILE_SYSTEM_INFO *LibFileSystemInfo()
+
+EFI_FILE_SYSTEM_VOLUME_LABEL *LibFileSystemVolumeLabelInfo(IN EFI_FILE_HANDLE FHand) {
+   return GetFileInfo(FHand, &FileSystemVolumeLabelInfo);
+} // EFI_FILE_SYSTEM_VOLUME_LABEL *LibFileSystemVolumeLabelInfo()
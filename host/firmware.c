@@ -0,0 +1,1241 @@
+/*
+ * host/firmware.c
+ * Mock boot services, runtime services, and text console
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Just enough firmware to run rEFInd's start-up on the build host:
+//
+// - Handles are kept in a simple array, each with a short list of protocols.
+// - Pool memory comes from malloc(), with a header so that HostStats can
+//   count what rEFInd allocates and frees. The mock's own bookkeeping uses
+//   malloc() directly, so it isn't counted.
+// - Time is the host's monotonic clock plus an offset. Waiting for a timer
+//   doesn't sleep; the clock is moved forward to the timer's deadline (and
+//   the time skipped is counted), so menu timeouts and pauses cost nothing.
+//   Short Stall()s really wait, since rEFInd times things with them.
+// - Key presses come from a script (see HostSetKeys()). Each key is "typed"
+//   only when rEFInd waits for (or checks) the keyboard event, so code that
+//   throws away stray keystrokes at start-up doesn't lose it.
+// - LoadImage() reads a PE file's header to tell drivers from applications.
+//   Starting a driver does nothing; starting an application, a reset, and
+//   waiting for input that the script won't provide all end the run, by a
+//   longjmp() to HostExitJump.
+// - Variables are kept in memory and start out empty.
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "host.h"
+
+HOST_STATS          HostStats;
+EFI_HANDLE          HostImageHandle = NULL;
+jmp_buf             HostExitJump;
+BOOLEAN             HostVerbose = FALSE;
+CHAR16              *HostLaunchedPath = NULL;
+
+//
+// Handles and protocols
+//
+
+#define HOST_HANDLE_SIGNATURE   EFI_SIGNATURE_32('h', 'n', 'd', 'l')
+#define HOST_MAX_PROTOCOLS      8
+
+typedef struct {
+   EFI_GUID   Guid;
+   VOID       *Interface;
+} HOST_PROTOCOL;
+
+typedef struct {
+   UINT32         Signature;
+   UINTN          ProtocolCount;
+   HOST_PROTOCOL  Protocols[HOST_MAX_PROTOCOLS];
+} HOST_HANDLE;
+
+static HOST_HANDLE  **Handles = NULL;
+static UINTN        HandleCount = 0;
+
+static HOST_HANDLE *FindHandle(IN EFI_HANDLE Handle) {
+   UINTN i;
+
+   for (i = 0; i < HandleCount; i++) {
+      if (Handles[i] == Handle)
+         return Handles[i];
+   }
+   return NULL;
+} // static HOST_HANDLE *FindHandle()
+
+static HOST_PROTOCOL *FindProtocol(IN HOST_HANDLE *Handle, IN EFI_GUID *Protocol) {
+   UINTN i;
+
+   for (i = 0; (Handle != NULL) && (i < Handle->ProtocolCount); i++) {
+      if (CompareGuid(&Handle->Protocols[i].Guid, Protocol) == 0)
+         return &Handle->Protocols[i];
+   }
+   return NULL;
+} // static HOST_PROTOCOL *FindProtocol()
+
+EFI_HANDLE HostCreateHandle(VOID) {
+   HOST_HANDLE *Handle = calloc(1, sizeof(HOST_HANDLE));
+
+   Handle->Signature = HOST_HANDLE_SIGNATURE;
+   Handles = realloc(Handles, (HandleCount + 1) * sizeof(HOST_HANDLE *));
+   Handles[HandleCount++] = Handle;
+   return Handle;
+} // EFI_HANDLE HostCreateHandle()
+
+static VOID DestroyHandle(IN HOST_HANDLE *Handle) {
+   UINTN i;
+
+   for (i = 0; i < HandleCount; i++) {
+      if (Handles[i] == Handle) {
+         Handles[i] = Handles[--HandleCount];
+         free(Handle);
+         return;
+      }
+   }
+} // static VOID DestroyHandle()
+
+EFI_STATUS HostInstallProtocol(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, IN VOID *Interface) {
+   HOST_HANDLE *Entry = FindHandle(Handle);
+
+   if ((Entry == NULL) || (Protocol == NULL))
+      return EFI_INVALID_PARAMETER;
+   if (FindProtocol(Entry, Protocol) != NULL)
+      return EFI_INVALID_PARAMETER;
+   if (Entry->ProtocolCount >= HOST_MAX_PROTOCOLS)
+      return EFI_OUT_OF_RESOURCES;
+   Entry->Protocols[Entry->ProtocolCount].Guid = *Protocol;
+   Entry->Protocols[Entry->ProtocolCount].Interface = Interface;
+   Entry->ProtocolCount++;
+   return EFI_SUCCESS;
+} // EFI_STATUS HostInstallProtocol()
+
+static EFI_STATUS EFIAPI InstallProtocolInterface(IN OUT EFI_HANDLE *Handle, IN EFI_GUID *Protocol,
+                                                  IN EFI_INTERFACE_TYPE InterfaceType, IN VOID *Interface) {
+   if (Handle == NULL)
+      return EFI_INVALID_PARAMETER;
+   if (*Handle == NULL)
+      *Handle = HostCreateHandle();
+   return HostInstallProtocol(*Handle, Protocol, Interface);
+} // static EFI_STATUS InstallProtocolInterface()
+
+static EFI_STATUS EFIAPI UninstallProtocolInterface(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, IN VOID *Interface) {
+   HOST_HANDLE   *Entry = FindHandle(Handle);
+   HOST_PROTOCOL *Found = FindProtocol(Entry, Protocol);
+
+   if ((Found == NULL) || (Found->Interface != Interface))
+      return EFI_NOT_FOUND;
+   *Found = Entry->Protocols[--Entry->ProtocolCount];
+   if (Entry->ProtocolCount == 0)
+      DestroyHandle(Entry);
+   return EFI_SUCCESS;
+} // static EFI_STATUS UninstallProtocolInterface()
+
+static EFI_STATUS EFIAPI ReinstallProtocolInterface(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol,
+                                                    IN VOID *OldInterface, IN VOID *NewInterface) {
+   HOST_PROTOCOL *Found = FindProtocol(FindHandle(Handle), Protocol);
+
+   if ((Found == NULL) || (Found->Interface != OldInterface))
+      return EFI_NOT_FOUND;
+   Found->Interface = NewInterface;
+   return EFI_SUCCESS;
+} // static EFI_STATUS ReinstallProtocolInterface()
+
+static EFI_STATUS EFIAPI HandleProtocol(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface) {
+   HOST_HANDLE   *Entry = FindHandle(Handle);
+   HOST_PROTOCOL *Found;
+
+   if ((Entry == NULL) || (Protocol == NULL) || (Interface == NULL))
+      return EFI_INVALID_PARAMETER;
+   Found = FindProtocol(Entry, Protocol);
+   if (Found == NULL) {
+      *Interface = NULL;
+      return EFI_UNSUPPORTED;
+   }
+   *Interface = Found->Interface;
+   return EFI_SUCCESS;
+} // static EFI_STATUS HandleProtocol()
+
+static EFI_STATUS EFIAPI OpenProtocol(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface OPTIONAL,
+                                      IN EFI_HANDLE AgentHandle, IN EFI_HANDLE ControllerHandle, IN UINT32 Attributes) {
+   VOID *Found;
+
+   if (Attributes == EFI_OPEN_PROTOCOL_TEST_PROTOCOL)
+      return HandleProtocol(Handle, Protocol, &Found);
+   return HandleProtocol(Handle, Protocol, Interface);
+} // static EFI_STATUS OpenProtocol()
+
+static EFI_STATUS EFIAPI CloseProtocol(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, IN EFI_HANDLE AgentHandle,
+                                       IN EFI_HANDLE ControllerHandle) {
+   return (FindProtocol(FindHandle(Handle), Protocol) == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+} // static EFI_STATUS CloseProtocol()
+
+// Nothing here tracks who has opened what, so there's never anything to report.
+static EFI_STATUS EFIAPI OpenProtocolInformation(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol,
+                                                 OUT EFI_OPEN_PROTOCOL_INFORMATION_ENTRY **EntryBuffer,
+                                                 OUT UINTN *EntryCount) {
+   if (FindProtocol(FindHandle(Handle), Protocol) == NULL)
+      return EFI_NOT_FOUND;
+   *EntryCount = 0;
+   *EntryBuffer = AllocatePool(sizeof(EFI_OPEN_PROTOCOL_INFORMATION_ENTRY));
+   return (*EntryBuffer == NULL) ? EFI_OUT_OF_RESOURCES : EFI_SUCCESS;
+} // static EFI_STATUS OpenProtocolInformation()
+
+static EFI_STATUS EFIAPI ProtocolsPerHandle(IN EFI_HANDLE Handle, OUT EFI_GUID ***ProtocolBuffer,
+                                            OUT UINTN *ProtocolBufferCount) {
+   HOST_HANDLE *Entry = FindHandle(Handle);
+   UINTN       i;
+
+   if (Entry == NULL)
+      return EFI_INVALID_PARAMETER;
+   *ProtocolBuffer = AllocatePool((Entry->ProtocolCount + 1) * sizeof(EFI_GUID *));
+   if (*ProtocolBuffer == NULL)
+      return EFI_OUT_OF_RESOURCES;
+   for (i = 0; i < Entry->ProtocolCount; i++)
+      (*ProtocolBuffer)[i] = &Entry->Protocols[i].Guid;
+   *ProtocolBufferCount = Entry->ProtocolCount;
+   return EFI_SUCCESS;
+} // static EFI_STATUS ProtocolsPerHandle()
+
+static BOOLEAN HandleMatches(IN HOST_HANDLE *Handle, IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol) {
+   return (SearchType == AllHandles) || ((SearchType == ByProtocol) && (FindProtocol(Handle, Protocol) != NULL));
+} // static BOOLEAN HandleMatches()
+
+static EFI_STATUS EFIAPI LocateHandle(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol OPTIONAL,
+                                      IN VOID *SearchKey OPTIONAL, IN OUT UINTN *BufferSize, OUT EFI_HANDLE *Buffer) {
+   UINTN i, Count = 0;
+
+   if ((BufferSize == NULL) || ((SearchType == ByProtocol) && (Protocol == NULL)))
+      return EFI_INVALID_PARAMETER;
+   if (SearchType == ByRegisterNotify)
+      return EFI_UNSUPPORTED;
+   for (i = 0; i < HandleCount; i++) {
+      if (HandleMatches(Handles[i], SearchType, Protocol)) {
+         if ((Buffer != NULL) && ((Count + 1) * sizeof(EFI_HANDLE) <= *BufferSize))
+            Buffer[Count] = Handles[i];
+         Count++;
+      }
+   }
+   if (Count == 0)
+      return EFI_NOT_FOUND;
+   if ((Buffer == NULL) || (Count * sizeof(EFI_HANDLE) > *BufferSize)) {
+      *BufferSize = Count * sizeof(EFI_HANDLE);
+      return EFI_BUFFER_TOO_SMALL;
+   }
+   *BufferSize = Count * sizeof(EFI_HANDLE);
+   return EFI_SUCCESS;
+} // static EFI_STATUS LocateHandle()
+
+static EFI_STATUS EFIAPI LocateHandleBuffer(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol OPTIONAL,
+                                            IN VOID *SearchKey OPTIONAL, IN OUT UINTN *NoHandles,
+                                            OUT EFI_HANDLE **Buffer) {
+   return LibLocateHandle(SearchType, Protocol, SearchKey, NoHandles, Buffer);
+} // static EFI_STATUS LocateHandleBuffer()
+
+static EFI_STATUS EFIAPI LocateProtocol(IN EFI_GUID *Protocol, IN VOID *Registration OPTIONAL, OUT VOID **Interface) {
+   UINTN         i;
+   HOST_PROTOCOL *Found;
+
+   for (i = 0; i < HandleCount; i++) {
+      Found = FindProtocol(Handles[i], Protocol);
+      if (Found != NULL) {
+         *Interface = Found->Interface;
+         return EFI_SUCCESS;
+      }
+   }
+   *Interface = NULL;
+   return EFI_NOT_FOUND;
+} // static EFI_STATUS LocateProtocol()
+
+// Find the handle with Protocol whose device path is the longest leading
+// part of *DevicePath, and advance *DevicePath past that part.
+static EFI_STATUS EFIAPI LocateDevicePath(IN EFI_GUID *Protocol, IN OUT EFI_DEVICE_PATH **DevicePath,
+                                          OUT EFI_HANDLE *Device) {
+   UINTN           i, Size, BestSize = 0;
+   EFI_DEVICE_PATH *HandlePath;
+   HOST_PROTOCOL   *Found;
+   HOST_HANDLE     *Best = NULL;
+
+   if ((DevicePath == NULL) || (*DevicePath == NULL) || (Device == NULL))
+      return EFI_INVALID_PARAMETER;
+   for (i = 0; i < HandleCount; i++) {
+      Found = FindProtocol(Handles[i], &DevicePathProtocol);
+      if ((Found == NULL) || (FindProtocol(Handles[i], Protocol) == NULL))
+         continue;
+      HandlePath = Found->Interface;
+      Size = DevicePathSize(HandlePath) - sizeof(EFI_DEVICE_PATH);
+      if ((Size >= BestSize) && (Size <= DevicePathSize(*DevicePath) - sizeof(EFI_DEVICE_PATH)) &&
+          (CompareMem(HandlePath, *DevicePath, Size) == 0)) {
+         Best = Handles[i];
+         BestSize = Size;
+      }
+   }
+   if (Best == NULL)
+      return EFI_NOT_FOUND;
+   *Device = Best;
+   *DevicePath = (EFI_DEVICE_PATH *) ((UINT8 *) *DevicePath + BestSize);
+   return EFI_SUCCESS;
+} // static EFI_STATUS LocateDevicePath()
+
+static EFI_STATUS EFIAPI InstallMultipleProtocolInterfaces(IN OUT EFI_HANDLE *Handle, ...) {
+   va_list    Args;
+   EFI_GUID   *Protocol;
+   EFI_STATUS Status = EFI_SUCCESS;
+
+   va_start(Args, Handle);
+   while (!EFI_ERROR(Status) && ((Protocol = va_arg(Args, EFI_GUID *)) != NULL))
+      Status = InstallProtocolInterface(Handle, Protocol, EFI_NATIVE_INTERFACE, va_arg(Args, VOID *));
+   va_end(Args);
+   return Status;
+} // static EFI_STATUS InstallMultipleProtocolInterfaces()
+
+static EFI_STATUS EFIAPI UninstallMultipleProtocolInterfaces(IN OUT EFI_HANDLE Handle, ...) {
+   va_list    Args;
+   EFI_GUID   *Protocol;
+   EFI_STATUS Status = EFI_SUCCESS;
+
+   va_start(Args, Handle);
+   while (!EFI_ERROR(Status) && ((Protocol = va_arg(Args, EFI_GUID *)) != NULL))
+      Status = UninstallProtocolInterface(Handle, Protocol, va_arg(Args, VOID *));
+   va_end(Args);
+   return Status;
+} // static EFI_STATUS UninstallMultipleProtocolInterfaces()
+
+// No drivers are ever really started, so there's never anything to connect.
+static EFI_STATUS EFIAPI ConnectController(IN EFI_HANDLE ControllerHandle, IN EFI_HANDLE *DriverImageHandle OPTIONAL,
+                                           IN EFI_DEVICE_PATH *RemainingDevicePath OPTIONAL, IN BOOLEAN Recursive) {
+   return (FindHandle(ControllerHandle) == NULL) ? EFI_INVALID_PARAMETER : EFI_NOT_FOUND;
+} // static EFI_STATUS ConnectController()
+
+static EFI_STATUS EFIAPI DisconnectController(IN EFI_HANDLE ControllerHandle, IN EFI_HANDLE DriverImageHandle OPTIONAL,
+                                              IN EFI_HANDLE ChildHandle OPTIONAL) {
+   return (FindHandle(ControllerHandle) == NULL) ? EFI_INVALID_PARAMETER : EFI_SUCCESS;
+} // static EFI_STATUS DisconnectController()
+
+static EFI_STATUS EFIAPI RegisterProtocolNotify(IN EFI_GUID *Protocol, IN EFI_EVENT Event, OUT VOID **Registration) {
+   return EFI_UNSUPPORTED;
+} // static EFI_STATUS RegisterProtocolNotify()
+
+static EFI_STATUS EFIAPI InstallConfigurationTable(IN EFI_GUID *Guid, IN VOID *Table) {
+   return EFI_UNSUPPORTED;
+} // static EFI_STATUS InstallConfigurationTable()
+
+//
+// Memory
+//
+
+#define POOL_SIGNATURE  EFI_SIGNATURE_32('p', 'o', 'o', 'l')
+
+// Put before each pool allocation; its size keeps the memory that follows
+// aligned as malloc()'s is.
+typedef struct {
+   UINT64   Signature;
+   UINT64   Size;
+} POOL_HEADER;
+
+static EFI_STATUS EFIAPI MockAllocatePool(IN EFI_MEMORY_TYPE PoolType, IN UINTN Size, OUT VOID **Buffer) {
+   POOL_HEADER *Header;
+
+   if (Buffer == NULL)
+      return EFI_INVALID_PARAMETER;
+   Header = malloc(sizeof(POOL_HEADER) + Size);
+   if (Header == NULL) {
+      *Buffer = NULL;
+      return EFI_OUT_OF_RESOURCES;
+   }
+   Header->Signature = POOL_SIGNATURE;
+   Header->Size = Size;
+   HostStats.PoolAllocations++;
+   HostStats.PoolBytes += Size;
+   HostStats.PoolLive += Size;
+   if (HostStats.PoolLive > HostStats.PoolPeak)
+      HostStats.PoolPeak = HostStats.PoolLive;
+   *Buffer = Header + 1;
+   return EFI_SUCCESS;
+} // static EFI_STATUS MockAllocatePool()
+
+static EFI_STATUS EFIAPI MockFreePool(IN VOID *Buffer) {
+   POOL_HEADER *Header;
+
+   if (Buffer == NULL)
+      return EFI_INVALID_PARAMETER;
+   Header = (POOL_HEADER *) Buffer - 1;
+   if (Header->Signature != POOL_SIGNATURE) {
+      // Real firmware would corrupt its pool (or hang); stop here instead.
+      fprintf(stderr, "FreePool() of memory that isn't pool memory, at %p\n", Buffer);
+      abort();
+   }
+   Header->Signature = 0;
+   HostStats.PoolFrees++;
+   HostStats.PoolLive -= Header->Size;
+   free(Header);
+   return EFI_SUCCESS;
+} // static EFI_STATUS MockFreePool()
+
+static EFI_STATUS EFIAPI AllocatePages(IN EFI_ALLOCATE_TYPE Type, IN EFI_MEMORY_TYPE MemoryType,
+                                       IN UINTN NoPages, OUT EFI_PHYSICAL_ADDRESS *Memory) {
+   VOID *Buffer;
+
+   if (Type == AllocateAddress)
+      return EFI_NOT_FOUND;
+   if (posix_memalign(&Buffer, EFI_PAGE_SIZE, NoPages * EFI_PAGE_SIZE) != 0)
+      return EFI_OUT_OF_RESOURCES;
+   HostStats.PageAllocations++;
+   *Memory = (EFI_PHYSICAL_ADDRESS) (UINTN) Buffer;
+   return EFI_SUCCESS;
+} // static EFI_STATUS AllocatePages()
+
+static EFI_STATUS EFIAPI FreePages(IN EFI_PHYSICAL_ADDRESS Memory, IN UINTN NoPages) {
+   free((VOID *) (UINTN) Memory);
+   return EFI_SUCCESS;
+} // static EFI_STATUS FreePages()
+
+static EFI_STATUS EFIAPI GetMemoryMap(IN OUT UINTN *MemoryMapSize, IN OUT EFI_MEMORY_DESCRIPTOR *MemoryMap,
+                                      OUT UINTN *MapKey, OUT UINTN *DescriptorSize, OUT UINT32 *DescriptorVersion) {
+   return EFI_UNSUPPORTED;
+} // static EFI_STATUS GetMemoryMap()
+
+static VOID EFIAPI MockCopyMem(IN VOID *Destination, IN VOID *Source, IN UINTN Length) {
+   memmove(Destination, Source, Length);
+} // static VOID MockCopyMem()
+
+static VOID EFIAPI MockSetMem(IN VOID *Buffer, IN UINTN Size, IN UINT8 Value) {
+   memset(Buffer, Value, Size);
+} // static VOID MockSetMem()
+
+static EFI_STATUS EFIAPI CalculateCrc32(IN VOID *Data, IN UINTN DataSize, OUT UINT32 *Crc32) {
+   UINT32 Crc = 0xFFFFFFFF;
+   UINT8  *Bytes = Data;
+   UINTN  i, Bit;
+
+   if ((Data == NULL) || (Crc32 == NULL) || (DataSize == 0))
+      return EFI_INVALID_PARAMETER;
+   for (i = 0; i < DataSize; i++) {
+      Crc ^= Bytes[i];
+      for (Bit = 0; Bit < 8; Bit++)
+         Crc = (Crc >> 1) ^ (0xEDB88320 & -(Crc & 1));
+   }
+   *Crc32 = ~Crc;
+   return EFI_SUCCESS;
+} // static EFI_STATUS CalculateCrc32()
+
+//
+// Time and events
+//
+
+static UINT64 ClockOffset = 0;   // microseconds skipped
+
+// The firmware's clock, in microseconds
+UINT64 HostNow(VOID) {
+   struct timespec Now;
+
+   clock_gettime(CLOCK_MONOTONIC, &Now);
+   return (UINT64) Now.tv_sec * 1000000 + Now.tv_nsec / 1000 + ClockOffset;
+} // UINT64 HostNow()
+
+static VOID SkipTime(IN UINT64 Microseconds) {
+   ClockOffset += Microseconds;
+   HostStats.SkippedUs += Microseconds;
+} // static VOID SkipTime()
+
+#define HOST_EVENT_SIGNATURE    EFI_SIGNATURE_32('e', 'v', 'n', 't')
+
+typedef struct {
+   UINT32            Signature;
+   UINT32            Type;
+   BOOLEAN           Signalled;
+   BOOLEAN           IsKeyEvent;  // the keyboard's WaitForKey
+   EFI_TIMER_DELAY   TimerType;   // TimerCancel if no timer is set
+   UINT64            Deadline;
+   UINT64            Period;
+} HOST_EVENT;
+
+static HOST_EVENT **Events = NULL;
+static UINTN      EventCount = 0;
+
+static VOID AddEvent(IN HOST_EVENT *Event) {
+   Events = realloc(Events, (EventCount + 1) * sizeof(HOST_EVENT *));
+   Events[EventCount++] = Event;
+} // static VOID AddEvent()
+
+static EFI_STATUS EFIAPI CreateEvent(IN UINT32 Type, IN EFI_TPL NotifyTpl, IN EFI_EVENT_NOTIFY NotifyFunction,
+                                     IN VOID *NotifyContext, OUT EFI_EVENT *Event) {
+   HOST_EVENT *NewEvent;
+
+   if (Event == NULL)
+      return EFI_INVALID_PARAMETER;
+   // Notification functions would need a scheduler, and rEFInd has none.
+   if (NotifyFunction != NULL)
+      return EFI_UNSUPPORTED;
+   NewEvent = calloc(1, sizeof(HOST_EVENT));
+   NewEvent->Signature = HOST_EVENT_SIGNATURE;
+   NewEvent->Type = Type;
+   NewEvent->TimerType = TimerCancel;
+   AddEvent(NewEvent);
+   *Event = NewEvent;
+   return EFI_SUCCESS;
+} // static EFI_STATUS CreateEvent()
+
+static EFI_STATUS EFIAPI CreateEventEx(IN UINT32 Type, IN EFI_TPL NotifyTpl, IN EFI_EVENT_NOTIFY NotifyFunction OPTIONAL,
+                                       IN const VOID *NotifyContext OPTIONAL, IN const EFI_GUID *EventGroup OPTIONAL,
+                                       OUT EFI_EVENT *Event) {
+   if (EventGroup != NULL)
+      return EFI_UNSUPPORTED;
+   return CreateEvent(Type, NotifyTpl, NotifyFunction, (VOID *) NotifyContext, Event);
+} // static EFI_STATUS CreateEventEx()
+
+// Returns the event, or NULL if Event isn't one. Events are looked up, rather
+// than their signatures checked, since rEFInd sometimes closes an event that
+// it never created (that is, an uninitialized variable).
+static HOST_EVENT *CheckedEvent(IN EFI_EVENT Event) {
+   UINTN i;
+
+   for (i = 0; i < EventCount; i++) {
+      if (Events[i] == Event)
+         return Events[i];
+   }
+   return NULL;
+} // static HOST_EVENT *CheckedEvent()
+
+static EFI_STATUS EFIAPI CloseEvent(IN EFI_EVENT Event) {
+   HOST_EVENT *Closing = CheckedEvent(Event);
+   UINTN      i;
+
+   if ((Closing == NULL) || Closing->IsKeyEvent)
+      return EFI_INVALID_PARAMETER;
+   for (i = 0; Events[i] != Closing; i++)
+      ;
+   Events[i] = Events[--EventCount];
+   Closing->Signature = 0;
+   free(Closing);
+   return EFI_SUCCESS;
+} // static EFI_STATUS CloseEvent()
+
+static EFI_STATUS EFIAPI SetTimer(IN EFI_EVENT Event, IN EFI_TIMER_DELAY Type, IN UINT64 TriggerTime) {
+   HOST_EVENT *Timer = CheckedEvent(Event);
+
+   if ((Timer == NULL) || !(Timer->Type & EVT_TIMER))
+      return EFI_INVALID_PARAMETER;
+   Timer->TimerType = Type;
+   Timer->Signalled = FALSE;
+   // TriggerTime is in units of 100ns
+   Timer->Period = TriggerTime / 10;
+   Timer->Deadline = HostNow() + Timer->Period;
+   return EFI_SUCCESS;
+} // static EFI_STATUS SetTimer()
+
+static EFI_STATUS EFIAPI SignalEvent(IN EFI_EVENT Event) {
+   HOST_EVENT *Signalled = CheckedEvent(Event);
+
+   if (Signalled == NULL)
+      return EFI_INVALID_PARAMETER;
+   Signalled->Signalled = TRUE;
+   return EFI_SUCCESS;
+} // static EFI_STATUS SignalEvent()
+
+static BOOLEAN KeyboardWaited(VOID);
+
+// Returns TRUE if Event is signalled (and, unless it's the keyboard's event,
+// clears it).
+static BOOLEAN TakeEvent(IN HOST_EVENT *Event) {
+   if (Event->IsKeyEvent)
+      return KeyboardWaited();
+   if ((Event->TimerType != TimerCancel) && (HostNow() >= Event->Deadline)) {
+      Event->Signalled = TRUE;
+      if (Event->TimerType == TimerPeriodic)
+         Event->Deadline += (Event->Period > 0) ? Event->Period : 1;
+      else
+         Event->TimerType = TimerCancel;
+   }
+   if (Event->Signalled) {
+      Event->Signalled = FALSE;
+      return TRUE;
+   }
+   return FALSE;
+} // static BOOLEAN TakeEvent()
+
+static EFI_STATUS EFIAPI CheckEvent(IN EFI_EVENT Event) {
+   HOST_EVENT *Checked = CheckedEvent(Event);
+
+   if (Checked == NULL)
+      return EFI_INVALID_PARAMETER;
+   return TakeEvent(Checked) ? EFI_SUCCESS : EFI_NOT_READY;
+} // static EFI_STATUS CheckEvent()
+
+static EFI_STATUS EFIAPI WaitForEvent(IN UINTN NumberOfEvents, IN EFI_EVENT *Event, OUT UINTN *Index) {
+   UINTN      i;
+   UINT64     Now, Earliest;
+   HOST_EVENT *Waited;
+
+   if ((NumberOfEvents == 0) || (Event == NULL) || (Index == NULL))
+      return EFI_INVALID_PARAMETER;
+   for (;;) {
+      Earliest = (UINT64) -1;
+      for (i = 0; i < NumberOfEvents; i++) {
+         Waited = CheckedEvent(Event[i]);
+         if (Waited == NULL) {
+            *Index = i;
+            return EFI_INVALID_PARAMETER;
+         }
+         if (TakeEvent(Waited)) {
+            *Index = i;
+            return EFI_SUCCESS;
+         }
+         if ((Waited->TimerType != TimerCancel) && (Waited->Deadline < Earliest))
+            Earliest = Waited->Deadline;
+      } // for
+
+      // Nothing's ready. Jump ahead to the next timer, if there is one; if
+      // not, nothing will ever happen.
+      if (Earliest == (UINT64) -1)
+         longjmp(HostExitJump, HOST_EXIT_IDLE);
+      Now = HostNow();
+      if (Earliest > Now)
+         SkipTime(Earliest - Now);
+   } // for
+} // static EFI_STATUS WaitForEvent()
+
+static EFI_STATUS EFIAPI Stall(IN UINTN Microseconds) {
+   struct timespec Delay;
+
+   HostStats.StalledUs += Microseconds;
+   if (Microseconds > HOST_STALL_LIMIT) {
+      SkipTime(Microseconds);
+   } else {
+      Delay.tv_sec = 0;
+      Delay.tv_nsec = Microseconds * 1000;
+      nanosleep(&Delay, NULL);
+   }
+   return EFI_SUCCESS;
+} // static EFI_STATUS Stall()
+
+static EFI_STATUS EFIAPI SetWatchdogTimer(IN UINTN Timeout, IN UINT64 WatchdogCode, IN UINTN DataSize,
+                                          IN CHAR16 *WatchdogData OPTIONAL) {
+   return EFI_SUCCESS;
+} // static EFI_STATUS SetWatchdogTimer()
+
+static EFI_STATUS EFIAPI GetNextMonotonicCount(OUT UINT64 *Count) {
+   static UINT64 Counter = 0;
+
+   if (Count == NULL)
+      return EFI_INVALID_PARAMETER;
+   *Count = Counter++;
+   return EFI_SUCCESS;
+} // static EFI_STATUS GetNextMonotonicCount()
+
+static EFI_TPL CurrentTpl = TPL_APPLICATION;
+
+static EFI_TPL EFIAPI RaiseTPL(IN EFI_TPL NewTpl) {
+   EFI_TPL OldTpl = CurrentTpl;
+
+   CurrentTpl = NewTpl;
+   return OldTpl;
+} // static EFI_TPL RaiseTPL()
+
+static VOID EFIAPI RestoreTPL(IN EFI_TPL OldTpl) {
+   CurrentTpl = OldTpl;
+} // static VOID RestoreTPL()
+
+//
+// Images
+//
+
+#define HOST_IMAGE_SIGNATURE    EFI_SIGNATURE_32('i', 'm', 'g', 'e')
+
+typedef struct {
+   UINT32            Signature;
+   EFI_LOADED_IMAGE  LoadedImage;
+   CHAR16            *Path;         // for reports
+   BOOLEAN           IsDriver;
+} HOST_IMAGE;
+
+// PE subsystems of boot service and runtime drivers
+#define PE_SUBSYSTEM_BOOT_DRIVER        11
+#define PE_SUBSYSTEM_RUNTIME_DRIVER     12
+
+// Returns the PE subsystem of the image in Data, or 0 if it isn't one.
+static UINT16 ImageSubsystem(IN UINT8 *Data, IN UINTN Size) {
+   UINT32 PeOffset;
+
+   if ((Data == NULL) || (Size < 0x40) || (Data[0] != 'M') || (Data[1] != 'Z'))
+      return 0;
+   PeOffset = Data[0x3c] | (Data[0x3d] << 8) | (Data[0x3e] << 16) | ((UINT32) Data[0x3f] << 24);
+   // Signature (4 bytes), COFF header (20), and optional header up to and
+   // including Subsystem (70), which is at the same place in PE32 and PE32+
+   if (((UINT64) PeOffset + 4 + 20 + 70 > Size) || (CompareMem(Data + PeOffset, "PE\0\0", 4) != 0))
+      return 0;
+   return Data[PeOffset + 4 + 20 + 68] | (Data[PeOffset + 4 + 20 + 69] << 8);
+} // static UINT16 ImageSubsystem()
+
+// Returns the file name in the file path nodes that begin FilePath, as a
+// malloc()ed string.
+static CHAR16 *FilePathName(IN EFI_DEVICE_PATH *FilePath) {
+   CHAR16 *Name = calloc(1, sizeof(CHAR16));
+   UINTN  Length = 0, NodeLength;
+
+   while ((FilePath != NULL) && (DevicePathType(FilePath) == MEDIA_DEVICE_PATH) &&
+          (DevicePathSubType(FilePath) == MEDIA_FILEPATH_DP)) {
+      NodeLength = StrLen(((FILEPATH_DEVICE_PATH *) FilePath)->PathName);
+      Name = realloc(Name, (Length + NodeLength + 1) * sizeof(CHAR16));
+      CopyMem(Name + Length, ((FILEPATH_DEVICE_PATH *) FilePath)->PathName, NodeLength * sizeof(CHAR16));
+      Length += NodeLength;
+      Name[Length] = 0;
+      FilePath = NextDevicePathNode(FilePath);
+   }
+   return Name;
+} // static CHAR16 *FilePathName()
+
+static EFI_STATUS EFIAPI LoadImage(IN BOOLEAN BootPolicy, IN EFI_HANDLE ParentImageHandle,
+                                   IN EFI_DEVICE_PATH *FilePath, IN VOID *SourceBuffer OPTIONAL,
+                                   IN UINTN SourceSize, OUT EFI_HANDLE *ImageHandle) {
+   EFI_STATUS      Status;
+   EFI_DEVICE_PATH *Remaining = FilePath;
+   EFI_HANDLE      Device = NULL;
+   HOST_IMAGE      *Image;
+   VOID            *Data = SourceBuffer;
+   UINTN           Size = SourceSize;
+   CHAR16          *Name;
+   UINT16          Subsystem;
+
+   if (ImageHandle == NULL)
+      return EFI_INVALID_PARAMETER;
+   if ((FilePath != NULL) && EFI_ERROR(LocateDevicePath(&FileSystemProtocol, &Remaining, &Device)))
+      Remaining = FilePath;
+   Name = FilePathName(Remaining);
+   if (SourceBuffer == NULL) {
+      if (Device == NULL) {
+         free(Name);
+         return EFI_NOT_FOUND;
+      }
+      Status = HostReadFile(Device, Name, &Data, &Size);
+      if (EFI_ERROR(Status)) {
+         free(Name);
+         return Status;
+      }
+   }
+   Subsystem = ImageSubsystem(Data, Size);
+   if (Data != SourceBuffer)
+      free(Data);
+   if (Subsystem == 0) {
+      free(Name);
+      return EFI_LOAD_ERROR;
+   }
+
+   Image = calloc(1, sizeof(HOST_IMAGE));
+   Image->Signature = HOST_IMAGE_SIGNATURE;
+   Image->Path = Name;
+   Image->IsDriver = (Subsystem == PE_SUBSYSTEM_BOOT_DRIVER) || (Subsystem == PE_SUBSYSTEM_RUNTIME_DRIVER);
+   Image->LoadedImage.Revision = EFI_IMAGE_INFORMATION_REVISION;
+   Image->LoadedImage.ParentHandle = ParentImageHandle;
+   Image->LoadedImage.SystemTable = &HostSystemTable;
+   Image->LoadedImage.DeviceHandle = Device;
+   Image->LoadedImage.FilePath = Remaining;
+   Image->LoadedImage.ImageSize = Size;
+   Image->LoadedImage.ImageCodeType = EfiLoaderCode;
+   Image->LoadedImage.ImageDataType = EfiLoaderData;
+   *ImageHandle = HostCreateHandle();
+   HostInstallProtocol(*ImageHandle, &LoadedImageProtocol, &Image->LoadedImage);
+   return EFI_SUCCESS;
+} // static EFI_STATUS LoadImage()
+
+static HOST_IMAGE *FindImage(IN EFI_HANDLE ImageHandle) {
+   HOST_PROTOCOL *Found = FindProtocol(FindHandle(ImageHandle), &LoadedImageProtocol);
+   HOST_IMAGE    *Image;
+
+   if (Found == NULL)
+      return NULL;
+   Image = (HOST_IMAGE *) ((UINT8 *) Found->Interface - offsetof(HOST_IMAGE, LoadedImage));
+   return (Image->Signature == HOST_IMAGE_SIGNATURE) ? Image : NULL;
+} // static HOST_IMAGE *FindImage()
+
+// Starting a driver succeeds without doing anything. Starting anything else
+// is as far as the run goes.
+static EFI_STATUS EFIAPI StartImage(IN EFI_HANDLE ImageHandle, OUT UINTN *ExitDataSize,
+                                    OUT CHAR16 **ExitData OPTIONAL) {
+   HOST_IMAGE *Image = FindImage(ImageHandle);
+
+   if (Image == NULL)
+      return EFI_INVALID_PARAMETER;
+   if (Image->IsDriver)
+      return EFI_SUCCESS;
+   HostLaunchedPath = Image->Path;
+   longjmp(HostExitJump, HOST_EXIT_LAUNCH);
+} // static EFI_STATUS StartImage()
+
+static EFI_STATUS EFIAPI UnloadImage(IN EFI_HANDLE ImageHandle) {
+   HOST_IMAGE *Image = FindImage(ImageHandle);
+
+   if (Image == NULL)
+      return EFI_INVALID_PARAMETER;
+   UninstallProtocolInterface(ImageHandle, &LoadedImageProtocol, &Image->LoadedImage);
+   free(Image->Path);
+   Image->Signature = 0;
+   free(Image);
+   return EFI_SUCCESS;
+} // static EFI_STATUS UnloadImage()
+
+static EFI_STATUS EFIAPI Exit(IN EFI_HANDLE ImageHandle, IN EFI_STATUS ExitStatus, IN UINTN ExitDataSize,
+                              IN CHAR16 *ExitData OPTIONAL) {
+   if (ImageHandle == HostImageHandle)
+      longjmp(HostExitJump, HOST_EXIT_RETURN);
+   return UnloadImage(ImageHandle);
+} // static EFI_STATUS Exit()
+
+static EFI_STATUS EFIAPI ExitBootServices(IN EFI_HANDLE ImageHandle, IN UINTN MapKey) {
+   return EFI_INVALID_PARAMETER;
+} // static EFI_STATUS ExitBootServices()
+
+// Make the image that efi_main() is called for, as if it had been loaded
+// from Path on DeviceHandle.
+VOID HostSetSelf(IN EFI_HANDLE DeviceHandle, IN CHAR16 *Path) {
+   HOST_IMAGE           *Image = calloc(1, sizeof(HOST_IMAGE));
+   UINTN                Size = StrSize(Path);
+   FILEPATH_DEVICE_PATH *FilePath = calloc(1, SIZE_OF_FILEPATH_DEVICE_PATH + Size + sizeof(EFI_DEVICE_PATH));
+
+   FilePath->Header.Type = MEDIA_DEVICE_PATH;
+   FilePath->Header.SubType = MEDIA_FILEPATH_DP;
+   SetDevicePathNodeLength(&FilePath->Header, SIZE_OF_FILEPATH_DEVICE_PATH + Size);
+   CopyMem(FilePath->PathName, Path, Size);
+   SetDevicePathEndNode(NextDevicePathNode(&FilePath->Header));
+
+   Image->Signature = HOST_IMAGE_SIGNATURE;
+   Image->Path = calloc(1, Size);
+   CopyMem(Image->Path, Path, Size);
+   Image->LoadedImage.Revision = EFI_IMAGE_INFORMATION_REVISION;
+   Image->LoadedImage.SystemTable = &HostSystemTable;
+   Image->LoadedImage.DeviceHandle = DeviceHandle;
+   Image->LoadedImage.FilePath = &FilePath->Header;
+   Image->LoadedImage.ImageCodeType = EfiLoaderCode;
+   Image->LoadedImage.ImageDataType = EfiLoaderData;
+   HostImageHandle = HostCreateHandle();
+   HostInstallProtocol(HostImageHandle, &LoadedImageProtocol, &Image->LoadedImage);
+} // VOID HostSetSelf()
+
+//
+// Runtime services
+//
+
+typedef struct HOST_VARIABLE {
+   struct HOST_VARIABLE *Next;
+   CHAR16               *Name;
+   EFI_GUID             Guid;
+   UINT32               Attributes;
+   UINTN                Size;
+   UINT8                *Data;
+} HOST_VARIABLE;
+
+static HOST_VARIABLE *Variables = NULL;
+
+static HOST_VARIABLE **FindVariable(IN CHAR16 *Name, IN EFI_GUID *Guid) {
+   HOST_VARIABLE **Variable;
+
+   for (Variable = &Variables; *Variable != NULL; Variable = &(*Variable)->Next) {
+      if ((StrCmp((*Variable)->Name, Name) == 0) && (CompareGuid(&(*Variable)->Guid, Guid) == 0))
+         break;
+   }
+   return Variable;
+} // static HOST_VARIABLE **FindVariable()
+
+static EFI_STATUS EFIAPI GetVariable(IN CHAR16 *VariableName, IN EFI_GUID *VendorGuid, OUT UINT32 *Attributes OPTIONAL,
+                                     IN OUT UINTN *DataSize, OUT VOID *Data) {
+   HOST_VARIABLE *Variable;
+
+   if ((VariableName == NULL) || (VendorGuid == NULL) || (DataSize == NULL))
+      return EFI_INVALID_PARAMETER;
+   Variable = *FindVariable(VariableName, VendorGuid);
+   if (Variable == NULL)
+      return EFI_NOT_FOUND;
+   if (Attributes != NULL)
+      *Attributes = Variable->Attributes;
+   if ((*DataSize < Variable->Size) || (Data == NULL)) {
+      *DataSize = Variable->Size;
+      return EFI_BUFFER_TOO_SMALL;
+   }
+   *DataSize = Variable->Size;
+   CopyMem(Data, Variable->Data, Variable->Size);
+   return EFI_SUCCESS;
+} // static EFI_STATUS GetVariable()
+
+static EFI_STATUS EFIAPI SetVariable(IN CHAR16 *VariableName, IN EFI_GUID *VendorGuid, IN UINT32 Attributes,
+                                     IN UINTN DataSize, IN VOID *Data) {
+   HOST_VARIABLE **Found, *Variable;
+
+   if ((VariableName == NULL) || (VariableName[0] == 0) || (VendorGuid == NULL) || ((DataSize > 0) && (Data == NULL)))
+      return EFI_INVALID_PARAMETER;
+   Found = FindVariable(VariableName, VendorGuid);
+   Variable = *Found;
+   if ((DataSize == 0) || (Attributes == 0)) {
+      if (Variable == NULL)
+         return EFI_NOT_FOUND;
+      *Found = Variable->Next;
+      free(Variable->Name);
+      free(Variable->Data);
+      free(Variable);
+      return EFI_SUCCESS;
+   }
+   if (Variable == NULL) {
+      Variable = calloc(1, sizeof(HOST_VARIABLE));
+      Variable->Name = calloc(1, StrSize(VariableName));
+      StrCpy(Variable->Name, VariableName);
+      Variable->Guid = *VendorGuid;
+      *Found = Variable;
+   }
+   Variable->Attributes = Attributes;
+   Variable->Data = realloc(Variable->Data, DataSize);
+   CopyMem(Variable->Data, Data, DataSize);
+   Variable->Size = DataSize;
+   return EFI_SUCCESS;
+} // static EFI_STATUS SetVariable()
+
+static EFI_STATUS EFIAPI GetNextVariableName(IN OUT UINTN *VariableNameSize, IN OUT CHAR16 *VariableName,
+                                             IN OUT EFI_GUID *VendorGuid) {
+   HOST_VARIABLE *Variable = Variables;
+
+   if ((VariableNameSize == NULL) || (VariableName == NULL) || (VendorGuid == NULL))
+      return EFI_INVALID_PARAMETER;
+   if (VariableName[0] != 0) {
+      Variable = *FindVariable(VariableName, VendorGuid);
+      if (Variable == NULL)
+         return EFI_INVALID_PARAMETER;
+      Variable = Variable->Next;
+   }
+   if (Variable == NULL)
+      return EFI_NOT_FOUND;
+   if (*VariableNameSize < StrSize(Variable->Name)) {
+      *VariableNameSize = StrSize(Variable->Name);
+      return EFI_BUFFER_TOO_SMALL;
+   }
+   StrCpy(VariableName, Variable->Name);
+   *VendorGuid = Variable->Guid;
+   return EFI_SUCCESS;
+} // static EFI_STATUS GetNextVariableName()
+
+static EFI_STATUS EFIAPI GetTime(OUT EFI_TIME *Time, OUT EFI_TIME_CAPABILITIES *Capabilities OPTIONAL) {
+   time_t    Now = time(NULL);
+   struct tm Local;
+
+   if (Time == NULL)
+      return EFI_INVALID_PARAMETER;
+   localtime_r(&Now, &Local);
+   ZeroMem(Time, sizeof(EFI_TIME));
+   Time->Year = Local.tm_year + 1900;
+   Time->Month = Local.tm_mon + 1;
+   Time->Day = Local.tm_mday;
+   Time->Hour = Local.tm_hour;
+   Time->Minute = Local.tm_min;
+   Time->Second = Local.tm_sec;
+   Time->TimeZone = 2047;   // EFI_UNSPECIFIED_TIMEZONE
+   if (Capabilities != NULL) {
+      Capabilities->Resolution = 1;
+      Capabilities->Accuracy = 50000000;
+      Capabilities->SetsToZero = FALSE;
+   }
+   return EFI_SUCCESS;
+} // static EFI_STATUS GetTime()
+
+static EFI_STATUS EFIAPI SetTime(IN EFI_TIME *Time) {
+   return EFI_UNSUPPORTED;
+} // static EFI_STATUS SetTime()
+
+static EFI_STATUS EFIAPI GetWakeupTime(OUT BOOLEAN *Enabled, OUT BOOLEAN *Pending, OUT EFI_TIME *Time) {
+   return EFI_UNSUPPORTED;
+} // static EFI_STATUS GetWakeupTime()
+
+static EFI_STATUS EFIAPI SetWakeupTime(IN BOOLEAN Enable, IN EFI_TIME *Time OPTIONAL) {
+   return EFI_UNSUPPORTED;
+} // static EFI_STATUS SetWakeupTime()
+
+static EFI_STATUS EFIAPI GetNextHighMonotonicCount(OUT UINT32 *HighCount) {
+   if (HighCount == NULL)
+      return EFI_INVALID_PARAMETER;
+   *HighCount = 0;
+   return EFI_SUCCESS;
+} // static EFI_STATUS GetNextHighMonotonicCount()
+
+static VOID EFIAPI ResetSystem(IN EFI_RESET_TYPE ResetType, IN EFI_STATUS ResetStatus, IN UINTN DataSize,
+                               IN CHAR16 *ResetData OPTIONAL) {
+   longjmp(HostExitJump, HOST_EXIT_RESET);
+} // static VOID ResetSystem()
+
+//
+// Text console
+//
+
+// Keys yet to be typed, and whether the first has been typed (that is,
+// rEFInd has waited for it but not yet read it)
+static EFI_INPUT_KEY *Keys = NULL;
+static UINTN         KeyCount = 0;
+static BOOLEAN       KeyTyped = FALSE;
+
+static const struct {
+   const char  *Name;
+   UINT16      ScanCode;
+   CHAR16      UnicodeChar;
+} KeyNames[] = {
+   { "enter", SCAN_NULL, CHAR_CARRIAGE_RETURN },
+   { "esc", SCAN_ESC, 0 },
+   { "tab", SCAN_NULL, CHAR_TAB },
+   { "backspace", SCAN_NULL, CHAR_BACKSPACE },
+   { "space", SCAN_NULL, L' ' },
+   { "comma", SCAN_NULL, L',' },
+   { "up", SCAN_UP, 0 },
+   { "down", SCAN_DOWN, 0 },
+   { "left", SCAN_LEFT, 0 },
+   { "right", SCAN_RIGHT, 0 },
+   { "home", SCAN_HOME, 0 },
+   { "end", SCAN_END, 0 },
+   { "insert", SCAN_INSERT, 0 },
+   { "delete", SCAN_DELETE, 0 },
+   { "pageup", SCAN_PAGE_UP, 0 },
+   { "pagedown", SCAN_PAGE_DOWN, 0 },
+   { "f1", SCAN_F1, 0 }, { "f2", SCAN_F2, 0 }, { "f3", SCAN_F3, 0 }, { "f4", SCAN_F4, 0 },
+   { "f5", SCAN_F5, 0 }, { "f6", SCAN_F6, 0 }, { "f7", SCAN_F7, 0 }, { "f8", SCAN_F8, 0 },
+   { "f9", SCAN_F9, 0 }, { "f10", SCAN_F10, 0 }, { "f11", SCAN_F11, 0 }, { "f12", SCAN_F12, 0 },
+   { NULL, 0, 0 }
+};
+
+// Set the keys to be typed: a comma-separated list of key names (as in
+// KeyNames[]) and single characters. Returns FALSE if a name isn't known.
+BOOLEAN HostSetKeys(IN const char *KeyList) {
+   char    *List = strdup(KeyList), *Name, *Saved = NULL;
+   UINTN   i;
+   BOOLEAN Known = TRUE;
+
+   KeyCount = 0;
+   KeyTyped = FALSE;
+   for (Name = strtok_r(List, ",", &Saved); Known && (Name != NULL); Name = strtok_r(NULL, ",", &Saved)) {
+      Keys = realloc(Keys, (KeyCount + 1) * sizeof(EFI_INPUT_KEY));
+      if (strlen(Name) == 1) {
+         Keys[KeyCount].ScanCode = SCAN_NULL;
+         Keys[KeyCount].UnicodeChar = (CHAR16) Name[0];
+      } else {
+         for (i = 0; (KeyNames[i].Name != NULL) && (strcasecmp(KeyNames[i].Name, Name) != 0); i++)
+            ;
+         Known = (KeyNames[i].Name != NULL);
+         Keys[KeyCount].ScanCode = KeyNames[i].ScanCode;
+         Keys[KeyCount].UnicodeChar = KeyNames[i].UnicodeChar;
+      }
+      KeyCount++;
+   }
+   free(List);
+   return Known;
+} // BOOLEAN HostSetKeys()
+
+// Called when rEFInd waits for (or checks) the keyboard. Types the next key,
+// if there is one, and returns TRUE if a key is waiting to be read.
+static BOOLEAN KeyboardWaited(VOID) {
+   if (KeyCount > 0)
+      KeyTyped = TRUE;
+   return KeyTyped;
+} // static BOOLEAN KeyboardWaited()
+
+static EFI_STATUS EFIAPI ReadKeyStroke(IN SIMPLE_INPUT_INTERFACE *This, OUT EFI_INPUT_KEY *Key) {
+   if (Key == NULL)
+      return EFI_INVALID_PARAMETER;
+   if (!KeyTyped)
+      return EFI_NOT_READY;
+   *Key = Keys[0];
+   KeyCount--;
+   memmove(Keys, Keys + 1, KeyCount * sizeof(EFI_INPUT_KEY));
+   KeyTyped = FALSE;
+   return EFI_SUCCESS;
+} // static EFI_STATUS ReadKeyStroke()
+
+// Resetting the keyboard loses a key that's been typed but not yet read;
+// but keys still to come are kept, since they're typed later.
+static EFI_STATUS EFIAPI InputReset(IN SIMPLE_INPUT_INTERFACE *This, IN BOOLEAN ExtendedVerification) {
+   if (KeyTyped) {
+      KeyCount--;
+      memmove(Keys, Keys + 1, KeyCount * sizeof(EFI_INPUT_KEY));
+      KeyTyped = FALSE;
+   }
+   return EFI_SUCCESS;
+} // static EFI_STATUS InputReset()
+
+#define TEXT_COLUMNS    80
+#define TEXT_ROWS       25
+
+static SIMPLE_TEXT_OUTPUT_MODE TextMode = { 1, 0, EFI_TEXT_ATTR(EFI_LIGHTGRAY, EFI_BLACK), 0, 0, TRUE };
+
+static EFI_STATUS EFIAPI OutputString(IN SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN CHAR16 *String) {
+   CHAR16 *Printable;
+   char   *Output;
+   UINTN  i, Length = 0;
+
+   HostStats.TextChars += StrLen(String);
+   if (HostVerbose) {
+      Printable = calloc(StrLen(String) + 1, sizeof(CHAR16));
+      for (i = 0; String[i]; i++) {
+         if (String[i] != L'\r')
+            Printable[Length++] = String[i];
+      }
+      Output = HostToUtf8(Printable);
+      fputs(Output, stderr);
+      free(Output);
+      free(Printable);
+   }
+   return EFI_SUCCESS;
+} // static EFI_STATUS OutputString()
+
+static EFI_STATUS EFIAPI TestString(IN SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN CHAR16 *String) {
+   return EFI_SUCCESS;
+} // static EFI_STATUS TestString()
+
+static EFI_STATUS EFIAPI QueryMode(IN SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN UINTN ModeNumber,
+                                   OUT UINTN *Columns, OUT UINTN *Rows) {
+   if (ModeNumber >= (UINTN) TextMode.MaxMode)
+      return EFI_UNSUPPORTED;
+   *Columns = TEXT_COLUMNS;
+   *Rows = TEXT_ROWS;
+   return EFI_SUCCESS;
+} // static EFI_STATUS QueryMode()
+
+static EFI_STATUS EFIAPI SetMode(IN SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN UINTN ModeNumber) {
+   if (ModeNumber >= (UINTN) TextMode.MaxMode)
+      return EFI_UNSUPPORTED;
+   TextMode.Mode = ModeNumber;
+   return EFI_SUCCESS;
+} // static EFI_STATUS SetMode()
+
+static EFI_STATUS EFIAPI SetAttribute(IN SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN UINTN Attribute) {
+   TextMode.Attribute = Attribute;
+   return EFI_SUCCESS;
+} // static EFI_STATUS SetAttribute()
+
+static EFI_STATUS EFIAPI ClearScreen(IN SIMPLE_TEXT_OUTPUT_INTERFACE *This) {
+   TextMode.CursorColumn = TextMode.CursorRow = 0;
+   return EFI_SUCCESS;
+} // static EFI_STATUS ClearScreen()
+
+static EFI_STATUS EFIAPI SetCursorPosition(IN SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN UINTN Column, IN UINTN Row) {
+   if ((Column >= TEXT_COLUMNS) || (Row >= TEXT_ROWS))
+      return EFI_UNSUPPORTED;
+   TextMode.CursorColumn = Column;
+   TextMode.CursorRow = Row;
+   return EFI_SUCCESS;
+} // static EFI_STATUS SetCursorPosition()
+
+static EFI_STATUS EFIAPI EnableCursor(IN SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN BOOLEAN Enable) {
+   TextMode.CursorVisible = Enable;
+   return EFI_SUCCESS;
+} // static EFI_STATUS EnableCursor()
+
+static HOST_EVENT KeyEvent = { HOST_EVENT_SIGNATURE, EVT_NOTIFY_WAIT, FALSE, TRUE, TimerCancel, 0, 0 };
+
+static SIMPLE_INPUT_INTERFACE TextIn = { InputReset, ReadKeyStroke, &KeyEvent };
+
+static SIMPLE_TEXT_OUTPUT_INTERFACE TextOut = {
+   NULL, OutputString, TestString, QueryMode, SetMode, SetAttribute, ClearScreen, SetCursorPosition,
+   EnableCursor, &TextMode
+};
+
+//
+// Tables
+//
+
+static EFI_BOOT_SERVICES BootServices = {
+   { 0x56524553544f4f42ULL, EFI_2_00_SYSTEM_TABLE_REVISION, sizeof(EFI_BOOT_SERVICES), 0, 0 },
+   RaiseTPL,
+   RestoreTPL,
+   AllocatePages,
+   FreePages,
+   GetMemoryMap,
+   MockAllocatePool,
+   MockFreePool,
+   CreateEvent,
+   SetTimer,
+   WaitForEvent,
+   SignalEvent,
+   CloseEvent,
+   CheckEvent,
+   InstallProtocolInterface,
+   ReinstallProtocolInterface,
+   UninstallProtocolInterface,
+   HandleProtocol,
+   NULL,
+   RegisterProtocolNotify,
+   LocateHandle,
+   LocateDevicePath,
+   InstallConfigurationTable,
+   LoadImage,
+   StartImage,
+   Exit,
+   UnloadImage,
+   ExitBootServices,
+   GetNextMonotonicCount,
+   Stall,
+   SetWatchdogTimer,
+   ConnectController,
+   DisconnectController,
+   OpenProtocol,
+   CloseProtocol,
+   OpenProtocolInformation,
+   ProtocolsPerHandle,
+   LocateHandleBuffer,
+   LocateProtocol,
+   InstallMultipleProtocolInterfaces,
+   UninstallMultipleProtocolInterfaces,
+   CalculateCrc32,
+   MockCopyMem,
+   MockSetMem,
+   CreateEventEx
+};
+
+static EFI_RUNTIME_SERVICES RuntimeServices = {
+   { 0x56524553544e5552ULL, EFI_2_00_SYSTEM_TABLE_REVISION, sizeof(EFI_RUNTIME_SERVICES), 0, 0 },
+   GetTime,
+   SetTime,
+   GetWakeupTime,
+   SetWakeupTime,
+   NULL,
+   NULL,
+   GetVariable,
+   GetNextVariableName,
+   SetVariable,
+   GetNextHighMonotonicCount,
+   ResetSystem,
+   NULL,
+   NULL,
+   NULL
+};
+
+EFI_SYSTEM_TABLE HostSystemTable = {
+   { EFI_SYSTEM_TABLE_SIGNATURE, EFI_2_00_SYSTEM_TABLE_REVISION, sizeof(EFI_SYSTEM_TABLE), 0, 0 },
+   (CHAR16 *) L"rEFInd host mock",
+   0x00010000,
+   NULL, &TextIn,
+   NULL, &TextOut,
+   NULL, &TextOut,
+   &RuntimeServices,
+   &BootServices,
+   0,
+   NULL
+};
+
+// Set up the console handles. This must be done before anything else.
+VOID HostFirmwareInit(VOID) {
+   // efilib.c's functions are used here too (through ST and BS).
+   InitializeLib(NULL, &HostSystemTable);
+   HostSystemTable.ConsoleInHandle = HostCreateHandle();
+   HostInstallProtocol(HostSystemTable.ConsoleInHandle, &TextInProtocol, &TextIn);
+   AddEvent(&KeyEvent);
+   HostSystemTable.ConsoleOutHandle = HostSystemTable.StandardErrorHandle = HostCreateHandle();
+   HostInstallProtocol(HostSystemTable.ConsoleOutHandle, &TextOutProtocol, &TextOut);
+} // VOID HostFirmwareInit()
@@ -0,0 +1,154 @@
+/*
+ * host/gop.c
+ * Mock graphics output protocol, drawing into memory
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// A GOP with one mode, whose frame buffer is ordinary memory. What's drawn
+// can be saved as a PPM file with HostGopSave().
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "host.h"
+
+static EFI_GRAPHICS_OUTPUT_MODE_INFORMATION ModeInfo;
+static EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE    GopMode;
+static EFI_GRAPHICS_OUTPUT_BLT_PIXEL        *FrameBuffer = NULL;
+
+static EFI_STATUS EFIAPI GopQueryMode(IN EFI_GRAPHICS_OUTPUT_PROTOCOL *This, IN UINT32 ModeNumber,
+                                      OUT UINTN *SizeOfInfo, OUT EFI_GRAPHICS_OUTPUT_MODE_INFORMATION **Info) {
+   if ((SizeOfInfo == NULL) || (Info == NULL) || (ModeNumber >= GopMode.MaxMode))
+      return EFI_INVALID_PARAMETER;
+   // The caller frees this.
+   *Info = AllocatePool(sizeof(EFI_GRAPHICS_OUTPUT_MODE_INFORMATION));
+   if (*Info == NULL)
+      return EFI_OUT_OF_RESOURCES;
+   **Info = ModeInfo;
+   *SizeOfInfo = sizeof(EFI_GRAPHICS_OUTPUT_MODE_INFORMATION);
+   return EFI_SUCCESS;
+} // static EFI_STATUS GopQueryMode()
+
+static EFI_STATUS EFIAPI GopSetMode(IN EFI_GRAPHICS_OUTPUT_PROTOCOL *This, IN UINT32 ModeNumber) {
+   if (ModeNumber >= GopMode.MaxMode)
+      return EFI_UNSUPPORTED;
+   ZeroMem(FrameBuffer, GopMode.FrameBufferSize);
+   return EFI_SUCCESS;
+} // static EFI_STATUS GopSetMode()
+
+static EFI_STATUS EFIAPI GopBlt(IN EFI_GRAPHICS_OUTPUT_PROTOCOL *This, IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BltBuffer,
+                                IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION BltOperation, IN UINTN SourceX, IN UINTN SourceY,
+                                IN UINTN DestinationX, IN UINTN DestinationY, IN UINTN Width, IN UINTN Height,
+                                IN UINTN Delta) {
+   UINTN                         Row, Column, ScreenWidth = ModeInfo.HorizontalResolution;
+   EFI_GRAPHICS_OUTPUT_BLT_PIXEL *Line;
+
+   if ((Width == 0) || (Height == 0) || (BltOperation >= EfiGraphicsOutputBltOperationMax))
+      return EFI_INVALID_PARAMETER;
+   if ((BltOperation != EfiBltVideoToVideo) && (BltBuffer == NULL))
+      return EFI_INVALID_PARAMETER;
+   // Delta is the BltBuffer's bytes per line; 0 means Width pixels' worth
+   if (Delta == 0)
+      Delta = Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+
+   // Check whichever rectangles are on the screen.
+   if ((BltOperation == EfiBltVideoToBltBuffer) || (BltOperation == EfiBltVideoToVideo)) {
+      if ((SourceX + Width > ScreenWidth) || (SourceY + Height > ModeInfo.VerticalResolution))
+         return EFI_INVALID_PARAMETER;
+   }
+   if (BltOperation != EfiBltVideoToBltBuffer) {
+      if ((DestinationX + Width > ScreenWidth) || (DestinationY + Height > ModeInfo.VerticalResolution))
+         return EFI_INVALID_PARAMETER;
+   }
+
+   HostStats.BltCalls++;
+   HostStats.BltPixels += Width * Height;
+   switch (BltOperation) {
+      case EfiBltVideoFill:
+         for (Row = 0; Row < Height; Row++) {
+            Line = FrameBuffer + (DestinationY + Row) * ScreenWidth + DestinationX;
+            for (Column = 0; Column < Width; Column++)
+               Line[Column] = *BltBuffer;
+         }
+         break;
+      case EfiBltVideoToBltBuffer:
+         for (Row = 0; Row < Height; Row++) {
+            Line = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) ((UINT8 *) BltBuffer + (DestinationY + Row) * Delta) + DestinationX;
+            CopyMem(Line, FrameBuffer + (SourceY + Row) * ScreenWidth + SourceX,
+                    Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+         }
+         break;
+      case EfiBltBufferToVideo:
+         for (Row = 0; Row < Height; Row++) {
+            Line = (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *) ((UINT8 *) BltBuffer + (SourceY + Row) * Delta) + SourceX;
+            CopyMem(FrameBuffer + (DestinationY + Row) * ScreenWidth + DestinationX, Line,
+                    Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+         }
+         break;
+      case EfiBltVideoToVideo:
+         // CopyMem() copes with overlaps within a line; take the lines in
+         // the order that copes with overlaps between them.
+         for (Row = 0; Row < Height; Row++) {
+            UINTN Line = (DestinationY > SourceY) ? Height - 1 - Row : Row;
+            CopyMem(FrameBuffer + (DestinationY + Line) * ScreenWidth + DestinationX,
+                    FrameBuffer + (SourceY + Line) * ScreenWidth + SourceX,
+                    Width * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+         }
+         break;
+      default:
+         break;
+   } // switch
+   return EFI_SUCCESS;
+} // static EFI_STATUS GopBlt()
+
+static EFI_GRAPHICS_OUTPUT_PROTOCOL Gop = { GopQueryMode, GopSetMode, GopBlt, &GopMode };
+
+// Install a GOP of the given size on the console output handle.
+VOID HostGopInit(IN UINT32 Width, IN UINT32 Height) {
+   ModeInfo.Version = 0;
+   ModeInfo.HorizontalResolution = Width;
+   ModeInfo.VerticalResolution = Height;
+   ModeInfo.PixelFormat = PixelBlueGreenRedReserved8BitPerColor;
+   ModeInfo.PixelsPerScanLine = Width;
+   FrameBuffer = calloc((UINTN) Width * Height, sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL));
+   GopMode.MaxMode = 1;
+   GopMode.Mode = 0;
+   GopMode.Info = &ModeInfo;
+   GopMode.SizeOfInfo = sizeof(ModeInfo);
+   GopMode.FrameBufferBase = (EFI_PHYSICAL_ADDRESS) (UINTN) FrameBuffer;
+   GopMode.FrameBufferSize = (UINTN) Width * Height * sizeof(EFI_GRAPHICS_OUTPUT_BLT_PIXEL);
+   HostInstallProtocol(HostSystemTable.ConsoleOutHandle, &GraphicsOutputProtocol, &Gop);
+} // VOID HostGopInit()
+
+// Save what's on the screen as a binary PPM file.
+BOOLEAN HostGopSave(IN const char *FileName) {
+   FILE  *Output = fopen(FileName, "wb");
+   UINTN i, Count = (UINTN) ModeInfo.HorizontalResolution * ModeInfo.VerticalResolution;
+
+   if ((Output == NULL) || (FrameBuffer == NULL)) {
+      if (Output != NULL)
+         fclose(Output);
+      return FALSE;
+   }
+   fprintf(Output, "P6\n%u %u\n255\n", ModeInfo.HorizontalResolution, ModeInfo.VerticalResolution);
+   for (i = 0; i < Count; i++) {
+      fputc(FrameBuffer[i].Red, Output);
+      fputc(FrameBuffer[i].Green, Output);
+      fputc(FrameBuffer[i].Blue, Output);
+   }
+   return (fclose(Output) == 0);
+} // BOOLEAN HostGopSave()
@@ -0,0 +1,85 @@
+/*
+ * host/host.h
+ * Mock UEFI firmware for running rEFInd as a host program
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __HOST_H_
+#define __HOST_H_
+
+#include <setjmp.h>
+#include "efi.h"
+#include "efilib.h"
+
+// Ways in which a run of efi_main() can end, other than by its returning
+#define HOST_EXIT_RETURN    0   // efi_main() returned
+#define HOST_EXIT_LAUNCH    1   // an application was started with StartImage()
+#define HOST_EXIT_RESET     2   // ResetSystem() was called
+#define HOST_EXIT_IDLE      3   // it waited for input that will never come
+
+// Longest Stall() that really waits; longer ones (such as pauses to let the
+// user read a message) only advance the firmware's clock
+#define HOST_STALL_LIMIT    10000
+
+// What the mock firmware counts
+typedef struct {
+   UINTN    PoolAllocations;    // AllocatePool() calls
+   UINTN    PoolFrees;          // FreePool() calls
+   UINTN    PoolBytes;          // bytes requested from AllocatePool()
+   UINTN    PoolLive;           // bytes allocated and not yet freed
+   UINTN    PoolPeak;           // most bytes allocated at once
+   UINTN    PageAllocations;    // AllocatePages() calls
+   UINTN    FileOpens;          // successful EFI_FILE Open() calls
+   UINTN    FileReads;          // EFI_FILE Read() calls
+   UINTN    FileReadBytes;      // bytes returned by them
+   UINTN    BlockReads;         // BlockIo ReadBlocks() calls
+   UINTN    BltCalls;           // GOP Blt() calls
+   UINTN    BltPixels;          // pixels drawn or read by them
+   UINTN    TextChars;          // characters written to the text console
+   UINT64   StalledUs;          // microseconds asked of Stall()
+   UINT64   SkippedUs;          // microseconds skipped by fast-forwarding timers and stalls
+} HOST_STATS;
+
+extern HOST_STATS       HostStats;
+extern EFI_SYSTEM_TABLE HostSystemTable;
+extern EFI_HANDLE       HostImageHandle;
+extern jmp_buf          HostExitJump;
+extern BOOLEAN          HostVerbose;
+extern CHAR16           *HostLaunchedPath;
+
+// firmware.c
+VOID HostFirmwareInit(VOID);
+EFI_HANDLE HostCreateHandle(VOID);
+EFI_STATUS HostInstallProtocol(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, IN VOID *Interface);
+BOOLEAN HostSetKeys(IN const char *KeyList);
+VOID HostSetSelf(IN EFI_HANDLE DeviceHandle, IN CHAR16 *Path);
+UINT64 HostNow(VOID);
+
+// hostfs.c
+EFI_HANDLE HostAddVolume(IN const char *Directory);
+EFI_STATUS HostReadFile(IN EFI_HANDLE Device, IN CHAR16 *Path, OUT VOID **Data, OUT UINTN *Size);
+
+// gop.c
+VOID HostGopInit(IN UINT32 Width, IN UINT32 Height);
+BOOLEAN HostGopSave(IN const char *FileName);
+
+// efilib.c
+char *HostToUtf8(IN CONST CHAR16 *String);
+CHAR16 *HostFromUtf8(IN const char *String);
+
+#endif
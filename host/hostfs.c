@@ -0,0 +1,637 @@
+/*
+ * host/hostfs.c
+ * Mock disks and file systems, backed by directories on the host
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Each directory given to HostAddVolume() becomes a SATA disk holding one
+// GPT partition, whose simple file system protocol serves the directory's
+// contents. File names are matched without regard to case, as on FAT.
+//
+// The disks' blocks all read as zeros, so rEFInd sees no partition table and
+// no file system type it knows; it finds the volumes only through their
+// file system protocols. Disk images aren't supported.
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include "host.h"
+
+#define HOST_BLOCK_SIZE         512
+#define HOST_PARTITION_START    2048
+#define HOST_PARTITION_BLOCKS   (1024 * 1024 * 2)   // 1 GiB
+
+typedef struct {
+   EFI_FILE_IO_INTERFACE   FileSystem;    // must be first
+   char                    *Root;         // the directory served
+   CHAR16                  *Label;
+   UINTN                   Index;
+   EFI_BLOCK_IO            DiskBlockIo;
+   EFI_BLOCK_IO_MEDIA      DiskMedia;
+   EFI_BLOCK_IO            PartitionBlockIo;
+   EFI_BLOCK_IO_MEDIA      PartitionMedia;
+} HOST_VOLUME;
+
+#define HOST_FILE_SIGNATURE     EFI_SIGNATURE_32('f', 'i', 'l', 'e')
+
+typedef struct {
+   EFI_FILE       File;          // must be first
+   UINT32         Signature;
+   HOST_VOLUME    *Volume;
+   char           *Path;         // relative to Volume->Root; "" for the root
+   int            Fd;            // -1 for a directory
+   BOOLEAN        Writable;
+   UINT64         Position;      // for a directory, the next entry to read
+   struct dirent  **Entries;     // a directory's entries, when first read
+   int            EntryCount;
+} HOST_FILE;
+
+static UINTN VolumeCount = 0;
+
+//
+// Block I/O
+//
+
+static EFI_STATUS EFIAPI BlockReset(IN EFI_BLOCK_IO *This, IN BOOLEAN ExtendedVerification) {
+   return EFI_SUCCESS;
+} // static EFI_STATUS BlockReset()
+
+static EFI_STATUS EFIAPI ReadBlocks(IN EFI_BLOCK_IO *This, IN UINT32 MediaId, IN EFI_LBA Lba,
+                                    IN UINTN BufferSize, OUT VOID *Buffer) {
+   if (MediaId != This->Media->MediaId)
+      return EFI_MEDIA_CHANGED;
+   if ((BufferSize % This->Media->BlockSize) != 0)
+      return EFI_BAD_BUFFER_SIZE;
+   if ((Lba > This->Media->LastBlock) || (BufferSize / This->Media->BlockSize > This->Media->LastBlock - Lba + 1))
+      return EFI_INVALID_PARAMETER;
+   HostStats.BlockReads++;
+   ZeroMem(Buffer, BufferSize);
+   return EFI_SUCCESS;
+} // static EFI_STATUS ReadBlocks()
+
+static EFI_STATUS EFIAPI WriteBlocks(IN EFI_BLOCK_IO *This, IN UINT32 MediaId, IN EFI_LBA Lba,
+                                     IN UINTN BufferSize, IN VOID *Buffer) {
+   return EFI_WRITE_PROTECTED;
+} // static EFI_STATUS WriteBlocks()
+
+static EFI_STATUS EFIAPI FlushBlocks(IN EFI_BLOCK_IO *This) {
+   return EFI_SUCCESS;
+} // static EFI_STATUS FlushBlocks()
+
+//
+// Paths
+//
+
+// Returns Path with Name appended, as a malloc()ed string.
+static char *JoinPath(IN const char *Path, IN const char *Name) {
+   char *Joined;
+
+   if (asprintf(&Joined, "%s%s%s", Path, (Path[0] && Name[0]) ? "/" : "", Name) < 0)
+      abort();
+   return Joined;
+} // static char *JoinPath()
+
+static char *HostPath(IN HOST_VOLUME *Volume, IN const char *Path) {
+   return JoinPath(Volume->Root, Path);
+} // static char *HostPath()
+
+// Returns the name of the entry in directory Path (relative to Volume's
+// root) that matches Name without regard to case; or Name if there's none.
+static char *MatchName(IN HOST_VOLUME *Volume, IN const char *Path, IN const char *Name) {
+   char          *Directory = HostPath(Volume, Path), *Match = NULL;
+   DIR           *Dir;
+   struct dirent *Entry;
+
+   Dir = opendir(Directory);
+   while ((Dir != NULL) && (Match == NULL) && ((Entry = readdir(Dir)) != NULL)) {
+      if (strcasecmp(Entry->d_name, Name) == 0)
+         Match = strdup(Entry->d_name);
+   }
+   if (Dir != NULL)
+      closedir(Dir);
+   free(Directory);
+   return (Match != NULL) ? Match : strdup(Name);
+} // static char *MatchName()
+
+// Works out the path, relative to Volume's root, of FileName opened from
+// the directory Path. Returns NULL if it would lead outside the volume.
+static char *ResolvePath(IN HOST_VOLUME *Volume, IN const char *Path, IN CHAR16 *FileName) {
+   char *Name = HostToUtf8(FileName), *Resolved, *Component, *Saved = NULL, *Next, *Slash;
+
+   Resolved = strdup((Name[0] == '\\') ? "" : Path);
+   for (Component = strtok_r(Name, "\\", &Saved); Component != NULL; Component = strtok_r(NULL, "\\", &Saved)) {
+      if (strcmp(Component, ".") == 0)
+         continue;
+      if (strcmp(Component, "..") == 0) {
+         if (Resolved[0] == '\0') {
+            free(Resolved);
+            Resolved = NULL;
+            break;
+         }
+         Slash = strrchr(Resolved, '/');
+         if (Slash != NULL)
+            *Slash = '\0';
+         else
+            Resolved[0] = '\0';
+         continue;
+      }
+      Component = MatchName(Volume, Resolved, Component);
+      Next = JoinPath(Resolved, Component);
+      free(Component);
+      free(Resolved);
+      Resolved = Next;
+   } // for
+   free(Name);
+   return Resolved;
+} // static char *ResolvePath()
+
+//
+// Files
+//
+
+static EFI_STATUS EFIAPI FileOpen(IN EFI_FILE_HANDLE File, OUT EFI_FILE_HANDLE *NewHandle, IN CHAR16 *FileName,
+                                  IN UINT64 OpenMode, IN UINT64 Attributes);
+static EFI_STATUS EFIAPI FileClose(IN EFI_FILE_HANDLE File);
+static EFI_STATUS EFIAPI FileDelete(IN EFI_FILE_HANDLE File);
+static EFI_STATUS EFIAPI FileRead(IN EFI_FILE_HANDLE File, IN OUT UINTN *BufferSize, OUT VOID *Buffer);
+static EFI_STATUS EFIAPI FileWrite(IN EFI_FILE_HANDLE File, IN OUT UINTN *BufferSize, IN VOID *Buffer);
+static EFI_STATUS EFIAPI FileGetPosition(IN EFI_FILE_HANDLE File, OUT UINT64 *Position);
+static EFI_STATUS EFIAPI FileSetPosition(IN EFI_FILE_HANDLE File, IN UINT64 Position);
+static EFI_STATUS EFIAPI FileGetInfo(IN EFI_FILE_HANDLE File, IN EFI_GUID *InformationType,
+                                     IN OUT UINTN *BufferSize, OUT VOID *Buffer);
+static EFI_STATUS EFIAPI FileSetInfo(IN EFI_FILE_HANDLE File, IN EFI_GUID *InformationType,
+                                     IN UINTN BufferSize, IN VOID *Buffer);
+static EFI_STATUS EFIAPI FileFlush(IN EFI_FILE_HANDLE File);
+
+static HOST_FILE *NewFile(IN HOST_VOLUME *Volume, IN char *Path, IN int Fd, IN BOOLEAN Writable) {
+   HOST_FILE *File = calloc(1, sizeof(HOST_FILE));
+
+   File->File.Revision = EFI_FILE_HANDLE_REVISION;
+   File->File.Open = FileOpen;
+   File->File.Close = FileClose;
+   File->File.Delete = FileDelete;
+   File->File.Read = FileRead;
+   File->File.Write = FileWrite;
+   File->File.GetPosition = FileGetPosition;
+   File->File.SetPosition = FileSetPosition;
+   File->File.GetInfo = FileGetInfo;
+   File->File.SetInfo = FileSetInfo;
+   File->File.Flush = FileFlush;
+   File->Signature = HOST_FILE_SIGNATURE;
+   File->Volume = Volume;
+   File->Path = Path;
+   File->Fd = Fd;
+   File->Writable = Writable;
+   HostStats.FileOpens++;
+   return File;
+} // static HOST_FILE *NewFile()
+
+static HOST_FILE *CheckedFile(IN EFI_FILE_HANDLE Handle) {
+   HOST_FILE *File = (HOST_FILE *) Handle;
+
+   if ((File == NULL) || (File->Signature != HOST_FILE_SIGNATURE))
+      return NULL;
+   return File;
+} // static HOST_FILE *CheckedFile()
+
+static EFI_STATUS EFIAPI FileOpen(IN EFI_FILE_HANDLE Handle, OUT EFI_FILE_HANDLE *NewHandle, IN CHAR16 *FileName,
+                                  IN UINT64 OpenMode, IN UINT64 Attributes) {
+   HOST_FILE   *File = CheckedFile(Handle);
+   char        *Path, *Full;
+   struct stat Info;
+   int         Fd = -1, Flags;
+   BOOLEAN     Writable = (OpenMode & EFI_FILE_MODE_WRITE) != 0;
+
+   if ((File == NULL) || (NewHandle == NULL) || (FileName == NULL) || !(OpenMode & EFI_FILE_MODE_READ))
+      return EFI_INVALID_PARAMETER;
+   if ((OpenMode & EFI_FILE_MODE_CREATE) && !Writable)
+      return EFI_INVALID_PARAMETER;
+   Path = ResolvePath(File->Volume, File->Path, FileName);
+   if (Path == NULL)
+      return EFI_NOT_FOUND;
+   Full = HostPath(File->Volume, Path);
+
+   if (stat(Full, &Info) != 0) {
+      if (!(OpenMode & EFI_FILE_MODE_CREATE)) {
+         free(Full);
+         free(Path);
+         return EFI_NOT_FOUND;
+      }
+      if ((Attributes & EFI_FILE_DIRECTORY) ? (mkdir(Full, 0777) != 0) :
+          ((Fd = open(Full, O_RDWR | O_CREAT, 0666)) < 0)) {
+         free(Full);
+         free(Path);
+         return EFI_DEVICE_ERROR;
+      }
+   } else if (!S_ISDIR(Info.st_mode)) {
+      Flags = Writable ? O_RDWR : O_RDONLY;
+      Fd = open(Full, Flags);
+      if (Fd < 0) {
+         free(Full);
+         free(Path);
+         return EFI_ACCESS_DENIED;
+      }
+   }
+   free(Full);
+   *NewHandle = &NewFile(File->Volume, Path, Fd, Writable)->File;
+   return EFI_SUCCESS;
+} // static EFI_STATUS FileOpen()
+
+static EFI_STATUS EFIAPI FileClose(IN EFI_FILE_HANDLE Handle) {
+   HOST_FILE *File = CheckedFile(Handle);
+   int       i;
+
+   if (File == NULL)
+      return EFI_INVALID_PARAMETER;
+   if (File->Fd >= 0)
+      close(File->Fd);
+   for (i = 0; i < File->EntryCount; i++)
+      free(File->Entries[i]);
+   free(File->Entries);
+   free(File->Path);
+   File->Signature = 0;
+   free(File);
+   return EFI_SUCCESS;
+} // static EFI_STATUS FileClose()
+
+static EFI_STATUS EFIAPI FileDelete(IN EFI_FILE_HANDLE Handle) {
+   HOST_FILE  *File = CheckedFile(Handle);
+   char       *Full;
+   int        Result;
+
+   if (File == NULL)
+      return EFI_INVALID_PARAMETER;
+   Full = HostPath(File->Volume, File->Path);
+   Result = (File->Fd >= 0) ? unlink(Full) : rmdir(Full);
+   free(Full);
+   FileClose(Handle);
+   return (Result == 0) ? EFI_SUCCESS : EFI_WARN_DELETE_FAILURE;
+} // static EFI_STATUS FileDelete()
+
+// Fills in an EFI_FILE_INFO for the file at Path, relative to Volume's root.
+static EFI_STATUS GetFileInfo(IN HOST_VOLUME *Volume, IN const char *Path, IN OUT UINTN *BufferSize,
+                              OUT EFI_FILE_INFO *Info) {
+   char        *Full = HostPath(Volume, Path);
+   const char  *Name = strrchr(Path, '/');
+   CHAR16      *FileName;
+   struct stat Status;
+   struct tm   Modified;
+   UINTN       Size;
+
+   if (stat(Full, &Status) != 0) {
+      free(Full);
+      return EFI_DEVICE_ERROR;
+   }
+   free(Full);
+   FileName = HostFromUtf8((Name != NULL) ? Name + 1 : Path);
+   Size = SIZE_OF_EFI_FILE_INFO + StrSize(FileName);
+   if ((*BufferSize < Size) || (Info == NULL)) {
+      *BufferSize = Size;
+      free(FileName);
+      return EFI_BUFFER_TOO_SMALL;
+   }
+   ZeroMem(Info, Size);
+   Info->Size = Size;
+   if (!S_ISDIR(Status.st_mode)) {
+      Info->FileSize = Status.st_size;
+      Info->PhysicalSize = (Status.st_size + HOST_BLOCK_SIZE - 1) / HOST_BLOCK_SIZE * HOST_BLOCK_SIZE;
+   }
+   localtime_r(&Status.st_mtime, &Modified);
+   Info->ModificationTime.Year = Modified.tm_year + 1900;
+   Info->ModificationTime.Month = Modified.tm_mon + 1;
+   Info->ModificationTime.Day = Modified.tm_mday;
+   Info->ModificationTime.Hour = Modified.tm_hour;
+   Info->ModificationTime.Minute = Modified.tm_min;
+   Info->ModificationTime.Second = Modified.tm_sec;
+   Info->CreateTime = Info->LastAccessTime = Info->ModificationTime;
+   Info->Attribute = S_ISDIR(Status.st_mode) ? EFI_FILE_DIRECTORY : EFI_FILE_ARCHIVE;
+   if (!(Status.st_mode & S_IWUSR))
+      Info->Attribute |= EFI_FILE_READ_ONLY;
+   StrCpy(Info->FileName, FileName);
+   free(FileName);
+   *BufferSize = Size;
+   return EFI_SUCCESS;
+} // static EFI_STATUS GetFileInfo()
+
+static int SkipDots(const struct dirent *Entry) {
+   return (strcmp(Entry->d_name, ".") != 0) && (strcmp(Entry->d_name, "..") != 0);
+} // static int SkipDots()
+
+// Reading a directory returns one EFI_FILE_INFO per entry, and then nothing.
+static EFI_STATUS ReadDirectory(IN HOST_FILE *File, IN OUT UINTN *BufferSize, OUT VOID *Buffer) {
+   char       *Full, *EntryPath;
+   EFI_STATUS Status;
+
+   if (File->Entries == NULL) {
+      Full = HostPath(File->Volume, File->Path);
+      File->EntryCount = scandir(Full, &File->Entries, SkipDots, alphasort);
+      free(Full);
+      if (File->EntryCount < 0) {
+         File->EntryCount = 0;
+         File->Entries = NULL;
+         return EFI_DEVICE_ERROR;
+      }
+   }
+   if (File->Position >= (UINT64) File->EntryCount) {
+      *BufferSize = 0;
+      return EFI_SUCCESS;
+   }
+   EntryPath = JoinPath(File->Path, File->Entries[File->Position]->d_name);
+   Status = GetFileInfo(File->Volume, EntryPath, BufferSize, Buffer);
+   free(EntryPath);
+   if (Status != EFI_BUFFER_TOO_SMALL)
+      File->Position++;
+   return Status;
+} // static EFI_STATUS ReadDirectory()
+
+static EFI_STATUS EFIAPI FileRead(IN EFI_FILE_HANDLE Handle, IN OUT UINTN *BufferSize, OUT VOID *Buffer) {
+   HOST_FILE  *File = CheckedFile(Handle);
+   ssize_t    Count;
+
+   if ((File == NULL) || (BufferSize == NULL))
+      return EFI_INVALID_PARAMETER;
+   HostStats.FileReads++;
+   if (File->Fd < 0)
+      return ReadDirectory(File, BufferSize, Buffer);
+   Count = pread(File->Fd, Buffer, *BufferSize, File->Position);
+   if (Count < 0)
+      return EFI_DEVICE_ERROR;
+   *BufferSize = Count;
+   File->Position += Count;
+   HostStats.FileReadBytes += Count;
+   return EFI_SUCCESS;
+} // static EFI_STATUS FileRead()
+
+static EFI_STATUS EFIAPI FileWrite(IN EFI_FILE_HANDLE Handle, IN OUT UINTN *BufferSize, IN VOID *Buffer) {
+   HOST_FILE  *File = CheckedFile(Handle);
+   ssize_t    Count;
+
+   if ((File == NULL) || (BufferSize == NULL))
+      return EFI_INVALID_PARAMETER;
+   if (File->Fd < 0)
+      return EFI_UNSUPPORTED;
+   if (!File->Writable)
+      return EFI_ACCESS_DENIED;
+   Count = pwrite(File->Fd, Buffer, *BufferSize, File->Position);
+   if (Count < 0)
+      return EFI_DEVICE_ERROR;
+   *BufferSize = Count;
+   File->Position += Count;
+   return EFI_SUCCESS;
+} // static EFI_STATUS FileWrite()
+
+static EFI_STATUS EFIAPI FileGetPosition(IN EFI_FILE_HANDLE Handle, OUT UINT64 *Position) {
+   HOST_FILE *File = CheckedFile(Handle);
+
+   if ((File == NULL) || (Position == NULL))
+      return EFI_INVALID_PARAMETER;
+   if (File->Fd < 0)
+      return EFI_UNSUPPORTED;
+   *Position = File->Position;
+   return EFI_SUCCESS;
+} // static EFI_STATUS FileGetPosition()
+
+static EFI_STATUS EFIAPI FileSetPosition(IN EFI_FILE_HANDLE Handle, IN UINT64 Position) {
+   HOST_FILE   *File = CheckedFile(Handle);
+   struct stat Status;
+
+   if (File == NULL)
+      return EFI_INVALID_PARAMETER;
+   if (File->Fd < 0) {
+      // Only rewinding is allowed for directories
+      if (Position != 0)
+         return EFI_UNSUPPORTED;
+      File->Position = 0;
+      return EFI_SUCCESS;
+   }
+   if (Position == 0xFFFFFFFFFFFFFFFFULL) {
+      if (fstat(File->Fd, &Status) != 0)
+         return EFI_DEVICE_ERROR;
+      Position = Status.st_size;
+   }
+   File->Position = Position;
+   return EFI_SUCCESS;
+} // static EFI_STATUS FileSetPosition()
+
+static EFI_STATUS EFIAPI FileGetInfo(IN EFI_FILE_HANDLE Handle, IN EFI_GUID *InformationType,
+                                     IN OUT UINTN *BufferSize, OUT VOID *Buffer) {
+   HOST_FILE            *File = CheckedFile(Handle);
+   EFI_FILE_SYSTEM_INFO *FsInfo = Buffer;
+   struct statvfs       Space;
+   UINTN                Size;
+
+   if ((File == NULL) || (InformationType == NULL) || (BufferSize == NULL))
+      return EFI_INVALID_PARAMETER;
+   if (CompareGuid(InformationType, &GenericFileInfo) == 0)
+      return GetFileInfo(File->Volume, File->Path, BufferSize, Buffer);
+
+   if (CompareGuid(InformationType, &FileSystemInfo) == 0) {
+      Size = SIZE_OF_EFI_FILE_SYSTEM_INFO + StrSize(File->Volume->Label);
+      if ((*BufferSize < Size) || (Buffer == NULL)) {
+         *BufferSize = Size;
+         return EFI_BUFFER_TOO_SMALL;
+      }
+      ZeroMem(FsInfo, Size);
+      FsInfo->Size = Size;
+      FsInfo->BlockSize = HOST_BLOCK_SIZE;
+      FsInfo->VolumeSize = (UINT64) HOST_PARTITION_BLOCKS * HOST_BLOCK_SIZE;
+      if (statvfs(File->Volume->Root, &Space) == 0)
+         FsInfo->FreeSpace = (UINT64) Space.f_bavail * Space.f_frsize;
+      StrCpy(FsInfo->VolumeLabel, File->Volume->Label);
+      *BufferSize = Size;
+      return EFI_SUCCESS;
+   }
+
+   if (CompareGuid(InformationType, &FileSystemVolumeLabelInfo) == 0) {
+      Size = StrSize(File->Volume->Label);
+      if ((*BufferSize < Size) || (Buffer == NULL)) {
+         *BufferSize = Size;
+         return EFI_BUFFER_TOO_SMALL;
+      }
+      StrCpy(((EFI_FILE_SYSTEM_VOLUME_LABEL *) Buffer)->VolumeLabel, File->Volume->Label);
+      *BufferSize = Size;
+      return EFI_SUCCESS;
+   }
+   return EFI_UNSUPPORTED;
+} // static EFI_STATUS FileGetInfo()
+
+// Only a file's size can be changed.
+static EFI_STATUS EFIAPI FileSetInfo(IN EFI_FILE_HANDLE Handle, IN EFI_GUID *InformationType,
+                                     IN UINTN BufferSize, IN VOID *Buffer) {
+   HOST_FILE     *File = CheckedFile(Handle);
+   EFI_FILE_INFO *Info = Buffer;
+
+   if ((File == NULL) || (InformationType == NULL) || (Buffer == NULL))
+      return EFI_INVALID_PARAMETER;
+   if (CompareGuid(InformationType, &GenericFileInfo) != 0)
+      return EFI_UNSUPPORTED;
+   if ((BufferSize < SIZE_OF_EFI_FILE_INFO) || (File->Fd < 0))
+      return EFI_INVALID_PARAMETER;
+   if (!File->Writable)
+      return EFI_ACCESS_DENIED;
+   return (ftruncate(File->Fd, Info->FileSize) == 0) ? EFI_SUCCESS : EFI_DEVICE_ERROR;
+} // static EFI_STATUS FileSetInfo()
+
+static EFI_STATUS EFIAPI FileFlush(IN EFI_FILE_HANDLE Handle) {
+   HOST_FILE *File = CheckedFile(Handle);
+
+   if (File == NULL)
+      return EFI_INVALID_PARAMETER;
+   return EFI_SUCCESS;
+} // static EFI_STATUS FileFlush()
+
+static EFI_STATUS EFIAPI OpenVolume(IN EFI_FILE_IO_INTERFACE *This, OUT EFI_FILE_HANDLE *Root) {
+   HOST_VOLUME *Volume = (HOST_VOLUME *) This;
+
+   if (Root == NULL)
+      return EFI_INVALID_PARAMETER;
+   *Root = &NewFile(Volume, strdup(""), -1, TRUE)->File;
+   return EFI_SUCCESS;
+} // static EFI_STATUS OpenVolume()
+
+//
+// Volumes
+//
+
+// Builds the device path of the Index'th disk, followed by Extra (if it's
+// not NULL), as a malloc()ed path.
+static EFI_DEVICE_PATH *DiskDevicePath(IN UINTN Index, IN EFI_DEVICE_PATH *Extra) {
+   ACPI_HID_DEVICE_PATH Acpi = { { ACPI_DEVICE_PATH, ACPI_DP, { sizeof(ACPI_HID_DEVICE_PATH), 0 } },
+                                 0x0A0341D0, 0 };   // PNP0A03, a PCI root bridge
+   PCI_DEVICE_PATH      Pci = { { HARDWARE_DEVICE_PATH, HW_PCI_DP, { sizeof(PCI_DEVICE_PATH), 0 } }, 2, 0x1f };
+   SATA_DEVICE_PATH     Sata = { { MESSAGING_DEVICE_PATH, MSG_SATA_DP, { sizeof(SATA_DEVICE_PATH), 0 } },
+                                 (UINT16) Index, 0xFFFF, 0 };
+   UINTN                ExtraSize = (Extra != NULL) ? DevicePathNodeLength(Extra) : 0;
+   UINTN                Size = sizeof(Acpi) + sizeof(Pci) + sizeof(Sata) + ExtraSize + sizeof(EFI_DEVICE_PATH);
+   UINT8                *Path = calloc(1, Size), *Next = Path;
+
+   CopyMem(Next, &Acpi, sizeof(Acpi));
+   Next += sizeof(Acpi);
+   CopyMem(Next, &Pci, sizeof(Pci));
+   Next += sizeof(Pci);
+   CopyMem(Next, &Sata, sizeof(Sata));
+   Next += sizeof(Sata);
+   if (Extra != NULL)
+      CopyMem(Next, Extra, ExtraSize);
+   Next += ExtraSize;
+   SetDevicePathEndNode((EFI_DEVICE_PATH *) Next);
+   return (EFI_DEVICE_PATH *) Path;
+} // static EFI_DEVICE_PATH *DiskDevicePath()
+
+static VOID InitBlockIo(IN EFI_BLOCK_IO *BlockIo, IN EFI_BLOCK_IO_MEDIA *Media, IN EFI_LBA LastBlock,
+                        IN BOOLEAN LogicalPartition) {
+   BlockIo->Revision = 0x00010000;
+   BlockIo->Media = Media;
+   BlockIo->Reset = BlockReset;
+   BlockIo->ReadBlocks = ReadBlocks;
+   BlockIo->WriteBlocks = WriteBlocks;
+   BlockIo->FlushBlocks = FlushBlocks;
+   Media->MediaId = 1;
+   Media->MediaPresent = TRUE;
+   Media->LogicalPartition = LogicalPartition;
+   Media->ReadOnly = TRUE;
+   Media->BlockSize = HOST_BLOCK_SIZE;
+   Media->IoAlign = 1;
+   Media->LastBlock = LastBlock;
+} // static VOID InitBlockIo()
+
+// Add a disk with a partition holding the files in Directory. Returns the
+// partition's handle, or NULL if Directory can't be used.
+EFI_HANDLE HostAddVolume(IN const char *Directory) {
+   HOST_VOLUME           *Volume;
+   HARDDRIVE_DEVICE_PATH Partition;
+   EFI_HANDLE            Disk, PartitionHandle;
+   struct stat           Status;
+   char                  *Base, *Copy;
+
+   if ((stat(Directory, &Status) != 0) || !S_ISDIR(Status.st_mode))
+      return NULL;
+   Volume = calloc(1, sizeof(HOST_VOLUME));
+   Volume->FileSystem.Revision = 0x00010000;
+   Volume->FileSystem.OpenVolume = OpenVolume;
+   Volume->Root = strdup(Directory);
+   Volume->Index = VolumeCount++;
+   Copy = strdup(Directory);
+   Base = basename(Copy);
+   Volume->Label = HostFromUtf8(Base);
+   free(Copy);
+
+   InitBlockIo(&Volume->DiskBlockIo, &Volume->DiskMedia,
+               HOST_PARTITION_START + HOST_PARTITION_BLOCKS + 33, FALSE);
+   Disk = HostCreateHandle();
+   HostInstallProtocol(Disk, &BlockIoProtocol, &Volume->DiskBlockIo);
+   HostInstallProtocol(Disk, &DevicePathProtocol, DiskDevicePath(Volume->Index, NULL));
+
+   ZeroMem(&Partition, sizeof(Partition));
+   Partition.Header.Type = MEDIA_DEVICE_PATH;
+   Partition.Header.SubType = MEDIA_HARDDRIVE_DP;
+   SetDevicePathNodeLength(&Partition.Header, sizeof(Partition));
+   Partition.PartitionNumber = 1;
+   Partition.PartitionStart = HOST_PARTITION_START;
+   Partition.PartitionSize = HOST_PARTITION_BLOCKS;
+   // A made-up but stable partition GUID
+   CopyMem(Partition.Signature, "rEFInd host\0\0\0\0", 16);
+   Partition.Signature[15] = (UINT8) Volume->Index;
+   Partition.MBRType = MBR_TYPE_EFI_PARTITION_TABLE_HEADER;
+   Partition.SignatureType = SIGNATURE_TYPE_GUID;
+
+   InitBlockIo(&Volume->PartitionBlockIo, &Volume->PartitionMedia, HOST_PARTITION_BLOCKS - 1, TRUE);
+   PartitionHandle = HostCreateHandle();
+   HostInstallProtocol(PartitionHandle, &FileSystemProtocol, &Volume->FileSystem);
+   HostInstallProtocol(PartitionHandle, &BlockIoProtocol, &Volume->PartitionBlockIo);
+   HostInstallProtocol(PartitionHandle, &DevicePathProtocol, DiskDevicePath(Volume->Index, &Partition.Header));
+   return PartitionHandle;
+} // EFI_HANDLE HostAddVolume()
+
+// Read the whole of the file at Path on the volume with handle Device, into
+// a malloc()ed buffer.
+EFI_STATUS HostReadFile(IN EFI_HANDLE Device, IN CHAR16 *Path, OUT VOID **Data, OUT UINTN *Size) {
+   EFI_FILE_HANDLE Root, File;
+   EFI_FILE_INFO   *Info;
+   EFI_STATUS      Status;
+
+   Root = LibOpenRoot(Device);
+   if (Root == NULL)
+      return EFI_NOT_FOUND;
+   Status = Root->Open(Root, &File, Path, EFI_FILE_MODE_READ, 0);
+   Root->Close(Root);
+   if (EFI_ERROR(Status))
+      return Status;
+   Info = LibFileInfo(File);
+   if (Info == NULL) {
+      File->Close(File);
+      return EFI_DEVICE_ERROR;
+   }
+   *Size = Info->FileSize;
+   FreePool(Info);
+   *Data = malloc(*Size + 1);
+   Status = File->Read(File, Size, *Data);
+   File->Close(File);
+   if (EFI_ERROR(Status)) {
+      free(*Data);
+      *Data = NULL;
+   }
+   return Status;
+} // EFI_STATUS HostReadFile()
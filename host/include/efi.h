@@ -0,0 +1,1053 @@
+/*
+ * host/include/efi.h
+ * Stand-in for GNU-EFI's efi.h, for building rEFInd as a host program
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// This declares the parts of the UEFI specification, under GNU-EFI's names,
+// that rEFInd uses, so that its sources can be compiled unchanged (with
+// __MAKEWITH_GNUEFI) into an ordinary program for the build host. The
+// firmware behind these declarations is the mock in host/firmware.c. Only
+// what rEFInd needs is here; layouts match the specification wherever
+// rEFInd depends on them (device paths, file information, and GPT data are
+// read and written as raw bytes). Protocol functions are ordinary C
+// functions here, so uefi_call_wrapper() simply calls them.
+
+#ifndef __HOST_EFI_H_
+#define __HOST_EFI_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+//
+// Basic types
+//
+
+typedef uint8_t             UINT8;
+typedef uint16_t            UINT16;
+typedef uint32_t            UINT32;
+typedef uint64_t            UINT64;
+typedef int8_t              INT8;
+typedef int16_t             INT16;
+typedef int32_t             INT32;
+typedef int64_t             INT64;
+typedef uintptr_t           UINTN;
+typedef intptr_t            INTN;
+typedef unsigned char       CHAR8;
+typedef UINT16              CHAR16;
+typedef unsigned char       BOOLEAN;
+typedef void                VOID;
+typedef UINTN               EFI_STATUS;
+typedef VOID                *EFI_HANDLE;
+typedef VOID                *EFI_EVENT;
+typedef UINTN               EFI_TPL;
+typedef UINT64              EFI_LBA;
+typedef UINT64              EFI_PHYSICAL_ADDRESS;
+typedef UINT64              EFI_VIRTUAL_ADDRESS;
+
+#define IN
+#define OUT
+#define OPTIONAL
+#define CONST               const
+#define EFIAPI
+#define TRUE                ((BOOLEAN) 1)
+#define FALSE               ((BOOLEAN) 0)
+#ifndef NULL
+#define NULL                ((VOID *) 0)
+#endif
+
+#define MAX_BIT             ((UINTN) 1 << (sizeof(UINTN) * 8 - 1))
+#define MAX_ADDRESS         ((UINTN) ~0)
+#define MIN(a, b)           (((a) < (b)) ? (a) : (b))
+#define MAX(a, b)           (((a) > (b)) ? (a) : (b))
+
+#define EFI_FORWARD_DECLARATION(x) typedef struct _##x x
+#define EFI_SIGNATURE_16(A, B)        ((A) | ((B) << 8))
+#define EFI_SIGNATURE_32(A, B, C, D)  (EFI_SIGNATURE_16(A, B) | (EFI_SIGNATURE_16(C, D) << 16))
+#define EFI_SIGNATURE_64(A, B, C, D, E, F, G, H) \
+    (EFI_SIGNATURE_32(A, B, C, D) | ((UINT64) (EFI_SIGNATURE_32(E, F, G, H)) << 32))
+
+#define EFI_PAGE_SIZE       4096
+#define EFI_PAGE_MASK       0xFFF
+#define EFI_PAGE_SHIFT      12
+#define EFI_SIZE_TO_PAGES(a)  (((a) >> EFI_PAGE_SHIFT) + (((a) & EFI_PAGE_MASK) ? 1 : 0))
+
+// Protocol functions are plain C functions on the host, so they're called
+// directly. include/refit_call_wrapper.h casts every argument to UINT64 on
+// x86-64 and ARM64, for GNU-EFI's calling-convention thunks; its uncast
+// forms are defined here instead, so that the compiler still checks the
+// arguments' types.
+#define uefi_call_wrapper(func, va_num, ...) func(__VA_ARGS__)
+
+#define __REFIT_CALL_WRAPPER_H__
+#define refit_call1_wrapper(f, a1) f(a1)
+#define refit_call2_wrapper(f, a1, a2) f(a1, a2)
+#define refit_call3_wrapper(f, a1, a2, a3) f(a1, a2, a3)
+#define refit_call4_wrapper(f, a1, a2, a3, a4) f(a1, a2, a3, a4)
+#define refit_call5_wrapper(f, a1, a2, a3, a4, a5) f(a1, a2, a3, a4, a5)
+#define refit_call6_wrapper(f, a1, a2, a3, a4, a5, a6) f(a1, a2, a3, a4, a5, a6)
+#define refit_call10_wrapper(f, a1, a2, a3, a4, a5, a6, a7, a8, a9, a10) \
+    f(a1, a2, a3, a4, a5, a6, a7, a8, a9, a10)
+
+typedef struct {
+   UINT32  Data1;
+   UINT16  Data2;
+   UINT16  Data3;
+   UINT8   Data4[8];
+} EFI_GUID;
+
+typedef struct {
+   UINT16  Year;
+   UINT8   Month;
+   UINT8   Day;
+   UINT8   Hour;
+   UINT8   Minute;
+   UINT8   Second;
+   UINT8   Pad1;
+   UINT32  Nanosecond;
+   INT16   TimeZone;
+   UINT8   Daylight;
+   UINT8   Pad2;
+} EFI_TIME;
+
+typedef struct {
+   UINT32  Resolution;
+   UINT32  Accuracy;
+   BOOLEAN SetsToZero;
+} EFI_TIME_CAPABILITIES;
+
+typedef struct {
+   UINT8   Addr[32];
+} EFI_MAC_ADDRESS;
+
+typedef struct {
+   UINT8   Addr[4];
+} EFI_IPv4_ADDRESS;
+
+typedef struct {
+   UINT8   Addr[16];
+} EFI_IPv6_ADDRESS;
+
+typedef union {
+   UINT32            Addr[4];
+   EFI_IPv4_ADDRESS  v4;
+   EFI_IPv6_ADDRESS  v6;
+} EFI_IP_ADDRESS;
+
+//
+// Status codes
+//
+
+#define EFI_ERROR_MASK          MAX_BIT
+#define EFIERR(a)               (EFI_ERROR_MASK | (a))
+#define EFI_ERROR(a)            (((INTN) (a)) < 0)
+
+#define EFI_SUCCESS             0
+#define EFI_LOAD_ERROR          EFIERR(1)
+#define EFI_INVALID_PARAMETER   EFIERR(2)
+#define EFI_UNSUPPORTED         EFIERR(3)
+#define EFI_BAD_BUFFER_SIZE     EFIERR(4)
+#define EFI_BUFFER_TOO_SMALL    EFIERR(5)
+#define EFI_NOT_READY           EFIERR(6)
+#define EFI_DEVICE_ERROR        EFIERR(7)
+#define EFI_WRITE_PROTECTED     EFIERR(8)
+#define EFI_OUT_OF_RESOURCES    EFIERR(9)
+#define EFI_VOLUME_CORRUPTED    EFIERR(10)
+#define EFI_VOLUME_FULL         EFIERR(11)
+#define EFI_NO_MEDIA            EFIERR(12)
+#define EFI_MEDIA_CHANGED       EFIERR(13)
+#define EFI_NOT_FOUND           EFIERR(14)
+#define EFI_ACCESS_DENIED       EFIERR(15)
+#define EFI_NO_RESPONSE         EFIERR(16)
+#define EFI_NO_MAPPING          EFIERR(17)
+#define EFI_TIMEOUT             EFIERR(18)
+#define EFI_NOT_STARTED         EFIERR(19)
+#define EFI_ALREADY_STARTED     EFIERR(20)
+#define EFI_ABORTED             EFIERR(21)
+#define EFI_ICMP_ERROR          EFIERR(22)
+#define EFI_TFTP_ERROR          EFIERR(23)
+#define EFI_PROTOCOL_ERROR      EFIERR(24)
+#define EFI_INCOMPATIBLE_VERSION EFIERR(25)
+#define EFI_SECURITY_VIOLATION  EFIERR(26)
+#define EFI_CRC_ERROR           EFIERR(27)
+#define EFI_END_OF_MEDIA        EFIERR(28)
+#define EFI_END_OF_FILE         EFIERR(31)
+#define EFI_INVALID_LANGUAGE    EFIERR(32)
+#define EFI_COMPROMISED_DATA    EFIERR(33)
+
+#define EFI_WARN_UNKOWN_GLYPH   1
+#define EFI_WARN_DELETE_FAILURE 2
+#define EFI_WARN_WRITE_FAILURE  3
+#define EFI_WARN_BUFFER_TOO_SMALL 4
+
+// GNU-EFI's misspelling, which some code uses
+#define EFI_OUT_OF_RESOURCE     EFI_OUT_OF_RESOURCES
+
+//
+// Device paths
+//
+
+typedef struct _EFI_DEVICE_PATH {
+   UINT8   Type;
+   UINT8   SubType;
+   UINT8   Length[2];
+} EFI_DEVICE_PATH;
+
+typedef EFI_DEVICE_PATH EFI_DEVICE_PATH_PROTOCOL;
+
+#define EFI_DP_TYPE_MASK                0x7F
+#define EFI_DP_TYPE_UNPACKED            0x80
+
+#define HARDWARE_DEVICE_PATH            0x01
+#define ACPI_DEVICE_PATH                0x02
+#define MESSAGING_DEVICE_PATH           0x03
+#define MEDIA_DEVICE_PATH               0x04
+#define BBS_DEVICE_PATH                 0x05
+#define END_DEVICE_PATH_TYPE            0x7F
+
+#define END_ENTIRE_DEVICE_PATH_SUBTYPE  0xFF
+#define END_INSTANCE_DEVICE_PATH_SUBTYPE 0x01
+#define END_DEVICE_PATH_LENGTH          (sizeof(EFI_DEVICE_PATH))
+
+#define HW_PCI_DP                       0x01
+#define HW_PCCARD_DP                    0x02
+#define HW_MEMMAP_DP                    0x03
+#define HW_VENDOR_DP                    0x04
+#define HW_CONTROLLER_DP                0x05
+
+#define ACPI_DP                         0x01
+#define EXPANDED_ACPI_DP                0x02
+
+#define MSG_ATAPI_DP                    0x01
+#define MSG_SCSI_DP                     0x02
+#define MSG_FIBRECHANNEL_DP             0x03
+#define MSG_1394_DP                     0x04
+#define MSG_USB_DP                      0x05
+#define MSG_I2O_DP                      0x06
+#define MSG_USB_CLASS_DP                0x0F
+#define MSG_MAC_ADDR_DP                 0x0B
+#define MSG_IPv4_DP                     0x0C
+#define MSG_IPv6_DP                     0x0D
+#define MSG_INFINIBAND_DP               0x09
+#define MSG_UART_DP                     0x0E
+#define MSG_VENDOR_DP                   0x0A
+#define MSG_SATA_DP                     0x12
+#define MSG_DEVICE_LOGICAL_UNIT_DP      0x11
+#define MSG_ISCSI_DP                    0x13
+#define MSG_NVME_NAMESPACE_DP           0x17
+#define MSG_URI_DP                      0x18
+#define MSG_SD_DP                       0x1A
+#define MSG_EMMC_DP                     0x1D
+
+#define MEDIA_HARDDRIVE_DP              0x01
+#define MEDIA_CDROM_DP                  0x02
+#define MEDIA_VENDOR_DP                 0x03
+#define MEDIA_FILEPATH_DP               0x04
+#define MEDIA_PROTOCOL_DP               0x05
+#define MEDIA_PIWG_FW_FILE_DP           0x06
+#define MEDIA_PIWG_FW_VOL_DP            0x07
+
+#define BBS_BBS_DP                      0x01
+
+#define MBR_TYPE_PCAT                   0x01
+#define MBR_TYPE_EFI_PARTITION_TABLE_HEADER 0x02
+#define SIGNATURE_TYPE_MBR              0x01
+#define SIGNATURE_TYPE_GUID             0x02
+
+#pragma pack(1)
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   UINT8           Function;
+   UINT8           Device;
+} PCI_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   EFI_GUID        Guid;
+} VENDOR_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   UINT32          HID;
+   UINT32          UID;
+} ACPI_HID_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   UINT8           ParentPortNumber;
+   UINT8           InterfaceNumber;
+} USB_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   UINT16          HBAPortNumber;
+   UINT16          PortMultiplierPortNumber;
+   UINT16          Lun;
+} SATA_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   UINT8           PrimarySecondary;
+   UINT8           SlaveMaster;
+   UINT16          Lun;
+} ATAPI_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   UINT16          Pun;
+   UINT16          Lun;
+} SCSI_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   EFI_MAC_ADDRESS MacAddress;
+   UINT8           IfType;
+} MAC_ADDR_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   UINT32          PartitionNumber;
+   UINT64          PartitionStart;
+   UINT64          PartitionSize;
+   UINT8           Signature[16];
+   UINT8           MBRType;
+   UINT8           SignatureType;
+} HARDDRIVE_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   UINT32          BootEntry;
+   UINT64          PartitionStart;
+   UINT64          PartitionSize;
+} CDROM_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   CHAR16          PathName[1];
+} FILEPATH_DEVICE_PATH;
+
+#define SIZE_OF_FILEPATH_DEVICE_PATH offsetof(FILEPATH_DEVICE_PATH, PathName)
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   EFI_GUID        Protocol;
+} MEDIA_PROTOCOL_DEVICE_PATH;
+
+typedef struct {
+   EFI_DEVICE_PATH Header;
+   UINT16          DeviceType;
+   UINT16          StatusFlag;
+   CHAR8           String[1];
+} BBS_BBS_DEVICE_PATH;
+
+#pragma pack()
+
+#define BBS_TYPE_FLOPPY                 0x01
+#define BBS_TYPE_HARDDRIVE              0x02
+#define BBS_TYPE_CDROM                  0x03
+#define BBS_TYPE_PCMCIA                 0x04
+#define BBS_TYPE_USB                    0x05
+#define BBS_TYPE_EMBEDDED_NETWORK       0x06
+#define BBS_TYPE_DEV                    0x80
+#define BBS_TYPE_UNKNOWN                0xFF
+
+#define DevicePathType(a)           (((a)->Type) & EFI_DP_TYPE_MASK)
+#define DevicePathSubType(a)        ((a)->SubType)
+#define DevicePathNodeLength(a)     ((UINTN) (((a)->Length[0]) | ((a)->Length[1] << 8)))
+#define NextDevicePathNode(a)       ((EFI_DEVICE_PATH *) (((UINT8 *) (a)) + DevicePathNodeLength(a)))
+#define IsDevicePathEndType(a)      (DevicePathType(a) == END_DEVICE_PATH_TYPE)
+#define IsDevicePathEndSubType(a)   ((a)->SubType == END_ENTIRE_DEVICE_PATH_SUBTYPE)
+#define IsDevicePathEnd(a)          (IsDevicePathEndType(a) && IsDevicePathEndSubType(a))
+#define IsDevicePathUnpacked(a)     ((a)->Type & EFI_DP_TYPE_UNPACKED)
+#define SetDevicePathNodeLength(a, l) {                        \
+            (a)->Length[0] = (UINT8) (l);                      \
+            (a)->Length[1] = (UINT8) ((l) >> 8);               \
+        }
+#define SetDevicePathEndNode(a) {                              \
+            (a)->Type = END_DEVICE_PATH_TYPE;                  \
+            (a)->SubType = END_ENTIRE_DEVICE_PATH_SUBTYPE;     \
+            (a)->Length[0] = sizeof(EFI_DEVICE_PATH);          \
+            (a)->Length[1] = 0;                                \
+        }
+
+//
+// Doubly-linked lists
+//
+
+typedef struct _LIST_ENTRY {
+   struct _LIST_ENTRY  *Flink;
+   struct _LIST_ENTRY  *Blink;
+} LIST_ENTRY;
+
+#define InitializeListHead(ListHead)    \
+    (ListHead)->Flink = ListHead;       \
+    (ListHead)->Blink = ListHead;
+#define IsListEmpty(ListHead)           ((ListHead)->Flink == (ListHead))
+#define RemoveEntryList(Entry) {                        \
+    LIST_ENTRY *_Blink = (Entry)->Blink;                \
+    LIST_ENTRY *_Flink = (Entry)->Flink;                \
+    _Blink->Flink = _Flink;                             \
+    _Flink->Blink = _Blink;                             \
+}
+#define InsertTailList(ListHead, Entry) {               \
+    LIST_ENTRY *_ListHead = ListHead;                   \
+    LIST_ENTRY *_Blink = _ListHead->Blink;              \
+    (Entry)->Flink = _ListHead;                         \
+    (Entry)->Blink = _Blink;                            \
+    _Blink->Flink = (Entry);                            \
+    _ListHead->Blink = (Entry);                         \
+}
+#define InsertHeadList(ListHead, Entry) {               \
+    LIST_ENTRY *_ListHead = ListHead;                   \
+    LIST_ENTRY *_Flink = _ListHead->Flink;              \
+    (Entry)->Flink = _Flink;                            \
+    (Entry)->Blink = _ListHead;                         \
+    _Flink->Blink = (Entry);                            \
+    _ListHead->Flink = (Entry);                         \
+}
+#define _CR(Record, TYPE, Field)        ((TYPE *) ((CHAR8 *) (Record) - (CHAR8 *) &(((TYPE *) 0)->Field)))
+#define CR(Record, TYPE, Field, Signature) _CR(Record, TYPE, Field)
+
+//
+// Tables and services
+//
+
+typedef struct {
+   UINT64  Signature;
+   UINT32  Revision;
+   UINT32  HeaderSize;
+   UINT32  CRC32;
+   UINT32  Reserved;
+} EFI_TABLE_HEADER;
+
+typedef enum {
+   AllocateAnyPages,
+   AllocateMaxAddress,
+   AllocateAddress,
+   MaxAllocateType
+} EFI_ALLOCATE_TYPE;
+
+typedef enum {
+   EfiReservedMemoryType,
+   EfiLoaderCode,
+   EfiLoaderData,
+   EfiBootServicesCode,
+   EfiBootServicesData,
+   EfiRuntimeServicesCode,
+   EfiRuntimeServicesData,
+   EfiConventionalMemory,
+   EfiUnusableMemory,
+   EfiACPIReclaimMemory,
+   EfiACPIMemoryNVS,
+   EfiMemoryMappedIO,
+   EfiMemoryMappedIOPortSpace,
+   EfiPalCode,
+   EfiMaxMemoryType
+} EFI_MEMORY_TYPE;
+
+typedef struct {
+   UINT32                Type;
+   UINT32                Pad;
+   EFI_PHYSICAL_ADDRESS  PhysicalStart;
+   EFI_VIRTUAL_ADDRESS   VirtualStart;
+   UINT64                NumberOfPages;
+   UINT64                Attribute;
+} EFI_MEMORY_DESCRIPTOR;
+
+typedef enum {
+   TimerCancel,
+   TimerPeriodic,
+   TimerRelative,
+   TimerTypeMax
+} EFI_TIMER_DELAY;
+
+typedef enum {
+   EFI_NATIVE_INTERFACE,
+   EFI_PCODE_INTERFACE
+} EFI_INTERFACE_TYPE;
+
+typedef enum {
+   AllHandles,
+   ByRegisterNotify,
+   ByProtocol
+} EFI_LOCATE_SEARCH_TYPE;
+
+typedef enum {
+   EfiResetCold,
+   EfiResetWarm,
+   EfiResetShutdown,
+   EfiResetPlatformSpecific
+} EFI_RESET_TYPE;
+
+#define EVT_TIMER                           0x80000000
+#define EVT_RUNTIME                         0x40000000
+#define EVT_NOTIFY_WAIT                     0x00000100
+#define EVT_NOTIFY_SIGNAL                   0x00000200
+#define EVT_SIGNAL_EXIT_BOOT_SERVICES       0x00000201
+#define EVT_SIGNAL_VIRTUAL_ADDRESS_CHANGE   0x60000202
+
+#define TPL_APPLICATION     4
+#define TPL_CALLBACK        8
+#define TPL_NOTIFY          16
+#define TPL_HIGH_LEVEL      31
+
+#define EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL  0x00000001
+#define EFI_OPEN_PROTOCOL_GET_PROTOCOL        0x00000002
+#define EFI_OPEN_PROTOCOL_TEST_PROTOCOL       0x00000004
+#define EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER 0x00000008
+#define EFI_OPEN_PROTOCOL_BY_DRIVER           0x00000010
+#define EFI_OPEN_PROTOCOL_EXCLUSIVE           0x00000020
+
+typedef struct {
+   EFI_HANDLE  AgentHandle;
+   EFI_HANDLE  ControllerHandle;
+   UINT32      Attributes;
+   UINT32      OpenCount;
+} EFI_OPEN_PROTOCOL_INFORMATION_ENTRY;
+
+#define EFI_VARIABLE_NON_VOLATILE           0x00000001
+#define EFI_VARIABLE_BOOTSERVICE_ACCESS     0x00000002
+#define EFI_VARIABLE_RUNTIME_ACCESS         0x00000004
+#define EFI_MAXIMUM_VARIABLE_SIZE           1024
+
+typedef VOID (EFIAPI *EFI_EVENT_NOTIFY)(IN EFI_EVENT Event, IN VOID *Context);
+
+typedef struct _EFI_BOOT_SERVICES {
+   EFI_TABLE_HEADER  Hdr;
+
+   EFI_TPL     (EFIAPI *RaiseTPL)(IN EFI_TPL NewTpl);
+   VOID        (EFIAPI *RestoreTPL)(IN EFI_TPL OldTpl);
+
+   EFI_STATUS  (EFIAPI *AllocatePages)(IN EFI_ALLOCATE_TYPE Type, IN EFI_MEMORY_TYPE MemoryType,
+                                       IN UINTN NoPages, OUT EFI_PHYSICAL_ADDRESS *Memory);
+   EFI_STATUS  (EFIAPI *FreePages)(IN EFI_PHYSICAL_ADDRESS Memory, IN UINTN NoPages);
+   EFI_STATUS  (EFIAPI *GetMemoryMap)(IN OUT UINTN *MemoryMapSize, IN OUT EFI_MEMORY_DESCRIPTOR *MemoryMap,
+                                      OUT UINTN *MapKey, OUT UINTN *DescriptorSize, OUT UINT32 *DescriptorVersion);
+   EFI_STATUS  (EFIAPI *AllocatePool)(IN EFI_MEMORY_TYPE PoolType, IN UINTN Size, OUT VOID **Buffer);
+   EFI_STATUS  (EFIAPI *FreePool)(IN VOID *Buffer);
+
+   EFI_STATUS  (EFIAPI *CreateEvent)(IN UINT32 Type, IN EFI_TPL NotifyTpl, IN EFI_EVENT_NOTIFY NotifyFunction,
+                                     IN VOID *NotifyContext, OUT EFI_EVENT *Event);
+   EFI_STATUS  (EFIAPI *SetTimer)(IN EFI_EVENT Event, IN EFI_TIMER_DELAY Type, IN UINT64 TriggerTime);
+   EFI_STATUS  (EFIAPI *WaitForEvent)(IN UINTN NumberOfEvents, IN EFI_EVENT *Event, OUT UINTN *Index);
+   EFI_STATUS  (EFIAPI *SignalEvent)(IN EFI_EVENT Event);
+   EFI_STATUS  (EFIAPI *CloseEvent)(IN EFI_EVENT Event);
+   EFI_STATUS  (EFIAPI *CheckEvent)(IN EFI_EVENT Event);
+
+   EFI_STATUS  (EFIAPI *InstallProtocolInterface)(IN OUT EFI_HANDLE *Handle, IN EFI_GUID *Protocol,
+                                                  IN EFI_INTERFACE_TYPE InterfaceType, IN VOID *Interface);
+   EFI_STATUS  (EFIAPI *ReinstallProtocolInterface)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol,
+                                                    IN VOID *OldInterface, IN VOID *NewInterface);
+   EFI_STATUS  (EFIAPI *UninstallProtocolInterface)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, IN VOID *Interface);
+   EFI_STATUS  (EFIAPI *HandleProtocol)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface);
+   VOID        *Reserved;
+   EFI_STATUS  (EFIAPI *RegisterProtocolNotify)(IN EFI_GUID *Protocol, IN EFI_EVENT Event, OUT VOID **Registration);
+   EFI_STATUS  (EFIAPI *LocateHandle)(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol OPTIONAL,
+                                      IN VOID *SearchKey OPTIONAL, IN OUT UINTN *BufferSize, OUT EFI_HANDLE *Buffer);
+   EFI_STATUS  (EFIAPI *LocateDevicePath)(IN EFI_GUID *Protocol, IN OUT EFI_DEVICE_PATH **DevicePath,
+                                          OUT EFI_HANDLE *Device);
+   EFI_STATUS  (EFIAPI *InstallConfigurationTable)(IN EFI_GUID *Guid, IN VOID *Table);
+
+   EFI_STATUS  (EFIAPI *LoadImage)(IN BOOLEAN BootPolicy, IN EFI_HANDLE ParentImageHandle,
+                                   IN EFI_DEVICE_PATH *FilePath, IN VOID *SourceBuffer OPTIONAL,
+                                   IN UINTN SourceSize, OUT EFI_HANDLE *ImageHandle);
+   EFI_STATUS  (EFIAPI *StartImage)(IN EFI_HANDLE ImageHandle, OUT UINTN *ExitDataSize,
+                                    OUT CHAR16 **ExitData OPTIONAL);
+   EFI_STATUS  (EFIAPI *Exit)(IN EFI_HANDLE ImageHandle, IN EFI_STATUS ExitStatus, IN UINTN ExitDataSize,
+                              IN CHAR16 *ExitData OPTIONAL);
+   EFI_STATUS  (EFIAPI *UnloadImage)(IN EFI_HANDLE ImageHandle);
+   EFI_STATUS  (EFIAPI *ExitBootServices)(IN EFI_HANDLE ImageHandle, IN UINTN MapKey);
+
+   EFI_STATUS  (EFIAPI *GetNextMonotonicCount)(OUT UINT64 *Count);
+   EFI_STATUS  (EFIAPI *Stall)(IN UINTN Microseconds);
+   EFI_STATUS  (EFIAPI *SetWatchdogTimer)(IN UINTN Timeout, IN UINT64 WatchdogCode, IN UINTN DataSize,
+                                          IN CHAR16 *WatchdogData OPTIONAL);
+
+   EFI_STATUS  (EFIAPI *ConnectController)(IN EFI_HANDLE ControllerHandle, IN EFI_HANDLE *DriverImageHandle OPTIONAL,
+                                           IN EFI_DEVICE_PATH *RemainingDevicePath OPTIONAL, IN BOOLEAN Recursive);
+   EFI_STATUS  (EFIAPI *DisconnectController)(IN EFI_HANDLE ControllerHandle, IN EFI_HANDLE DriverImageHandle OPTIONAL,
+                                              IN EFI_HANDLE ChildHandle OPTIONAL);
+
+   EFI_STATUS  (EFIAPI *OpenProtocol)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, OUT VOID **Interface OPTIONAL,
+                                      IN EFI_HANDLE AgentHandle, IN EFI_HANDLE ControllerHandle, IN UINT32 Attributes);
+   EFI_STATUS  (EFIAPI *CloseProtocol)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol, IN EFI_HANDLE AgentHandle,
+                                       IN EFI_HANDLE ControllerHandle);
+   EFI_STATUS  (EFIAPI *OpenProtocolInformation)(IN EFI_HANDLE Handle, IN EFI_GUID *Protocol,
+                                                 OUT EFI_OPEN_PROTOCOL_INFORMATION_ENTRY **EntryBuffer,
+                                                 OUT UINTN *EntryCount);
+   EFI_STATUS  (EFIAPI *ProtocolsPerHandle)(IN EFI_HANDLE Handle, OUT EFI_GUID ***ProtocolBuffer,
+                                            OUT UINTN *ProtocolBufferCount);
+   EFI_STATUS  (EFIAPI *LocateHandleBuffer)(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol OPTIONAL,
+                                            IN VOID *SearchKey OPTIONAL, IN OUT UINTN *NoHandles,
+                                            OUT EFI_HANDLE **Buffer);
+   EFI_STATUS  (EFIAPI *LocateProtocol)(IN EFI_GUID *Protocol, IN VOID *Registration OPTIONAL, OUT VOID **Interface);
+   EFI_STATUS  (EFIAPI *InstallMultipleProtocolInterfaces)(IN OUT EFI_HANDLE *Handle, ...);
+   EFI_STATUS  (EFIAPI *UninstallMultipleProtocolInterfaces)(IN OUT EFI_HANDLE Handle, ...);
+
+   EFI_STATUS  (EFIAPI *CalculateCrc32)(IN VOID *Data, IN UINTN DataSize, OUT UINT32 *Crc32);
+   VOID        (EFIAPI *CopyMem)(IN VOID *Destination, IN VOID *Source, IN UINTN Length);
+   VOID        (EFIAPI *SetMem)(IN VOID *Buffer, IN UINTN Size, IN UINT8 Value);
+   EFI_STATUS  (EFIAPI *CreateEventEx)(IN UINT32 Type, IN EFI_TPL NotifyTpl, IN EFI_EVENT_NOTIFY NotifyFunction OPTIONAL,
+                                       IN const VOID *NotifyContext OPTIONAL, IN const EFI_GUID *EventGroup OPTIONAL,
+                                       OUT EFI_EVENT *Event);
+} EFI_BOOT_SERVICES;
+
+typedef struct {
+   EFI_TABLE_HEADER  Hdr;
+
+   EFI_STATUS  (EFIAPI *GetTime)(OUT EFI_TIME *Time, OUT EFI_TIME_CAPABILITIES *Capabilities OPTIONAL);
+   EFI_STATUS  (EFIAPI *SetTime)(IN EFI_TIME *Time);
+   EFI_STATUS  (EFIAPI *GetWakeupTime)(OUT BOOLEAN *Enabled, OUT BOOLEAN *Pending, OUT EFI_TIME *Time);
+   EFI_STATUS  (EFIAPI *SetWakeupTime)(IN BOOLEAN Enable, IN EFI_TIME *Time OPTIONAL);
+
+   EFI_STATUS  (EFIAPI *SetVirtualAddressMap)(IN UINTN MemoryMapSize, IN UINTN DescriptorSize,
+                                              IN UINT32 DescriptorVersion, IN EFI_MEMORY_DESCRIPTOR *VirtualMap);
+   EFI_STATUS  (EFIAPI *ConvertPointer)(IN UINTN DebugDisposition, IN OUT VOID **Address);
+
+   EFI_STATUS  (EFIAPI *GetVariable)(IN CHAR16 *VariableName, IN EFI_GUID *VendorGuid, OUT UINT32 *Attributes OPTIONAL,
+                                     IN OUT UINTN *DataSize, OUT VOID *Data);
+   EFI_STATUS  (EFIAPI *GetNextVariableName)(IN OUT UINTN *VariableNameSize, IN OUT CHAR16 *VariableName,
+                                             IN OUT EFI_GUID *VendorGuid);
+   EFI_STATUS  (EFIAPI *SetVariable)(IN CHAR16 *VariableName, IN EFI_GUID *VendorGuid, IN UINT32 Attributes,
+                                     IN UINTN DataSize, IN VOID *Data);
+
+   EFI_STATUS  (EFIAPI *GetNextHighMonotonicCount)(OUT UINT32 *HighCount);
+   VOID        (EFIAPI *ResetSystem)(IN EFI_RESET_TYPE ResetType, IN EFI_STATUS ResetStatus, IN UINTN DataSize,
+                                     IN CHAR16 *ResetData OPTIONAL);
+
+   VOID        *UpdateCapsule;
+   VOID        *QueryCapsuleCapabilities;
+   VOID        *QueryVariableInfo;
+} EFI_RUNTIME_SERVICES;
+
+typedef struct {
+   EFI_GUID    VendorGuid;
+   VOID        *VendorTable;
+} EFI_CONFIGURATION_TABLE;
+
+//
+// Console
+//
+
+typedef struct {
+   UINT16  ScanCode;
+   CHAR16  UnicodeChar;
+} EFI_INPUT_KEY;
+
+typedef struct _SIMPLE_INPUT_INTERFACE {
+   EFI_STATUS  (EFIAPI *Reset)(IN struct _SIMPLE_INPUT_INTERFACE *This, IN BOOLEAN ExtendedVerification);
+   EFI_STATUS  (EFIAPI *ReadKeyStroke)(IN struct _SIMPLE_INPUT_INTERFACE *This, OUT EFI_INPUT_KEY *Key);
+   EFI_EVENT   WaitForKey;
+} SIMPLE_INPUT_INTERFACE, EFI_SIMPLE_TEXT_INPUT_PROTOCOL;
+
+#define CHAR_NULL               0x0000
+#define CHAR_BACKSPACE          0x0008
+#define CHAR_TAB                0x0009
+#define CHAR_LINEFEED           0x000A
+#define CHAR_CARRIAGE_RETURN    0x000D
+
+#define SCAN_NULL               0x0000
+#define SCAN_UP                 0x0001
+#define SCAN_DOWN               0x0002
+#define SCAN_RIGHT              0x0003
+#define SCAN_LEFT               0x0004
+#define SCAN_HOME               0x0005
+#define SCAN_END                0x0006
+#define SCAN_INSERT             0x0007
+#define SCAN_DELETE             0x0008
+#define SCAN_PAGE_UP            0x0009
+#define SCAN_PAGE_DOWN          0x000A
+#define SCAN_F1                 0x000B
+#define SCAN_F2                 0x000C
+#define SCAN_F3                 0x000D
+#define SCAN_F4                 0x000E
+#define SCAN_F5                 0x000F
+#define SCAN_F6                 0x0010
+#define SCAN_F7                 0x0011
+#define SCAN_F8                 0x0012
+#define SCAN_F9                 0x0013
+#define SCAN_F10                0x0014
+#define SCAN_F11                0x0015
+#define SCAN_F12                0x0016
+#define SCAN_ESC                0x0017
+
+typedef struct {
+   INT32   MaxMode;
+   INT32   Mode;
+   INT32   Attribute;
+   INT32   CursorColumn;
+   INT32   CursorRow;
+   BOOLEAN CursorVisible;
+} SIMPLE_TEXT_OUTPUT_MODE;
+
+typedef struct _SIMPLE_TEXT_OUTPUT_INTERFACE {
+   EFI_STATUS  (EFIAPI *Reset)(IN struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN BOOLEAN ExtendedVerification);
+   EFI_STATUS  (EFIAPI *OutputString)(IN struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN CHAR16 *String);
+   EFI_STATUS  (EFIAPI *TestString)(IN struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN CHAR16 *String);
+   EFI_STATUS  (EFIAPI *QueryMode)(IN struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN UINTN ModeNumber,
+                                   OUT UINTN *Columns, OUT UINTN *Rows);
+   EFI_STATUS  (EFIAPI *SetMode)(IN struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN UINTN ModeNumber);
+   EFI_STATUS  (EFIAPI *SetAttribute)(IN struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN UINTN Attribute);
+   EFI_STATUS  (EFIAPI *ClearScreen)(IN struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This);
+   EFI_STATUS  (EFIAPI *SetCursorPosition)(IN struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN UINTN Column,
+                                           IN UINTN Row);
+   EFI_STATUS  (EFIAPI *EnableCursor)(IN struct _SIMPLE_TEXT_OUTPUT_INTERFACE *This, IN BOOLEAN Enable);
+   SIMPLE_TEXT_OUTPUT_MODE *Mode;
+} SIMPLE_TEXT_OUTPUT_INTERFACE, EFI_SIMPLE_TEXT_OUTPUT_PROTOCOL;
+
+#define EFI_BLACK               0x00
+#define EFI_BLUE                0x01
+#define EFI_GREEN               0x02
+#define EFI_CYAN                (EFI_BLUE | EFI_GREEN)
+#define EFI_RED                 0x04
+#define EFI_MAGENTA             (EFI_BLUE | EFI_RED)
+#define EFI_BROWN               (EFI_GREEN | EFI_RED)
+#define EFI_LIGHTGRAY           (EFI_BLUE | EFI_GREEN | EFI_RED)
+#define EFI_BRIGHT              0x08
+#define EFI_DARKGRAY            (EFI_BRIGHT)
+#define EFI_LIGHTBLUE           (EFI_BLUE | EFI_BRIGHT)
+#define EFI_LIGHTGREEN          (EFI_GREEN | EFI_BRIGHT)
+#define EFI_LIGHTCYAN           (EFI_CYAN | EFI_BRIGHT)
+#define EFI_LIGHTRED            (EFI_RED | EFI_BRIGHT)
+#define EFI_LIGHTMAGENTA        (EFI_MAGENTA | EFI_BRIGHT)
+#define EFI_YELLOW              (EFI_BROWN | EFI_BRIGHT)
+#define EFI_WHITE               (EFI_BLUE | EFI_GREEN | EFI_RED | EFI_BRIGHT)
+#define EFI_TEXT_ATTR(f, b)     ((f) | ((b) << 4))
+#define EFI_BACKGROUND_BLACK    0x00
+#define EFI_BACKGROUND_BLUE     0x10
+#define EFI_BACKGROUND_GREEN    0x20
+#define EFI_BACKGROUND_CYAN     (EFI_BACKGROUND_BLUE | EFI_BACKGROUND_GREEN)
+#define EFI_BACKGROUND_RED      0x40
+#define EFI_BACKGROUND_MAGENTA  (EFI_BACKGROUND_BLUE | EFI_BACKGROUND_RED)
+#define EFI_BACKGROUND_BROWN    (EFI_BACKGROUND_GREEN | EFI_BACKGROUND_RED)
+#define EFI_BACKGROUND_LIGHTGRAY (EFI_BACKGROUND_BLUE | EFI_BACKGROUND_GREEN | EFI_BACKGROUND_RED)
+
+#define BOXDRAW_HORIZONTAL      0x2500
+#define BOXDRAW_VERTICAL        0x2502
+#define BOXDRAW_DOWN_RIGHT      0x250c
+#define BOXDRAW_DOWN_LEFT       0x2510
+#define BOXDRAW_UP_RIGHT        0x2514
+#define BOXDRAW_UP_LEFT         0x2518
+#define BLOCKELEMENT_FULL_BLOCK 0x2588
+#define BLOCKELEMENT_LIGHT_SHADE 0x2591
+#define ARROW_UP                0x2191
+#define ARROW_DOWN              0x2193
+#define ARROW_LEFT              0x2190
+#define ARROW_RIGHT             0x2192
+
+typedef struct {
+   EFI_TABLE_HEADER                 Hdr;
+   CHAR16                           *FirmwareVendor;
+   UINT32                           FirmwareRevision;
+   EFI_HANDLE                       ConsoleInHandle;
+   SIMPLE_INPUT_INTERFACE           *ConIn;
+   EFI_HANDLE                       ConsoleOutHandle;
+   SIMPLE_TEXT_OUTPUT_INTERFACE     *ConOut;
+   EFI_HANDLE                       StandardErrorHandle;
+   SIMPLE_TEXT_OUTPUT_INTERFACE     *StdErr;
+   EFI_RUNTIME_SERVICES             *RuntimeServices;
+   EFI_BOOT_SERVICES                *BootServices;
+   UINTN                            NumberOfTableEntries;
+   EFI_CONFIGURATION_TABLE          *ConfigurationTable;
+} EFI_SYSTEM_TABLE;
+
+#define EFI_SYSTEM_TABLE_SIGNATURE      0x5453595320494249ULL
+#define EFI_2_00_SYSTEM_TABLE_REVISION  ((2 << 16) | 0)
+#define EFI_SPECIFICATION_VERSION       EFI_2_00_SYSTEM_TABLE_REVISION
+
+typedef EFI_STATUS (EFIAPI *EFI_IMAGE_ENTRY_POINT)(IN EFI_HANDLE ImageHandle, IN EFI_SYSTEM_TABLE *SystemTable);
+
+//
+// Files
+//
+
+EFI_FORWARD_DECLARATION(EFI_FILE);
+typedef struct _EFI_FILE *EFI_FILE_HANDLE;
+typedef EFI_FILE EFI_FILE_PROTOCOL;
+
+#define EFI_FILE_MODE_READ      0x0000000000000001ULL
+#define EFI_FILE_MODE_WRITE     0x0000000000000002ULL
+#define EFI_FILE_MODE_CREATE    0x8000000000000000ULL
+
+#define EFI_FILE_READ_ONLY      0x0000000000000001ULL
+#define EFI_FILE_HIDDEN         0x0000000000000002ULL
+#define EFI_FILE_SYSTEM         0x0000000000000004ULL
+#define EFI_FILE_RESERVED       0x0000000000000008ULL
+#define EFI_FILE_DIRECTORY      0x0000000000000010ULL
+#define EFI_FILE_ARCHIVE        0x0000000000000020ULL
+#define EFI_FILE_VALID_ATTR     0x0000000000000037ULL
+
+#define EFI_FILE_HANDLE_REVISION 0x00010000
+
+typedef EFI_STATUS (EFIAPI *EFI_FILE_OPEN)(IN EFI_FILE_HANDLE File, OUT EFI_FILE_HANDLE *NewHandle,
+                                           IN CHAR16 *FileName, IN UINT64 OpenMode, IN UINT64 Attributes);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_CLOSE)(IN EFI_FILE_HANDLE File);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_DELETE)(IN EFI_FILE_HANDLE File);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_READ)(IN EFI_FILE_HANDLE File, IN OUT UINTN *BufferSize, OUT VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_WRITE)(IN EFI_FILE_HANDLE File, IN OUT UINTN *BufferSize, IN VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_SET_POSITION)(IN EFI_FILE_HANDLE File, IN UINT64 Position);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_GET_POSITION)(IN EFI_FILE_HANDLE File, OUT UINT64 *Position);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_GET_INFO)(IN EFI_FILE_HANDLE File, IN EFI_GUID *InformationType,
+                                               IN OUT UINTN *BufferSize, OUT VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_SET_INFO)(IN EFI_FILE_HANDLE File, IN EFI_GUID *InformationType,
+                                               IN UINTN BufferSize, IN VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_FILE_FLUSH)(IN EFI_FILE_HANDLE File);
+
+typedef struct _EFI_FILE {
+   UINT64                 Revision;
+   EFI_FILE_OPEN          Open;
+   EFI_FILE_CLOSE         Close;
+   EFI_FILE_DELETE        Delete;
+   EFI_FILE_READ          Read;
+   EFI_FILE_WRITE         Write;
+   EFI_FILE_GET_POSITION  GetPosition;
+   EFI_FILE_SET_POSITION  SetPosition;
+   EFI_FILE_GET_INFO      GetInfo;
+   EFI_FILE_SET_INFO      SetInfo;
+   EFI_FILE_FLUSH         Flush;
+} EFI_FILE;
+
+typedef struct _EFI_FILE_IO_INTERFACE {
+   UINT64      Revision;
+   EFI_STATUS  (EFIAPI *OpenVolume)(IN struct _EFI_FILE_IO_INTERFACE *This, OUT EFI_FILE_HANDLE *Root);
+} EFI_FILE_IO_INTERFACE, EFI_SIMPLE_FILE_SYSTEM_PROTOCOL;
+
+#define EFI_FILE_INFO_ID \
+    { 0x09576e92, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
+#define EFI_FILE_SYSTEM_INFO_ID \
+    { 0x09576e93, 0x6d3f, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
+#define EFI_FILE_SYSTEM_VOLUME_LABEL_INFO_ID \
+    { 0xdb47d7d3, 0xfe81, 0x11d3, { 0x9a, 0x35, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d } }
+#define EFI_FILE_SYSTEM_VOLUME_LABEL_ID EFI_FILE_SYSTEM_VOLUME_LABEL_INFO_ID
+
+typedef struct {
+   UINT64      Size;
+   UINT64      FileSize;
+   UINT64      PhysicalSize;
+   EFI_TIME    CreateTime;
+   EFI_TIME    LastAccessTime;
+   EFI_TIME    ModificationTime;
+   UINT64      Attribute;
+   CHAR16      FileName[1];
+} EFI_FILE_INFO;
+
+#define SIZE_OF_EFI_FILE_INFO offsetof(EFI_FILE_INFO, FileName)
+
+typedef struct {
+   UINT64      Size;
+   BOOLEAN     ReadOnly;
+   UINT64      VolumeSize;
+   UINT64      FreeSpace;
+   UINT32      BlockSize;
+   CHAR16      VolumeLabel[1];
+} EFI_FILE_SYSTEM_INFO;
+
+#define SIZE_OF_EFI_FILE_SYSTEM_INFO offsetof(EFI_FILE_SYSTEM_INFO, VolumeLabel)
+
+typedef struct {
+   CHAR16      VolumeLabel[1];
+} EFI_FILE_SYSTEM_VOLUME_LABEL;
+
+#define SIZE_OF_EFI_FILE_SYSTEM_VOLUME_LABEL_INFO offsetof(EFI_FILE_SYSTEM_VOLUME_LABEL, VolumeLabel)
+
+//
+// Block and disk I/O
+//
+
+typedef struct {
+   UINT32      MediaId;
+   BOOLEAN     RemovableMedia;
+   BOOLEAN     MediaPresent;
+   BOOLEAN     LogicalPartition;
+   BOOLEAN     ReadOnly;
+   BOOLEAN     WriteCaching;
+   UINT32      BlockSize;
+   UINT32      IoAlign;
+   EFI_LBA     LastBlock;
+   EFI_LBA     LowestAlignedLba;
+   UINT32      LogicalBlocksPerPhysicalBlock;
+   UINT32      OptimalTransferLengthGranularity;
+} EFI_BLOCK_IO_MEDIA;
+
+EFI_FORWARD_DECLARATION(EFI_BLOCK_IO);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_RESET)(IN EFI_BLOCK_IO *This, IN BOOLEAN ExtendedVerification);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_READ)(IN EFI_BLOCK_IO *This, IN UINT32 MediaId, IN EFI_LBA LBA,
+                                            IN UINTN BufferSize, OUT VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_WRITE)(IN EFI_BLOCK_IO *This, IN UINT32 MediaId, IN EFI_LBA LBA,
+                                             IN UINTN BufferSize, IN VOID *Buffer);
+typedef EFI_STATUS (EFIAPI *EFI_BLOCK_FLUSH)(IN EFI_BLOCK_IO *This);
+
+struct _EFI_BLOCK_IO {
+   UINT64              Revision;
+   EFI_BLOCK_IO_MEDIA  *Media;
+   EFI_BLOCK_RESET     Reset;
+   EFI_BLOCK_READ      ReadBlocks;
+   EFI_BLOCK_WRITE     WriteBlocks;
+   EFI_BLOCK_FLUSH     FlushBlocks;
+};
+typedef EFI_BLOCK_IO EFI_BLOCK_IO_PROTOCOL;
+
+typedef struct _EFI_DISK_IO {
+   UINT64      Revision;
+   EFI_STATUS  (EFIAPI *ReadDisk)(IN struct _EFI_DISK_IO *This, IN UINT32 MediaId, IN UINT64 Offset,
+                                  IN UINTN BufferSize, OUT VOID *Buffer);
+   EFI_STATUS  (EFIAPI *WriteDisk)(IN struct _EFI_DISK_IO *This, IN UINT32 MediaId, IN UINT64 Offset,
+                                   IN UINTN BufferSize, IN VOID *Buffer);
+} EFI_DISK_IO, EFI_DISK_IO_PROTOCOL;
+
+//
+// Loaded images and loading files
+//
+
+typedef struct {
+   UINT32              Revision;
+   EFI_HANDLE          ParentHandle;
+   EFI_SYSTEM_TABLE    *SystemTable;
+   EFI_HANDLE          DeviceHandle;
+   EFI_DEVICE_PATH     *FilePath;
+   VOID                *Reserved;
+   UINT32              LoadOptionsSize;
+   VOID                *LoadOptions;
+   VOID                *ImageBase;
+   UINT64              ImageSize;
+   EFI_MEMORY_TYPE     ImageCodeType;
+   EFI_MEMORY_TYPE     ImageDataType;
+   EFI_STATUS          (EFIAPI *Unload)(IN EFI_HANDLE ImageHandle);
+} EFI_LOADED_IMAGE, EFI_LOADED_IMAGE_PROTOCOL;
+
+#define EFI_IMAGE_INFORMATION_REVISION  0x1000
+
+typedef struct _EFI_LOAD_FILE_PROTOCOL {
+   EFI_STATUS  (EFIAPI *LoadFile)(IN struct _EFI_LOAD_FILE_PROTOCOL *This, IN EFI_DEVICE_PATH *FilePath,
+                                  IN BOOLEAN BootPolicy, IN OUT UINTN *BufferSize, IN VOID *Buffer OPTIONAL);
+} EFI_LOAD_FILE_PROTOCOL, EFI_LOAD_FILE_INTERFACE;
+
+typedef EFI_LOAD_FILE_PROTOCOL EFI_LOAD_FILE2_PROTOCOL;
+
+//
+// Graphics output
+//
+
+typedef struct {
+   UINT32  RedMask;
+   UINT32  GreenMask;
+   UINT32  BlueMask;
+   UINT32  ReservedMask;
+} EFI_PIXEL_BITMASK;
+
+typedef enum {
+   PixelRedGreenBlueReserved8BitPerColor,
+   PixelBlueGreenRedReserved8BitPerColor,
+   PixelBitMask,
+   PixelBltOnly,
+   PixelFormatMax
+} EFI_GRAPHICS_PIXEL_FORMAT;
+
+typedef struct {
+   UINT32                     Version;
+   UINT32                     HorizontalResolution;
+   UINT32                     VerticalResolution;
+   EFI_GRAPHICS_PIXEL_FORMAT  PixelFormat;
+   EFI_PIXEL_BITMASK          PixelInformation;
+   UINT32                     PixelsPerScanLine;
+} EFI_GRAPHICS_OUTPUT_MODE_INFORMATION;
+
+typedef struct {
+   UINT32                                MaxMode;
+   UINT32                                Mode;
+   EFI_GRAPHICS_OUTPUT_MODE_INFORMATION  *Info;
+   UINTN                                 SizeOfInfo;
+   EFI_PHYSICAL_ADDRESS                  FrameBufferBase;
+   UINTN                                 FrameBufferSize;
+} EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE;
+
+typedef struct {
+   UINT8   Blue;
+   UINT8   Green;
+   UINT8   Red;
+   UINT8   Reserved;
+} EFI_GRAPHICS_OUTPUT_BLT_PIXEL;
+
+typedef enum {
+   EfiBltVideoFill,
+   EfiBltVideoToBltBuffer,
+   EfiBltBufferToVideo,
+   EfiBltVideoToVideo,
+   EfiGraphicsOutputBltOperationMax
+} EFI_GRAPHICS_OUTPUT_BLT_OPERATION;
+
+typedef struct _EFI_GRAPHICS_OUTPUT_PROTOCOL {
+   EFI_STATUS  (EFIAPI *QueryMode)(IN struct _EFI_GRAPHICS_OUTPUT_PROTOCOL *This, IN UINT32 ModeNumber,
+                                   OUT UINTN *SizeOfInfo, OUT EFI_GRAPHICS_OUTPUT_MODE_INFORMATION **Info);
+   EFI_STATUS  (EFIAPI *SetMode)(IN struct _EFI_GRAPHICS_OUTPUT_PROTOCOL *This, IN UINT32 ModeNumber);
+   EFI_STATUS  (EFIAPI *Blt)(IN struct _EFI_GRAPHICS_OUTPUT_PROTOCOL *This,
+                             IN OUT EFI_GRAPHICS_OUTPUT_BLT_PIXEL *BltBuffer OPTIONAL,
+                             IN EFI_GRAPHICS_OUTPUT_BLT_OPERATION BltOperation, IN UINTN SourceX, IN UINTN SourceY,
+                             IN UINTN DestinationX, IN UINTN DestinationY, IN UINTN Width, IN UINTN Height,
+                             IN UINTN Delta OPTIONAL);
+   EFI_GRAPHICS_OUTPUT_PROTOCOL_MODE *Mode;
+} EFI_GRAPHICS_OUTPUT_PROTOCOL;
+
+#define EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID \
+    { 0x9042a9de, 0x23dc, 0x4a38, { 0x96, 0xfb, 0x7a, 0xde, 0xd0, 0x80, 0x51, 0x6a } }
+
+//
+// Pointers
+//
+
+typedef struct {
+   INT32   RelativeMovementX;
+   INT32   RelativeMovementY;
+   INT32   RelativeMovementZ;
+   BOOLEAN LeftButton;
+   BOOLEAN RightButton;
+} EFI_SIMPLE_POINTER_STATE;
+
+typedef struct {
+   UINT64  ResolutionX;
+   UINT64  ResolutionY;
+   UINT64  ResolutionZ;
+   BOOLEAN LeftButton;
+   BOOLEAN RightButton;
+} EFI_SIMPLE_POINTER_MODE;
+
+typedef struct _EFI_SIMPLE_POINTER_PROTOCOL {
+   EFI_STATUS  (EFIAPI *Reset)(IN struct _EFI_SIMPLE_POINTER_PROTOCOL *This, IN BOOLEAN ExtendedVerification);
+   EFI_STATUS  (EFIAPI *GetState)(IN struct _EFI_SIMPLE_POINTER_PROTOCOL *This, IN OUT EFI_SIMPLE_POINTER_STATE *State);
+   EFI_EVENT   WaitForInput;
+   EFI_SIMPLE_POINTER_MODE *Mode;
+} EFI_SIMPLE_POINTER_PROTOCOL;
+
+#define EFI_SIMPLE_POINTER_PROTOCOL_GUID \
+    { 0x31878c87, 0x0b75, 0x11d5, { 0x9a, 0x4f, 0x00, 0x90, 0x27, 0x3f, 0xc1, 0x4d } }
+
+//
+// Well-known GUIDs
+//
+
+#define EFI_GLOBAL_VARIABLE \
+    { 0x8be4df61, 0x93ca, 0x11d2, { 0xaa, 0x0d, 0x00, 0xe0, 0x98, 0x03, 0x2b, 0x8c } }
+#define EFI_LOADED_IMAGE_PROTOCOL_GUID \
+    { 0x5b1b31a1, 0x9562, 0x11d2, { 0x8e, 0x3f, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
+#define LOADED_IMAGE_PROTOCOL EFI_LOADED_IMAGE_PROTOCOL_GUID
+#define SIMPLE_FILE_SYSTEM_PROTOCOL \
+    { 0x964e5b22, 0x6459, 0x11d2, { 0x8e, 0x39, 0x00, 0xa0, 0xc9, 0x69, 0x72, 0x3b } }
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * host/include/efilib.h
+ * Stand-in for GNU-EFI's efilib.h, for building rEFInd as a host program
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// The GNU-EFI library functions and globals that rEFInd uses. They're
+// implemented in host/efilib.c, on top of the mock firmware.
+
+#ifndef __HOST_EFILIB_H_
+#define __HOST_EFILIB_H_
+
+#include "efi.h"
+
+extern EFI_SYSTEM_TABLE        *ST;
+extern EFI_BOOT_SERVICES       *BS;
+extern EFI_RUNTIME_SERVICES    *RT;
+extern EFI_HANDLE              LibImageHandle;
+
+extern EFI_DEVICE_PATH         EndDevicePath[];
+
+extern EFI_GUID gEfiBlockIoProtocolGuid;
+extern EFI_GUID gEfiDiskIoProtocolGuid;
+extern EFI_GUID gEfiSimpleFileSystemProtocolGuid;
+extern EFI_GUID gEfiLoadedImageProtocolGuid;
+extern EFI_GUID gEfiDevicePathProtocolGuid;
+extern EFI_GUID gEfiSimpleTextInProtocolGuid;
+extern EFI_GUID gEfiSimpleTextOutProtocolGuid;
+extern EFI_GUID gEfiGraphicsOutputProtocolGuid;
+extern EFI_GUID gEfiSimplePointerProtocolGuid;
+extern EFI_GUID gEfiLoadFileProtocolGuid;
+extern EFI_GUID gEfiLoadFile2ProtocolGuid;
+extern EFI_GUID gEfiGlobalVariableGuid;
+extern EFI_GUID gEfiFileInfoGuid;
+extern EFI_GUID gEfiFileSystemInfoGuid;
+extern EFI_GUID gEfiFileSystemVolumeLabelInfoIdGuid;
+
+// GNU-EFI's older names for the same GUIDs
+#define BlockIoProtocol                 gEfiBlockIoProtocolGuid
+#define DiskIoProtocol                  gEfiDiskIoProtocolGuid
+#define FileSystemProtocol              gEfiSimpleFileSystemProtocolGuid
+#define LoadedImageProtocol             gEfiLoadedImageProtocolGuid
+#define DevicePathProtocol              gEfiDevicePathProtocolGuid
+#define TextInProtocol                  gEfiSimpleTextInProtocolGuid
+#define TextOutProtocol                 gEfiSimpleTextOutProtocolGuid
+#define GraphicsOutputProtocol          gEfiGraphicsOutputProtocolGuid
+#define LoadFileProtocol                gEfiLoadFileProtocolGuid
+#define EfiGlobalVariable               gEfiGlobalVariableGuid
+#define GenericFileInfo                 gEfiFileInfoGuid
+#define FileSystemInfo                  gEfiFileSystemInfoGuid
+#define FileSystemVolumeLabelInfo       gEfiFileSystemVolumeLabelInfoIdGuid
+
+#define ASSERT(a)
+
+typedef struct {
+   CHAR16  *str;
+   UINTN   len;
+   UINTN   maxlen;
+} POOL_PRINT;
+
+VOID InitializeLib(IN EFI_HANDLE ImageHandle, IN EFI_SYSTEM_TABLE *SystemTable);
+
+//
+// Memory
+//
+
+VOID *AllocatePool(IN UINTN Size);
+VOID *AllocateZeroPool(IN UINTN Size);
+VOID *ReallocatePool(IN VOID *OldPool, IN UINTN OldSize, IN UINTN NewSize);
+VOID FreePool(IN VOID *p);
+VOID ZeroMem(IN VOID *Buffer, IN UINTN Size);
+VOID SetMem(IN VOID *Buffer, IN UINTN Size, IN UINT8 Value);
+VOID CopyMem(IN VOID *Dest, IN CONST VOID *Src, IN UINTN len);
+INTN CompareMem(IN CONST VOID *Dest, IN CONST VOID *Src, IN UINTN len);
+INTN CompareGuid(IN EFI_GUID *Guid1, IN EFI_GUID *Guid2);
+
+//
+// Strings
+//
+
+INTN StrCmp(IN CONST CHAR16 *s1, IN CONST CHAR16 *s2);
+INTN StrnCmp(IN CONST CHAR16 *s1, IN CONST CHAR16 *s2, IN UINTN len);
+INTN StriCmp(IN CONST CHAR16 *s1, IN CONST CHAR16 *s2);
+VOID StrLwr(IN CHAR16 *Str);
+VOID StrUpr(IN CHAR16 *Str);
+VOID StrCpy(IN CHAR16 *Dest, IN CONST CHAR16 *Src);
+VOID StrnCpy(IN CHAR16 *Dest, IN CONST CHAR16 *Src, IN UINTN Len);
+VOID StrCat(IN CHAR16 *Dest, IN CONST CHAR16 *Src);
+VOID StrnCat(IN CHAR16 *Dest, IN CONST CHAR16 *Src, IN UINTN Len);
+UINTN StrLen(IN CONST CHAR16 *s1);
+UINTN StrSize(IN CONST CHAR16 *s1);
+CHAR16 *StrDuplicate(IN CONST CHAR16 *Src);
+UINTN strlena(IN CONST CHAR8 *s1);
+UINTN strcmpa(IN CONST CHAR8 *s1, IN CONST CHAR8 *s2);
+UINTN strncmpa(IN CONST CHAR8 *s1, IN CONST CHAR8 *s2, IN UINTN len);
+UINTN xtoi(IN CONST CHAR16 *str);
+UINTN Atoi(IN CONST CHAR16 *str);
+BOOLEAN MetaiMatch(IN CHAR16 *String, IN CHAR16 *Pattern);
+VOID StatusToString(OUT CHAR16 *Buffer, IN EFI_STATUS Status);
+
+//
+// Printing
+//
+
+UINTN Print(IN CONST CHAR16 *fmt, ...);
+UINTN SPrint(OUT CHAR16 *Str, IN UINTN StrSize, IN CONST CHAR16 *fmt, ...);
+UINTN VSPrint(OUT CHAR16 *Str, IN UINTN StrSize, IN CONST CHAR16 *fmt, va_list args);
+CHAR16 *PoolPrint(IN CONST CHAR16 *fmt, ...);
+CHAR16 *VPoolPrint(IN CONST CHAR16 *fmt, va_list args);
+
+//
+// Device paths
+//
+
+EFI_DEVICE_PATH *DevicePathFromHandle(IN EFI_HANDLE Handle);
+EFI_DEVICE_PATH *AppendDevicePath(IN EFI_DEVICE_PATH *Src1, IN EFI_DEVICE_PATH *Src2);
+EFI_DEVICE_PATH *AppendDevicePathNode(IN EFI_DEVICE_PATH *Src1, IN EFI_DEVICE_PATH *Src2);
+EFI_DEVICE_PATH *FileDevicePath(IN EFI_HANDLE Device OPTIONAL, IN CHAR16 *FileName);
+UINTN DevicePathSize(IN EFI_DEVICE_PATH *DevPath);
+EFI_DEVICE_PATH *DuplicateDevicePath(IN EFI_DEVICE_PATH *DevPath);
+CHAR16 *DevicePathToStr(EFI_DEVICE_PATH *DevPath);
+
+//
+// Protocols and files
+//
+
+EFI_STATUS LibLocateProtocol(IN EFI_GUID *ProtocolGuid, OUT VOID **Interface);
+EFI_STATUS LibLocateHandle(IN EFI_LOCATE_SEARCH_TYPE SearchType, IN EFI_GUID *Protocol OPTIONAL,
+                           IN VOID *SearchKey OPTIONAL, IN OUT UINTN *NoHandles, OUT EFI_HANDLE **Buffer);
+EFI_FILE_HANDLE LibOpenRoot(IN EFI_HANDLE DeviceHandle);
+EFI_FILE_INFO *LibFileInfo(IN EFI_FILE_HANDLE FHand);
+EFI_FILE_SYSTEM_INFO *LibFileSystemInfo(IN EFI_FILE_HANDLE FHand);
+EFI_FILE_SYSTEM_VOLUME_LABEL *LibFileSystemVolumeLabelInfo(IN EFI_FILE_HANDLE FHand);
+
+#define EFI_HANDLE_TYPE_UNKNOWN                     0x000
+#define EFI_HANDLE_TYPE_IMAGE_HANDLE                0x001
+#define EFI_HANDLE_TYPE_DRIVER_BINDING_HANDLE       0x002
+#define EFI_HANDLE_TYPE_DEVICE_DRIVER               0x004
+#define EFI_HANDLE_TYPE_BUS_DRIVER                  0x008
+#define EFI_HANDLE_TYPE_DRIVER_CONFIGURATION_HANDLE 0x010
+#define EFI_HANDLE_TYPE_DRIVER_DIAGNOSTICS_HANDLE   0x020
+#define EFI_HANDLE_TYPE_COMPONENT_NAME_HANDLE       0x040
+#define EFI_HANDLE_TYPE_DEVICE_HANDLE               0x080
+#define EFI_HANDLE_TYPE_PARENT_HANDLE               0x100
+#define EFI_HANDLE_TYPE_CONTROLLER_HANDLE           0x200
+#define EFI_HANDLE_TYPE_CHILD_HANDLE                0x400
+
+#endif
@@ -1,30 +1,26 @@
 #include "libegint.h"
 
 
-static VOID drawRectangle(EG_IMAGE img, UINTN x, UINTN y, UINTN width, UINTN height,
-			   EG_PIXEL color) {
-
-  for (int i = x; i < x + width; i++) {
-    if(i >= img.Width) break;
-
-    for (int j = y; j < y+height; j++) {
-      if (j >= img.Height) break;
-
-      img.PixelData[img.Height * j + i] = color;
-    }
-  }
-}
-    
-
-static VOID drawGrid(EG_IMAGE img, UINTN xi, UINTN yi, UINTN xis, UINTN yis, UINTN xs, UINTN ys,
-		      UINTN xoff, UINTN yoff, EG_PIXEL color)
-{
-  UINTN x = xi * xs / xis + xoff;
-  UINTN y = yi * ys / yis + yoff;
-  UINTN xw = (xi+1) * xs / xis + xoff - x;
-  UINTN yw = (yi+1) * ys / yis + yoff - y;
-
-  drawRectangle(img, x, y, xw, yw, color);
+//number of identicons kept by egDrawIdenticon(), so that rescans and re-layouts of the
+//menu don't have to draw them again
+#define IDENTICON_CACHE_SIZE 64
+#define IDENTICON_MAX_HASH 32
+
+typedef struct {
+  UINTN IconSize;
+  UINTN HashLength;
+  unsigned char Hash[IDENTICON_MAX_HASH];
+  EG_IMAGE *Image;
+} IDENTICON_CACHE_ENTRY;
+
+static IDENTICON_CACHE_ENTRY IdenticonCache[IDENTICON_CACHE_SIZE];
+static UINTN IdenticonCacheNext = 0;
+
+
+//fill Count pixels starting at Dest with color
+static VOID fillSpan(EG_PIXEL *Dest, UINTN Count, EG_PIXEL color) {
+  while (Count-- > 0)
+    *Dest++ = color;
 }
 
 
@@ -54,11 +50,11 @@ static EG_PIXEL chooseColor(unsigned char* hash, int length, int mod, int off)
 /**
  * Draw an identicon. Only up to the first 32 characters are used (enough to cover sha256).
  */
-EG_IMAGE *egDrawIdenticon(IN UINTN IconSize, UINTN hashlen, unsigned char *hash) {
-  if(hash == NULL) return NULL;
-
+static EG_IMAGE *rasterizeIdenticon(UINTN IconSize, UINTN hashlen, unsigned char *hash) {
   UINTN w = IconSize;
   UINTN h = IconSize;
+  UINT16 rows[16];
+  UINTN colStart[33];
 
   EG_IMAGE *Image = egCreateImage(w,h, FALSE);
   if(Image == NULL) return NULL;
@@ -68,26 +64,82 @@ EG_IMAGE *egDrawIdenticon(IN UINTN IconSize, UINTN hashlen, unsigned char *hash)
   EG_PIXEL colors[2] = {chooseColor(hash,hashlen,63,128+64),
 			chooseColor(hash,hashlen,92,0)};
 
+  //each of the 32 bytes of (wrapped) hash supplies 8 bits of the 16x16 grid, row by row
   for (int i = 0; i < 32; i++) {
-    
     //if the hash is too short, we wrap around. We don't want to recopy the exact same bytes,
     //so we xor with i to make it slightly different each time around
     unsigned char hi = hash[i % hashlen] ^ i;
 
-    for(int j = 0; j < 8; j++) {
-      int ci = (hi >> j) & 1;
-      EG_PIXEL color = colors[ci];
-      int index = (i << 3) | j;
-      int x = index & 15;
-      int y = index >> 4;
-      //printf ("index is %d, x is %d, y is %d, ci is %d, hi is %d, i is %d, j is %d\n",index,x,y,ci,hi,i,j);
-      
-      //now we have an 16x16 position
-      //we mirror the image left and right to make it more pretty for the user, creating a 32x16, which
-      //we squish into the dimensions provided
-      drawGrid(*Image, x, y, 16,16,w/2,h,0,0,color);
-      drawGrid(*Image, 15-x, y, 16,16,w-w/2,h,w/2,0,color);
+    if (i & 1)
+      rows[i >> 1] |= (UINT16) hi << 8;
+    else
+      rows[i >> 1] = hi;
+  }
+
+  //we mirror the grid left and right to make it more pretty for the user, creating 32x16 cells,
+  //which we squish into the dimensions provided: cells 0-15 cover the left w/2 pixels and cells
+  //16-31 the rest. All edges are whole pixels, so when IconSize is a multiple of 32, every cell
+  //is exactly the same size.
+  for (int c = 0; c < 16; c++) {
+    colStart[c] = c * (w/2) / 16;
+    colStart[c + 16] = w/2 + c * (w - w/2) / 16;
+  }
+  colStart[32] = w;
+
+  for (int y = 0; y < 16; y++) {
+    UINTN top = y * h / 16;
+    UINTN bottom = (y + 1) * h / 16;
+    EG_PIXEL *row = Image->PixelData + top * w;
+
+    if (top == bottom)
+      continue;
+
+    //draw the first pixel row of this grid row as spans of color, one per cell...
+    for (int c = 0; c < 32; c++) {
+      int x = (c < 16) ? c : 31 - c;
+      fillSpan(row + colStart[c], colStart[c + 1] - colStart[c], colors[(rows[y] >> x) & 1]);
+    }
+    //...then duplicate it for the rest of the grid row
+    for (UINTN py = top + 1; py < bottom; py++)
+      CopyMem(Image->PixelData + py * w, row, w * sizeof(EG_PIXEL));
+  }
+
+  return Image;
+}
+
+
+/**
+ * Draw an identicon. Only up to the first 32 characters are used (enough to cover sha256).
+ * Identicons are cached by size and hash, so a given one is drawn only once; the caller
+ * owns (and must free) the returned copy.
+ */
+EG_IMAGE *egDrawIdenticon(IN UINTN IconSize, UINTN hashlen, unsigned char *hash) {
+  if(hash == NULL || hashlen == 0) return NULL;
+
+  //chooseColor() uses the whole hash, so it's only cached if it fits in full
+  BOOLEAN cacheable = (hashlen <= IDENTICON_MAX_HASH);
+
+  if (cacheable) {
+    for (int i = 0; i < IDENTICON_CACHE_SIZE; i++) {
+      IDENTICON_CACHE_ENTRY *entry = &IdenticonCache[i];
+      if (entry->Image != NULL && entry->IconSize == IconSize && entry->HashLength == hashlen &&
+          CompareMem(entry->Hash, hash, hashlen) == 0)
+        return egCopyImage(entry->Image);
+    }
+  }
 
+  EG_IMAGE *Image = rasterizeIdenticon(IconSize, hashlen, hash);
+
+  if (cacheable && Image != NULL) {
+    IDENTICON_CACHE_ENTRY *entry = &IdenticonCache[IdenticonCacheNext];
+    EG_IMAGE *cached = egCopyImage(Image);
+    if (cached != NULL) {
+      egFreeImage(entry->Image);
+      entry->Image = cached;
+      entry->IconSize = IconSize;
+      entry->HashLength = hashlen;
+      CopyMem(entry->Hash, hash, hashlen);
+      IdenticonCacheNext = (IdenticonCacheNext + 1) % IDENTICON_CACHE_SIZE;
     }
   }
 
@@ -60,6 +60,7 @@
 #include "../refind/lib.h"
 #include "../refind/screen.h"
 #include "../refind/mystrings.h"
+#include "../refind/log.h"
 #include "../include/refit_call_wrapper.h"
 #include "lodepng.h"
 #include "libeg.h"
@@ -330,14 +331,16 @@ EFI_STATUS egSaveFile(IN EFI_FILE* BaseDir OPTIONAL, IN CHAR16 *FileName,
 // Loading images from files and embedded data
 //
 
-// Decode the specified image data. The IconSize parameter is relevant only
-// for ICNS, for which it selects which ICNS sub-image is decoded.
+// Decode the specified image data. IconSize is the size to which the caller
+// will scale the image, or 0 if the image is wanted at its natural size. For
+// ICNS, it selects which ICNS sub-image is decoded; the PNG decoder uses it
+// to shrink large images as they're decoded.
 // Returns a pointer to the resulting EG_IMAGE or NULL if decoding failed.
 static EG_IMAGE * egDecodeAny(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN IconSize, IN BOOLEAN WantAlpha)
 {
    EG_IMAGE        *NewImage = NULL;
 
-   NewImage = egDecodeICNS(FileData, FileDataLength, IconSize, WantAlpha);
+   NewImage = egDecodeICNS(FileData, FileDataLength, (IconSize > 0) ? IconSize : 128, WantAlpha);
    if (NewImage == NULL)
       NewImage = egDecodePNG(FileData, FileDataLength, IconSize, WantAlpha);
    if (NewImage == NULL)
@@ -358,14 +361,23 @@ EG_IMAGE * egLoadImage(IN EFI_FILE* BaseDir, IN CHAR16 *FileName, IN BOOLEAN Wan
     if (BaseDir == NULL || FileName == NULL)
         return NULL;
 
+    // use the theme pack's copy, if there is one
+    NewImage = egFindPackedImage(BaseDir, FileName, WantAlpha);
+    if (NewImage != NULL)
+        return NewImage;
+
     // load file
     Status = egLoadFile(BaseDir, FileName, &FileData, &FileDataLength);
-    if (EFI_ERROR(Status))
+    if (EFI_ERROR(Status)) {
+        LOG_WARNING(L"Couldn't read image %s: %r", FileName, Status);
         return NULL;
+    }
 
     // decode it
-    NewImage = egDecodeAny(FileData, FileDataLength, 128 /* arbitrary value */, WantAlpha);
+    NewImage = egDecodeAny(FileData, FileDataLength, 0 /* natural size */, WantAlpha);
     FreePool(FileData);
+    if (NewImage == NULL)
+        LOG_WARNING(L"Couldn't decode image %s", FileName);
 
     return NewImage;
 }
@@ -382,19 +394,31 @@ EG_IMAGE * egLoadIcon(IN EFI_FILE* BaseDir, IN CHAR16 *Path, IN UINTN IconSize)
     if (BaseDir == NULL || Path == NULL)
         return NULL;
 
-    // load file
-    Status = egLoadFile(BaseDir, Path, &FileData, &FileDataLength);
-    if (EFI_ERROR(Status))
-       return NULL;
+    // use the theme pack's copy, if there is one; otherwise load and decode the file
+    Image = egFindPackedImage(BaseDir, Path, TRUE);
+    if (Image == NULL) {
+        // (A missing file is normal, since callers try several names.)
+        Status = egLoadFile(BaseDir, Path, &FileData, &FileDataLength);
+        if (EFI_ERROR(Status)) {
+           if (Status != EFI_NOT_FOUND)
+              LOG_WARNING(L"Couldn't read icon %s: %r", Path, Status);
+           return NULL;
+        }
 
-    // decode it
-    Image = egDecodeAny(FileData, FileDataLength, IconSize, TRUE);
-    FreePool(FileData);
+        Image = egDecodeAny(FileData, FileDataLength, IconSize, TRUE);
+        FreePool(FileData);
+        if (Image == NULL) {
+           LOG_WARNING(L"Couldn't decode icon %s", Path);
+           return NULL;
+        }
+    }
     if ((Image->Width != IconSize) || (Image->Height != IconSize)) {
        NewImage = egScaleImage(Image, IconSize, IconSize);
        if (!NewImage) {
           Print(L"Warning: Unable to scale icon from %d x %d to %d x %d from '%s'\n",
                 Image->Width, Image->Height, IconSize, IconSize, Path);
+          LOG_WARNING(L"Couldn't scale icon %s from %d x %d to %d x %d",
+                      Path, Image->Width, Image->Height, IconSize, IconSize);
        }
        egFreeImage(Image);
        Image = NewImage;
@@ -593,16 +617,10 @@ VOID egRawCopy(IN OUT EG_PIXEL *CompBasePtr, IN EG_PIXEL *TopBasePtr,
                IN UINTN Width, IN UINTN Height,
                IN UINTN CompLineOffset, IN UINTN TopLineOffset)
 {
-    UINTN       x, y;
-    EG_PIXEL    *TopPtr, *CompPtr;
+    UINTN       y;
 
     for (y = 0; y < Height; y++) {
-        TopPtr = TopBasePtr;
-        CompPtr = CompBasePtr;
-        for (x = 0; x < Width; x++) {
-            *CompPtr = *TopPtr;
-            TopPtr++, CompPtr++;
-        }
+        CopyMem(CompBasePtr, TopBasePtr, Width * sizeof(EG_PIXEL));
         TopBasePtr += TopLineOffset;
         CompBasePtr += CompLineOffset;
     }
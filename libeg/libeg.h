@@ -86,6 +86,14 @@ typedef struct {
     UINTN       DataLength;
 } EG_EMBEDDED_IMAGE;
 
+// Memory used by egDecodePNG(), for debugging
+typedef struct {
+    UINTN       Decodes;
+    UINTN       Allocations;    // lodepng_malloc() calls, including reallocations that moved
+    UINTN       GrownInPlace;   // lodepng_realloc() calls that didn't have to move
+    UINTN       PeakBytes;      // most pool memory held by the decode arena at once
+} EG_PNG_MEMORY_STATS;
+
 /* functions */
 
 VOID egInitScreen(VOID);
@@ -115,6 +123,9 @@ EG_IMAGE * egPrepareEmbeddedImage(IN EG_EMBEDDED_IMAGE *EmbeddedImage, IN BOOLEA
 
 EG_IMAGE * egEnsureImageSize(IN EG_IMAGE *Image, IN UINTN Width, IN UINTN Height, IN EG_PIXEL *Color);
 
+EFI_STATUS egLoadThemePack(IN EFI_FILE *BaseDir, IN CHAR16 *FileName);
+VOID egFreeThemePack(VOID);
+
 EFI_STATUS egLoadFile(IN EFI_FILE* BaseDir, IN CHAR16 *FileName,
                       OUT UINT8 **FileData, OUT UINTN *FileDataLength);
 EFI_STATUS egFindESP(OUT EFI_FILE_HANDLE *RootDir);
@@ -146,9 +157,13 @@ VOID egDisplayMessage(IN CHAR16 *Text, EG_PIXEL *BGColor, UINTN PositionCode);
 EG_IMAGE * egCopyScreen(VOID);
 EG_IMAGE * egCopyScreenArea(UINTN XPos, UINTN YPos, UINTN Width, UINTN Height);
 VOID egScreenShot(VOID);
+VOID egEnableShadowBuffer(IN BOOLEAN Enable);
+VOID egInvalidateShadowBuffer(VOID);
+VOID egFlushScreen(VOID);
 BOOLEAN egSetTextMode(UINT32 RequestedMode);
 
 EG_IMAGE * egDecodePNG(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN IconSize, IN BOOLEAN WantAlpha);
+VOID egGetPNGMemoryStats(OUT EG_PNG_MEMORY_STATS *Stats);
 EG_IMAGE * egDecodeJPEG(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN IconSize, IN BOOLEAN WantAlpha);
 
 /**
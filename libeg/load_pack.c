@@ -0,0 +1,191 @@
+/*
+ * libeg/load_pack.c
+ * Loading images from a pre-decoded theme pack
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * Distributed under the terms of the GNU General Public License (GPL)
+ * version 3 (GPLv3), or (at your option) any later version.
+ *
+ */
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// A theme pack holds any number of images, already decoded to EG_PIXEL
+// (B,G,R,A) order, in a single file created by the mkthemepack script. It's
+// read with one egLoadFile() call; after that, loading any image it holds is
+// just a memory copy, which avoids the Open/GetInfo/Read round trips and the
+// PNG/ICNS/JPEG/BMP decoding that loose files need. Images are looked up by
+// the filename (relative to the rEFInd directory) that would otherwise be
+// loaded, so anything not in the pack is loaded from a loose file as usual.
+//
+// File layout (all integers little-endian):
+//   THEME_PACK_HEADER
+//   THEME_PACK_ENTRY[EntryCount]
+//   Entry names (ASCII, not NUL-terminated) and pixel data, at the offsets
+//   given in the entries; pixel data is 4-byte aligned.
+
+#include "libegint.h"
+#include "../refind/log.h"
+
+#define THEME_PACK_MAGIC      "rEFIpak1"
+#define THEME_PACK_MAGIC_SIZE 8
+
+#define THEME_PACK_FLAG_ALPHA 0x01
+
+#pragma pack(1)
+
+typedef struct {
+    CHAR8         Magic[THEME_PACK_MAGIC_SIZE];
+    UINT32        EntryCount;
+    UINT32        Reserved;
+} THEME_PACK_HEADER;
+
+typedef struct {
+    UINT32        NameOffset;
+    UINT32        NameLength;
+    UINT32        Width;
+    UINT32        Height;
+    UINT32        Flags;
+    UINT32        DataOffset;
+} THEME_PACK_ENTRY;
+
+#pragma pack()
+
+static UINT8              *PackData = NULL;
+static THEME_PACK_ENTRY   *PackEntries = NULL;
+static UINTN              PackEntryCount = 0;
+static EFI_FILE           *PackBaseDir = NULL;   // the pack must be freed before this is closed
+
+// Returns TRUE if the packed entry name (ASCII, of length NameLength) matches
+// FileName. The comparison is case-insensitive and treats '/' and '\' as
+// equivalent; leading directory separators on either name are ignored.
+static BOOLEAN PackNameMatches(IN CHAR8 *Name, IN UINTN NameLength, IN CHAR16 *FileName) {
+   CHAR16 a, b;
+
+   while ((NameLength > 0) && ((*Name == '\\') || (*Name == '/'))) {
+      Name++;
+      NameLength--;
+   }
+   while ((*FileName == L'\\') || (*FileName == L'/'))
+      FileName++;
+
+   for (; NameLength > 0; NameLength--) {
+      a = (CHAR16) *Name++;
+      b = *FileName++;
+      if (b == L'\0')
+         return FALSE;
+      if (a == L'/')
+         a = L'\\';
+      if (b == L'/')
+         b = L'\\';
+      if ((a >= L'A') && (a <= L'Z'))
+         a += (L'a' - L'A');
+      if ((b >= L'A') && (b <= L'Z'))
+         b += (L'a' - L'A');
+      if (a != b)
+         return FALSE;
+   } // for
+   return (*FileName == L'\0');
+} // static BOOLEAN PackNameMatches()
+
+// Forget about the current theme pack, if any.
+VOID egFreeThemePack(VOID) {
+   if (PackData != NULL)
+      FreePool(PackData);
+   PackData = NULL;
+   PackEntries = NULL;
+   PackEntryCount = 0;
+   PackBaseDir = NULL;
+} // VOID egFreeThemePack()
+
+// Load the theme pack in FileName (relative to BaseDir), replacing any that's
+// already loaded. Images in the pack are used in place of same-named files
+// in BaseDir by egLoadImage() and egLoadIcon(). The whole pack is validated
+// here, so lookups needn't check offsets later.
+EFI_STATUS egLoadThemePack(IN EFI_FILE *BaseDir, IN CHAR16 *FileName) {
+   EFI_STATUS          Status;
+   UINT8               *Data;
+   UINTN               DataLength, i;
+   THEME_PACK_HEADER   *Header;
+   THEME_PACK_ENTRY    *Entries;
+   UINT64              PixelBytes;
+
+   egFreeThemePack();
+
+   Status = egLoadFile(BaseDir, FileName, &Data, &DataLength);
+   if (EFI_ERROR(Status)) {
+      LOG_WARNING(L"Couldn't read theme pack %s: %r", FileName, Status);
+      return Status;
+   }
+
+   Header = (THEME_PACK_HEADER *) Data;
+   Status = EFI_SUCCESS;
+   if ((DataLength < sizeof(THEME_PACK_HEADER)) ||
+       (CompareMem(Header->Magic, THEME_PACK_MAGIC, THEME_PACK_MAGIC_SIZE) != 0) ||
+       ((UINT64) Header->EntryCount * sizeof(THEME_PACK_ENTRY) > DataLength - sizeof(THEME_PACK_HEADER))) {
+      Status = EFI_UNSUPPORTED;
+   }
+
+   Entries = (THEME_PACK_ENTRY *) (Data + sizeof(THEME_PACK_HEADER));
+   for (i = 0; !EFI_ERROR(Status) && (i < Header->EntryCount); i++) {
+      PixelBytes = (UINT64) Entries[i].Width * Entries[i].Height * sizeof(EG_PIXEL);
+      if (((UINT64) Entries[i].NameOffset + Entries[i].NameLength > DataLength) ||
+          ((UINT64) Entries[i].DataOffset + PixelBytes > DataLength) ||
+          ((Entries[i].DataOffset % sizeof(EG_PIXEL)) != 0)) {
+         Status = EFI_UNSUPPORTED;
+      }
+   } // for
+
+   if (EFI_ERROR(Status)) {
+      Print(L"Warning: Theme pack '%s' is invalid; using individual image files\n", FileName);
+      LOG_WARNING(L"Theme pack %s is invalid; using individual image files", FileName);
+      FreePool(Data);
+      return Status;
+   }
+
+   PackData = Data;
+   PackEntries = Entries;
+   PackEntryCount = Header->EntryCount;
+   PackBaseDir = BaseDir;
+   LOG_INFO(L"Loaded theme pack %s, holding %d images", FileName, PackEntryCount);
+   return EFI_SUCCESS;
+} // EFI_STATUS egLoadThemePack()
+
+// Returns a copy of the image packed under FileName, or NULL if there's no
+// theme pack for BaseDir or it holds no such image. The result belongs to the
+// caller, just like one from egDecodeAny().
+EG_IMAGE * egFindPackedImage(IN EFI_FILE *BaseDir, IN CHAR16 *FileName, IN BOOLEAN WantAlpha) {
+   EG_IMAGE           *Image = NULL;
+   THEME_PACK_ENTRY   *Entry;
+   UINTN              i;
+
+   if ((PackData == NULL) || (BaseDir != PackBaseDir) || (FileName == NULL))
+      return NULL;
+
+   for (i = 0; i < PackEntryCount; i++) {
+      Entry = &PackEntries[i];
+      if (PackNameMatches((CHAR8 *) (PackData + Entry->NameOffset), Entry->NameLength, FileName)) {
+         Image = egCreateImage(Entry->Width, Entry->Height, WantAlpha && (Entry->Flags & THEME_PACK_FLAG_ALPHA));
+         if (Image != NULL)
+            CopyMem(Image->PixelData, PackData + Entry->DataOffset, Entry->Width * Entry->Height * sizeof(EG_PIXEL));
+         break;
+      } // if
+   } // for
+
+   return Image;
+} // EG_IMAGE * egFindPackedImage()
+
+/* EOF */
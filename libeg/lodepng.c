@@ -4519,18 +4519,19 @@ static unsigned readChunk_pHYs(LodePNGInfo* info, const unsigned char* data, siz
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
 /*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
-static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
-                          LodePNGState* state,
-                          const unsigned char* in, size_t insize)
+/*rEFInd: split out of decodeGeneric so that lodepng_decode_rows can share it.
+Reads all chunks and inflates the IDAT data into the (already initialized)
+scanlines vector, which then holds the filtered scanlines.*/
+static void decodeScanlines(ucvector* scanlines, unsigned* w, unsigned* h,
+                            LodePNGState* state,
+                            const unsigned char* in, size_t insize)
 {
   unsigned char IEND = 0;
   const unsigned char* chunk;
   size_t i;
   ucvector idat; /*the data from idat chunks*/
-  ucvector scanlines;
   size_t predict;
   size_t numpixels;
-  size_t outsize = 0;
 
   /*for unknown chunk order*/
   unsigned unknown = 0;
@@ -4538,9 +4539,6 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   unsigned critical_pos = 1; /*1 = after IHDR, 2 = after PLTE, 3 = after IDAT*/
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
-  /*provide some proper output values if error will happen*/
-  *out = 0;
-
   state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
   if(state->error) return;
 
@@ -4676,7 +4674,6 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     if(!IEND) chunk = lodepng_chunk_next_const(chunk);
   }
 
-  ucvector_init(&scanlines);
   /*predict output size, to allocate exact size for output buffer to avoid more dynamic allocation.
   If the decompressed size does not match the prediction, the image must be corrupt.*/
   if(state->info_png.interlace_method == 0)
@@ -4697,14 +4694,29 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
     if(*w > 1) predict += lodepng_get_raw_size_idat((*w + 0) >> 1, (*h + 1) >> 1, color) + ((*h + 1) >> 1);
     predict += lodepng_get_raw_size_idat((*w + 0), (*h + 0) >> 1, color) + ((*h + 0) >> 1);
   }
-  if(!state->error && !ucvector_reserve(&scanlines, predict)) state->error = 83; /*alloc fail*/
+  if(!state->error && !ucvector_reserve(scanlines, predict)) state->error = 83; /*alloc fail*/
   if(!state->error)
   {
-    state->error = zlib_decompress(&scanlines.data, &scanlines.size, idat.data,
+    state->error = zlib_decompress(&scanlines->data, &scanlines->size, idat.data,
                                    idat.size, &state->decoder.zlibsettings);
-    if(!state->error && scanlines.size != predict) state->error = 91; /*decompressed size doesn't match prediction*/
+    if(!state->error && scanlines->size != predict) state->error = 91; /*decompressed size doesn't match prediction*/
   }
   ucvector_cleanup(&idat);
+}
+
+static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
+                          LodePNGState* state,
+                          const unsigned char* in, size_t insize)
+{
+  size_t i;
+  ucvector scanlines;
+  size_t outsize = 0;
+
+  /*provide some proper output values if error will happen*/
+  *out = 0;
+
+  ucvector_init(&scanlines);
+  decodeScanlines(&scanlines, w, h, state, in, insize);
 
   if(!state->error)
   {
@@ -4720,6 +4732,76 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   ucvector_cleanup(&scanlines);
 }
 
+/*rEFInd addition: decode without ever holding the whole raw image in memory.
+Each row is unfiltered in place in the inflated scanline buffer, converted
+to 8-bit RGBA in a single-row buffer, and passed to the callback. Adam7
+images can't be unfiltered row by row, so they're fully post-processed
+first and then handed out the same way.*/
+unsigned lodepng_decode_rows(unsigned* w, unsigned* h, LodePNGState* state,
+                             const unsigned char* in, size_t insize,
+                             lodepng_row_callback callback, void* userdata)
+{
+  ucvector scanlines;
+  unsigned char* row = 0;
+  unsigned char* image = 0;
+  const LodePNGColorMode* mode = &state->info_png.color;
+  unsigned y;
+  size_t x, bpp, linebytes;
+
+  ucvector_init(&scanlines);
+  decodeScanlines(&scanlines, w, h, state, in, insize);
+  if(!state->error)
+  {
+    row = (unsigned char*)lodepng_malloc((size_t)*w * 4);
+    if(!row) state->error = 83; /*alloc fail*/
+  }
+  if(!state->error)
+  {
+    bpp = lodepng_get_bpp(mode);
+    linebytes = (*w * bpp + 7) / 8;
+    if(state->info_png.interlace_method == 0)
+    {
+      unsigned char* prevline = 0;
+      for(y = 0; y < *h && !state->error; ++y)
+      {
+        unsigned char* line = &scanlines.data[(1 + linebytes) * y];
+        state->error = unfilterScanline(line + 1, line + 1, prevline, (bpp + 7) / 8, line[0], linebytes);
+        if(state->error) break;
+        prevline = line + 1;
+        getPixelColorsRGBA8(row, *w, 1, line + 1, mode);
+        callback(userdata, y, row);
+      }
+    }
+    else
+    {
+      image = (unsigned char*)lodepng_malloc(lodepng_get_raw_size(*w, *h, mode));
+      if(!image) state->error = 83; /*alloc fail*/
+      else
+      {
+        for(x = 0; x < lodepng_get_raw_size(*w, *h, mode); ++x) image[x] = 0;
+        state->error = postProcessScanlines(image, scanlines.data, *w, *h, &state->info_png);
+      }
+      for(y = 0; y < *h && !state->error; ++y)
+      {
+        if(bpp >= 8) getPixelColorsRGBA8(row, *w, 1, &image[linebytes * y], mode);
+        else /*rows aren't byte-aligned in the deinterlaced image*/
+        {
+          for(x = 0; x < *w; ++x)
+          {
+            getPixelColorRGBA8(&row[x * 4 + 0], &row[x * 4 + 1], &row[x * 4 + 2], &row[x * 4 + 3],
+                               image, (size_t)y * *w + x, mode);
+          }
+        }
+        callback(userdata, y, row);
+      }
+      lodepng_free(image);
+    }
+  }
+  lodepng_free(row);
+  ucvector_cleanup(&scanlines);
+  return state->error;
+}
+
 unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
                         LodePNGState* state,
                         const unsigned char* in, size_t insize)
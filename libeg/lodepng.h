@@ -26,7 +26,7 @@ freely, subject to the following restrictions:
  * This version of lodepng.h is modified for use with rEFInd. Some options
  * are commented out and several definitions (commented on shortly) are added
  * for GNU-EFI compatibility. The associated lodepng.c file is unmodified
- * from the original.
+ * from the original, except for the addition of lodepng_decode_rows().
  */
 
 #ifndef LODEPNG_H
@@ -682,6 +682,17 @@ information is placed in the info_png field of the LodePNGState.
 unsigned lodepng_inspect(unsigned* w, unsigned* h,
                          LodePNGState* state,
                          const unsigned char* in, size_t insize);
+
+/*
+rEFInd addition: decode the PNG one row at a time, without allocating a buffer
+for the whole raw image. The callback is called once per row, in order from
+y = 0, with the row's pixels as 8-bit RGBA (w * 4 bytes, valid only for the
+duration of the call).
+*/
+typedef void (*lodepng_row_callback)(void* userdata, unsigned y, const unsigned char* rgba);
+unsigned lodepng_decode_rows(unsigned* w, unsigned* h, LodePNGState* state,
+                             const unsigned char* in, size_t insize,
+                             lodepng_row_callback callback, void* userdata);
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 
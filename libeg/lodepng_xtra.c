@@ -27,53 +27,149 @@
 #include "../refind/screen.h"
 #include "lodepng.h"
 
-// EFI's equivalent of realloc requires the original buffer's size as an
-// input parameter, which the standard libc realloc does not require. Thus,
-// I've modified lodepng_malloc() to allocate more memory to store this data,
-// and lodepng_realloc() can then read it when required. Because the size is
-// stored at the start of the allocated area, these functions are NOT
-// interchangeable with the standard EFI functions; memory allocated via
-// lodepng_malloc() should be freed via lodepng_free(), and myfree() should
-// NOT be used with memory allocated via AllocatePool() or AllocateZeroPool()!
+// LodePNG's memory comes from a decode arena rather than straight from the
+// pool. Inflating and unfiltering a PNG makes many small allocations and
+// grows its output buffers with lodepng_realloc(), but nothing it allocates
+// outlives the egDecodePNG() call, so allocations are simply handed out in
+// order from large pool blocks. lodepng_realloc() grows the most recent
+// allocation in place when its block has room, and lodepng_free() reclaims
+// only the most recent allocation; everything else is released when
+// egDecodePNG() resets the arena. Memory from lodepng_malloc() is NOT zeroed
+// (LodePNG, like any malloc() user, doesn't expect it to be), and must never
+// be passed to FreePool().
+
+// Size of a typical decode arena block; larger requests get blocks of their own
+#define PNG_ARENA_BLOCK_SIZE (256 * 1024)
+
+// Arena allocations are aligned to this many bytes
+#define PNG_ARENA_ALIGN 8
+#define PNG_ARENA_ROUND(n) (((n) + PNG_ARENA_ALIGN - 1) & ~((size_t) PNG_ARENA_ALIGN - 1))
+
+typedef struct _png_arena_block {
+   struct _png_arena_block *Next;
+   size_t                  Size;   // bytes of data following the (rounded) header
+   size_t                  Used;
+} png_arena_block;
+
+// Each allocation is preceded by a header holding its size, for
+// lodepng_realloc(); PNG_ARENA_SIZE() finds it from the allocation itself
+#define PNG_ARENA_BLOCK_HEADER PNG_ARENA_ROUND(sizeof(png_arena_block))
+#define PNG_ARENA_ITEM_HEADER  PNG_ARENA_ROUND(sizeof(size_t))
+#define PNG_ARENA_DATA(Block)  (((UINT8 *) (Block)) + PNG_ARENA_BLOCK_HEADER)
+#define PNG_ARENA_SIZE(ptr)    (*(size_t *) (((UINT8 *) (ptr)) - PNG_ARENA_ITEM_HEADER))
+
+// Blocks in use (most recent first), a standard-size block kept for the next
+// decode, and the pool memory currently held
+static png_arena_block *PngArena = NULL;
+static png_arena_block *PngArenaSpare = NULL;
+static UINTN           PngArenaBytes = 0;
+static EG_PNG_MEMORY_STATS PngMemoryStats = { 0, 0, 0, 0 };
+
+// Return a new arena block with room for at least Size bytes of data
+static png_arena_block * PNGArenaNewBlock(size_t Size) {
+   png_arena_block *Block;
+
+   if (Size <= PNG_ARENA_BLOCK_SIZE) {
+      Size = PNG_ARENA_BLOCK_SIZE;
+      if (PngArenaSpare != NULL) {
+         Block = PngArenaSpare;
+         PngArenaSpare = NULL;
+         Block->Used = 0;
+         return Block;
+      }
+   }
+   Block = AllocatePool(PNG_ARENA_BLOCK_HEADER + Size);
+   if (Block != NULL) {
+      Block->Size = Size;
+      Block->Used = 0;
+      PngArenaBytes += PNG_ARENA_BLOCK_HEADER + Size;
+      if (PngArenaBytes > PngMemoryStats.PeakBytes)
+         PngMemoryStats.PeakBytes = PngArenaBytes;
+   }
+   return Block;
+} // static png_arena_block * PNGArenaNewBlock()
+
+// Returns TRUE if ptr is the most recent allocation, which can grow and
+// shrink in place
+static BOOLEAN PNGArenaIsLast(void *ptr) {
+   return (PngArena != NULL) &&
+          ((UINT8 *) ptr + PNG_ARENA_ROUND(PNG_ARENA_SIZE(ptr)) == PNG_ARENA_DATA(PngArena) + PngArena->Used);
+} // static BOOLEAN PNGArenaIsLast()
 
 void* lodepng_malloc(size_t size) {
-   void *ptr;
+   png_arena_block *Block;
+   size_t Needed;
+   UINT8 *Item;
 
-   ptr = AllocateZeroPool(size + sizeof(size_t));
-   if (ptr) {
-      *(size_t *) ptr = size;
-      return ((size_t *) ptr) + 1;
-   } else {
-      return NULL;
+   Needed = PNG_ARENA_ITEM_HEADER + PNG_ARENA_ROUND(size);
+   if ((PngArena == NULL) || (PngArena->Size - PngArena->Used < Needed)) {
+      Block = PNGArenaNewBlock(Needed);
+      if (Block == NULL)
+         return NULL;
+      Block->Next = PngArena;
+      PngArena = Block;
    }
+   Item = PNG_ARENA_DATA(PngArena) + PngArena->Used;
+   PngArena->Used += Needed;
+   Item += PNG_ARENA_ITEM_HEADER;
+   PNG_ARENA_SIZE(Item) = size;
+   PngMemoryStats.Allocations++;
+   return Item;
 } // void* lodepng_malloc()
 
 void lodepng_free (void *ptr) {
-   if (ptr) {
-      ptr = (void *) (((size_t *) ptr) - 1);
-      FreePool(ptr);
-   }
+   if (ptr && PNGArenaIsLast(ptr))
+      PngArena->Used = (UINT8 *) ptr - PNG_ARENA_ITEM_HEADER - PNG_ARENA_DATA(PngArena);
 } // void lodepng_free()
 
-static size_t report_size(void *ptr) {
-   if (ptr)
-      return * (((size_t *) ptr) - 1);
-   else
-      return 0;
-} // size_t report_size()
-
 void* lodepng_realloc(void *ptr, size_t new_size) {
-   size_t *new_pool;
-   size_t old_size;
+   void   *new_ptr;
+   size_t old_size, Available;
 
-   new_pool = lodepng_malloc(new_size);
-   if (new_pool && ptr) {
-      old_size = report_size(ptr);
-      CopyMem(new_pool, ptr, (old_size < new_size) ? old_size : new_size);
-   }
-   return new_pool;
+   if (ptr == NULL)
+      return lodepng_malloc(new_size);
+
+   old_size = PNG_ARENA_SIZE(ptr);
+   if (PNGArenaIsLast(ptr)) {
+      Available = PngArena->Size - ((UINT8 *) ptr - PNG_ARENA_DATA(PngArena));
+      if (PNG_ARENA_ROUND(new_size) <= Available) {
+         PngArena->Used += PNG_ARENA_ROUND(new_size) - PNG_ARENA_ROUND(old_size);
+         PNG_ARENA_SIZE(ptr) = new_size;
+         PngMemoryStats.GrownInPlace++;
+         return ptr;
+      }
+   } // if
+
+   new_ptr = lodepng_malloc(new_size);
+   if (new_ptr)
+      CopyMem(new_ptr, ptr, (old_size < new_size) ? old_size : new_size);
+   return new_ptr;
 } // lodepng_realloc()
 
+// Release everything allocated while decoding an image. One standard-size
+// block is kept for the next image, since icons are usually decoded in
+// batches.
+static VOID PNGArenaReset(VOID) {
+   png_arena_block *Next;
+
+   while (PngArena != NULL) {
+      Next = PngArena->Next;
+      if ((PngArenaSpare == NULL) && (PngArena->Size == PNG_ARENA_BLOCK_SIZE)) {
+         PngArenaSpare = PngArena;
+      } else {
+         PngArenaBytes -= PNG_ARENA_BLOCK_HEADER + PngArena->Size;
+         FreePool(PngArena);
+      }
+      PngArena = Next;
+   } // while
+} // static VOID PNGArenaReset()
+
+// Report how much memory PNG decoding has used so far
+VOID egGetPNGMemoryStats(OUT EG_PNG_MEMORY_STATS *Stats) {
+   if (Stats)
+      CopyMem(Stats, &PngMemoryStats, sizeof(EG_PNG_MEMORY_STATS));
+} // VOID egGetPNGMemoryStats()
+
 // Finds length of ASCII string, which MUST be NULL-terminated.
 int MyStrlen(const char *InString) {
    int Length = 0;
@@ -102,37 +198,139 @@ typedef struct _lode_color {
    UINT8 alpha;
 } lode_color;
 
+// Largest factor by which egDecodePNG() reduces an image while decoding;
+// keeps the 32-bit per-column sums in PNGRowToImage() from overflowing.
+#define PNG_MAX_DECODE_SCALE 64
+
+// State shared with PNGRowToImage() while a PNG is decoded row by row.
+typedef struct _png_row_state {
+   EG_IMAGE *Image;
+   UINTN    Scale;     // source pixels per destination pixel, in each direction
+   BOOLEAN  WantAlpha;
+   UINT32   *Sums;     // per-column B, G, R, A totals for the current destination row
+} png_row_state;
+
+// Callback for lodepng_decode_rows(): store one row of RGBA data in the
+// EG_IMAGE, converting to EFI's BGRA order. When shrinking (Scale > 1), each
+// destination pixel is the average of a Scale x Scale block of source pixels,
+// weighted by alpha so that the colors of transparent pixels don't bleed
+// into the edges of icons. Source pixels beyond the last full block are
+// dropped.
+static void PNGRowToImage(void *UserData, unsigned y, const unsigned char *Rgba) {
+   png_row_state *State = (png_row_state *) UserData;
+   const lode_color *Src = (const lode_color *) Rgba;
+   EG_PIXEL *Dest;
+   UINT32 *Sum;
+   UINTN x, Width, Count;
+
+   if ((y / State->Scale) >= State->Image->Height)
+      return;
+   Width = State->Image->Width;
+   Dest = State->Image->PixelData + (y / State->Scale) * Width;
+
+   if (State->Scale == 1) {
+      for (x = 0; x < Width; x++) {
+         Dest[x].r = Src[x].red;
+         Dest[x].g = Src[x].green;
+         Dest[x].b = Src[x].blue;
+         Dest[x].a = State->WantAlpha ? Src[x].alpha : 0;
+      }
+      return;
+   } // if
+
+   for (x = 0; x < Width * State->Scale; x++) {
+      Sum = &State->Sums[(x / State->Scale) * 4];
+      if (State->WantAlpha) {
+         Sum[0] += (UINT32) Src[x].blue * Src[x].alpha;
+         Sum[1] += (UINT32) Src[x].green * Src[x].alpha;
+         Sum[2] += (UINT32) Src[x].red * Src[x].alpha;
+         Sum[3] += Src[x].alpha;
+      } else {
+         Sum[0] += Src[x].blue;
+         Sum[1] += Src[x].green;
+         Sum[2] += Src[x].red;
+      }
+   } // for
+
+   if ((y % State->Scale) == (State->Scale - 1)) { // last source row of this destination row
+      Count = State->Scale * State->Scale;
+      for (x = 0; x < Width; x++) {
+         Sum = &State->Sums[x * 4];
+         if (!State->WantAlpha) {
+            Dest[x].b = Sum[0] / Count;
+            Dest[x].g = Sum[1] / Count;
+            Dest[x].r = Sum[2] / Count;
+            Dest[x].a = 0;
+         } else if (Sum[3] > 0) {
+            Dest[x].b = Sum[0] / Sum[3];
+            Dest[x].g = Sum[1] / Sum[3];
+            Dest[x].r = Sum[2] / Sum[3];
+            Dest[x].a = Sum[3] / Count;
+         } else {
+            Dest[x].b = Dest[x].g = Dest[x].r = Dest[x].a = 0;
+         }
+         Sum[0] = Sum[1] = Sum[2] = Sum[3] = 0;
+      } // for
+   } // if
+} // static void PNGRowToImage()
+
+// Decode a PNG image. If IconSize is non-0, the caller is going to scale the
+// result to IconSize x IconSize, so an image at least twice that size is
+// shrunk by an integral factor as it's decoded, which saves memory and gives
+// the final scaling step less work to do. Decoding goes straight from the
+// inflated data into the EG_IMAGE, one row at a time, rather than through
+// full-size intermediate RGBA buffers.
 EG_IMAGE * egDecodePNG(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN IconSize, IN BOOLEAN WantAlpha) {
    EG_IMAGE *NewImage = NULL;
    unsigned Error, Width, Height;
-   EG_PIXEL *PixelData;
-   lode_color *LodeData;
-   UINTN i;
+   LodePNGState PngState;
+   png_row_state RowState;
 
-   Error = lodepng_decode_memory((unsigned char **) &PixelData, &Width, &Height, (unsigned char*) FileData,
-                                 (size_t) FileDataLength, LCT_RGBA, 8);
-
-   if (Error) {
+   lodepng_state_init(&PngState);
+   Error = lodepng_inspect(&Width, &Height, &PngState, (unsigned char *) FileData, (size_t) FileDataLength);
+   if (Error || (Width == 0) || (Height == 0)) {
+      lodepng_state_cleanup(&PngState);
+      PNGArenaReset();
       return NULL;
    }
 
+   RowState.Scale = 1;
+   if ((IconSize > 0) && (Width >= IconSize * 2) && (Height >= IconSize * 2)) {
+      RowState.Scale = ((Width < Height) ? Width : Height) / IconSize;
+      if (RowState.Scale > PNG_MAX_DECODE_SCALE)
+         RowState.Scale = PNG_MAX_DECODE_SCALE;
+   }
+   RowState.WantAlpha = WantAlpha;
+   RowState.Sums = NULL;
+
    // allocate image structure and buffer
-   NewImage = egCreateImage(Width, Height, WantAlpha);
-   if ((NewImage == NULL) || (NewImage->Width != Width) || (NewImage->Height != Height))
+   RowState.Image = NewImage = egCreateImage(Width / RowState.Scale, Height / RowState.Scale, WantAlpha);
+   if (NewImage == NULL) {
+      lodepng_state_cleanup(&PngState);
+      PNGArenaReset();
       return NULL;
+   }
+   if (RowState.Scale > 1) {
+      RowState.Sums = AllocateZeroPool(NewImage->Width * 4 * sizeof(UINT32));
+      if (RowState.Sums == NULL) {
+         egFreeImage(NewImage);
+         lodepng_state_cleanup(&PngState);
+         PNGArenaReset();
+         return NULL;
+      }
+   }
 
-   LodeData = (lode_color *) PixelData;
-
-   // Annoyingly, EFI and LodePNG use different ordering of RGB values in
-   // their pixel data representations, so we've got to adjust them....
-   for (i = 0; i < (NewImage->Height * NewImage->Width); i++) {
-      NewImage->PixelData[i].r = LodeData[i].red;
-      NewImage->PixelData[i].g = LodeData[i].green;
-      NewImage->PixelData[i].b = LodeData[i].blue;
-      if (WantAlpha)
-         NewImage->PixelData[i].a = LodeData[i].alpha;
+   Error = lodepng_decode_rows(&Width, &Height, &PngState, (unsigned char *) FileData, (size_t) FileDataLength,
+                               PNGRowToImage, &RowState);
+   if (RowState.Sums != NULL)
+      FreePool(RowState.Sums);
+   lodepng_state_cleanup(&PngState);
+   if (Error) {
+      egFreeImage(NewImage);
+      NewImage = NULL;
    }
-   lodepng_free(PixelData);
+   PNGArenaReset();
+   PngMemoryStats.Decodes++;
 
    return NewImage;
 } // EG_IMAGE * egDecodePNG()
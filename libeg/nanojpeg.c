@@ -171,6 +171,32 @@ unsigned char* njGetImage(void);
 // undefined.
 int njGetImageSize(void);
 
+// Modified: The following four functions are rEFInd additions, to support
+// decoding large images (such as banners and backgrounds) straight to a
+// reduced size and to EFI's pixel format.
+
+// njGetSize: Read the width and height of a baseline JPEG from its frame
+// header, without decoding anything.
+// Returns 1 on success, 0 if the data is not a (supported) JPEG file.
+int njGetSize(const void* jpeg, const int size, int* width, int* height);
+
+// njSetScale: Select the scale for subsequent njDecode() calls. Each 8x8
+// block is decoded to (8 >> shift) pixels on a side, so shift values of 0-3
+// give full, 1/2, 1/4 and 1/8 size. This is much faster than decoding at
+// full size and scaling afterwards, since the inverse DCT uses only the
+// low-frequency coefficients and everything after it works on fewer pixels.
+// njGetWidth() and njGetHeight() report the reduced size (rounded up).
+void njSetScale(int shift);
+
+// njSetBGRA: If enable is nonzero, subsequent njDecode() calls produce
+// 32-bit pixels in B, G, R, A order (alpha always 255) for both color and
+// grayscale images, rather than the packed RGB or grayscale formats.
+void njSetBGRA(int enable);
+
+// njDetachImage: Like njGetImage(), but transfers ownership of the buffer
+// to the caller, who must free() it; njDone() will then leave it alone.
+unsigned char* njDetachImage(void);
+
 // njDone: Uninitialize NanoJPEG.
 // Resets NanoJPEG's internal state and frees all memory that has been
 // allocated at run-time by NanoJPEG. It is still possible to decode another
@@ -338,10 +364,17 @@ typedef struct _nj_ctx {
     int block[64];
     int rstinterval;
     unsigned char *rgb;
+    int scale, bshift;  // Modified: reduced-size decoding; bshift = 3 - scale
+    int bgra;           // Modified: nonzero to produce B,G,R,A output
 } nj_context_t;
 
 static nj_context_t nj;
 
+// Modified: Settings from njSetScale() and njSetBGRA(); kept outside of nj
+// because njDecode() resets that.
+static int njScaleSetting = 0;
+static int njBGRASetting = 0;
+
 static const char njZZ[64] = { 0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18,
 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28, 35,
 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45,
@@ -452,6 +485,47 @@ NJ_INLINE void njColIDCT(const int* blk, unsigned char *out, int stride) {
     *out = njClip(((x7 - x1) >> 14) + 128);
 }
 
+// Modified: Reduced-size inverse DCTs for scaled decoding. Each output pixel
+// is the 8x8 IDCT's underlying cosine series sampled at the center of the
+// 2x2 or 4x4 area of full-size pixels it replaces, so only the N x N
+// lowest-frequency coefficients are needed. Tables hold
+// C(u) * cos((2x + 1) * u * pi / 2N) * 1024, indexed [x][u].
+static const int njIDCT4[4][4] = {
+    { 724,  946,  724,  392 },
+    { 724,  392, -724, -946 },
+    { 724, -392, -724,  946 },
+    { 724, -946,  724, -392 } };
+static const int njIDCT2[2][2] = {
+    { 724,  724 },
+    { 724, -724 } };
+
+NJ_INLINE void njReducedIDCT(unsigned char *out, int stride) {
+    const int n = 8 >> nj.scale;
+    const int *t;
+    int tmp[4][4];
+    int x, y, u, sum;
+    if (n == 1) {
+        // DC only: the block's average
+        *out = njClip(((nj.block[0] + 4) >> 3) + 128);
+        return;
+    }
+    t = (n == 4) ? &njIDCT4[0][0] : &njIDCT2[0][0];
+    for (y = 0;  y < n;  ++y)
+        for (x = 0;  x < n;  ++x) {
+            for (sum = 0, u = 0;  u < n;  ++u)
+                sum += t[x * n + u] * nj.block[y * 8 + u];
+            tmp[y][x] = (sum + 512) >> 10;
+        }
+    for (y = 0;  y < n;  ++y) {
+        for (x = 0;  x < n;  ++x) {
+            for (sum = 0, u = 0;  u < n;  ++u)
+                sum += t[y * n + u] * tmp[u][x];
+            out[x] = njClip(((sum + 2048) >> 12) + 128);
+        }
+        out += stride;
+    }
+}
+
 #define njThrow(e) do { nj.error = e; return; } while (0)
 #define njCheckError() do { if (nj.error) return; } while (0)
 
@@ -574,12 +648,26 @@ NJ_INLINE void njDecodeSOF(void) {
     for (i = 0, c = nj.comp;  i < nj.ncomp;  ++i, ++c) {
         c->width = (nj.width * c->ssx + ssxmax - 1) / ssxmax;
         c->height = (nj.height * c->ssy + ssymax - 1) / ssymax;
-        c->stride = nj.mbwidth * c->ssx << 3;
         if (((c->width < 3) && (c->ssx != ssxmax)) || ((c->height < 3) && (c->ssy != ssymax))) njThrow(NJ_UNSUPPORTED);
-        if (!(c->pixels = (unsigned char*) njAllocMem(c->stride * nj.mbheight * c->ssy << 3))) njThrow(NJ_OUT_OF_MEM);
+        // Modified: the chroma upsampler needs 3 pixels of a subsampled
+        // component, so decode a small image at a larger scale if need be
+        while (nj.scale && (((((c->width + (1 << nj.scale) - 1) >> nj.scale) < 3) && (c->ssx != ssxmax))
+                         || ((((c->height + (1 << nj.scale) - 1) >> nj.scale) < 3) && (c->ssy != ssymax)))) {
+            --nj.scale;
+            ++nj.bshift;
+        }
     }
-    if (nj.ncomp == 3) {
-        nj.rgb = (unsigned char*) njAllocMem(nj.width * nj.height * nj.ncomp);
+    // Modified: from here on, all sizes are those of the reduced image
+    nj.width = (nj.width + (1 << nj.scale) - 1) >> nj.scale;
+    nj.height = (nj.height + (1 << nj.scale) - 1) >> nj.scale;
+    for (i = 0, c = nj.comp;  i < nj.ncomp;  ++i, ++c) {
+        c->width = (nj.width * c->ssx + ssxmax - 1) / ssxmax;
+        c->height = (nj.height * c->ssy + ssymax - 1) / ssymax;
+        c->stride = nj.mbwidth * c->ssx << nj.bshift;
+        if (!(c->pixels = (unsigned char*) njAllocMem(c->stride * nj.mbheight * c->ssy << nj.bshift))) njThrow(NJ_OUT_OF_MEM);
+    }
+    if ((nj.ncomp == 3) || nj.bgra) {
+        nj.rgb = (unsigned char*) njAllocMem(nj.width * nj.height * (nj.bgra ? 4 : nj.ncomp));
         if (!nj.rgb) njThrow(NJ_OUT_OF_MEM);
     }
     njSkip(nj.length);
@@ -680,6 +768,10 @@ NJ_INLINE void njDecodeBlock(nj_component_t* c, unsigned char* out) {
         if (coef > 63) njThrow(NJ_SYNTAX_ERROR);
         nj.block[(int) njZZ[coef]] = value * nj.qtab[c->qtsel][coef];
     } while (coef < 63);
+    if (nj.scale) {
+        njReducedIDCT(out, c->stride);
+        return;
+    }
     for (coef = 0;  coef < 64;  coef += 8)
         njRowIDCT(&nj.block[coef]);
     for (coef = 0;  coef < 8;  ++coef)
@@ -708,7 +800,7 @@ NJ_INLINE void njDecodeScan(void) {
         for (i = 0, c = nj.comp;  i < nj.ncomp;  ++i, ++c)
             for (sby = 0;  sby < c->ssy;  ++sby)
                 for (sbx = 0;  sbx < c->ssx;  ++sbx) {
-                    njDecodeBlock(c, &c->pixels[((mby * c->ssy + sby) * c->stride + mbx * c->ssx + sbx) << 3]);
+                    njDecodeBlock(c, &c->pixels[((mby * c->ssy + sby) * c->stride + mbx * c->ssx + sbx) << nj.bshift]);
                     njCheckError();
                 }
         if (++mbx >= nj.mbwidth) {
@@ -842,7 +934,37 @@ NJ_INLINE void njConvert(void) {
         #endif
         if ((c->width < nj.width) || (c->height < nj.height)) njThrow(NJ_INTERNAL_ERR);
     }
-    if (nj.ncomp == 3) {
+    if (nj.bgra) {
+        // Modified: convert straight to EFI's B,G,R,A pixel layout
+        int x, yy;
+        unsigned char *pout = nj.rgb;
+        const unsigned char *py  = nj.comp[0].pixels;
+        const unsigned char *pcb = (nj.ncomp == 3) ? nj.comp[1].pixels : NULL;
+        const unsigned char *pcr = (nj.ncomp == 3) ? nj.comp[2].pixels : NULL;
+        for (yy = nj.height;  yy;  --yy) {
+            if (pcb) {
+                for (x = 0;  x < nj.width;  ++x) {
+                    register int y = py[x] << 8;
+                    register int cb = pcb[x] - 128;
+                    register int cr = pcr[x] - 128;
+                    *pout++ = njClip((y + 454 * cb            + 128) >> 8);
+                    *pout++ = njClip((y -  88 * cb - 183 * cr + 128) >> 8);
+                    *pout++ = njClip((y            + 359 * cr + 128) >> 8);
+                    *pout++ = 0xFF;
+                }
+                pcb += nj.comp[1].stride;
+                pcr += nj.comp[2].stride;
+            } else {
+                for (x = 0;  x < nj.width;  ++x) {
+                    *pout++ = py[x];
+                    *pout++ = py[x];
+                    *pout++ = py[x];
+                    *pout++ = 0xFF;
+                }
+            }
+            py += nj.comp[0].stride;
+        }
+    } else if (nj.ncomp == 3) {
         // convert to RGB
         int x, yy;
         unsigned char *prgb = nj.rgb;
@@ -915,6 +1037,9 @@ void njDone(void) {
 
 nj_result_t njDecode(const void* jpeg, const int size) {
     njDone();
+    nj.scale = njScaleSetting;
+    nj.bshift = 3 - nj.scale;
+    nj.bgra = njBGRASetting;
     nj.pos = (const unsigned char*) jpeg;
     nj.size = size & 0x7FFFFFFF;
     if (nj.size < 2) return NJ_NO_JPEG;
@@ -946,7 +1071,39 @@ nj_result_t njDecode(const void* jpeg, const int size) {
 int njGetWidth(void)            { return nj.width; }
 int njGetHeight(void)           { return nj.height; }
 int njIsColor(void)             { return (nj.ncomp != 1); }
-unsigned char* njGetImage(void) { return (nj.ncomp == 1) ? nj.comp[0].pixels : nj.rgb; }
-int njGetImageSize(void)        { return nj.width * nj.height * nj.ncomp; }
+unsigned char* njGetImage(void) { return ((nj.ncomp == 1) && !nj.bgra) ? nj.comp[0].pixels : nj.rgb; }
+int njGetImageSize(void)        { return nj.width * nj.height * (nj.bgra ? 4 : nj.ncomp); }
+
+// Modified: rEFInd additions; see header section for descriptions.
+void njSetScale(int shift)      { njScaleSetting = (shift < 0) ? 0 : ((shift > 3) ? 3 : shift); }
+void njSetBGRA(int enable)      { njBGRASetting = enable; }
+
+unsigned char* njDetachImage(void) {
+    unsigned char* image = njGetImage();
+    if (image == nj.rgb)
+        nj.rgb = NULL;
+    else
+        nj.comp[0].pixels = NULL;
+    return image;
+}
+
+int njGetSize(const void* jpeg, const int size, int* width, int* height) {
+    const unsigned char* p = (const unsigned char*) jpeg;
+    int pos = 2;
+    if ((size < 2) || (p[0] != 0xFF) || (p[1] != 0xD8)) return 0;
+    while (pos + 4 <= size) {
+        if (p[pos] != 0xFF) return 0;
+        if (p[pos + 1] == 0xFF) { ++pos; continue; }  // fill byte
+        if (p[pos + 1] == 0xC0) {
+            if (pos + 9 > size) return 0;
+            *height = njDecode16(p + pos + 5);
+            *width = njDecode16(p + pos + 7);
+            return 1;
+        }
+        if ((p[pos + 1] == 0xDA) || (p[pos + 1] == 0xD9)) return 0;  // no (baseline) frame header
+        pos += 2 + njDecode16(p + pos + 2);
+    }
+    return 0;
+}
 
 #endif // _NJ_INCLUDE_HEADER_ONLY
@@ -31,48 +31,45 @@
 #define _NJ_INCLUDE_HEADER_ONLY
 #include "nanojpeg.c"
 
-typedef struct _jpeg_color {
-   UINT8 red;
-   UINT8 green;
-   UINT8 blue;
-} jpeg_color;
+// Largest JPEG scale shift supported by NanoJPEG (1/8 size)
+#define JPEG_MAX_SCALE_SHIFT 3
 
 // Decode JPEG data into something libeg can use. This function is a wrapper around
 // various NanoJPEG functions.
+// If IconSize > 0 and the image is at least twice that size in both dimensions,
+// the image is decoded at 1/2, 1/4, or 1/8 size (the smallest that's still at
+// least IconSize in both dimensions), which is far faster than a full decode.
+// The caller's egScaleImage() call then has much less work to do, too.
 EG_IMAGE * egDecodeJPEG(IN UINT8 *FileData, IN UINTN FileDataLength, IN UINTN IconSize, IN BOOLEAN WantAlpha) {
     EG_IMAGE *NewImage = NULL;
-    unsigned Width, Height;
-    jpeg_color *JpegData;
-    UINTN i;
-    nj_result_t Result;
+    int Width, Height, Shift = 0;
 
-    if (njInit()) {
-        Result = njDecode((VOID *) FileData, FileDataLength);
-        if (Result != NJ_OK)
-            return NULL;
-
-        Width = njGetWidth();
-        Height = njGetHeight();
-
-        // allocate image structure and buffer
-        NewImage = egCreateImage(Width, Height, WantAlpha);
-        if ((NewImage == NULL) || (NewImage->Width != Width) || (NewImage->Height != Height))
-            return NULL;
-
-        JpegData = (jpeg_color *) njGetImage();
+    // Check the header first, so that non-JPEG data is rejected before
+    // njInit() allocates its Huffman tables....
+    if (!njGetSize((VOID *) FileData, FileDataLength, &Width, &Height))
+        return NULL;
+    if (IconSize > 0) {
+        while ((Shift < JPEG_MAX_SCALE_SHIFT) && ((UINTN) (Width >> (Shift + 1)) >= IconSize) &&
+               ((UINTN) (Height >> (Shift + 1)) >= IconSize))
+            Shift++;
+    }
 
-        // Annoyingly, EFI and NanoJPEG use different ordering of RGB values in
-        // their pixel data representations, so we've got to adjust them....
-        for (i = 0; i < (NewImage->Height * NewImage->Width); i++) {
-            NewImage->PixelData[i].r = JpegData[i].red;
-            NewImage->PixelData[i].g = JpegData[i].green;
-            NewImage->PixelData[i].b = JpegData[i].blue;
-            // Note: AFAIK, NanoJPEG doesn't support alpha/transparency, so if we're
-            // asked to do this, set it to be fully opaque.
-            if (WantAlpha)
-                NewImage->PixelData[i].a = 255;
+    if (njInit()) {
+        njSetScale(Shift);
+        // Have NanoJPEG write EFI's B,G,R,A layout directly, so that its
+        // buffer can become the image's PixelData without a copy.
+        njSetBGRA(1);
+        if (njDecode((VOID *) FileData, FileDataLength) == NJ_OK) {
+            NewImage = (EG_IMAGE *) AllocatePool(sizeof(EG_IMAGE));
+            if (NewImage != NULL) {
+                NewImage->Width = njGetWidth();
+                NewImage->Height = njGetHeight();
+                // Note: AFAIK, NanoJPEG doesn't support alpha/transparency, so
+                // all pixels are fully opaque.
+                NewImage->HasAlpha = WantAlpha;
+                NewImage->PixelData = (EG_PIXEL *) njDetachImage();
+            }
         }
-        FreePool(JpegData);
         njDone();
     }
 
@@ -59,6 +59,7 @@
 #include "../refind/screen.h"
 #include "../refind/lib.h"
 #include "../refind/mystrings.h"
+#include "../refind/log.h"
 #include "../include/refit_call_wrapper.h"
 #include "libeg.h"
 #include "../include/Handle.h"
@@ -85,6 +86,19 @@ static BOOLEAN egHasGraphics = FALSE;
 static UINTN egScreenWidth  = 800;
 static UINTN egScreenHeight = 600;
 
+// Shadow framebuffer defines and variables
+
+#define EG_MAX_DIRTY_RECTS 16
+
+typedef struct {
+    UINTN X, Y, Width, Height;
+} EG_RECT;
+
+static EG_IMAGE *egShadow = NULL;
+static BOOLEAN  egShadowValid = FALSE; // TRUE if egShadow mirrors what's on the screen
+static EG_RECT  egDirtyRects[EG_MAX_DIRTY_RECTS];
+static UINTN    egDirtyCount = 0;
+
 //
 // Screen handling
 //
@@ -216,6 +230,7 @@ BOOLEAN egSetScreenSize(IN OUT UINTN *ScreenWidth, IN OUT UINTN *ScreenHeight) {
       } else {// If unsuccessful, display an error message for the user....
          SwitchToText(FALSE);
          Print(L"Error setting graphics mode %d x %d; using default mode!\nAvailable modes are:\n", *ScreenWidth, *ScreenHeight);
+         LOG_WARNING(L"Couldn't set graphics mode %d x %d; using the default mode", *ScreenWidth, *ScreenHeight);
          ModeNum = 0;
          do {
             Status = refit_call4_wrapper(GraphicsOutput->QueryMode, GraphicsOutput, ModeNum, &Size, &Info);
@@ -247,6 +262,8 @@ BOOLEAN egSetScreenSize(IN OUT UINTN *ScreenWidth, IN OUT UINTN *ScreenHeight) {
          Print(L"Error setting graphics mode %d x %d; unsupported mode!\n");
       } // if/else
    } // if/else if UGA mode (EFI 1.x)
+   if (egShadow != NULL)
+      egEnableShadowBuffer(TRUE);
    return (ModeSet);
 } // BOOLEAN egSetScreenSize()
 
@@ -333,6 +350,10 @@ VOID egSetGraphicsModeEnabled(IN BOOLEAN Enable)
     EFI_CONSOLE_CONTROL_SCREEN_MODE CurrentMode;
     EFI_CONSOLE_CONTROL_SCREEN_MODE NewMode;
 
+    // Text output (or the mode switch itself) will alter the screen without
+    // updating the shadow buffer....
+    egInvalidateShadowBuffer();
+
     if (ConsoleControl != NULL) {
         refit_call4_wrapper(ConsoleControl->GetMode, ConsoleControl, &CurrentMode, NULL, NULL);
 
@@ -343,6 +364,138 @@ VOID egSetGraphicsModeEnabled(IN BOOLEAN Enable)
     }
 }
 
+//
+// Shadow framebuffer
+//
+// When enabled, all drawing goes to an off-screen copy of the display and
+// the modified areas are recorded as a short list of dirty rectangles.
+// egFlushScreen() then copies just those areas to the screen, so a complete
+// menu repaint costs a handful of Blt() calls rather than one per image. This
+// matters on firmware with a high fixed cost per Blt() (remote consoles, IPMI
+// KVM, some virtual machines).
+// The shadow is only used while it's known to match the screen; anything that
+// may draw behind libeg's back (text mode, external programs) must call
+// egInvalidateShadowBuffer(), after which drawing goes directly to the screen
+// until the next full-screen egClearScreen() re-synchronizes the two.
+//
+
+// Blt a rectangle of Image (with upper-left corner at SrcX,SrcY) to the
+// screen at DestX,DestY.
+static VOID egBltArea(IN EG_IMAGE *Image, IN UINTN SrcX, IN UINTN SrcY, IN UINTN DestX, IN UINTN DestY,
+                      IN UINTN Width, IN UINTN Height)
+{
+    if (GraphicsOutput != NULL) {
+        refit_call10_wrapper(GraphicsOutput->Blt, GraphicsOutput, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)Image->PixelData,
+                             EfiBltBufferToVideo, SrcX, SrcY, DestX, DestY, Width, Height, Image->Width * 4);
+    } else if (UgaDraw != NULL) {
+        refit_call10_wrapper(UgaDraw->Blt, UgaDraw, (EFI_UGA_PIXEL *)Image->PixelData, EfiUgaBltBufferToVideo,
+                             SrcX, SrcY, DestX, DestY, Width, Height, Image->Width * 4);
+    }
+} // static VOID egBltArea()
+
+// Returns TRUE if the two rectangles overlap or share an edge.
+static BOOLEAN egRectsTouch(IN EG_RECT *A, IN EG_RECT *B) {
+    return ((A->X <= B->X + B->Width) && (B->X <= A->X + A->Width) &&
+            (A->Y <= B->Y + B->Height) && (B->Y <= A->Y + A->Height));
+} // static BOOLEAN egRectsTouch()
+
+// Grow *Target so that it also covers *Other.
+static VOID egRectUnion(IN OUT EG_RECT *Target, IN EG_RECT *Other) {
+    UINTN Right, Bottom;
+
+    Right = (Target->X + Target->Width > Other->X + Other->Width) ? Target->X + Target->Width : Other->X + Other->Width;
+    Bottom = (Target->Y + Target->Height > Other->Y + Other->Height) ? Target->Y + Target->Height : Other->Y + Other->Height;
+    if (Other->X < Target->X)
+        Target->X = Other->X;
+    if (Other->Y < Target->Y)
+        Target->Y = Other->Y;
+    Target->Width = Right - Target->X;
+    Target->Height = Bottom - Target->Y;
+} // static VOID egRectUnion()
+
+// Record that the specified screen area has changed in the shadow buffer.
+// Touching rectangles are merged; if the list is full, the new area is merged
+// into whichever existing rectangle grows the least. (Over-estimating the
+// dirty area is harmless, since the shadow holds valid data everywhere.)
+static VOID egMarkDirty(IN UINTN XPos, IN UINTN YPos, IN UINTN Width, IN UINTN Height) {
+    EG_RECT NewRect, Merged;
+    UINTN   i, Best = 0, Growth, BestGrowth = (UINTN) -1;
+
+    if ((Width == 0) || (Height == 0))
+        return;
+
+    NewRect.X = XPos;
+    NewRect.Y = YPos;
+    NewRect.Width = Width;
+    NewRect.Height = Height;
+
+    i = 0;
+    while (i < egDirtyCount) {
+        if (egRectsTouch(&NewRect, &egDirtyRects[i])) {
+            egRectUnion(&NewRect, &egDirtyRects[i]);
+            egDirtyRects[i] = egDirtyRects[--egDirtyCount];
+            i = 0; // grown rectangle may now touch ones already checked
+        } else {
+            i++;
+        }
+    } // while
+
+    if (egDirtyCount < EG_MAX_DIRTY_RECTS) {
+        egDirtyRects[egDirtyCount++] = NewRect;
+        return;
+    }
+
+    for (i = 0; i < egDirtyCount; i++) {
+        Merged = egDirtyRects[i];
+        egRectUnion(&Merged, &NewRect);
+        Growth = Merged.Width * Merged.Height - egDirtyRects[i].Width * egDirtyRects[i].Height;
+        if (Growth < BestGrowth) {
+            BestGrowth = Growth;
+            Best = i;
+        }
+    } // for
+    egRectUnion(&egDirtyRects[Best], &NewRect);
+} // static VOID egMarkDirty()
+
+// Returns TRUE if drawing should go to the shadow buffer rather than directly
+// to the screen.
+static BOOLEAN egUseShadow(VOID) {
+    return ((egShadow != NULL) && egShadowValid);
+} // static BOOLEAN egUseShadow()
+
+// Copy all dirty areas of the shadow buffer to the screen.
+VOID egFlushScreen(VOID)
+{
+    UINTN i;
+
+    if ((egShadow != NULL) && egHasGraphics) {
+        for (i = 0; i < egDirtyCount; i++) {
+            egBltArea(egShadow, egDirtyRects[i].X, egDirtyRects[i].Y, egDirtyRects[i].X, egDirtyRects[i].Y,
+                      egDirtyRects[i].Width, egDirtyRects[i].Height);
+        }
+    }
+    egDirtyCount = 0;
+} // VOID egFlushScreen()
+
+// Flush any pending drawing and note that the screen may no longer match the
+// shadow buffer.
+VOID egInvalidateShadowBuffer(VOID)
+{
+    egFlushScreen();
+    egShadowValid = FALSE;
+} // VOID egInvalidateShadowBuffer()
+
+// Turn the shadow framebuffer on or off. Also used to re-create the buffer
+// after a change in resolution.
+VOID egEnableShadowBuffer(IN BOOLEAN Enable)
+{
+    egInvalidateShadowBuffer();
+    egFreeImage(egShadow);
+    egShadow = NULL;
+    if (Enable && egHasGraphics)
+        egShadow = egCreateImage(egScreenWidth, egScreenHeight, FALSE);
+} // VOID egEnableShadowBuffer()
+
 //
 // Drawing to the screen
 //
@@ -365,6 +518,14 @@ VOID egClearScreen(IN EG_PIXEL *Color)
     }
     FillColor.Reserved = 0;
 
+    // A fill is a single cheap Blt(), so it's done on the screen immediately
+    // even when shadowing; this also brings the shadow back in sync.
+    if (egShadow != NULL) {
+        egFillImage(egShadow, (EG_PIXEL *) &FillColor);
+        egShadowValid = TRUE;
+        egDirtyCount = 0;
+    }
+
     if (GraphicsOutput != NULL) {
         // EFI_GRAPHICS_OUTPUT_BLT_PIXEL and EFI_UGA_PIXEL have the same
         // layout, and the header from TianoCore actually defines them
@@ -376,6 +537,33 @@ VOID egClearScreen(IN EG_PIXEL *Color)
     }
 }
 
+// Shadow-buffer counterpart to the body of egDrawImage(): restore the
+// background under the image and compose the image over it, all in memory.
+static VOID egDrawImageToShadow(IN EG_IMAGE *Image, IN UINTN ScreenPosX, IN UINTN ScreenPosY)
+{
+    EG_IMAGE *Background = GlobalConfig.ScreenBackground;
+    EG_PIXEL *ShadowPtr;
+    UINTN    Width, Height;
+
+    ShadowPtr = egShadow->PixelData + ScreenPosY * egShadow->Width + ScreenPosX;
+    if ((Background == NULL) || (Background == Image) ||
+        ((Image->Width == egScreenWidth) && (Image->Height == egScreenHeight))) {
+       egRawCopy(ShadowPtr, Image->PixelData, Image->Width, Image->Height, egShadow->Width, Image->Width);
+    } else {
+       Width = Image->Width;
+       Height = Image->Height;
+       egRestrictImageArea(Background, ScreenPosX, ScreenPosY, &Width, &Height);
+       if ((Width < Image->Width) || (Height < Image->Height)) {
+          Print(L"Error! Can't crop image in egDrawImage()!\n");
+          return;
+       }
+       egRawCopy(ShadowPtr, Background->PixelData + ScreenPosY * Background->Width + ScreenPosX,
+                 Width, Height, egShadow->Width, Background->Width);
+       egComposeImage(egShadow, Image, ScreenPosX, ScreenPosY);
+    }
+    egMarkDirty(ScreenPosX, ScreenPosY, Image->Width, Image->Height);
+} // static VOID egDrawImageToShadow()
+
 VOID egDrawImage(IN EG_IMAGE *Image, IN UINTN ScreenPosX, IN UINTN ScreenPosY)
 {
     EG_IMAGE *CompImage = NULL;
@@ -387,6 +575,14 @@ VOID egDrawImage(IN EG_IMAGE *Image, IN UINTN ScreenPosX, IN UINTN ScreenPosY)
         (ScreenPosX > egScreenWidth) || (ScreenPosY > egScreenHeight))
         return;
 
+    // A full-screen image replaces everything, so the shadow is in sync afterwards
+    if ((egShadow != NULL) && (Image->Width == egScreenWidth) && (Image->Height == egScreenHeight))
+       egShadowValid = TRUE;
+    if (egUseShadow()) {
+       egDrawImageToShadow(Image, ScreenPosX, ScreenPosY);
+       return;
+    }
+
     if ((GlobalConfig.ScreenBackground == NULL) || ((Image->Width == egScreenWidth) && (Image->Height == egScreenHeight))) {
        CompImage = Image;
     } else if (GlobalConfig.ScreenBackground == Image) {
@@ -436,13 +632,19 @@ VOID egDrawImageArea(IN EG_IMAGE *Image,
     if (AreaWidth == 0)
         return;
 
-    if (GraphicsOutput != NULL) {
-        refit_call10_wrapper(GraphicsOutput->Blt, GraphicsOutput, (EFI_GRAPHICS_OUTPUT_BLT_PIXEL *)Image->PixelData,
-                             EfiBltBufferToVideo, AreaPosX, AreaPosY, ScreenPosX, ScreenPosY, AreaWidth, AreaHeight,
-                             Image->Width * 4);
-    } else if (UgaDraw != NULL) {
-        refit_call10_wrapper(UgaDraw->Blt, UgaDraw, (EFI_UGA_PIXEL *)Image->PixelData, EfiUgaBltBufferToVideo,
-                             AreaPosX, AreaPosY, ScreenPosX, ScreenPosY, AreaWidth, AreaHeight, Image->Width * 4);
+    if (egUseShadow()) {
+        if ((ScreenPosX >= egScreenWidth) || (ScreenPosY >= egScreenHeight))
+            return;
+        if (AreaWidth > egScreenWidth - ScreenPosX)
+            AreaWidth = egScreenWidth - ScreenPosX;
+        if (AreaHeight > egScreenHeight - ScreenPosY)
+            AreaHeight = egScreenHeight - ScreenPosY;
+        egRawCopy(egShadow->PixelData + ScreenPosY * egShadow->Width + ScreenPosX,
+                  Image->PixelData + AreaPosY * Image->Width + AreaPosX,
+                  AreaWidth, AreaHeight, egShadow->Width, Image->Width);
+        egMarkDirty(ScreenPosX, ScreenPosY, AreaWidth, AreaHeight);
+    } else {
+        egBltArea(Image, AreaPosX, AreaPosY, ScreenPosX, ScreenPosY, AreaWidth, AreaHeight);
     }
 }
 
@@ -477,6 +679,7 @@ VOID egDisplayMessage(IN CHAR16 *Text, EG_PIXEL *BGColor, UINTN PositionCode) {
               break;
       } // switch()
       egDrawImage(Box, (egScreenWidth - BoxWidth) / 2, Position);
+      egFlushScreen();
       if ((PositionCode == CENTER) || (Position >= egScreenHeight - (BoxHeight * 5)))
           Position = 1;
    } // if non-NULL inputs
@@ -496,6 +699,10 @@ EG_IMAGE * egCopyScreenArea(UINTN XPos, UINTN YPos, UINTN Width, UINTN Height) {
    if (!egHasGraphics)
       return NULL;
 
+   // the shadow buffer already holds the pixels; no need to read them back
+   if (egUseShadow())
+      return egCropImage(egShadow, XPos, YPos, Width, Height);
+
    // allocate a buffer for the screen area
    Image = egCreateImage(Width, Height, FALSE);
    if (Image == NULL) {
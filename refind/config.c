@@ -65,6 +65,7 @@
 #include "screen.h"
 #include "apple.h"
 #include "mystrings.h"
+#include "log.h"
 #include "../include/refit_call_wrapper.h"
 #include "../mok/mok.h"
 
@@ -268,12 +269,50 @@ static BOOLEAN KeepReading(IN OUT CHAR16 *p, IN OUT BOOLEAN *IsQuoted) {
    return MoreToRead;
 } // BOOLEAN KeepReading()
 
+// Returns the next token from the line at *Position, or NULL if there are no
+// more. The token is terminated in place, and *Position is advanced past it
+// (or set to NULL at the end of the line). *IsQuoted tracks whether the
+// position is within quotes.
+static CHAR16 *NextToken(IN OUT CHAR16 **Position, IN OUT BOOLEAN *IsQuoted)
+{
+    CHAR16 *p = *Position, *Token;
+
+    if (p == NULL)
+        return NULL;
+
+    // skip whitespace & find start of token
+    while ((*p == ' ' || *p == '\t' || *p == '=' || *p == ',') && !*IsQuoted)
+        p++;
+    if (*p == 0 || *p == '#')
+        return NULL;
+
+    if (*p == '"') {
+       *IsQuoted = !*IsQuoted;
+       p++;
+    } // if
+    Token = p;
+
+    // find end of token
+    while (KeepReading(p, IsQuoted)) {
+       if ((*p == L'/') && !*IsQuoted) // Switch Unix-style to DOS-style directory separators
+          *p = L'\\';
+       p++;
+    } // while
+    if (*p == L'\0' || *p == L'#')
+        *Position = NULL;
+    else
+        *Position = p + 1;
+    *p = 0;
+
+    return Token;
+} // static CHAR16 *NextToken()
+
 //
 // get a line of tokens from a file
 //
 UINTN ReadTokenLine(IN REFIT_FILE *File, OUT CHAR16 ***TokenList)
 {
-    BOOLEAN         LineFinished, IsQuoted = FALSE;
+    BOOLEAN         IsQuoted = FALSE;
     CHAR16          *Line, *Token, *p;
     UINTN           TokenCount = 0;
 
@@ -285,32 +324,8 @@ UINTN ReadTokenLine(IN REFIT_FILE *File, OUT CHAR16 ***TokenList)
             return(0);
 
         p = Line;
-        LineFinished = FALSE;
-        while (!LineFinished) {
-            // skip whitespace & find start of token
-            while ((*p == ' ' || *p == '\t' || *p == '=' || *p == ',') && !IsQuoted)
-                p++;
-            if (*p == 0 || *p == '#')
-                break;
-
-            if (*p == '"') {
-               IsQuoted = !IsQuoted;
-               p++;
-            } // if
-            Token = p;
-
-            // find end of token
-            while (KeepReading(p, &IsQuoted)) {
-               if ((*p == L'/') && !IsQuoted) // Switch Unix-style to DOS-style directory separators
-                  *p = L'\\';
-               p++;
-            } // while
-            if (*p == L'\0' || *p == L'#')
-                LineFinished = TRUE;
-            *p++ = 0;
-
+        while ((Token = NextToken(&p, &IsQuoted)) != NULL)
             AddListElement((VOID ***)TokenList, &TokenCount, (VOID *)StrDuplicate(Token));
-        }
 
         FreePool(Line);
     }
@@ -323,6 +338,377 @@ VOID FreeTokenLine(IN OUT CHAR16 ***TokenList, IN OUT UINTN *TokenCount)
     FreeList((VOID ***)TokenList, TokenCount);
 }
 
+//
+// compiled configuration files
+//
+
+// Keywords understood in refind.conf and the files it includes, as returned
+// by ConfigKeyword()....
+#define KEYWORD_NONE                     0
+#define KEYWORD_TIMEOUT                  1
+#define KEYWORD_SHUTDOWN_AFTER_TIMEOUT   2
+#define KEYWORD_HIDEUI                   3
+#define KEYWORD_ICONS_DIR                4
+#define KEYWORD_SCANFOR                  5
+#define KEYWORD_USE_NVRAM                6
+#define KEYWORD_DEEP_LEGACY_SCAN         7
+#define KEYWORD_SCAN_DELAY               8
+#define KEYWORD_ALSO_SCAN_DIRS           9
+#define KEYWORD_DONT_SCAN_VOLUMES        10
+#define KEYWORD_DONT_SCAN_DIRS           11
+#define KEYWORD_DONT_SCAN_FILES          12
+#define KEYWORD_DONT_SCAN_TOOLS          13
+#define KEYWORD_WINDOWS_RECOVERY_FILES   14
+#define KEYWORD_SCAN_DRIVER_DIRS         15
+#define KEYWORD_SHOWTOOLS                16
+#define KEYWORD_BANNER                   17
+#define KEYWORD_BANNER_SCALE             18
+#define KEYWORD_SMALL_ICON_SIZE          19
+#define KEYWORD_BIG_ICON_SIZE            20
+#define KEYWORD_MOUSE_SIZE               21
+#define KEYWORD_SELECTION_SMALL          22
+#define KEYWORD_SELECTION_BIG            23
+#define KEYWORD_DEFAULT_SELECTION        24
+#define KEYWORD_TEXTONLY                 25
+#define KEYWORD_TEXTMODE                 26
+#define KEYWORD_RESOLUTION               27
+#define KEYWORD_SCREENSAVER              28
+#define KEYWORD_USE_GRAPHICS_FOR         29
+#define KEYWORD_FONT                     30
+#define KEYWORD_THEME_PACK               31
+#define KEYWORD_SCAN_CACHE               32
+#define KEYWORD_SCAN_ALL_LINUX_KERNELS   33
+#define KEYWORD_FOLD_LINUX_KERNELS       34
+#define KEYWORD_EXTRA_KERNEL_VERSIONS    35
+#define KEYWORD_MAX_TAGS                 36
+#define KEYWORD_ENABLE_AND_LOCK_VMX      37
+#define KEYWORD_SPOOF_OSX_VERSION        38
+#define KEYWORD_CSR_VALUES               39
+#define KEYWORD_INCLUDE                  40
+#define KEYWORD_ENABLE_MOUSE             41
+#define KEYWORD_ENABLE_TOUCH             42
+#define KEYWORD_SHADOW_FRAMEBUFFER       43
+#define KEYWORD_MOUSE_SPEED              44
+// ... and within menuentry stanzas
+#define KEYWORD_MENUENTRY                45
+#define KEYWORD_LOADER                   46
+#define KEYWORD_VOLUME                   47
+#define KEYWORD_ICON                     48
+#define KEYWORD_INITRD                   49
+#define KEYWORD_OPTIONS                  50
+#define KEYWORD_ADD_OPTIONS              51
+#define KEYWORD_OSTYPE                   52
+#define KEYWORD_HASHFILES                53
+#define KEYWORD_GRAPHICS                 54
+#define KEYWORD_DISABLED                 55
+#define KEYWORD_SUBMENUENTRY             56
+#define KEYWORD_END_STANZA               57
+// ... and more options, added after the menuentry keywords
+#define KEYWORD_PRELOAD_LOADERS          58
+#define KEYWORD_DRIVER_MANIFEST          59
+#define KEYWORD_BOOT_TRACE               60
+#define KEYWORD_LOG_LEVEL                61
+#define KEYWORD_PROGRESSIVE_MENU         62
+
+typedef struct {
+    CHAR16  *Name;
+    UINTN   Keyword;
+} CONFIG_KEYWORD;
+
+static CONFIG_KEYWORD ConfigKeywords[] = {
+    { L"timeout",                      KEYWORD_TIMEOUT },
+    { L"shutdown_after_timeout",       KEYWORD_SHUTDOWN_AFTER_TIMEOUT },
+    { L"hideui",                       KEYWORD_HIDEUI },
+    { L"icons_dir",                    KEYWORD_ICONS_DIR },
+    { L"scanfor",                      KEYWORD_SCANFOR },
+    { L"use_nvram",                    KEYWORD_USE_NVRAM },
+    { L"uefi_deep_legacy_scan",        KEYWORD_DEEP_LEGACY_SCAN },
+    { L"scan_delay",                   KEYWORD_SCAN_DELAY },
+    { L"also_scan_dirs",               KEYWORD_ALSO_SCAN_DIRS },
+    { L"don't_scan_volumes",           KEYWORD_DONT_SCAN_VOLUMES },
+    { L"dont_scan_volumes",            KEYWORD_DONT_SCAN_VOLUMES },
+    { L"don't_scan_dirs",              KEYWORD_DONT_SCAN_DIRS },
+    { L"dont_scan_dirs",               KEYWORD_DONT_SCAN_DIRS },
+    { L"don't_scan_files",             KEYWORD_DONT_SCAN_FILES },
+    { L"dont_scan_files",              KEYWORD_DONT_SCAN_FILES },
+    { L"don't_scan_tools",             KEYWORD_DONT_SCAN_TOOLS },
+    { L"dont_scan_tools",              KEYWORD_DONT_SCAN_TOOLS },
+    { L"windows_recovery_files",       KEYWORD_WINDOWS_RECOVERY_FILES },
+    { L"scan_driver_dirs",             KEYWORD_SCAN_DRIVER_DIRS },
+    { L"showtools",                    KEYWORD_SHOWTOOLS },
+    { L"banner",                       KEYWORD_BANNER },
+    { L"banner_scale",                 KEYWORD_BANNER_SCALE },
+    { L"small_icon_size",              KEYWORD_SMALL_ICON_SIZE },
+    { L"big_icon_size",                KEYWORD_BIG_ICON_SIZE },
+    { L"mouse_size",                   KEYWORD_MOUSE_SIZE },
+    { L"selection_small",              KEYWORD_SELECTION_SMALL },
+    { L"selection_big",                KEYWORD_SELECTION_BIG },
+    { L"default_selection",            KEYWORD_DEFAULT_SELECTION },
+    { L"textonly",                     KEYWORD_TEXTONLY },
+    { L"textmode",                     KEYWORD_TEXTMODE },
+    { L"resolution",                   KEYWORD_RESOLUTION },
+    { L"screensaver",                  KEYWORD_SCREENSAVER },
+    { L"use_graphics_for",             KEYWORD_USE_GRAPHICS_FOR },
+    { L"font",                         KEYWORD_FONT },
+    { L"theme_pack",                   KEYWORD_THEME_PACK },
+    { L"scan_cache",                   KEYWORD_SCAN_CACHE },
+    { L"preload_loaders",              KEYWORD_PRELOAD_LOADERS },
+    { L"driver_manifest",              KEYWORD_DRIVER_MANIFEST },
+    { L"boot_trace",                   KEYWORD_BOOT_TRACE },
+    { L"log_level",                    KEYWORD_LOG_LEVEL },
+    { L"progressive_menu",             KEYWORD_PROGRESSIVE_MENU },
+    { L"scan_all_linux_kernels",       KEYWORD_SCAN_ALL_LINUX_KERNELS },
+    { L"fold_linux_kernels",           KEYWORD_FOLD_LINUX_KERNELS },
+    { L"extra_kernel_version_strings", KEYWORD_EXTRA_KERNEL_VERSIONS },
+    { L"max_tags",                     KEYWORD_MAX_TAGS },
+    { L"enable_and_lock_vmx",          KEYWORD_ENABLE_AND_LOCK_VMX },
+    { L"spoof_osx_version",            KEYWORD_SPOOF_OSX_VERSION },
+    { L"csr_values",                   KEYWORD_CSR_VALUES },
+    { L"include",                      KEYWORD_INCLUDE },
+    { L"enable_mouse",                 KEYWORD_ENABLE_MOUSE },
+    { L"enable_touch",                 KEYWORD_ENABLE_TOUCH },
+    { L"shadow_framebuffer",           KEYWORD_SHADOW_FRAMEBUFFER },
+    { L"mouse_speed",                  KEYWORD_MOUSE_SPEED },
+    { L"menuentry",                    KEYWORD_MENUENTRY },
+    { L"loader",                       KEYWORD_LOADER },
+    { L"volume",                       KEYWORD_VOLUME },
+    { L"icon",                         KEYWORD_ICON },
+    { L"initrd",                       KEYWORD_INITRD },
+    { L"options",                      KEYWORD_OPTIONS },
+    { L"add_options",                  KEYWORD_ADD_OPTIONS },
+    { L"ostype",                       KEYWORD_OSTYPE },
+    { L"hashfiles",                    KEYWORD_HASHFILES },
+    { L"graphics",                     KEYWORD_GRAPHICS },
+    { L"disabled",                     KEYWORD_DISABLED },
+    { L"submenuentry",                 KEYWORD_SUBMENUENTRY }
+};
+
+#define NUM_CONFIG_KEYWORDS (sizeof(ConfigKeywords) / sizeof(CONFIG_KEYWORD))
+
+// Hash table mapping keyword names to entries in ConfigKeywords[] (plus 1;
+// 0 marks an empty slot). KEYWORD_HASH_SEED was chosen so that no two of the
+// names above share a slot, so a lookup takes one hash and one MyStriCmp().
+// Collisions among names added later are resolved by linear probing.
+#define KEYWORD_HASH_SIZE   256
+#define KEYWORD_HASH_SEED   3501
+static UINT8   KeywordSlots[KEYWORD_HASH_SIZE];
+static BOOLEAN KeywordSlotsReady = FALSE;
+
+// Hash of Name, ignoring case the same way MyStriCmp() does
+static UINTN KeywordHash(IN CHAR16 *Name) {
+    UINT32 Hash = KEYWORD_HASH_SEED;
+
+    while (*Name != L'\0')
+        Hash = (Hash ^ (*Name++ & ~0x20)) * 16777619;
+    return (Hash >> 16) % KEYWORD_HASH_SIZE;
+} // static UINTN KeywordHash()
+
+// Returns the KEYWORD_* value for Token, or KEYWORD_NONE if it's not a keyword.
+static UINTN ConfigKeyword(IN CHAR16 *Token) {
+    UINTN i, Slot;
+
+    // MyStriCmp() would equate "}" with "]", so this one's checked exactly....
+    if (StrCmp(Token, L"}") == 0)
+        return KEYWORD_END_STANZA;
+
+    if (!KeywordSlotsReady) {
+        for (i = 0; i < NUM_CONFIG_KEYWORDS; i++) {
+            Slot = KeywordHash(ConfigKeywords[i].Name);
+            while (KeywordSlots[Slot] != 0)
+                Slot = (Slot + 1) % KEYWORD_HASH_SIZE;
+            KeywordSlots[Slot] = (UINT8) (i + 1);
+        } // for
+        KeywordSlotsReady = TRUE;
+    } // if
+
+    Slot = KeywordHash(Token);
+    while (KeywordSlots[Slot] != 0) {
+        if (MyStriCmp(Token, ConfigKeywords[KeywordSlots[Slot] - 1].Name))
+            return ConfigKeywords[KeywordSlots[Slot] - 1].Keyword;
+        Slot = (Slot + 1) % KEYWORD_HASH_SIZE;
+    } // while
+    return KEYWORD_NONE;
+} // static UINTN ConfigKeyword()
+
+// One non-empty line of a compiled configuration file
+typedef struct {
+    UINTN   Keyword;      // KEYWORD_* value of the first token
+    UINTN   TokenCount;
+    UINTN   FirstToken;   // index into COMPILED_CONFIG.Tokens
+} CONFIG_LINE;
+
+// A configuration file, tokenized once and kept for as long as the
+// configuration is in use, so that ReadConfig(), ScanUserConfigured() and
+// includes all work from the same copy without reading or parsing it again.
+// All token text lives in a single buffer.
+typedef struct {
+    CHAR16       *FileName;
+    CHAR16       *Text;
+    CHAR16       **Tokens;
+    CONFIG_LINE  *Lines;
+    UINTN        LineCount;
+    UINTN        NextLine;    // next line to be returned by NextConfigLine()
+} COMPILED_CONFIG;
+
+static COMPILED_CONFIG **CompiledConfigs = NULL;
+static UINTN           CompiledConfigCount = 0;
+
+// Makes *Buffer, currently *Size bytes long, at least Needed bytes long,
+// doubling its size as often as necessary. Returns FALSE if out of memory.
+static BOOLEAN GrowBuffer(IN OUT VOID **Buffer, IN OUT UINTN *Size, IN UINTN Needed) {
+    VOID   *NewBuffer;
+    UINTN  NewSize;
+
+    if (Needed <= *Size)
+        return TRUE;
+    NewSize = (*Size > 0) ? *Size : 256;
+    while (NewSize < Needed)
+        NewSize *= 2;
+    NewBuffer = AllocatePool(NewSize);
+    if (NewBuffer == NULL)
+        return FALSE;
+    if (*Buffer != NULL) {
+        CopyMem(NewBuffer, *Buffer, *Size);
+        FreePool(*Buffer);
+    }
+    *Buffer = NewBuffer;
+    *Size = NewSize;
+    return TRUE;
+} // static BOOLEAN GrowBuffer()
+
+static VOID FreeCompiledConfig(IN COMPILED_CONFIG *Config) {
+    if (Config != NULL) {
+        MyFreePool(Config->FileName);
+        MyFreePool(Config->Text);
+        MyFreePool(Config->Tokens);
+        MyFreePool(Config->Lines);
+        MyFreePool(Config);
+    }
+} // static VOID FreeCompiledConfig()
+
+// Forget all compiled configuration files, so that they'll be read afresh.
+static VOID FreeCompiledConfigs(VOID) {
+    UINTN i;
+
+    for (i = 0; i < CompiledConfigCount; i++)
+        FreeCompiledConfig(CompiledConfigs[i]);
+    MyFreePool(CompiledConfigs);
+    CompiledConfigs = NULL;
+    CompiledConfigCount = 0;
+} // static VOID FreeCompiledConfigs()
+
+// Reads and tokenizes FileName (in rEFInd's own directory). Tokens are split
+// exactly as ReadTokenLine() splits them.
+static COMPILED_CONFIG * CompileConfig(IN CHAR16 *FileName) {
+    EFI_STATUS       Status;
+    REFIT_FILE       File;
+    COMPILED_CONFIG  *Config;
+    CHAR16           *Line, *Position, *Token;
+    UINTN            *TokenOffsets = NULL;
+    UINTN            TextSize = 0, TextUsed = 0, OffsetsSize = 0, LinesSize = 0;
+    UINTN            TotalTokens = 0, LineTokens, Length, i, size;
+    BOOLEAN          IsQuoted = FALSE, OutOfMemory = FALSE;
+
+    Status = ReadFile(SelfDir, FileName, &File, &size);
+    if (EFI_ERROR(Status))
+        return NULL;
+
+    Config = AllocateZeroPool(sizeof(COMPILED_CONFIG));
+    if (Config == NULL) {
+        MyFreePool(File.Buffer);
+        return NULL;
+    }
+    Config->FileName = StrDuplicate(FileName);
+
+    while (!OutOfMemory && ((Line = ReadLine(&File)) != NULL)) {
+        Position = Line;
+        LineTokens = 0;
+        while (!OutOfMemory && ((Token = NextToken(&Position, &IsQuoted)) != NULL)) {
+            Length = StrLen(Token) + 1;
+            if (!GrowBuffer((VOID **) &Config->Text, &TextSize, (TextUsed + Length) * sizeof(CHAR16)) ||
+                !GrowBuffer((VOID **) &TokenOffsets, &OffsetsSize, (TotalTokens + 1) * sizeof(UINTN))) {
+                OutOfMemory = TRUE;
+            } else {
+                CopyMem(Config->Text + TextUsed, Token, Length * sizeof(CHAR16));
+                TokenOffsets[TotalTokens++] = TextUsed;
+                TextUsed += Length;
+                LineTokens++;
+            } // if/else
+        } // while
+        FreePool(Line);
+
+        if (!OutOfMemory && (LineTokens > 0)) {
+            if (GrowBuffer((VOID **) &Config->Lines, &LinesSize, (Config->LineCount + 1) * sizeof(CONFIG_LINE))) {
+                Config->Lines[Config->LineCount].TokenCount = LineTokens;
+                Config->Lines[Config->LineCount].FirstToken = TotalTokens - LineTokens;
+                Config->Lines[Config->LineCount].Keyword = ConfigKeyword(Config->Text + TokenOffsets[TotalTokens - LineTokens]);
+                Config->LineCount++;
+                IsQuoted = FALSE; // as in ReadTokenLine(), quotes don't carry past a line with tokens
+            } else {
+                OutOfMemory = TRUE;
+            } // if/else
+        } // if
+    } // while
+    MyFreePool(File.Buffer);
+
+    // The text buffer has reached its final size, so token offsets can now
+    // become pointers....
+    if (!OutOfMemory && (TotalTokens > 0)) {
+        Config->Tokens = AllocatePool(TotalTokens * sizeof(CHAR16 *));
+        if (Config->Tokens == NULL) {
+            OutOfMemory = TRUE;
+        } else {
+            for (i = 0; i < TotalTokens; i++)
+                Config->Tokens[i] = Config->Text + TokenOffsets[i];
+        } // if/else
+    } // if
+    MyFreePool(TokenOffsets);
+
+    if (OutOfMemory) {
+        FreeCompiledConfig(Config);
+        Config = NULL;
+    }
+    return Config;
+} // static COMPILED_CONFIG * CompileConfig()
+
+// Returns the compiled form of FileName, compiling it if that hasn't yet been
+// done since the last FreeCompiledConfigs(). The result is set to return its
+// first line from NextConfigLine().
+static COMPILED_CONFIG * GetCompiledConfig(IN CHAR16 *FileName) {
+    COMPILED_CONFIG *Config = NULL;
+    UINTN           i;
+
+    for (i = 0; (i < CompiledConfigCount) && (Config == NULL); i++) {
+        if (MyStriCmp(CompiledConfigs[i]->FileName, FileName))
+            Config = CompiledConfigs[i];
+    }
+    if (Config == NULL) {
+        Config = CompileConfig(FileName);
+        if (Config != NULL)
+            AddListElement((VOID ***) &CompiledConfigs, &CompiledConfigCount, Config);
+    }
+    if (Config != NULL)
+        Config->NextLine = 0;
+    return Config;
+} // static COMPILED_CONFIG * GetCompiledConfig()
+
+// Returns the number of tokens on the next line of Config, or 0 at the end
+// of the file. *TokenList points into Config and must NOT be freed; *Keyword
+// receives the KEYWORD_* value of its first token.
+static UINTN NextConfigLine(IN COMPILED_CONFIG *Config, OUT CHAR16 ***TokenList, OUT UINTN *Keyword) {
+    CONFIG_LINE *Line;
+
+    if (Config->NextLine >= Config->LineCount) {
+        *TokenList = NULL;
+        *Keyword = KEYWORD_NONE;
+        return 0;
+    }
+    Line = &Config->Lines[Config->NextLine++];
+    *TokenList = &Config->Tokens[Line->FirstToken];
+    *Keyword = Line->Keyword;
+    return Line->TokenCount;
+} // static UINTN NextConfigLine()
+
 // handle a parameter with a single integer argument
 static VOID HandleInt(IN CHAR16 **TokenList, IN UINTN TokenCount, OUT UINTN *Value)
 {
@@ -484,12 +870,11 @@ static VOID SetDefaultByTime(IN CHAR16 **TokenList, OUT CHAR16 **Default) {
 // read config file
 VOID ReadConfig(CHAR16 *FileName)
 {
-    EFI_STATUS      Status;
-    REFIT_FILE      File;
+    COMPILED_CONFIG *Config;
     CHAR16          **TokenList;
     CHAR16          *FlagName;
     CHAR16          *TempStr = NULL;
-    UINTN           TokenCount, i;
+    UINTN           TokenCount, Keyword, i;
 
     // Set a few defaults only if we're loading the default file.
     if (MyStriCmp(FileName, GlobalConfig.ConfigFilename)) {
@@ -518,33 +903,40 @@ VOID ReadConfig(CHAR16 *FileName)
        GlobalConfig.MacOSRecoveryFiles = StrDuplicate(MACOS_RECOVERY_FILES);
        MyFreePool(GlobalConfig.DefaultSelection);
        GlobalConfig.DefaultSelection = StrDuplicate(L"+");
+       // Reading the main file (at startup or on a rescan), so re-read every file
+       FreeCompiledConfigs();
+       // ... and drop any theme pack, which is loaded again if theme_pack is still set
+       egFreeThemePack();
     } // if
 
     if (!FileExists(SelfDir, FileName)) {
        Print(L"Configuration file '%s' missing!\n", FileName);
+       LOG_WARNING(L"Configuration file %s is missing", FileName);
        if (!FileExists(SelfDir, L"icons")) {
           Print(L"Icons directory doesn't exist; setting textonly = TRUE!\n");
+          LOG_WARNING(L"Icons directory is missing; using text mode");
           GlobalConfig.TextOnly = TRUE;
        }
        return;
     }
 
-    Status = ReadFile(SelfDir, FileName, &File, &i);
-    if (EFI_ERROR(Status))
+    Config = GetCompiledConfig(FileName);
+    if (Config == NULL)
         return;
+    LOG_INFO(L"Reading configuration file %s", FileName);
 
     for (;;) {
-        TokenCount = ReadTokenLine(&File, &TokenList);
+        TokenCount = NextConfigLine(Config, &TokenList, &Keyword);
         if (TokenCount == 0)
             break;
 
-        if (MyStriCmp(TokenList[0], L"timeout")) {
+        if (Keyword == KEYWORD_TIMEOUT) {
             HandleInt(TokenList, TokenCount, &(GlobalConfig.Timeout));
 
-        } else if (MyStriCmp(TokenList[0], L"shutdown_after_timeout")) {
+        } else if (Keyword == KEYWORD_SHUTDOWN_AFTER_TIMEOUT) {
            GlobalConfig.ShutdownAfterTimeout = HandleBoolean(TokenList, TokenCount);
 
-        } else if (MyStriCmp(TokenList[0], L"hideui")) {
+        } else if (Keyword == KEYWORD_HIDEUI) {
             for (i = 1; i < TokenCount; i++) {
                 FlagName = TokenList[i];
                 if (MyStriCmp(FlagName, L"banner")) {
@@ -569,13 +961,14 @@ VOID ReadConfig(CHAR16 *FileName)
                    GlobalConfig.HideUIFlags = HIDEUI_FLAG_ALL;
                 } else {
                     Print(L" unknown hideui flag: '%s'\n", FlagName);
+                    LOG_WARNING(L"Unknown hideui flag in %s: %s", FileName, FlagName);
                 }
             }
 
-        } else if (MyStriCmp(TokenList[0], L"icons_dir")) {
+        } else if (Keyword == KEYWORD_ICONS_DIR) {
            HandleString(TokenList, TokenCount, &(GlobalConfig.IconsDir));
 
-        } else if (MyStriCmp(TokenList[0], L"scanfor")) {
+        } else if (Keyword == KEYWORD_SCANFOR) {
            for (i = 0; i < NUM_SCAN_OPTIONS; i++) {
               if (i < TokenCount)
                  GlobalConfig.ScanFor[i] = TokenList[i][0];
@@ -583,19 +976,19 @@ VOID ReadConfig(CHAR16 *FileName)
                  GlobalConfig.ScanFor[i] = ' ';
            }
 
-        } else if (MyStriCmp(TokenList[0], L"use_nvram")) {
+        } else if (Keyword == KEYWORD_USE_NVRAM) {
            GlobalConfig.UseNvram = HandleBoolean(TokenList, TokenCount);
 
-        } else if (MyStriCmp(TokenList[0], L"uefi_deep_legacy_scan")) {
+        } else if (Keyword == KEYWORD_DEEP_LEGACY_SCAN) {
            GlobalConfig.DeepLegacyScan = HandleBoolean(TokenList, TokenCount);
 
-        } else if (MyStriCmp(TokenList[0], L"scan_delay") && (TokenCount == 2)) {
+        } else if ((Keyword == KEYWORD_SCAN_DELAY) && (TokenCount == 2)) {
            HandleInt(TokenList, TokenCount, &(GlobalConfig.ScanDelay));
 
-        } else if (MyStriCmp(TokenList[0], L"also_scan_dirs")) {
+        } else if (Keyword == KEYWORD_ALSO_SCAN_DIRS) {
             HandleStrings(TokenList, TokenCount, &(GlobalConfig.AlsoScan));
 
-        } else if (MyStriCmp(TokenList[0], L"don't_scan_volumes") || MyStriCmp(TokenList[0], L"dont_scan_volumes")) {
+        } else if (Keyword == KEYWORD_DONT_SCAN_VOLUMES) {
            // Note: Don't use HandleStrings() because it modifies slashes, which might be present in volume name
            MyFreePool(GlobalConfig.DontScanVolumes);
            GlobalConfig.DontScanVolumes = NULL;
@@ -603,22 +996,22 @@ VOID ReadConfig(CHAR16 *FileName)
               MergeStrings(&GlobalConfig.DontScanVolumes, TokenList[i], L',');
            }
 
-        } else if (MyStriCmp(TokenList[0], L"don't_scan_dirs") || MyStriCmp(TokenList[0], L"dont_scan_dirs")) {
+        } else if (Keyword == KEYWORD_DONT_SCAN_DIRS) {
             HandleStrings(TokenList, TokenCount, &(GlobalConfig.DontScanDirs));
 
-        } else if (MyStriCmp(TokenList[0], L"don't_scan_files") || MyStriCmp(TokenList[0], L"dont_scan_files")) {
+        } else if (Keyword == KEYWORD_DONT_SCAN_FILES) {
            HandleStrings(TokenList, TokenCount, &(GlobalConfig.DontScanFiles));
 
-        } else if (MyStriCmp(TokenList[0], L"don't_scan_tools") || MyStriCmp(TokenList[0], L"dont_scan_tools")) {
+        } else if (Keyword == KEYWORD_DONT_SCAN_TOOLS) {
            HandleStrings(TokenList, TokenCount, &(GlobalConfig.DontScanTools));
 
-        } else if (MyStriCmp(TokenList[0], L"windows_recovery_files")) {
+        } else if (Keyword == KEYWORD_WINDOWS_RECOVERY_FILES) {
            HandleStrings(TokenList, TokenCount, &(GlobalConfig.WindowsRecoveryFiles));
 
-        } else if (MyStriCmp(TokenList[0], L"scan_driver_dirs")) {
+        } else if (Keyword == KEYWORD_SCAN_DRIVER_DIRS) {
             HandleStrings(TokenList, TokenCount, &(GlobalConfig.DriverDirs));
 
-        } else if (MyStriCmp(TokenList[0], L"showtools")) {
+        } else if (Keyword == KEYWORD_SHOWTOOLS) {
             SetMem(GlobalConfig.ShowTools, NUM_TOOLS * sizeof(UINTN), 0);
             GlobalConfig.HiddenTags = FALSE;
             for (i = 1; (i < TokenCount) && (i < NUM_TOOLS); i++) {
@@ -658,29 +1051,31 @@ VOID ReadConfig(CHAR16 *FileName)
                     GlobalConfig.HiddenTags = TRUE;
                 } else {
                    Print(L" unknown showtools flag: '%s'\n", FlagName);
+                   LOG_WARNING(L"Unknown showtools flag in %s: %s", FileName, FlagName);
                 }
             } // showtools options
 
-        } else if (MyStriCmp(TokenList[0], L"banner")) {
+        } else if (Keyword == KEYWORD_BANNER) {
            HandleString(TokenList, TokenCount, &(GlobalConfig.BannerFileName));
 
-        } else if (MyStriCmp(TokenList[0], L"banner_scale") && (TokenCount == 2)) {
+        } else if ((Keyword == KEYWORD_BANNER_SCALE) && (TokenCount == 2)) {
            if (MyStriCmp(TokenList[1], L"noscale")) {
               GlobalConfig.BannerScale = BANNER_NOSCALE;
            } else if (MyStriCmp(TokenList[1], L"fillscreen") || MyStriCmp(TokenList[1], L"fullscreen")) {
               GlobalConfig.BannerScale = BANNER_FILLSCREEN;
            } else {
               Print(L" unknown banner_type flag: '%s'\n", TokenList[1]);
+              LOG_WARNING(L"Unknown banner_scale flag in %s: %s", FileName, TokenList[1]);
            } // if/else
 
-        } else if (MyStriCmp(TokenList[0], L"small_icon_size") && (TokenCount == 2)) {
+        } else if ((Keyword == KEYWORD_SMALL_ICON_SIZE) && (TokenCount == 2)) {
            HandleInt(TokenList, TokenCount, &i);
            if (i >= 32) {
               GlobalConfig.IconSizes[ICON_SIZE_SMALL] = i;
               HaveResized = TRUE;
            }
 
-        } else if (MyStriCmp(TokenList[0], L"big_icon_size") && (TokenCount == 2)) {
+        } else if ((Keyword == KEYWORD_BIG_ICON_SIZE) && (TokenCount == 2)) {
            HandleInt(TokenList, TokenCount, &i);
            if (i >= 32) {
               GlobalConfig.IconSizes[ICON_SIZE_BIG] = i;
@@ -689,42 +1084,42 @@ VOID ReadConfig(CHAR16 *FileName)
               HaveResized = TRUE;
            }
 
-        } else if (MyStriCmp(TokenList[0], L"mouse_size") && (TokenCount == 2)) {
+        } else if ((Keyword == KEYWORD_MOUSE_SIZE) && (TokenCount == 2)) {
            HandleInt(TokenList, TokenCount, &i);
            if (i >= DEFAULT_MOUSE_SIZE) {
               GlobalConfig.IconSizes[ICON_SIZE_MOUSE] = i;
            }
 
-        } else if (MyStriCmp(TokenList[0], L"selection_small")) {
+        } else if (Keyword == KEYWORD_SELECTION_SMALL) {
            HandleString(TokenList, TokenCount, &(GlobalConfig.SelectionSmallFileName));
 
-        } else if (MyStriCmp(TokenList[0], L"selection_big")) {
+        } else if (Keyword == KEYWORD_SELECTION_BIG) {
            HandleString(TokenList, TokenCount, &(GlobalConfig.SelectionBigFileName));
 
-        } else if (MyStriCmp(TokenList[0], L"default_selection")) {
+        } else if (Keyword == KEYWORD_DEFAULT_SELECTION) {
            if (TokenCount == 4) {
               SetDefaultByTime(TokenList, &(GlobalConfig.DefaultSelection));
            } else {
               HandleString(TokenList, TokenCount, &(GlobalConfig.DefaultSelection));
            }
 
-        } else if (MyStriCmp(TokenList[0], L"textonly")) {
+        } else if (Keyword == KEYWORD_TEXTONLY) {
            GlobalConfig.TextOnly = HandleBoolean(TokenList, TokenCount);
 
-        } else if (MyStriCmp(TokenList[0], L"textmode")) {
+        } else if (Keyword == KEYWORD_TEXTMODE) {
            HandleInt(TokenList, TokenCount, &(GlobalConfig.RequestedTextMode));
 
-        } else if (MyStriCmp(TokenList[0], L"resolution") && ((TokenCount == 2) || (TokenCount == 3))) {
+        } else if ((Keyword == KEYWORD_RESOLUTION) && ((TokenCount == 2) || (TokenCount == 3))) {
            GlobalConfig.RequestedScreenWidth = Atoi(TokenList[1]);
            if (TokenCount == 3)
               GlobalConfig.RequestedScreenHeight = Atoi(TokenList[2]);
            else
               GlobalConfig.RequestedScreenHeight = 0;
 
-        } else if (MyStriCmp(TokenList[0], L"screensaver")) {
+        } else if (Keyword == KEYWORD_SCREENSAVER) {
            HandleInt(TokenList, TokenCount, &(GlobalConfig.ScreensaverTime));
 
-        } else if (MyStriCmp(TokenList[0], L"use_graphics_for")) {
+        } else if (Keyword == KEYWORD_USE_GRAPHICS_FOR) {
            if ((TokenCount == 2) || ((TokenCount > 2) && (!MyStriCmp(TokenList[1], L"+"))))
               GlobalConfig.GraphicsFor = 0;
            for (i = 1; i < TokenCount; i++) {
@@ -741,48 +1136,72 @@ VOID ReadConfig(CHAR16 *FileName)
               }
            } // for (graphics_on tokens)
 
-        } else if (MyStriCmp(TokenList[0], L"font") && (TokenCount == 2)) {
+        } else if ((Keyword == KEYWORD_FONT) && (TokenCount == 2)) {
            egLoadFont(TokenList[1]);
 
-        } else if (MyStriCmp(TokenList[0], L"scan_all_linux_kernels")) {
+        } else if ((Keyword == KEYWORD_THEME_PACK) && (TokenCount == 2)) {
+           egLoadThemePack(SelfDir, TokenList[1]);
+
+        } else if (Keyword == KEYWORD_SCAN_CACHE) {
+           GlobalConfig.ScanCache = HandleBoolean(TokenList, TokenCount);
+
+        } else if (Keyword == KEYWORD_PRELOAD_LOADERS) {
+           GlobalConfig.PreloadLoaders = HandleBoolean(TokenList, TokenCount);
+
+        } else if (Keyword == KEYWORD_DRIVER_MANIFEST) {
+           GlobalConfig.DriverManifest = HandleBoolean(TokenList, TokenCount);
+
+        } else if (Keyword == KEYWORD_BOOT_TRACE) {
+           GlobalConfig.BootTrace = HandleBoolean(TokenList, TokenCount);
+
+        } else if (Keyword == KEYWORD_LOG_LEVEL) {
+           HandleInt(TokenList, TokenCount, &(GlobalConfig.LogLevel));
+
+        } else if (Keyword == KEYWORD_PROGRESSIVE_MENU) {
+           GlobalConfig.ProgressiveMenu = HandleBoolean(TokenList, TokenCount);
+
+        } else if (Keyword == KEYWORD_SCAN_ALL_LINUX_KERNELS) {
            GlobalConfig.ScanAllLinux = HandleBoolean(TokenList, TokenCount);
 
-        } else if (MyStriCmp(TokenList[0], L"fold_linux_kernels")) {
+        } else if (Keyword == KEYWORD_FOLD_LINUX_KERNELS) {
             GlobalConfig.FoldLinuxKernels = HandleBoolean(TokenList, TokenCount);
 
-        } else if (MyStriCmp(TokenList[0], L"extra_kernel_version_strings")) {
+        } else if (Keyword == KEYWORD_EXTRA_KERNEL_VERSIONS) {
             HandleStrings(TokenList, TokenCount, &(GlobalConfig.ExtraKernelVersionStrings));
 
-        } else if (MyStriCmp(TokenList[0], L"max_tags")) {
+        } else if (Keyword == KEYWORD_MAX_TAGS) {
            HandleInt(TokenList, TokenCount, &(GlobalConfig.MaxTags));
 
-        } else if (MyStriCmp(TokenList[0], L"enable_and_lock_vmx")) {
+        } else if (Keyword == KEYWORD_ENABLE_AND_LOCK_VMX) {
            GlobalConfig.EnableAndLockVMX = HandleBoolean(TokenList, TokenCount);
 
-        } else if (MyStriCmp(TokenList[0], L"spoof_osx_version")) {
+        } else if (Keyword == KEYWORD_SPOOF_OSX_VERSION) {
             HandleString(TokenList, TokenCount, &(GlobalConfig.SpoofOSXVersion));
 
-        } else if (MyStriCmp(TokenList[0], L"csr_values")) {
+        } else if (Keyword == KEYWORD_CSR_VALUES) {
             HandleHexes(TokenList, TokenCount, CSR_MAX_LEGAL_VALUE, &(GlobalConfig.CsrValues));
 
-        } else if (MyStriCmp(TokenList[0], L"include") && (TokenCount == 2) && MyStriCmp(FileName, GlobalConfig.ConfigFilename)) {
+        } else if ((Keyword == KEYWORD_INCLUDE) && (TokenCount == 2) && MyStriCmp(FileName, GlobalConfig.ConfigFilename)) {
            if (!MyStriCmp(TokenList[1], FileName)) {
               ReadConfig(TokenList[1]);
            }
 
-        } else if (MyStriCmp(TokenList[0], L"enable_mouse")) {
+        } else if (Keyword == KEYWORD_ENABLE_MOUSE) {
            GlobalConfig.EnableMouse = HandleBoolean(TokenList, TokenCount);
            if(GlobalConfig.EnableMouse) {
                GlobalConfig.EnableTouch = FALSE;
            }
         
-        } else if (MyStriCmp(TokenList[0], L"enable_touch")) {
+        } else if (Keyword == KEYWORD_ENABLE_TOUCH) {
            GlobalConfig.EnableTouch = HandleBoolean(TokenList, TokenCount);
            if(GlobalConfig.EnableTouch) {
                GlobalConfig.EnableMouse = FALSE;
            }
            
-        } else if (MyStriCmp(TokenList[0], L"mouse_speed") && (TokenCount == 2)) {
+        } else if (Keyword == KEYWORD_SHADOW_FRAMEBUFFER) {
+           GlobalConfig.ShadowFramebuffer = HandleBoolean(TokenList, TokenCount);
+
+        } else if ((Keyword == KEYWORD_MOUSE_SPEED) && (TokenCount == 2)) {
            HandleInt(TokenList, TokenCount, &i);
            if (i < 1)
               i = 1;
@@ -790,23 +1209,21 @@ VOID ReadConfig(CHAR16 *FileName)
               i = 32;
            GlobalConfig.MouseSpeed = i;
         }
-
-        FreeTokenLine(&TokenList, &TokenCount);
     }
     if ((GlobalConfig.DontScanFiles) && (GlobalConfig.WindowsRecoveryFiles))
        MergeStrings(&(GlobalConfig.DontScanFiles), GlobalConfig.WindowsRecoveryFiles, L',');
-    MyFreePool(File.Buffer);
 
     if (!FileExists(SelfDir, L"icons") && !FileExists(SelfDir, GlobalConfig.IconsDir)) {
        Print(L"Icons directory doesn't exist; setting textonly = TRUE!\n");
+       LOG_WARNING(L"Icons directory is missing; using text mode");
        GlobalConfig.TextOnly = TRUE;
     }
 } /* VOID ReadConfig() */
 
-static VOID AddSubmenu(LOADER_ENTRY *Entry, REFIT_FILE *File, REFIT_VOLUME *Volume, CHAR16 *Title) {
+static VOID AddSubmenu(LOADER_ENTRY *Entry, COMPILED_CONFIG *Config, REFIT_VOLUME *Volume, CHAR16 *Title) {
    REFIT_MENU_SCREEN  *SubScreen;
    LOADER_ENTRY       *SubEntry;
-   UINTN              TokenCount;
+   UINTN              TokenCount, Keyword;
    CHAR16             **TokenList;
 
    SubScreen = InitializeSubScreen(Entry);
@@ -818,14 +1235,14 @@ static VOID AddSubmenu(LOADER_ENTRY *Entry, REFIT_FILE *File, REFIT_VOLUME *Volu
       return;
    SubEntry->me.Title        = StrDuplicate(Title);
 
-   while (((TokenCount = ReadTokenLine(File, &TokenList)) > 0) && (StrCmp(TokenList[0], L"}") != 0)) {
+   while (((TokenCount = NextConfigLine(Config, &TokenList, &Keyword)) > 0) && (Keyword != KEYWORD_END_STANZA)) {
 
-      if (MyStriCmp(TokenList[0], L"loader") && (TokenCount > 1)) { // set the boot loader filename
+      if ((Keyword == KEYWORD_LOADER) && (TokenCount > 1)) { // set the boot loader filename
          MyFreePool(SubEntry->LoaderPath);
          SubEntry->LoaderPath = StrDuplicate(TokenList[1]);
          SubEntry->Volume = Volume;
 
-      } else if (MyStriCmp(TokenList[0], L"volume") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_VOLUME) && (TokenCount > 1)) {
          if (FindVolume(&Volume, TokenList[1])) {
             if ((Volume != NULL) && (Volume->IsReadable) && (Volume->RootDir)) {
                MyFreePool(SubEntry->me.Title);
@@ -836,35 +1253,33 @@ static VOID AddSubmenu(LOADER_ENTRY *Entry, REFIT_FILE *File, REFIT_VOLUME *Volu
             } // if volume is readable
          } // if match found
 
-      } else if (MyStriCmp(TokenList[0], L"initrd")) {
+      } else if (Keyword == KEYWORD_INITRD) {
          MyFreePool(SubEntry->InitrdPath);
          SubEntry->InitrdPath = NULL;
          if (TokenCount > 1) {
             SubEntry->InitrdPath = StrDuplicate(TokenList[1]);
          }
 
-      } else if (MyStriCmp(TokenList[0], L"options")) {
+      } else if (Keyword == KEYWORD_OPTIONS) {
          MyFreePool(SubEntry->LoadOptions);
          SubEntry->LoadOptions = NULL;
          if (TokenCount > 1) {
             SubEntry->LoadOptions = StrDuplicate(TokenList[1]);
          } // if/else
 
-      } else if (MyStriCmp(TokenList[0], L"add_options") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_ADD_OPTIONS) && (TokenCount > 1)) {
          MergeStrings(&SubEntry->LoadOptions, TokenList[1], L' ');
 
-      } else if (MyStriCmp(TokenList[0], L"hashfiles") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_HASHFILES) && (TokenCount > 1)) {
 	//any hashfiles entry in a submenuitem is added to those in the parent
 	for(int i = 1; i < TokenCount; i++)
 	  AddListElement((VOID ***)&(SubEntry->HashPaths),&(SubEntry->HashPathsCount),(VOID *)StrDuplicate(TokenList[i]));
-      } else if (MyStriCmp(TokenList[0], L"graphics") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_GRAPHICS) && (TokenCount > 1)) {
          SubEntry->UseGraphicsMode = MyStriCmp(TokenList[1], L"on");
 
-      } else if (MyStriCmp(TokenList[0], L"disabled")) {
+      } else if (Keyword == KEYWORD_DISABLED) {
          SubEntry->Enabled = FALSE;
       } // ief/elseif
-
-      FreeTokenLine(&TokenList, &TokenCount);
    } // while()
 
    if (SubEntry->InitrdPath != NULL) {
@@ -882,9 +1297,9 @@ static VOID AddSubmenu(LOADER_ENTRY *Entry, REFIT_FILE *File, REFIT_VOLUME *Volu
 // Adds the options from a SINGLE refind.conf stanza to a new loader entry and returns
 // that entry. The calling function is then responsible for adding the entry to the
 // list of entries.
-static LOADER_ENTRY * AddStanzaEntries(REFIT_FILE *File, REFIT_VOLUME *Volume, CHAR16 *Title) {
+static LOADER_ENTRY * AddStanzaEntries(COMPILED_CONFIG *Config, REFIT_VOLUME *Volume, CHAR16 *Title) {
    CHAR16       **TokenList;
-   UINTN        TokenCount;
+   UINTN        TokenCount, Keyword;
    LOADER_ENTRY *Entry;
    BOOLEAN      DefaultsSet = FALSE, AddedSubmenu = FALSE;
    REFIT_VOLUME *CurrentVolume = Volume;
@@ -904,15 +1319,15 @@ static LOADER_ENTRY * AddStanzaEntries(REFIT_FILE *File, REFIT_VOLUME *Volume, C
 
    // Parse the config file to add options for a single stanza, terminating when the token
    // is "}" or when the end of file is reached.
-   while (((TokenCount = ReadTokenLine(File, &TokenList)) > 0) && (StrCmp(TokenList[0], L"}") != 0)) {
-      if (MyStriCmp(TokenList[0], L"loader") && (TokenCount > 1)) { // set the boot loader filename
+   while (((TokenCount = NextConfigLine(Config, &TokenList, &Keyword)) > 0) && (Keyword != KEYWORD_END_STANZA)) {
+      if ((Keyword == KEYWORD_LOADER) && (TokenCount > 1)) { // set the boot loader filename
          Entry->LoaderPath = StrDuplicate(TokenList[1]);
          SetLoaderDefaults(Entry, TokenList[1], CurrentVolume);
          MyFreePool(Entry->LoadOptions);
          Entry->LoadOptions = NULL; // Discard default options, if any
          DefaultsSet = TRUE;
 
-      } else if (MyStriCmp(TokenList[0], L"volume") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_VOLUME) && (TokenCount > 1)) {
          if (FindVolume(&CurrentVolume, TokenList[1])) {
             if ((CurrentVolume != NULL) && (CurrentVolume->IsReadable) && (CurrentVolume->RootDir)) {
                MyFreePool(Entry->me.Title);
@@ -923,41 +1338,40 @@ static LOADER_ENTRY * AddStanzaEntries(REFIT_FILE *File, REFIT_VOLUME *Volume, C
             } // if volume is readable
          } // if match found
 
-      } else if (MyStriCmp(TokenList[0], L"icon") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_ICON) && (TokenCount > 1)) {
 	 MyFreePool(Entry->me.Image); //FIXME: tim e. shouldn't this be egFreeImage ?
          Entry->me.Image = egLoadIcon(CurrentVolume->RootDir, TokenList[1], GlobalConfig.IconSizes[ICON_SIZE_BIG]);
          if (Entry->me.Image == NULL) {
             Entry->me.Image = DummyImage(GlobalConfig.IconSizes[ICON_SIZE_BIG]);
          }
 
-      } else if (MyStriCmp(TokenList[0], L"initrd") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_INITRD) && (TokenCount > 1)) {
          MyFreePool(Entry->InitrdPath);
          Entry->InitrdPath = StrDuplicate(TokenList[1]);
 
-      } else if (MyStriCmp(TokenList[0], L"options") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_OPTIONS) && (TokenCount > 1)) {
          MyFreePool(Entry->LoadOptions);
          Entry->LoadOptions = StrDuplicate(TokenList[1]);
 
-      } else if (MyStriCmp(TokenList[0], L"ostype") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_OSTYPE) && (TokenCount > 1)) {
          if (TokenCount > 1) {
             Entry->OSType = TokenList[1][0];
          }
-      } else if (MyStriCmp(TokenList[0], L"hashfiles") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_HASHFILES) && (TokenCount > 1)) {
 	//we allow for multiple lines or a single line with multiple entries
 	for(int i = 1; i < TokenCount; i++)
 	  AddListElement((VOID ***)&(Entry->HashPaths),&(Entry->HashPathsCount),(VOID *)StrDuplicate(TokenList[i]));
-      } else if (MyStriCmp(TokenList[0], L"graphics") && (TokenCount > 1)) {
+      } else if ((Keyword == KEYWORD_GRAPHICS) && (TokenCount > 1)) {
          Entry->UseGraphicsMode = MyStriCmp(TokenList[1], L"on");
 
-      } else if (MyStriCmp(TokenList[0], L"disabled")) {
+      } else if (Keyword == KEYWORD_DISABLED) {
          Entry->Enabled = FALSE;
 
-      } else if (MyStriCmp(TokenList[0], L"submenuentry") && (TokenCount > 1)) {
-         AddSubmenu(Entry, File, CurrentVolume, TokenList[1]);
+      } else if ((Keyword == KEYWORD_SUBMENUENTRY) && (TokenCount > 1)) {
+         AddSubmenu(Entry, Config, CurrentVolume, TokenList[1]);
          AddedSubmenu = TRUE;
 
       } // set options to pass to the loader program
-      FreeTokenLine(&TokenList, &TokenCount);
    } // while()
 
    if (AddedSubmenu)
@@ -981,25 +1395,24 @@ static LOADER_ENTRY * AddStanzaEntries(REFIT_FILE *File, REFIT_VOLUME *Volume, C
 // entries based on the contents of that file....
 VOID ScanUserConfigured(CHAR16 *FileName)
 {
-   EFI_STATUS        Status;
-   REFIT_FILE        File;
+   COMPILED_CONFIG   *Config;
    REFIT_VOLUME      *Volume;
    CHAR16            **TokenList;
    CHAR16            *Title = NULL;
-   UINTN             TokenCount, size;
+   UINTN             TokenCount, Keyword;
    LOADER_ENTRY      *Entry;
 
    if (FileExists(SelfDir, FileName)) {
-      Status = ReadFile(SelfDir, FileName, &File, &size);
-      if (EFI_ERROR(Status))
+      Config = GetCompiledConfig(FileName);
+      if (Config == NULL)
          return;
 
       Volume = SelfVolume;
 
-      while ((TokenCount = ReadTokenLine(&File, &TokenList)) > 0) {
-         if (MyStriCmp(TokenList[0], L"menuentry") && (TokenCount > 1)) {
+      while ((TokenCount = NextConfigLine(Config, &TokenList, &Keyword)) > 0) {
+         if ((Keyword == KEYWORD_MENUENTRY) && (TokenCount > 1)) {
             Title = StrDuplicate(TokenList[1]);
-            Entry = AddStanzaEntries(&File, Volume, TokenList[1]);
+            Entry = AddStanzaEntries(Config, Volume, TokenList[1]);
             if (Entry->Enabled) {
                if (Entry->me.SubScreen == NULL)
                   GenerateSubScreen(Entry, Volume, TRUE);
@@ -1009,14 +1422,13 @@ VOID ScanUserConfigured(CHAR16 *FileName)
             } // if/else
             MyFreePool(Title);
 
-         } else if (MyStriCmp(TokenList[0], L"include") && (TokenCount == 2) &&
+         } else if ((Keyword == KEYWORD_INCLUDE) && (TokenCount == 2) &&
                     MyStriCmp(FileName, GlobalConfig.ConfigFilename)) {
             if (!MyStriCmp(TokenList[1], FileName)) {
                ScanUserConfigured(TokenList[1]);
             }
 
          } // if/else if...
-         FreeTokenLine(&TokenList, &TokenCount);
       } // while()
    } // if()
 } // VOID ScanUserConfigured()
@@ -45,6 +45,9 @@
 
 #include "crc32.h"
 
+// The btrfs driver includes this file for crc32c() alone, and defines
+// CRC32C_ONLY to leave out crc32() and its tables.
+#ifndef CRC32C_ONLY
 static UINT32 crc32_tab[] = {
    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
    0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
@@ -90,17 +93,167 @@ static UINT32 crc32_tab[] = {
    0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
    0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
+#endif
 
-UINT32 crc32(UINT32 crc, const VOID *buf, UINTN size)
-{
-   const UINT8 *p;
+// Slicing-by-8: Crc32Tables[0] is crc32_tab, and Crc32Tables[k][n] is the
+// CRC contribution of byte n followed by k zero bytes, so that eight bytes
+// can be folded in at once with eight independent table lookups.
+// Crc32cTables holds the same for the Castagnoli polynomial (CRC32C, as
+// used by btrfs and ext4). Both are filled in on first use.
+#ifndef CRC32C_ONLY
+static UINT32 Crc32Tables[8][256];
+static BOOLEAN Crc32TablesReady = FALSE;
+#endif
+static UINT32 Crc32cTables[8][256];
+static BOOLEAN Crc32cTablesReady = FALSE;
+
+// Reflected CRC32C polynomial (0x1edc6f41, bit-reversed)
+#define CRC32C_POLYNOMIAL 0x82f63b78
+
+// Fill in Tables[1] through Tables[7] from Tables[0]
+static VOID BuildSlicingTables(UINT32 Tables[8][256]) {
+   UINTN i, k;
 
-   p = buf;
-   crc = crc ^ ~0U;
+   for (i = 0; i < 256; i++) {
+      for (k = 1; k < 8; k++)
+         Tables[k][i] = (Tables[k - 1][i] >> 8) ^ Tables[0][Tables[k - 1][i] & 0xFF];
+   }
+} // static VOID BuildSlicingTables()
 
+// Update the (already inverted) crc with size bytes from p, eight at a time
+// once p is aligned. Assumes a little-endian CPU, as all EFI platforms are.
+static UINT32 SliceBy8(UINT32 Tables[8][256], UINT32 crc, const UINT8 *p, UINTN size) {
+   UINT32 Low, High;
+
+   while (size && ((UINTN) p & 7)) {
+      crc = Tables[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+      size--;
+   }
+   while (size >= 8) {
+      Low = *(const UINT32 *) p ^ crc;
+      High = *(const UINT32 *) (p + 4);
+      crc = Tables[7][Low & 0xFF] ^ Tables[6][(Low >> 8) & 0xFF] ^
+            Tables[5][(Low >> 16) & 0xFF] ^ Tables[4][Low >> 24] ^
+            Tables[3][High & 0xFF] ^ Tables[2][(High >> 8) & 0xFF] ^
+            Tables[1][(High >> 16) & 0xFF] ^ Tables[0][High >> 24];
+      p += 8;
+      size -= 8;
+   }
    while (size--)
-      crc = crc32_tab[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+      crc = Tables[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+   return crc;
+} // static UINT32 SliceBy8()
+
+#ifndef CRC32C_ONLY
+UINT32 crc32(UINT32 crc, const VOID *buf, UINTN size)
+{
+   UINTN i;
+
+   if (!Crc32TablesReady) {
+      for (i = 0; i < 256; i++)
+         Crc32Tables[0][i] = crc32_tab[i];
+      BuildSlicingTables(Crc32Tables);
+      Crc32TablesReady = TRUE;
+   }
 
-   return crc ^ ~0U;
+   return SliceBy8(Crc32Tables, crc ^ ~0U, buf, size) ^ ~0U;
 }
+#endif
+
+//
+// CRC32C, with the CPU's CRC32C instructions where it has them....
+//
+
+#if defined(__GNUC__) && defined(__x86_64__)
+
+// SSE4.2 (CPUID leaf 1, ECX bit 20) provides the crc32 instruction, which
+// works on general-purpose registers, so no SSE state is touched.
+static BOOLEAN HasCrc32cInstructions(VOID) {
+   UINT32 Eax, Ebx, Ecx, Edx;
+
+   __asm__ volatile ("cpuid" : "=a" (Eax), "=b" (Ebx), "=c" (Ecx), "=d" (Edx) : "a" (1), "c" (0));
+   return (Ecx & (1 << 20)) != 0;
+} // static BOOLEAN HasCrc32cInstructions()
+
+static UINT32 Crc32cInstructions(UINT32 crc, const UINT8 *p, UINTN size) {
+   UINT64 Crc64;
 
+   while (size && ((UINTN) p & 7)) {
+      __asm__ ("crc32b %1, %0" : "+r" (crc) : "rm" (*p));
+      p++;
+      size--;
+   }
+   Crc64 = crc;
+   while (size >= 8) {
+      __asm__ ("crc32q %1, %0" : "+r" (Crc64) : "rm" (*(const UINT64 *) p));
+      p += 8;
+      size -= 8;
+   }
+   crc = (UINT32) Crc64;
+   while (size--) {
+      __asm__ ("crc32b %1, %0" : "+r" (crc) : "rm" (*p));
+      p++;
+   }
+   return crc;
+} // static UINT32 Crc32cInstructions()
+
+#define HAVE_CRC32C_INSTRUCTIONS 1
+
+#elif defined(__GNUC__) && defined(__aarch64__)
+
+// ARMv8 CRC32 extension, as reported by ID_AA64ISAR0_EL1 bits 16-19
+static BOOLEAN HasCrc32cInstructions(VOID) {
+   UINT64 Isar0;
+
+   __asm__ volatile ("mrs %0, id_aa64isar0_el1" : "=r" (Isar0));
+   return ((Isar0 >> 16) & 0xF) != 0;
+} // static BOOLEAN HasCrc32cInstructions()
+
+static UINT32 Crc32cInstructions(UINT32 crc, const UINT8 *p, UINTN size) {
+   while (size && ((UINTN) p & 7)) {
+      __asm__ (".arch_extension crc\n\tcrc32cb %w0, %w0, %w1" : "+r" (crc) : "r" ((UINT32) *p));
+      p++;
+      size--;
+   }
+   while (size >= 8) {
+      __asm__ (".arch_extension crc\n\tcrc32cx %w0, %w0, %x1" : "+r" (crc) : "r" (*(const UINT64 *) p));
+      p += 8;
+      size -= 8;
+   }
+   while (size--) {
+      __asm__ (".arch_extension crc\n\tcrc32cb %w0, %w0, %w1" : "+r" (crc) : "r" ((UINT32) *p));
+      p++;
+   }
+   return crc;
+} // static UINT32 Crc32cInstructions()
+
+#define HAVE_CRC32C_INSTRUCTIONS 1
+
+#endif
+
+UINT32 crc32c(UINT32 crc, const VOID *buf, UINTN size)
+{
+   UINTN  i, j;
+   UINT32 c;
+#ifdef HAVE_CRC32C_INSTRUCTIONS
+   static INTN UseInstructions = -1;
+
+   if (UseInstructions < 0)
+      UseInstructions = HasCrc32cInstructions();
+   if (UseInstructions)
+      return Crc32cInstructions(crc ^ ~0U, buf, size) ^ ~0U;
+#endif
+
+   if (!Crc32cTablesReady) {
+      for (i = 0; i < 256; i++) {
+         c = (UINT32) i;
+         for (j = 0; j < 8; j++)
+            c = (c >> 1) ^ ((c & 1) ? CRC32C_POLYNOMIAL : 0);
+         Crc32cTables[0][i] = c;
+      }
+      BuildSlicingTables(Crc32cTables);
+      Crc32cTablesReady = TRUE;
+   }
+
+   return SliceBy8(Crc32cTables, crc ^ ~0U, buf, size) ^ ~0U;
+}
@@ -54,5 +54,6 @@
 #endif
 
 UINT32 crc32(UINT32 crc, const VOID *buf, UINTN size);
+UINT32 crc32c(UINT32 crc, const VOID *buf, UINTN size);
 
 #endif
\ No newline at end of file
@@ -70,6 +70,9 @@
  */
 
 #include "driver_support.h"
+#include "drivermanifest.h"
+#include "trace.h"
+#include "log.h"
 #include "lib.h"
 #include "mystrings.h"
 #include "screen.h"
@@ -534,6 +537,63 @@ VOID ConnectFilesystemDriver(EFI_HANDLE DriverHandle) {
     FreePool(Handles);
 } // VOID ConnectFilesystemDriver()
 
+// Connect each Block I/O controller (disk or partition) to whatever drivers
+// will bind to it, recursively, leaving all other controllers as they are.
+static VOID ConnectBlockIoControllers(VOID) {
+    EFI_STATUS  Status;
+    UINTN       HandleCount = 0, Index;
+    EFI_HANDLE  *Handles = NULL;
+
+    Status = refit_call5_wrapper(gBS->LocateHandleBuffer,
+                                 ByProtocol,
+                                 &gMyEfiBlockIoProtocolGuid,
+                                 NULL,
+                                 &HandleCount,
+                                 &Handles);
+    if (EFI_ERROR(Status) || HandleCount == 0)
+        return;
+
+    for (Index = 0; Index < HandleCount; Index++)
+        refit_call4_wrapper(gBS->ConnectController, Handles[Index], NULL, NULL, TRUE);
+    FreePool(Handles);
+} // static VOID ConnectBlockIoControllers()
+
+// Returns what the driver loaded as ImageHandle has bound to: one of the
+// DRIVER_BINDS_* values from drivermanifest.h. A driver whose binding
+// protocol isn't on its image handle counts as binding to other controllers.
+UINTN DriverBindings(IN EFI_HANDLE ImageHandle) {
+    EFI_STATUS              Status;
+    UINTN                   HandleCount, Index, Binds;
+    EFI_HANDLE              *HandleBuffer;
+    UINT32                  *HandleType, DriverIndex;
+    MY_EFI_BLOCK_IO_PROTOCOL *BlockIo;
+
+    Status = LibScanHandleDatabase(ImageHandle, &DriverIndex, NULL, NULL, &HandleCount, &HandleBuffer, &HandleType);
+    if (EFI_ERROR(Status))
+        return DRIVER_BINDS_OTHER;
+
+    if (DriverIndex >= HandleCount) {
+        Binds = DRIVER_BINDS_NOTHING;   // the driver has unloaded itself
+    } else if (!(HandleType[DriverIndex] & EFI_HANDLE_TYPE_DRIVER_BINDING_HANDLE)) {
+        Binds = DRIVER_BINDS_OTHER;
+    } else {
+        Binds = DRIVER_BINDS_NOTHING;
+        for (Index = 0; (Index < HandleCount) && (Binds != DRIVER_BINDS_OTHER); Index++) {
+            if (HandleType[Index] & EFI_HANDLE_TYPE_CONTROLLER_HANDLE) {
+                Status = refit_call3_wrapper(gBS->HandleProtocol,
+                                             HandleBuffer[Index],
+                                             &gMyEfiBlockIoProtocolGuid,
+                                             (VOID **) &BlockIo);
+                Binds = EFI_ERROR(Status) ? DRIVER_BINDS_OTHER : DRIVER_BINDS_BLOCK_IO;
+            } // if
+        } // for
+    } // if/else
+
+    MyFreePool(HandleBuffer);
+    MyFreePool(HandleType);
+    return Binds;
+} // UINTN DriverBindings()
+
 // Scan a directory for drivers.
 // Originally from rEFIt's main.c (BSD), but modified since then (GPLv3).
 static UINTN ScanDriverDir(IN CHAR16 *Path)
@@ -542,6 +602,7 @@ static UINTN ScanDriverDir(IN CHAR16 *Path)
     REFIT_DIR_ITER          DirIter;
     UINTN                   NumFound = 0;
     EFI_FILE_INFO           *DirEntry;
+    EFI_HANDLE              ImageHandle;
     CHAR16                  FileName[256];
 
     CleanUpPathNameSlashes(Path);
@@ -553,7 +614,14 @@ static UINTN ScanDriverDir(IN CHAR16 *Path)
 
         SPrint(FileName, 255, L"%s\\%s", Path, DirEntry->FileName);
         NumFound++;
-        Status = StartEFIImage(SelfVolume, FileName, L"", DirEntry->FileName, 0, FALSE, TRUE);
+        TraceBegin(L"LoadDriver");
+        Status = StartEFIImage(SelfVolume, FileName, L"", DirEntry->FileName, 0, FALSE, TRUE, &ImageHandle);
+        TraceEnd(L"LoadDriver");
+        DriverManifestAdd(FileName, DirEntry, EFI_ERROR(Status) ? NULL : ImageHandle);
+        if (EFI_ERROR(Status))
+            LOG_WARNING(L"Couldn't load driver %s: %r", FileName, Status);
+        else
+            LOG_INFO(L"Loaded and connected driver %s in %ld us", FileName, TraceDuration(L"LoadDriver"));
     } // while
     Status = DirIterClose(&DirIter);
     if ((Status != EFI_NOT_FOUND) && (Status != EFI_INVALID_PARAMETER)) {
@@ -573,6 +641,9 @@ BOOLEAN LoadDrivers(VOID) {
     CHAR16        *Directory, *SelfDirectory;
     UINTN         i = 0, Length, NumFound = 0;
 
+    TraceBegin(L"LoadDrivers");
+    DriverManifestLoad();
+
     // load drivers from the subdirectories of rEFInd's home directory specified
     // in the DRIVER_DIRS constant.
     while ((Directory = FindCommaDelimited(DRIVER_DIRS, i++)) != NULL) {
@@ -595,8 +666,24 @@ BOOLEAN LoadDrivers(VOID) {
         MyFreePool(Directory);
     } // while
 
-    // connect all devices
-    if (NumFound > 0)
-        ConnectAllDriversToAllControllers();
+    // connect all devices, or only disks and partitions if the driver manifest
+    // shows that that's all the drivers need
+    if (NumFound > 0) {
+        if (DriverManifestBlockIoOnly()) {
+            TraceBegin(L"ConnectBlockIo");
+            ConnectBlockIoControllers();
+            TraceEnd(L"ConnectBlockIo");
+            LOG_INFO(L"Loaded %d drivers; driver manifest shows Block I/O only, so connected disks and partitions in %ld us",
+                     NumFound, TraceDuration(L"ConnectBlockIo"));
+        } else {
+            TraceBegin(L"ConnectAll");
+            ConnectAllDriversToAllControllers();
+            TraceEnd(L"ConnectAll");
+            LOG_INFO(L"Loaded %d drivers; driver manifest missing or not Block I/O only, so connected all controllers in %ld us",
+                     NumFound, TraceDuration(L"ConnectAll"));
+            DriverManifestClassify();
+        }
+    } // if
+    TraceEnd(L"LoadDrivers");
     return (NumFound > 0);
 } /* BOOLEAN LoadDrivers() */
@@ -54,6 +54,7 @@ LibScanHandleDatabase (
   );
 EFI_STATUS ConnectAllDriversToAllControllers(VOID);
 VOID ConnectFilesystemDriver(EFI_HANDLE DriverHandle);
+UINTN DriverBindings(IN EFI_HANDLE ImageHandle);
 BOOLEAN LoadDrivers(VOID);
 
 #endif
@@ -0,0 +1,260 @@
+/*
+ * refind/drivermanifest.c
+ * Record of the drivers loaded and the controllers they bind to
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// After loading its drivers, rEFInd connects every driver to every
+// controller, which walks the whole handle database and gives each driver a
+// look at each PCI device, USB port, and so on. Most drivers loaded by
+// rEFInd are filesystem drivers, which need only the disks and partitions.
+// When the driver_manifest option is set, the drivers loaded, along with the
+// size and time stamp of each one's file and the kinds of controllers it
+// bound to after that full connection, are saved in the "vars"
+// subdirectory. On later boots, if every driver loaded matches its entry in
+// that manifest and bound only to Block I/O controllers (or to nothing),
+// LoadDrivers() connects just the Block I/O controllers. Any new, changed,
+// or other driver brings back the full connection, after which the manifest
+// is brought up to date.
+//
+// Drivers are loaded before the configuration file is read, so on any given
+// boot it's the manifest file's presence that enables this; the option's
+// setting is applied afterwards, by DriverManifestSave(), which writes or
+// deletes the file for the next boot.
+
+#include "drivermanifest.h"
+#include "driver_support.h"
+#include "lib.h"
+#include "mystrings.h"
+#include "../include/refit_call_wrapper.h"
+
+#define DRIVER_MANIFEST_MAGIC      "rEFIdrv1"
+#define DRIVER_MANIFEST_MAGIC_SIZE 8
+
+#pragma pack(1)
+typedef struct {
+   CHAR8     Magic[DRIVER_MANIFEST_MAGIC_SIZE];
+   UINT32    EntryCount;
+   UINT32    Reserved;
+} DRIVER_MANIFEST_HEADER;
+
+// On disk, each record is followed by NameLength CHAR16s (no terminating NUL)
+typedef struct {
+   UINT64    FileSize;
+   EFI_TIME  FileTime;
+   UINT8     Binds;
+   UINT8     Reserved;
+   UINT16    NameLength;
+} DRIVER_MANIFEST_RECORD;
+#pragma pack(0)
+
+typedef struct {
+   DRIVER_MANIFEST_RECORD  Record;
+   CHAR16                  *FileName;
+   EFI_HANDLE              ImageHandle;  // for drivers loaded this time; NULL if it failed
+   BOOLEAN                 Known;        // matches an entry in the manifest file
+} DRIVER_MANIFEST_ENTRY;
+
+// Entries read from the manifest file....
+static DRIVER_MANIFEST_ENTRY  **ManifestEntries = NULL;
+static UINTN                  ManifestEntryCount = 0;
+static BOOLEAN                ManifestFound = FALSE;
+// ... and for the drivers loaded this time
+static DRIVER_MANIFEST_ENTRY  **LoadedDrivers = NULL;
+static UINTN                  LoadedDriverCount = 0;
+static BOOLEAN                AllRecorded = TRUE;
+static BOOLEAN                ManifestChanged = FALSE;
+
+static VOID FreeEntries(IN OUT DRIVER_MANIFEST_ENTRY ***Entries, IN OUT UINTN *Count) {
+   UINTN i;
+
+   for (i = 0; i < *Count; i++) {
+      MyFreePool((*Entries)[i]->FileName);
+      MyFreePool((*Entries)[i]);
+   }
+   MyFreePool(*Entries);
+   *Entries = NULL;
+   *Count = 0;
+} // static VOID FreeEntries()
+
+// Read the manifest file, if there is one.
+VOID DriverManifestLoad(VOID) {
+   EFI_STATUS              Status;
+   EFI_FILE                *VarsDir = NULL;
+   UINT8                   *Data = NULL, *Pos;
+   UINTN                   DataLength = 0, i;
+   DRIVER_MANIFEST_HEADER  *Header;
+   DRIVER_MANIFEST_ENTRY   *Entry;
+
+   Status = refit_call5_wrapper(SelfDir->Open, SelfDir, &VarsDir, L"vars", EFI_FILE_MODE_READ, EFI_FILE_DIRECTORY);
+   if (EFI_ERROR(Status))
+      return;
+   Status = egLoadFile(VarsDir, DRIVER_MANIFEST_FILENAME, &Data, &DataLength);
+   refit_call1_wrapper(VarsDir->Close, VarsDir);
+   if (EFI_ERROR(Status))
+      return;
+   ManifestFound = TRUE;
+
+   Header = (DRIVER_MANIFEST_HEADER *) Data;
+   if ((DataLength >= sizeof(DRIVER_MANIFEST_HEADER)) &&
+       (CompareMem(Header->Magic, DRIVER_MANIFEST_MAGIC, DRIVER_MANIFEST_MAGIC_SIZE) == 0)) {
+      Pos = Data + sizeof(DRIVER_MANIFEST_HEADER);
+      for (i = 0; i < Header->EntryCount; i++) {
+         if ((Pos + sizeof(DRIVER_MANIFEST_RECORD) > Data + DataLength) ||
+             (Pos + sizeof(DRIVER_MANIFEST_RECORD) + ((DRIVER_MANIFEST_RECORD *) Pos)->NameLength * sizeof(CHAR16) >
+              Data + DataLength))
+            break; // truncated file; any drivers missing from it get a full connection
+         Entry = AllocateZeroPool(sizeof(DRIVER_MANIFEST_ENTRY));
+         if (Entry == NULL)
+            break;
+         CopyMem(&(Entry->Record), Pos, sizeof(DRIVER_MANIFEST_RECORD));
+         Pos += sizeof(DRIVER_MANIFEST_RECORD);
+         Entry->FileName = AllocateZeroPool((Entry->Record.NameLength + 1) * sizeof(CHAR16));
+         if (Entry->FileName == NULL) {
+            MyFreePool(Entry);
+            break;
+         }
+         CopyMem(Entry->FileName, Pos, Entry->Record.NameLength * sizeof(CHAR16));
+         Pos += Entry->Record.NameLength * sizeof(CHAR16);
+         AddListElement((VOID ***) &ManifestEntries, &ManifestEntryCount, Entry);
+      } // for
+   } // if
+   MyFreePool(Data);
+} // VOID DriverManifestLoad()
+
+// Note that the driver in FileName (described by FileInfo, its directory
+// entry) has been loaded as ImageHandle, or has failed to load if ImageHandle
+// is NULL, and look it up in the manifest.
+VOID DriverManifestAdd(IN CHAR16 *FileName, IN EFI_FILE_INFO *FileInfo, IN EFI_HANDLE ImageHandle) {
+   DRIVER_MANIFEST_ENTRY  *Entry, *Old;
+   UINTN                  i;
+
+   if ((FileName == NULL) || (FileInfo == NULL))
+      return;
+
+   Entry = AllocateZeroPool(sizeof(DRIVER_MANIFEST_ENTRY));
+   if (Entry == NULL) {
+      AllRecorded = FALSE;
+      return;
+   }
+   Entry->FileName = StrDuplicate(FileName);
+   Entry->ImageHandle = ImageHandle;
+   Entry->Record.FileSize = FileInfo->FileSize;
+   // The padding is cleared so that times can be compared with CompareMem().
+   CopyMem(&(Entry->Record.FileTime), &(FileInfo->ModificationTime), sizeof(EFI_TIME));
+   Entry->Record.FileTime.Pad1 = Entry->Record.FileTime.Pad2 = 0;
+   Entry->Record.NameLength = (UINT16) StrLen(FileName);
+   Entry->Record.Binds = DRIVER_BINDS_OTHER;
+
+   for (i = 0; i < ManifestEntryCount; i++) {
+      Old = ManifestEntries[i];
+      if (MyStriCmp(Old->FileName, FileName) && (Old->Record.FileSize == Entry->Record.FileSize) &&
+          (CompareMem(&(Old->Record.FileTime), &(Entry->Record.FileTime), sizeof(EFI_TIME)) == 0)) {
+         Entry->Record.Binds = (Old->Record.Binds <= DRIVER_BINDS_OTHER) ? Old->Record.Binds : DRIVER_BINDS_OTHER;
+         Entry->Known = TRUE;
+         break;
+      }
+   } // for
+   if (!Entry->Known)
+      ManifestChanged = TRUE;
+   AddListElement((VOID ***) &LoadedDrivers, &LoadedDriverCount, Entry);
+} // VOID DriverManifestAdd()
+
+// Returns TRUE if the manifest covers every driver loaded and shows that
+// none of them needs more than the Block I/O controllers connected.
+BOOLEAN DriverManifestBlockIoOnly(VOID) {
+   UINTN i;
+
+   if (!ManifestFound || !AllRecorded)
+      return FALSE;
+   for (i = 0; i < LoadedDriverCount; i++) {
+      if (!LoadedDrivers[i]->Known || (LoadedDrivers[i]->Record.Binds == DRIVER_BINDS_OTHER))
+         return FALSE;
+   }
+   return TRUE;
+} // BOOLEAN DriverManifestBlockIoOnly()
+
+// Record what each driver loaded has bound to. Call this only after every
+// controller has been connected.
+VOID DriverManifestClassify(VOID) {
+   UINTN i, Binds;
+
+   for (i = 0; i < LoadedDriverCount; i++) {
+      Binds = (LoadedDrivers[i]->ImageHandle == NULL) ? DRIVER_BINDS_NOTHING :
+                                                        DriverBindings(LoadedDrivers[i]->ImageHandle);
+      if (Binds != LoadedDrivers[i]->Record.Binds) {
+         LoadedDrivers[i]->Record.Binds = (UINT8) Binds;
+         ManifestChanged = TRUE;
+      }
+   } // for
+} // VOID DriverManifestClassify()
+
+// Once the configuration file has been read, write the manifest file (if it's
+// changed) or, if the driver_manifest option isn't set, delete it; then free
+// the manifest.
+VOID DriverManifestSave(VOID) {
+   EFI_STATUS              Status;
+   EFI_FILE                *VarsDir = NULL, *ManifestFile = NULL;
+   UINT8                   *Data, *Pos;
+   UINTN                   DataLength, i;
+   DRIVER_MANIFEST_HEADER  *Header;
+
+   if (!GlobalConfig.DriverManifest) {
+      if (ManifestFound) {
+         Status = refit_call5_wrapper(SelfDir->Open, SelfDir, &VarsDir, L"vars",
+                                      EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, EFI_FILE_DIRECTORY);
+         if (!EFI_ERROR(Status)) {
+            Status = refit_call5_wrapper(VarsDir->Open, VarsDir, &ManifestFile, DRIVER_MANIFEST_FILENAME,
+                                         EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE, 0);
+            if (!EFI_ERROR(Status))
+               refit_call1_wrapper(ManifestFile->Delete, ManifestFile);
+            refit_call1_wrapper(VarsDir->Close, VarsDir);
+         }
+      } // if
+   } else if (ManifestChanged || (LoadedDriverCount != ManifestEntryCount)) {
+      DataLength = sizeof(DRIVER_MANIFEST_HEADER);
+      for (i = 0; i < LoadedDriverCount; i++)
+         DataLength += sizeof(DRIVER_MANIFEST_RECORD) + LoadedDrivers[i]->Record.NameLength * sizeof(CHAR16);
+      Data = AllocateZeroPool(DataLength);
+      if (Data != NULL) {
+         Header = (DRIVER_MANIFEST_HEADER *) Data;
+         CopyMem(Header->Magic, DRIVER_MANIFEST_MAGIC, DRIVER_MANIFEST_MAGIC_SIZE);
+         Header->EntryCount = (UINT32) LoadedDriverCount;
+         Pos = Data + sizeof(DRIVER_MANIFEST_HEADER);
+         for (i = 0; i < LoadedDriverCount; i++) {
+            CopyMem(Pos, &(LoadedDrivers[i]->Record), sizeof(DRIVER_MANIFEST_RECORD));
+            Pos += sizeof(DRIVER_MANIFEST_RECORD);
+            CopyMem(Pos, LoadedDrivers[i]->FileName, LoadedDrivers[i]->Record.NameLength * sizeof(CHAR16));
+            Pos += LoadedDrivers[i]->Record.NameLength * sizeof(CHAR16);
+         } // for
+
+         Status = refit_call5_wrapper(SelfDir->Open, SelfDir, &VarsDir, L"vars",
+                                      EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, EFI_FILE_DIRECTORY);
+         if (!EFI_ERROR(Status)) {
+            egSaveFile(VarsDir, DRIVER_MANIFEST_FILENAME, Data, DataLength);
+            refit_call1_wrapper(VarsDir->Close, VarsDir);
+         }
+         MyFreePool(Data);
+      } // if
+   } // if/else
+
+   FreeEntries(&ManifestEntries, &ManifestEntryCount);
+   FreeEntries(&LoadedDrivers, &LoadedDriverCount);
+   ManifestFound = ManifestChanged = FALSE;
+   AllRecorded = TRUE;
+} // VOID DriverManifestSave()
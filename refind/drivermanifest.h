@@ -0,0 +1,50 @@
+/*
+ * refind/drivermanifest.h
+ * Record of the drivers loaded and the controllers they bind to
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __DRIVERMANIFEST_H_
+#define __DRIVERMANIFEST_H_
+
+#ifdef __MAKEWITH_GNUEFI
+#include "efi.h"
+#include "efilib.h"
+#else
+#include "../include/tiano_includes.h"
+#endif
+#include "global.h"
+
+// What a driver bound to when it was last connected....
+// Nothing at all (as with a filesystem driver when no volume uses its filesystem)
+#define DRIVER_BINDS_NOTHING        0
+// Only controllers with Block I/O (disks and partitions)
+#define DRIVER_BINDS_BLOCK_IO       1
+// Other controllers, or it couldn't be told; needs every controller connected
+#define DRIVER_BINDS_OTHER          2
+
+// Name of the manifest file in rEFInd's "vars" subdirectory
+#define DRIVER_MANIFEST_FILENAME    L"DriverManifest"
+
+VOID DriverManifestLoad(VOID);
+VOID DriverManifestAdd(IN CHAR16 *FileName, IN EFI_FILE_INFO *FileInfo, IN EFI_HANDLE ImageHandle);
+BOOLEAN DriverManifestBlockIoOnly(VOID);
+VOID DriverManifestClassify(VOID);
+VOID DriverManifestSave(VOID);
+
+#endif
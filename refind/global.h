@@ -262,6 +262,8 @@ typedef struct {
    BOOLEAN             IsMbrPartition;
    UINTN               MbrPartitionIndex;
    EFI_BLOCK_IO        *BlockIO;
+   UINT32              MediaId;      // BlockIO->Media->MediaId when scanned
+   EFI_LBA             LastBlock;    // BlockIO->Media->LastBlock when scanned
    UINT64              BlockIOOffset;
    EFI_BLOCK_IO        *WholeDiskBlockIO;
    EFI_DEVICE_PATH     *WholeDiskDevicePath;
@@ -336,6 +338,12 @@ typedef struct {
    BOOLEAN          HiddenTags;
    BOOLEAN          UseNvram;
    BOOLEAN          ShutdownAfterTimeout;
+   BOOLEAN          ShadowFramebuffer;
+   BOOLEAN          ScanCache;
+   BOOLEAN          PreloadLoaders;
+   BOOLEAN          DriverManifest;
+   BOOLEAN          BootTrace;
+   BOOLEAN          ProgressiveMenu;
    UINTN            RequestedScreenWidth;
    UINTN            RequestedScreenHeight;
    UINTN            BannerBottomEdge;
@@ -348,6 +356,7 @@ typedef struct {
    UINTN            ScanDelay;
    UINTN            ScreensaverTime;
    UINTN            MouseSpeed;
+   UINTN            LogLevel;    // most detailed LOG_LEVEL_* written to the log file; 0 for none
    UINTN            IconSizes[5];
    UINTN            BannerScale;
    REFIT_VOLUME     *DiscoveredRoot;
@@ -399,7 +408,8 @@ EFI_STATUS StartEFIImage(IN REFIT_VOLUME *Volume,
                          IN CHAR16 *ImageTitle,
                          IN CHAR8 OSType,
                          IN BOOLEAN Verbose,
-                         IN BOOLEAN IsDriver);
+                         IN BOOLEAN IsDriver,
+                         OUT EFI_HANDLE *NewImageHandle OPTIONAL);
 LOADER_ENTRY *InitializeLoaderEntry(IN LOADER_ENTRY *Entry);
 REFIT_MENU_SCREEN *InitializeSubScreen(IN LOADER_ENTRY *Entry);
 VOID GenerateSubScreen(LOADER_ENTRY *Entry, IN REFIT_VOLUME *Volume, IN BOOLEAN GenerateReturn);
@@ -25,62 +25,8 @@
 #include "../include/refit_call_wrapper.h"
 #include "mystrings.h"
 #include "sha256.h"
-
-//for logHack
-#define GetTime ST->RuntimeServices->GetTime
-
-//FIXME hack
-static EFI_FILE_HANDLE logHandle;
-static BOOLEAN logOpened = FALSE;
-static CHAR16 *logFileName = L"log.txt";
-
-static void SPrintTime(CHAR16 *buf, UINTN maxSize)
-{
-  EFI_TIME time;
-
-  refit_call2_wrapper(GetTime, &time, NULL);
-
-  SPrint(buf, maxSize, L"%04d-%02d-%02d %02d:%02d:%02d.%09d ",
-	 time.Year,
-	 time.Month,
-	 time.Day,
-	 time.Hour,
-	 time.Minute,
-	 time.Second,
-	 time.Nanosecond);
-}
-
-static void logHack(CHAR16 *fmt, ...) {
-  va_list          args;
-  UINTN            len;
-  CHAR16          Message[256];
-  CHAR16          Time[256];
-  EFI_STATUS      Status;
-  
-  if(!logOpened) {
-    Status = refit_call5_wrapper(SelfVolume->RootDir->Open, SelfVolume->RootDir, &logHandle, logFileName,
-				 EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0);
-    if(CheckError(Status, Message)) {
-      return;
-    }
-    logOpened = TRUE;
-  }
-
-  va_start (args, fmt);
-  len = VSPrint(Message, 255, fmt, args);
-  va_end (args);
-
-  SPrintTime(Time,255);
-
-  UINTN size;
-  size = StrLen(Time) * sizeof(CHAR16);
-  refit_call3_wrapper(SelfVolume->RootDir->Write, logHandle, &size, (BYTE *)Time);
-  
-  size = len * sizeof(CHAR16);
-  refit_call3_wrapper(SelfVolume->RootDir->Write, logHandle, &size, (BYTE *)Message);
-  
-  refit_call1_wrapper(SelfVolume->RootDir->Flush, logHandle);
-}
+#include "trace.h"
+#include "log.h"
 
 /*
   Reads a file and calls Func for each chunk of data.
@@ -99,7 +45,7 @@ EFI_STATUS ReadFileInChunks(IN EFI_FILE_HANDLE BaseDir, IN CHAR16 *FilePath, UIN
 
     BYTE *Buf;
 
-    logHack(L"ReadFileInChunks Start\n");
+    LOG_DEBUG(L"ReadFileInChunks Start");
 
     Buf = AllocatePool(BufferSize);
     if (Buf == NULL) {
@@ -141,7 +87,7 @@ EFI_STATUS ReadFileInChunks(IN EFI_FILE_HANDLE BaseDir, IN CHAR16 *FilePath, UIN
 
     MyFreePool(Buf);
 
-    logHack(L"ReadFileInChunks End\n");
+    LOG_DEBUG(L"ReadFileInChunks End");
     return EFI_SUCCESS;
 }
 
@@ -167,9 +113,9 @@ VOID HashDataFunc(void *vctx, BYTE *buf, UINTN size)
 {
   SHA256_CTX *ctx = (SHA256_CTX *)vctx;
 		     
-  logHack(L"HashDataFunc Start\n");
+  LOG_DEBUG(L"HashDataFunc Start");
   Sha256Update(ctx, buf, size);
-  logHack(L"HashDataFunc End\n");
+  LOG_DEBUG(L"HashDataFunc End");
 }
 
 
@@ -199,17 +145,22 @@ VOID HashFile(SHA256_CTX *ctx, REFIT_VOLUME *DeviceVolume, CHAR16 *filePath)
   ReadFileInChunks(DeviceVolume->RootDir, filePath, CHUNK_SIZE, ctx, HashDataFunc);
 }
 
-#define FixUpRoot(x) (x[0] == '\0' ? L"\\" : x)
+// A loader in the root directory has a NULL path
+#define FixUpRoot(x) (((x) == NULL || (x)[0] == '\0') ? L"\\" : (x))
   
 static VOID HashDirRecursive(UINTN recursiveCount, SHA256_CTX *ctx, REFIT_VOLUME *Volume, CHAR16 *dirPath)
 {
   REFIT_DIR_ITER          DirIter;
   EFI_FILE_INFO           *DirEntry;
+  MEM_ARENA_MARK          mark, fileMark;
   
   CHAR16 **Dirs = NULL;
   UINTN DirsCount = 0;
 
-  logHack(L"%02d, HashDirRecursive for %s\n",recursiveCount, dirPath);
+  LOG_DEBUG(L"%02d, HashDirRecursive for %s",recursiveCount, dirPath);
+
+  //the directory names and paths are only needed until we return, so they come from the arena
+  mark = ArenaMark(&ScanArena);
 
   DirIterOpen(Volume->RootDir, FixUpRoot(dirPath), &DirIter);
   while (DirIterNext(&DirIter, 0, NULL, &DirEntry)) {
@@ -217,30 +168,32 @@ static VOID HashDirRecursive(UINTN recursiveCount, SHA256_CTX *ctx, REFIT_VOLUME
       continue;   // skip "." and ".." (not sure if these will be
     		  // returned, but just to be safe)
 
-    logHack(L"%02d, DirEntry %s, dirsCount %d, attr %d, isDir? %d\n",recursiveCount, DirEntry->FileName,DirsCount, DirEntry->Attribute,
+    LOG_DEBUG(L"%02d, DirEntry %s, dirsCount %d, attr %d, isDir? %d",recursiveCount, DirEntry->FileName,DirsCount, DirEntry->Attribute,
 	    DirEntry->Attribute & EFI_FILE_DIRECTORY);
 
     if (DirEntry->Attribute & EFI_FILE_DIRECTORY) {
-      AddListElement((VOID ***)&Dirs,&DirsCount, (VOID *)StrDuplicate(DirEntry->FileName));
+      AddListElement((VOID ***)&Dirs,&DirsCount, (VOID *)ArenaStrDuplicate(&ScanArena, DirEntry->FileName));
     }
     else {
-      CHAR16 *FilePath = StrDuplicate(dirPath);
-      MergeStrings(&FilePath, DirEntry->FileName,'\\');
+      fileMark = ArenaMark(&ScanArena);
+      CHAR16 *FilePath = ArenaMergeStrings(&ScanArena, dirPath, DirEntry->FileName,'\\');
       HashFile(ctx, Volume, FilePath);
-      MyFreePool(FilePath);
+      ArenaRelease(&ScanArena, fileMark);
     }
   }
   DirIterClose(&DirIter);
 
   for(int i = 0; i< DirsCount; i++) {
-    CHAR16 *result = StrDuplicate(dirPath);
-    MergeStrings(&result, Dirs[i],'\\');
-    logHack(L"%02d, RecursiveCall dirPath %s, Dirs[%d] %s, result %s\n",recursiveCount,dirPath, i, Dirs[i], result);
+    fileMark = ArenaMark(&ScanArena);
+    CHAR16 *result = ArenaMergeStrings(&ScanArena, dirPath, Dirs[i],'\\');
+    LOG_DEBUG(L"%02d, RecursiveCall dirPath %s, Dirs[%d] %s, result %s",recursiveCount,dirPath, i, Dirs[i], result);
     HashDirRecursive(recursiveCount+1, ctx, Volume, result);
-    MyFreePool(result);
+    ArenaRelease(&ScanArena, fileMark);
   }
 
-  FreeList((VOID ***)&Dirs,&DirsCount);
+  //the names themselves are in the arena, so only the list is freed
+  MyFreePool(Dirs);
+  ArenaRelease(&ScanArena, mark);
 }
 
 static VOID HashHashPath(SHA256_CTX *ctx, REFIT_VOLUME *Volume, CHAR16 *hashPathC)
@@ -264,6 +217,7 @@ static VOID HashHashPath(SHA256_CTX *ctx, REFIT_VOLUME *Volume, CHAR16 *hashPath
 
   REFIT_DIR_ITER          DirIter;
   EFI_FILE_INFO           *DirEntry;
+  MEM_ARENA_MARK          mark = ArenaMark(&ScanArena), fileMark;
 
   CHAR16 **Dirs = NULL;
   UINTN DirsCount = 0;
@@ -281,32 +235,35 @@ static VOID HashHashPath(SHA256_CTX *ctx, REFIT_VOLUME *Volume, CHAR16 *hashPath
 		    // returned, but just to be safe)
     }
     
+    //DirEntry is freed by the next DirIterNext(), so keep a copy of the name
     if (DirEntry->Attribute & EFI_FILE_DIRECTORY)
-      AddListElement((VOID ***)&Dirs,&DirsCount, (VOID *)DirEntry->FileName);
+      AddListElement((VOID ***)&Dirs,&DirsCount, (VOID *)ArenaStrDuplicate(&ScanArena, DirEntry->FileName));
     else {
-      CHAR16 *FilePath = StrDuplicate(hashPath);
-      MergeStrings(&FilePath, DirEntry->FileName,'\\');
+      fileMark = ArenaMark(&ScanArena);
+      CHAR16 *FilePath = ArenaMergeStrings(&ScanArena, hashPath, DirEntry->FileName,'\\');
       HashFile(ctx, Volume, FilePath);
-      MyFreePool(FilePath);
+      ArenaRelease(&ScanArena, fileMark);
     }
   }
 
   DirIterClose(&DirIter);
 
   for(int i = 0; i < DirsCount; i++) {
-    CHAR16 *DirPath = StrDuplicate(hashPath);
-    MergeStrings(&DirPath, Dirs[i],'\\');
+    fileMark = ArenaMark(&ScanArena);
+    CHAR16 *DirPath = ArenaMergeStrings(&ScanArena, hashPath, Dirs[i],'\\');
     HashDirRecursive(0, ctx, Volume, DirPath);
-    MyFreePool(DirPath);
+    ArenaRelease(&ScanArena, fileMark);
   }
 
-  FreeList((VOID ***)&Dirs,&DirsCount);
+  MyFreePool(Dirs);
+  ArenaRelease(&ScanArena, mark);
   MyFreePool(hashPath);
 }
 		    
 VOID GenerateHash(LOADER_ENTRY *Entry)
 {
   SHA256_CTX ctx;
+  TraceBegin(L"GenerateHash");
   Sha256Init(&ctx);
 
   HashCHAR16NTA(&ctx,Entry->LoaderPath);
@@ -335,7 +292,7 @@ VOID GenerateHash(LOADER_ENTRY *Entry)
     if(Volume == NULL)
       ; // TODO error reporting
     else {
-      logHack(L"GenerateHash calling HashDirRecursive Volume %s, Path %s Filename %s\n",VolName, Path, Filename);
+      LOG_DEBUG(L"GenerateHash calling HashDirRecursive Volume %s, Path %s Filename %s",VolName, Path, Filename);
       
       HashDirRecursive(0,&ctx, Volume, Path);
     }
@@ -345,6 +302,8 @@ VOID GenerateHash(LOADER_ENTRY *Entry)
     MyFreePool(Filename);
   }
 
+  TraceEnd(L"GenerateHash");
+
   //TODO Add in error reporting
   MyFreePool(Entry->Hash);
   Entry->Hash = AllocatePool(32 * sizeof(unsigned char));
@@ -353,5 +312,5 @@ VOID GenerateHash(LOADER_ENTRY *Entry)
   if(Entry->Hash == NULL) return;
   Sha256Final(&ctx, Entry->Hash);
   
-  logHack(L"End GenerateHash\n");
+  LOG_DEBUG(L"End GenerateHash");
 }
@@ -39,6 +39,7 @@
 #include "icns.h"
 #include "config.h"
 #include "mystrings.h"
+#include "trace.h"
 #include "../refind/screen.h"
 
 //
@@ -105,6 +106,7 @@ EG_IMAGE * LoadOSIcon(IN CHAR16 *OSIconName OPTIONAL, IN CHAR16 *FallbackIconNam
 
     if (GlobalConfig.TextOnly)      // skip loading if it's not used anyway
         return NULL;
+    TraceBegin(L"LoadOSIcon");
 
     // First, try to find an icon from the OSIconName list....
     while (((CutoutName = FindCommaDelimited(OSIconName, Index++)) != NULL) && (Image == NULL)) {
@@ -128,6 +130,7 @@ EG_IMAGE * LoadOSIcon(IN CHAR16 *OSIconName OPTIONAL, IN CHAR16 *FallbackIconNam
     if (Image == NULL)
        Image = DummyImage(GlobalConfig.IconSizes[ICON_SIZE_BIG]);
 
+    TraceEnd(L"LoadOSIcon");
     return Image;
 } /* EG_IMAGE * LoadOSIcon() */
 
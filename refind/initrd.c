@@ -0,0 +1,283 @@
+/*
+ * refind/initrd.c
+ * Pre-loading of Linux initial RAM disks
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// A Linux kernel's EFI stub loader reads the files named by "initrd="
+// options itself, through the firmware's file protocol, after rEFInd has
+// launched it. Since version 5.8, though, the kernel first looks for a
+// LoadFile2 protocol on the LINUX_EFI_INITRD_MEDIA_GUID vendor device path,
+// and if it finds one it takes its initrd from there and ignores the
+// "initrd=" options. When preload_loaders is set, rEFInd reads the initrd
+// files (concatenated, in the order given, as the kernel itself would) with
+// a few large reads and publishes them this way. The "initrd=" options are
+// left in place, so older kernels still read the files themselves.
+
+#include "initrd.h"
+#include "prefetch.h"
+#include "lib.h"
+#include "mystrings.h"
+#include "../include/refit_call_wrapper.h"
+
+#ifndef __MAKEWITH_GNUEFI
+#define DevicePathProtocol gEfiDevicePathProtocolGuid
+#endif
+
+// Largest total size of the initrd files read for one launch
+#define INITRD_MAX_SIZE (1024 * 1024 * 1024)
+
+static EFI_GUID LoadFile2Guid = { 0x4006c0c1, 0xfcb3, 0x403e, { 0x99, 0x6d, 0x4a, 0x6c, 0x87, 0x24, 0xe0, 0x6d } };
+
+typedef struct _INITRD_LOAD_FILE2 INITRD_LOAD_FILE2;
+
+typedef EFI_STATUS (EFIAPI *INITRD_LOAD_FILE) (
+   IN INITRD_LOAD_FILE2  *This,
+   IN EFI_DEVICE_PATH    *FilePath,
+   IN BOOLEAN            BootPolicy,
+   IN OUT UINTN          *BufferSize,
+   IN VOID               *Buffer OPTIONAL
+);
+
+// Same layout as EFI_LOAD_FILE2_PROTOCOL, which not every GNU-EFI defines
+struct _INITRD_LOAD_FILE2 {
+   INITRD_LOAD_FILE  LoadFile;
+};
+
+#pragma pack(1)
+typedef struct {
+   VENDOR_DEVICE_PATH  Vendor;
+   EFI_DEVICE_PATH     End;
+} INITRD_DEVICE_PATH;
+#pragma pack()
+
+static INITRD_DEVICE_PATH InitrdDevicePath = {
+   { { MEDIA_DEVICE_PATH, MEDIA_VENDOR_DP, { sizeof(VENDOR_DEVICE_PATH), 0 } }, LINUX_EFI_INITRD_MEDIA_GUID },
+   { END_DEVICE_PATH_TYPE, END_ENTIRE_DEVICE_PATH_SUBTYPE, { END_DEVICE_PATH_LENGTH, 0 } }
+};
+
+// The initrd data read for one set of load options
+typedef struct {
+   REFIT_VOLUME  *Volume;
+   CHAR16        *LoadOptions;  // the options the data was read for
+   EFI_STATUS    Status;        // the result of reading it
+   UINT8         *Data;
+   UINTN         Size;
+   EFI_HANDLE    Handle;        // non-NULL while the data is published
+} PRELOADED_INITRD;
+
+static PRELOADED_INITRD Initrd;
+
+// Returns a copy of the filename given by the next "initrd=" option in
+// *Options, with any forward slashes turned into backslashes, and moves
+// *Options past it; or returns NULL if there are no more such options.
+CHAR16 *NextInitrdName(IN OUT CHAR16 **Options) {
+   CHAR16  *Start = *Options, *End, *Name = NULL;
+   UINTN   Length, i;
+
+   while ((Name == NULL) && (*Start != L'\0')) {
+      while (*Start == L' ')
+         Start++;
+      for (End = Start; (*End != L'\0') && (*End != L' '); End++)
+         ;
+      Length = End - Start;
+      if ((Length > 7) && (CompareMem(Start, L"initrd=", 7 * sizeof(CHAR16)) == 0)) {
+         Length -= 7;
+         Name = AllocatePool((Length + 1) * sizeof(CHAR16));
+         if (Name == NULL)
+            break;
+         for (i = 0; i < Length; i++)
+            Name[i] = (Start[7 + i] == L'/') ? L'\\' : Start[7 + i];
+         Name[Length] = L'\0';
+      } // if
+      Start = End;
+   } // while
+   *Options = Start;
+   return Name;
+} // CHAR16 *NextInitrdName()
+
+// Opens, in order, each initrd file on Volume named by an "initrd=" option
+// in LoadOptions. If Buffer is NULL, sets *Size to their total size;
+// otherwise reads them (or takes them from the files read ahead) into Buffer
+// one after another, failing unless they fill exactly *Size bytes.
+static EFI_STATUS ReadInitrds(IN REFIT_VOLUME *Volume, IN CHAR16 *LoadOptions,
+                              OUT UINT8 *Buffer OPTIONAL, IN OUT UINT64 *Size) {
+   EFI_STATUS       Status = EFI_SUCCESS;
+   EFI_FILE_HANDLE  FileHandle;
+   EFI_FILE_INFO    *FileInfo;
+   CHAR16           *Name;
+   UINT8            *Data;
+   UINTN            DataSize;
+   UINT64           Limit, Done = 0, FileSize;
+
+   Limit = (Buffer == NULL) ? INITRD_MAX_SIZE : *Size;
+   while (!EFI_ERROR(Status) && ((Name = NextInitrdName(&LoadOptions)) != NULL)) {
+      if ((Buffer != NULL) && PrefetchTake(Volume, Name, &Data, &DataSize)) {
+         FreePool(Name);
+         if (DataSize > Limit - Done) {
+            Status = EFI_BAD_BUFFER_SIZE;
+         } else {
+            CopyMem(Buffer + Done, Data, DataSize);
+            Done += DataSize;
+         }
+         FreePool(Data);
+         continue;
+      } // if
+      Status = refit_call5_wrapper(Volume->RootDir->Open, Volume->RootDir, &FileHandle, Name, EFI_FILE_MODE_READ, 0);
+      FreePool(Name);
+      if (EFI_ERROR(Status))
+         break;
+
+      FileInfo = LibFileInfo(FileHandle);
+      if (FileInfo == NULL) {
+         Status = EFI_NOT_FOUND;
+      } else {
+         FileSize = FileInfo->FileSize;
+         FreePool(FileInfo);
+         if (FileSize > Limit - Done)
+            Status = EFI_BAD_BUFFER_SIZE;
+         else if (Buffer != NULL)
+            Status = ReadFileFully(FileHandle, Buffer + Done, (UINTN) FileSize);
+         Done += FileSize;
+      } // if/else
+      refit_call1_wrapper(FileHandle->Close, FileHandle);
+   } // while
+
+   if (!EFI_ERROR(Status)) {
+      if (Done == 0)
+         Status = EFI_NOT_FOUND;
+      else if (Buffer == NULL)
+         *Size = Done;
+      else if (Done != *Size)
+         Status = EFI_LOAD_ERROR;
+   } // if
+   return Status;
+} // static EFI_STATUS ReadInitrds()
+
+// The LoadFile2 protocol's LoadFile() function, as called by the kernel:
+// once with no buffer, to learn the size, and again to fetch the data.
+static EFI_STATUS EFIAPI InitrdLoadFile(IN INITRD_LOAD_FILE2 *This, IN EFI_DEVICE_PATH *FilePath,
+                                        IN BOOLEAN BootPolicy, IN OUT UINTN *BufferSize,
+                                        IN VOID *Buffer OPTIONAL) {
+   if (BufferSize == NULL)
+      return EFI_INVALID_PARAMETER;
+   if (BootPolicy)
+      return EFI_UNSUPPORTED;
+   if (Initrd.Data == NULL)
+      return EFI_NOT_FOUND;
+   if ((Buffer == NULL) || (*BufferSize < Initrd.Size)) {
+      *BufferSize = Initrd.Size;
+      return EFI_BUFFER_TOO_SMALL;
+   }
+   CopyMem(Buffer, Initrd.Data, Initrd.Size);
+   *BufferSize = Initrd.Size;
+   return EFI_SUCCESS;
+} // static EFI_STATUS InitrdLoadFile()
+
+static INITRD_LOAD_FILE2 InitrdLoadFile2 = { InitrdLoadFile };
+
+// Reads into memory the initrd files named by LoadOptions's "initrd=" options,
+// from Volume. The data is kept until InitrdWithdraw() is called, so calling
+// this again with the same arguments costs nothing. Returns EFI_NOT_FOUND if
+// LoadOptions names no initrd, or another error if any of them can't be read.
+EFI_STATUS InitrdPreload(IN REFIT_VOLUME *Volume, IN CHAR16 *LoadOptions) {
+   EFI_STATUS  Status;
+   UINT64      Size = 0;
+   UINT8       *Data = NULL;
+   UINTN       DataSize;
+   CHAR16      *Options, *First, *Second;
+
+   if ((Volume == NULL) || (Volume->RootDir == NULL) || (LoadOptions == NULL))
+      return EFI_NOT_FOUND;
+   if ((Initrd.LoadOptions != NULL) && (Initrd.Volume == Volume) && (StrCmp(Initrd.LoadOptions, LoadOptions) == 0))
+      return Initrd.Status;
+
+   InitrdWithdraw();
+   Initrd.Volume = Volume;
+   Initrd.LoadOptions = StrDuplicate(LoadOptions);
+
+   // A lone initrd that's been read ahead can be used as it is, without copying.
+   Options = LoadOptions;
+   First = NextInitrdName(&Options);
+   Second = NextInitrdName(&Options);
+   if ((First != NULL) && (Second == NULL) && PrefetchTake(Volume, First, &Data, &DataSize)) {
+      Status = EFI_SUCCESS;
+      Size = DataSize;
+   } else {
+      Status = ReadInitrds(Volume, LoadOptions, NULL, &Size);
+      if (!EFI_ERROR(Status)) {
+         Data = AllocatePool((UINTN) Size);
+         if (Data == NULL)
+            Status = EFI_OUT_OF_RESOURCES;
+         else
+            Status = ReadInitrds(Volume, LoadOptions, Data, &Size);
+      } // if
+   } // if/else
+   MyFreePool(First);
+   MyFreePool(Second);
+   if (EFI_ERROR(Status)) {
+      MyFreePool(Data);
+   } else {
+      Initrd.Data = Data;
+      Initrd.Size = (UINTN) Size;
+   } // if/else
+   Initrd.Status = Status;
+   return Status;
+} // EFI_STATUS InitrdPreload()
+
+// Makes the data read by InitrdPreload() available to the kernel that's
+// about to be launched. Does nothing if some other program has already
+// published an initrd this way.
+EFI_STATUS InitrdPublish(VOID) {
+   EFI_STATUS       Status;
+   EFI_DEVICE_PATH  *RemainingPath = (EFI_DEVICE_PATH *) &InitrdDevicePath;
+   EFI_HANDLE       Handle;
+
+   if (Initrd.Data == NULL)
+      return EFI_NOT_FOUND;
+   if (Initrd.Handle != NULL)
+      return EFI_SUCCESS;
+
+   Status = refit_call3_wrapper(BS->LocateDevicePath, &LoadFile2Guid, &RemainingPath, &Handle);
+   if (!EFI_ERROR(Status) && (DevicePathType(RemainingPath) == END_DEVICE_PATH_TYPE))
+      return EFI_ALREADY_STARTED;
+
+   Status = refit_call4_wrapper(BS->InstallProtocolInterface, &Initrd.Handle, &DevicePathProtocol,
+                                EFI_NATIVE_INTERFACE, &InitrdDevicePath);
+   if (!EFI_ERROR(Status)) {
+      Status = refit_call4_wrapper(BS->InstallProtocolInterface, &Initrd.Handle, &LoadFile2Guid,
+                                   EFI_NATIVE_INTERFACE, &InitrdLoadFile2);
+      if (EFI_ERROR(Status)) {
+         refit_call3_wrapper(BS->UninstallProtocolInterface, Initrd.Handle, &DevicePathProtocol, &InitrdDevicePath);
+         Initrd.Handle = NULL;
+      }
+   } // if
+   return Status;
+} // EFI_STATUS InitrdPublish()
+
+// Stops publishing any initrd data (as when the kernel returns to rEFInd)
+// and frees it.
+VOID InitrdWithdraw(VOID) {
+   if (Initrd.Handle != NULL) {
+      refit_call3_wrapper(BS->UninstallProtocolInterface, Initrd.Handle, &LoadFile2Guid, &InitrdLoadFile2);
+      refit_call3_wrapper(BS->UninstallProtocolInterface, Initrd.Handle, &DevicePathProtocol, &InitrdDevicePath);
+   }
+   MyFreePool(Initrd.Data);
+   MyFreePool(Initrd.LoadOptions);
+   SetMem(&Initrd, sizeof(PRELOADED_INITRD), 0);
+} // VOID InitrdWithdraw()
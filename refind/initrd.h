@@ -0,0 +1,42 @@
+/*
+ * refind/initrd.h
+ * Pre-loading of Linux initial RAM disks
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __INITRD_H_
+#define __INITRD_H_
+
+#ifdef __MAKEWITH_GNUEFI
+#include "efi.h"
+#include "efilib.h"
+#else
+#include "../include/tiano_includes.h"
+#endif
+#include "global.h"
+
+// Device path under which Linux 5.8 and later look for an initrd's LoadFile2 protocol
+#define LINUX_EFI_INITRD_MEDIA_GUID \
+   { 0x5568e427, 0x68fc, 0x4f3d, { 0xac, 0x74, 0xca, 0x55, 0x52, 0x31, 0xcc, 0x68 } }
+
+CHAR16 *NextInitrdName(IN OUT CHAR16 **Options);
+EFI_STATUS InitrdPreload(IN REFIT_VOLUME *Volume, IN CHAR16 *LoadOptions);
+EFI_STATUS InitrdPublish(VOID);
+VOID InitrdWithdraw(VOID);
+
+#endif
@@ -64,6 +64,8 @@
 #include "gpt.h"
 #include "config.h"
 #include "mystrings.h"
+#include "trace.h"
+#include "log.h"
 
 #ifdef __MAKEWITH_GNUEFI
 #define EfiReallocatePool ReallocatePool
@@ -101,6 +103,10 @@ CHAR16           *SelfDirPath;
 REFIT_VOLUME     *SelfVolume = NULL;
 REFIT_VOLUME     **Volumes = NULL;
 UINTN            VolumesCount = 0;
+
+// Arena for temporaries used while scanning; emptied by RescanAll()
+MEM_ARENA         ScanArena = { NULL, NULL };
+ALLOCATION_COUNTS AllocationCounts = { 0, 0, 0, 0 };
 extern GPT_DATA *gPartitions;
 extern EFI_GUID RefindGuid;
 
@@ -111,6 +117,70 @@ extern EFI_GUID RefindGuid;
 // and identify its boot loader, and hence probable BIOS-mode OS installation
 #define SAMPLE_SIZE 69632 /* 68 KiB -- ReiserFS superblock begins at 64 KiB */
 
+// Block I/O 2 protocol, which supports non-blocking reads. Defined here under
+// our own names, since not all versions of GNU-EFI provide it....
+#define REFIT_BLOCK_IO2_PROTOCOL_GUID \
+   { 0xa77b2472, 0xe282, 0x4e9f, { 0xa2, 0x45, 0xc2, 0xc0, 0xe2, 0x7b, 0xbc, 0xc1 } }
+
+typedef struct {
+   EFI_EVENT   Event;
+   EFI_STATUS  TransactionStatus;
+} REFIT_BLOCK_IO2_TOKEN;
+
+typedef struct _REFIT_BLOCK_IO2_PROTOCOL REFIT_BLOCK_IO2_PROTOCOL;
+
+typedef EFI_STATUS (EFIAPI *REFIT_BLOCK_READ_EX) (
+   IN REFIT_BLOCK_IO2_PROTOCOL   *This,
+   IN UINT32                     MediaId,
+   IN EFI_LBA                    LBA,
+   IN OUT REFIT_BLOCK_IO2_TOKEN  *Token,
+   IN UINTN                      BufferSize,
+   OUT VOID                      *Buffer
+);
+
+struct _REFIT_BLOCK_IO2_PROTOCOL {
+   EFI_BLOCK_IO_MEDIA   *Media;
+   VOID                 *Reset;
+   REFIT_BLOCK_READ_EX  ReadBlocksEx;
+   VOID                 *WriteBlocksEx;
+   VOID                 *FlushBlocksEx;
+};
+
+static EFI_GUID BlockIo2Protocol = REFIT_BLOCK_IO2_PROTOCOL_GUID;
+
+// A boot sector read started by PrefetchBootSectors() and not yet collected
+// by ReadBootSector()
+typedef struct {
+   EFI_HANDLE             DeviceHandle;
+   REFIT_BLOCK_IO2_TOKEN  Token;
+   UINT8                  *Buffer;
+} BOOT_SECTOR_PREFETCH;
+
+static BOOT_SECTOR_PREFETCH *Prefetches = NULL;
+static UINTN                PrefetchCount = 0;
+
+// The first blocks of a whole disk, which hold its MBR and primary GPT, read
+// once and shared by everything that examines the disk's partition tables
+// during a scan. The Block I/O protocol stands for the whole-disk handle.
+typedef struct _disk_sector_cache {
+   EFI_BLOCK_IO               *BlockIO;
+   UINT32                     MediaId;
+   UINTN                      Size;      // bytes held; 0 if they couldn't be read
+   UINT8                      *Data;
+   struct _disk_sector_cache  *Next;
+} DISK_SECTOR_CACHE;
+
+// Number of blocks held for each disk: the MBR, the GPT header and a
+// 128-entry GPT partition array (with 512-byte blocks)
+#define DISK_CACHE_BLOCKS 34
+
+static DISK_SECTOR_CACHE *DiskSectorCaches = NULL;
+
+// TRUE when Volumes holds the results of a scan that RescanVolumes() can build
+// on; FALSE before the first scan and after UninitVolumes(), which discards
+// the volumes' handles and Block I/O protocols.
+static BOOLEAN VolumesAreCurrent = FALSE;
+
 //
 // Pathname manipulations
 //
@@ -250,6 +320,7 @@ static VOID UninitVolumes(VOID)
         Volume->BlockIO = NULL;
         Volume->WholeDiskBlockIO = NULL;
     }
+    VolumesAreCurrent = FALSE;
 } /* VOID UninitVolumes() */
 
 VOID ReinitVolumes(VOID)
@@ -307,6 +378,9 @@ VOID UninitRefitLib(VOID)
 
     UninitVolumes();
 
+    // The theme pack is matched by SelfDir, which is about to be closed
+    egFreeThemePack();
+
     if (SelfDir != NULL) {
         refit_call1_wrapper(SelfDir->Close, SelfDir);
         SelfDir = NULL;
@@ -408,16 +482,22 @@ EFI_STATUS EfivarSetRaw(EFI_GUID *vendor, CHAR16 *name, CHAR8 *buf, UINTN size,
 // list functions
 //
 
+// Lists grow geometrically: room for 16 elements at first, then double that
+// whenever a list fills up. The capacity isn't stored, but it's always 16 or
+// the smallest power of 2 that's no less than *ElementCount, so it's time to
+// grow when *ElementCount is 0, or is a power of 2 that's 16 or more.
 VOID AddListElement(IN OUT VOID ***ListPtr, IN OUT UINTN *ElementCount, IN VOID *NewElement)
 {
     UINTN AllocateCount;
 
-    if ((*ElementCount & 15) == 0) {
-        AllocateCount = *ElementCount + 16;
+    AllocationCounts.ListAdditions++;
+    if ((*ElementCount == 0) || ((*ElementCount >= 16) && ((*ElementCount & (*ElementCount - 1)) == 0))) {
+        AllocateCount = (*ElementCount == 0) ? 16 : *ElementCount * 2;
         if (*ElementCount == 0)
             *ListPtr = AllocatePool(sizeof(VOID *) * AllocateCount);
         else
             *ListPtr = EfiReallocatePool(*ListPtr, sizeof(VOID *) * (*ElementCount), sizeof(VOID *) * AllocateCount);
+        AllocationCounts.ListAllocations++;
     }
     (*ListPtr)[*ElementCount] = NewElement;
     (*ElementCount)++;
@@ -436,6 +516,131 @@ VOID FreeList(IN OUT VOID ***ListPtr, IN OUT UINTN *ElementCount)
     }
 } // VOID FreeList()
 
+//
+// memory arena functions
+//
+
+// Size of a typical arena block; larger allocations get blocks of their own
+#define ARENA_BLOCK_SIZE 16384
+
+// Arena allocations are aligned to this many bytes
+#define ARENA_ALIGNMENT  8
+
+#define ARENA_ALIGN(x) (((x) + ARENA_ALIGNMENT - 1) & ~((UINTN) ARENA_ALIGNMENT - 1))
+
+// Returns the first usable byte of Block
+#define ARENA_BLOCK_DATA(Block) ((UINT8 *) (Block) + ARENA_ALIGN(sizeof(MEM_ARENA_BLOCK)))
+
+// Returns Size bytes (uninitialized) from Arena, or NULL if memory runs out.
+VOID *ArenaAlloc(IN OUT MEM_ARENA *Arena, IN UINTN Size) {
+    MEM_ARENA_BLOCK   *Block, **Spare;
+    VOID              *Data;
+
+    Size = ARENA_ALIGN(Size);
+    Block = Arena->Blocks;
+    if ((Block == NULL) || (Block->Size - Block->Used < Size)) {
+        // Reuse a released block if one's big enough; otherwise get a new one....
+        for (Spare = &(Arena->Spares); (*Spare != NULL) && ((*Spare)->Size < Size); Spare = &((*Spare)->Next))
+            ;
+        if (*Spare != NULL) {
+            Block = *Spare;
+            *Spare = Block->Next;
+        } else {
+            Block = AllocatePool(ARENA_ALIGN(sizeof(MEM_ARENA_BLOCK)) + ((Size > ARENA_BLOCK_SIZE) ? Size : ARENA_BLOCK_SIZE));
+            if (Block == NULL)
+                return NULL;
+            Block->Size = (Size > ARENA_BLOCK_SIZE) ? Size : ARENA_BLOCK_SIZE;
+            AllocationCounts.ArenaBlocks++;
+        } // if/else
+        Block->Used = 0;
+        Block->Next = Arena->Blocks;
+        Arena->Blocks = Block;
+    } // if
+    Data = ARENA_BLOCK_DATA(Block) + Block->Used;
+    Block->Used += Size;
+    AllocationCounts.ArenaAllocations++;
+    return Data;
+} // VOID *ArenaAlloc()
+
+// Like StrDuplicate(), but the copy comes from Arena.
+CHAR16 *ArenaStrDuplicate(IN OUT MEM_ARENA *Arena, IN CHAR16 *String) {
+    CHAR16 *Copy;
+    UINTN  Size;
+
+    if (String == NULL)
+        return NULL;
+    Size = (StrLen(String) + 1) * sizeof(CHAR16);
+    Copy = ArenaAlloc(Arena, Size);
+    if (Copy != NULL)
+        CopyMem(Copy, String, Size);
+    return Copy;
+} // CHAR16 *ArenaStrDuplicate()
+
+// Returns a new string, from Arena, holding First and Second, separated by
+// AddChar if it's not 0 and First isn't NULL or empty -- that is, the string
+// MergeStrings() would create, but without freeing First.
+CHAR16 *ArenaMergeStrings(IN OUT MEM_ARENA *Arena, IN CHAR16 *First, IN CHAR16 *Second, IN CHAR16 AddChar) {
+    UINTN   Length1 = 0, Length2 = 0;
+    CHAR16  *NewString;
+
+    if (First != NULL)
+        Length1 = StrLen(First);
+    if (Second != NULL)
+        Length2 = StrLen(Second);
+    NewString = ArenaAlloc(Arena, sizeof(CHAR16) * (Length1 + Length2 + 2));
+    if (NewString != NULL) {
+        if (Length1 > 0) {
+            CopyMem(NewString, First, sizeof(CHAR16) * Length1);
+            if (AddChar)
+                NewString[Length1++] = AddChar;
+        } // if
+        if (Length2 > 0)
+            CopyMem(NewString + Length1, Second, sizeof(CHAR16) * Length2);
+        NewString[Length1 + Length2] = L'\0';
+    } // if
+    return NewString;
+} // CHAR16 *ArenaMergeStrings()
+
+// Returns a mark recording how much of Arena is in use, for ArenaRelease().
+MEM_ARENA_MARK ArenaMark(IN MEM_ARENA *Arena) {
+    MEM_ARENA_MARK Mark;
+
+    Mark.Block = Arena->Blocks;
+    Mark.Used = (Mark.Block != NULL) ? Mark.Block->Used : 0;
+    return Mark;
+} // MEM_ARENA_MARK ArenaMark()
+
+// Releases everything allocated from Arena since Mark was taken. Blocks that
+// are no longer needed are kept for reuse.
+VOID ArenaRelease(IN OUT MEM_ARENA *Arena, IN MEM_ARENA_MARK Mark) {
+    MEM_ARENA_BLOCK *Block;
+
+    while ((Arena->Blocks != NULL) && (Arena->Blocks != Mark.Block)) {
+        Block = Arena->Blocks;
+        Arena->Blocks = Block->Next;
+        Block->Next = Arena->Spares;
+        Arena->Spares = Block;
+    } // while
+    if (Arena->Blocks != NULL)
+        Arena->Blocks->Used = Mark.Used;
+} // VOID ArenaRelease()
+
+// Frees all of Arena's memory, including its spare blocks.
+VOID ArenaFree(IN OUT MEM_ARENA *Arena) {
+    MEM_ARENA_BLOCK *Block;
+
+    while (Arena->Blocks != NULL) {
+        Block = Arena->Blocks;
+        Arena->Blocks = Block->Next;
+        FreePool(Block);
+    } // while
+    while (Arena->Spares != NULL) {
+        Block = Arena->Spares;
+        Arena->Spares = Block->Next;
+        FreePool(Block);
+    } // while
+} // VOID ArenaFree()
+
 //
 // volume functions
 //
@@ -594,6 +799,197 @@ static VOID SetFilesystemData(IN UINT8 *Buffer, IN UINTN BufferSize, IN OUT REFI
    } // if ((Buffer != NULL) && (Volume != NULL))
 } // UINT32 SetFilesystemData()
 
+// Start non-blocking reads of the first SAMPLE_SIZE bytes of every device in
+// Handles that supports Block I/O 2, so that the drives work in parallel
+// while ScanVolumes() examines the devices one at a time. Devices without
+// Block I/O 2 are read normally by ReadBootSector().
+static VOID PrefetchBootSectors(IN EFI_HANDLE *Handles, IN UINTN HandleCount) {
+    EFI_STATUS                Status;
+    REFIT_BLOCK_IO2_PROTOCOL  *BlockIo2;
+    BOOT_SECTOR_PREFETCH      *Prefetch;
+    UINTN                     i;
+
+    Prefetches = AllocateZeroPool(sizeof(BOOT_SECTOR_PREFETCH) * HandleCount);
+    if (Prefetches == NULL)
+        return;
+    PrefetchCount = 0;
+
+    for (i = 0; i < HandleCount; i++) {
+        Status = refit_call3_wrapper(BS->HandleProtocol, Handles[i], &BlockIo2Protocol, (VOID **) &BlockIo2);
+        if (EFI_ERROR(Status) || (BlockIo2 == NULL) || !BlockIo2->Media->MediaPresent ||
+            (BlockIo2->Media->BlockSize == 0) || (BlockIo2->Media->BlockSize > SAMPLE_SIZE) ||
+            (SAMPLE_SIZE % BlockIo2->Media->BlockSize != 0))
+            continue;
+
+        Prefetch = &Prefetches[PrefetchCount];
+        Prefetch->Buffer = AllocatePool(SAMPLE_SIZE);
+        if (Prefetch->Buffer == NULL)
+            continue;
+        Status = refit_call5_wrapper(BS->CreateEvent, 0, 0, NULL, NULL, &(Prefetch->Token.Event));
+        if (!EFI_ERROR(Status)) {
+            Status = refit_call6_wrapper(BlockIo2->ReadBlocksEx, BlockIo2, BlockIo2->Media->MediaId, 0,
+                                         &(Prefetch->Token), SAMPLE_SIZE, Prefetch->Buffer);
+            if (EFI_ERROR(Status))
+                refit_call1_wrapper(BS->CloseEvent, Prefetch->Token.Event);
+        }
+        if (EFI_ERROR(Status)) {
+            MyFreePool(Prefetch->Buffer);
+            Prefetch->Buffer = NULL;
+            continue;
+        }
+        Prefetch->DeviceHandle = Handles[i];
+        PrefetchCount++;
+    } // for
+} // static VOID PrefetchBootSectors()
+
+// Wait for a prefetched read to finish and release its resources. If the
+// read succeeded and Buffer isn't NULL, the data read is copied to Buffer.
+// Returns the read's status.
+static EFI_STATUS FinishPrefetch(IN BOOT_SECTOR_PREFETCH *Prefetch, OUT UINT8 *Buffer OPTIONAL) {
+    EFI_STATUS  Status;
+    UINTN       Index;
+
+    Status = refit_call3_wrapper(BS->WaitForEvent, 1, &(Prefetch->Token.Event), &Index);
+    if (!EFI_ERROR(Status))
+        Status = Prefetch->Token.TransactionStatus;
+    if (!EFI_ERROR(Status) && (Buffer != NULL))
+        CopyMem(Buffer, Prefetch->Buffer, SAMPLE_SIZE);
+    refit_call1_wrapper(BS->CloseEvent, Prefetch->Token.Event);
+    MyFreePool(Prefetch->Buffer);
+    Prefetch->Buffer = NULL;
+    Prefetch->DeviceHandle = NULL;
+    return Status;
+} // static EFI_STATUS FinishPrefetch()
+
+// Wait for and discard any prefetched reads that weren't used.
+static VOID FinishAllPrefetches(VOID) {
+    UINTN i;
+
+    for (i = 0; i < PrefetchCount; i++) {
+        if (Prefetches[i].Buffer != NULL)
+            FinishPrefetch(&Prefetches[i], NULL);
+    }
+    MyFreePool(Prefetches);
+    Prefetches = NULL;
+    PrefetchCount = 0;
+} // static VOID FinishAllPrefetches()
+
+// Returns the cached first blocks of the disk whose Block I/O protocol is
+// BlockIO, or NULL if they haven't been cached (or the medium has changed).
+static DISK_SECTOR_CACHE * FindDiskSectors(IN EFI_BLOCK_IO *BlockIO) {
+    DISK_SECTOR_CACHE *Cache;
+
+    for (Cache = DiskSectorCaches; Cache != NULL; Cache = Cache->Next) {
+        if ((Cache->BlockIO == BlockIO) && (Cache->MediaId == BlockIO->Media->MediaId))
+            return Cache;
+    } // for
+    return NULL;
+} // static DISK_SECTOR_CACHE * FindDiskSectors()
+
+// Cache the first DISK_CACHE_BLOCKS blocks of the whole disk whose Block I/O
+// protocol is BlockIO. They're copied from Sample (the first SampleSize
+// bytes of the disk) if that's given, or read in a single operation if not.
+// Returns NULL if BlockIO isn't a whole disk or memory runs out.
+static DISK_SECTOR_CACHE * CacheDiskSectors(IN EFI_BLOCK_IO *BlockIO, IN UINT8 *Sample OPTIONAL, IN UINTN SampleSize) {
+    EFI_STATUS         Status = EFI_SUCCESS;
+    DISK_SECTOR_CACHE  *Cache;
+    UINTN              Size = DISK_CACHE_BLOCKS;
+
+    if ((BlockIO == NULL) || !BlockIO->Media->MediaPresent || BlockIO->Media->LogicalPartition ||
+        (BlockIO->Media->BlockSize == 0))
+        return NULL;
+
+    if (BlockIO->Media->LastBlock < Size)
+        Size = (UINTN) BlockIO->Media->LastBlock + 1;
+    Size *= BlockIO->Media->BlockSize;
+    if ((Sample != NULL) && (SampleSize < Size))
+        Size = SampleSize - SampleSize % BlockIO->Media->BlockSize;
+
+    Cache = AllocateZeroPool(sizeof(DISK_SECTOR_CACHE));
+    if (Cache == NULL)
+        return NULL;
+    Cache->Data = (Size > 0) ? AllocatePool(Size) : NULL;
+    if (Cache->Data == NULL) {
+        MyFreePool(Cache);
+        return NULL;
+    }
+
+    if (Sample != NULL) {
+        CopyMem(Cache->Data, Sample, Size);
+    } else {
+        Status = refit_call5_wrapper(BlockIO->ReadBlocks, BlockIO, BlockIO->Media->MediaId, 0, Size, Cache->Data);
+    }
+    if (EFI_ERROR(Status)) {
+        // remember the failure, so that later reads go straight to the disk
+        MyFreePool(Cache->Data);
+        Cache->Data = NULL;
+        Size = 0;
+    }
+    Cache->BlockIO = BlockIO;
+    Cache->MediaId = BlockIO->Media->MediaId;
+    Cache->Size = Size;
+    Cache->Next = DiskSectorCaches;
+    DiskSectorCaches = Cache;
+    return Cache;
+} // static DISK_SECTOR_CACHE * CacheDiskSectors()
+
+// Read BufferSize bytes starting at block Lba of the device whose Block I/O
+// protocol is BlockIO. Reads of a whole disk's partition tables are served
+// from its DISK_SECTOR_CACHE, which is filled on the first such read; all
+// other reads go to the device.
+EFI_STATUS ReadDiskBlocks(IN EFI_BLOCK_IO *BlockIO, IN EFI_LBA Lba, IN UINTN BufferSize, OUT VOID *Buffer) {
+    DISK_SECTOR_CACHE *Cache;
+    UINTN             Offset;
+
+    if (Lba < DISK_CACHE_BLOCKS) {
+        Cache = FindDiskSectors(BlockIO);
+        if (Cache == NULL)
+            Cache = CacheDiskSectors(BlockIO, NULL, 0);
+        Offset = (UINTN) Lba * BlockIO->Media->BlockSize;
+        if ((Cache != NULL) && (Offset + BufferSize <= Cache->Size)) {
+            CopyMem(Buffer, Cache->Data + Offset, BufferSize);
+            return EFI_SUCCESS;
+        }
+    } // if
+
+    return refit_call5_wrapper(BlockIO->ReadBlocks, BlockIO, BlockIO->Media->MediaId, Lba, BufferSize, Buffer);
+} // EFI_STATUS ReadDiskBlocks()
+
+// Discard the partition table blocks cached by ReadDiskBlocks() and
+// ScanVolumeBootcode().
+VOID ForgetDiskSectors(VOID) {
+    DISK_SECTOR_CACHE *Next;
+
+    while (DiskSectorCaches != NULL) {
+        Next = DiskSectorCaches->Next;
+        MyFreePool(DiskSectorCaches->Data);
+        MyFreePool(DiskSectorCaches);
+        DiskSectorCaches = Next;
+    } // while
+} // VOID ForgetDiskSectors()
+
+// Read the first SAMPLE_SIZE bytes of Volume into Buffer, using the data from
+// PrefetchBootSectors() if it read this volume.
+static EFI_STATUS ReadBootSector(IN REFIT_VOLUME *Volume, OUT UINT8 *Buffer) {
+    EFI_STATUS  Status;
+    UINTN       i;
+
+    if (Volume->BlockIOOffset == 0) {
+        for (i = 0; i < PrefetchCount; i++) {
+            if ((Prefetches[i].Buffer != NULL) && (Prefetches[i].DeviceHandle == Volume->DeviceHandle)) {
+                Status = FinishPrefetch(&Prefetches[i], Buffer);
+                if (!EFI_ERROR(Status))
+                    return Status;
+                break; // failed; try again the old-fashioned way....
+            } // if
+        } // for
+    } // if
+
+    return refit_call5_wrapper(Volume->BlockIO->ReadBlocks,
+                               Volume->BlockIO, Volume->BlockIO->Media->MediaId,
+                               Volume->BlockIOOffset, SAMPLE_SIZE, Buffer);
+} // static EFI_STATUS ReadBootSector()
+
 static VOID ScanVolumeBootcode(REFIT_VOLUME *Volume, BOOLEAN *Bootable)
 {
     EFI_STATUS              Status;
@@ -613,11 +1009,12 @@ static VOID ScanVolumeBootcode(REFIT_VOLUME *Volume, BOOLEAN *Bootable)
         return;   // our buffer is too small...
 
     // look at the boot sector (this is used for both hard disks and El Torito images!)
-    Status = refit_call5_wrapper(Volume->BlockIO->ReadBlocks,
-                                 Volume->BlockIO, Volume->BlockIO->Media->MediaId,
-                                 Volume->BlockIOOffset, SAMPLE_SIZE, Buffer);
+    Status = ReadBootSector(Volume, Buffer);
     if (!EFI_ERROR(Status)) {
         SetFilesystemData(Buffer, SAMPLE_SIZE, Volume);
+        // on a whole disk, this holds the partition tables too, so keep them
+        if ((Volume->BlockIOOffset == 0) && (FindDiskSectors(Volume->BlockIO) == NULL))
+            CacheDiskSectors(Volume->BlockIO, Buffer, SAMPLE_SIZE);
     }
     if ((Status == EFI_SUCCESS) && (GlobalConfig.LegacyType == LEGACY_TYPE_MAC)) {
         if ((*((UINT16 *)(Buffer + 510)) == 0xaa55 && Buffer[0] != 0) && (FindMem(Buffer, 512, "EXFAT", 5) == -1)) {
@@ -942,6 +1339,8 @@ VOID ScanVolume(REFIT_VOLUME *Volume)
         Volume->BlockIO = NULL;
         Print(L"Warning: Can't get BlockIO protocol.\n");
     } else {
+        Volume->MediaId = Volume->BlockIO->Media->MediaId;
+        Volume->LastBlock = Volume->BlockIO->Media->LastBlock;
         if (Volume->BlockIO->Media->BlockSize == 2048)
             Volume->DiskKind = DISK_KIND_OPTICAL;
     }
@@ -1059,10 +1458,7 @@ static VOID ScanExtendedPartition(REFIT_VOLUME *WholeDiskVolume, MBR_PARTITION_I
 
     for (ExtCurrent = ExtBase; ExtCurrent; ExtCurrent = NextExtCurrent) {
         // read current EMBR
-      Status = refit_call5_wrapper(WholeDiskVolume->BlockIO->ReadBlocks,
-                                   WholeDiskVolume->BlockIO,
-                                   WholeDiskVolume->BlockIO->Media->MediaId,
-                                   ExtCurrent, 512, SectorBuffer);
+        Status = ReadDiskBlocks(WholeDiskVolume->BlockIO, ExtCurrent, 512, SectorBuffer);
         if (EFI_ERROR(Status))
             break;
         if (*((UINT16 *)(SectorBuffer + 510)) != 0xaa55)
@@ -1102,25 +1498,70 @@ static VOID ScanExtendedPartition(REFIT_VOLUME *WholeDiskVolume, MBR_PARTITION_I
     } // for
 } /* VOID ScanExtendedPartition() */
 
-VOID ScanVolumes(VOID)
+// Returns the volume in OldVolumes that was scanned from DeviceHandle, if
+// that volume can be used as it stands: the handle must still carry the same
+// device path and Block I/O protocol, the medium must not have changed, and
+// no filesystem may have appeared on it since. Returns NULL otherwise.
+static REFIT_VOLUME * FindUnchangedVolume(IN EFI_HANDLE DeviceHandle, IN REFIT_VOLUME **OldVolumes, IN UINTN OldCount)
 {
     EFI_STATUS              Status;
-    EFI_HANDLE              *Handles;
-    REFIT_VOLUME            *Volume, *WholeDiskVolume;
+    REFIT_VOLUME            *Volume = NULL;
+    EFI_BLOCK_IO            *BlockIO;
+    EFI_DEVICE_PATH         *DevicePath;
+    EFI_FILE                *RootDir;
+    UINTN                   i, Size;
+
+    for (i = 0; (i < OldCount) && (Volume == NULL); i++) {
+        if (OldVolumes[i]->DeviceHandle == DeviceHandle)
+            Volume = OldVolumes[i];
+    } // for
+    if ((Volume == NULL) || (Volume->BlockIO == NULL) || (Volume->DevicePath == NULL))
+        return NULL;
+
+    Status = refit_call3_wrapper(BS->HandleProtocol, DeviceHandle, &BlockIoProtocol, (VOID **) &BlockIO);
+    if (EFI_ERROR(Status) || (BlockIO != Volume->BlockIO) || (BlockIO->Media->MediaId != Volume->MediaId) ||
+        (BlockIO->Media->LastBlock != Volume->LastBlock))
+        return NULL;
+
+    DevicePath = DevicePathFromHandle(DeviceHandle);
+    Size = DevicePathSize(Volume->DevicePath);
+    if ((DevicePath == NULL) || (DevicePathSize(DevicePath) != Size) || (CompareMem(DevicePath, Volume->DevicePath, Size) != 0))
+        return NULL;
+
+    // A filesystem driver may have been connected to the device since it was scanned....
+    if (Volume->RootDir == NULL) {
+        RootDir = LibOpenRoot(DeviceHandle);
+        if (RootDir != NULL) {
+            refit_call1_wrapper(RootDir->Close, RootDir);
+            return NULL;
+        }
+    } // if
+    return Volume;
+} // static REFIT_VOLUME * FindUnchangedVolume()
+
+// Add a volume to Volumes for each Block I/O handle. Volumes in OldVolumes that
+// FindUnchangedVolume() accepts are carried over as they are, along with the
+// logical partitions of any such whole disk; every other handle is scanned
+// afresh. Volumes that aren't carried over are left allocated, since menu
+// entries from earlier scans may still point to them.
+static VOID ScanBlockIoHandles(IN REFIT_VOLUME **OldVolumes, IN UINTN OldCount)
+{
+    EFI_STATUS              Status;
+    EFI_HANDLE              *Handles, *NewHandles;
+    REFIT_VOLUME            *Volume, *WholeDiskVolume, **Unchanged, *OldVolume;
     MBR_PARTITION_INFO      *MbrTable;
-    UINTN                   HandleCount = 0;
+    UINTN                   HandleCount = 0, NewHandleCount = 0;
+    UINTN                   OldHandleCount = 0, UnchangedCount = 0;
     UINTN                   HandleIndex;
     UINTN                   VolumeIndex, VolumeIndex2;
     UINTN                   PartitionIndex;
     UINTN                   SectorSum, i;
     UINT8                   *SectorBuffer1, *SectorBuffer2;
+    BOOLEAN                 WasReadable, IsUnchanged;
     EFI_GUID                *UuidList;
     EFI_GUID                NullUuid = NULL_GUID_VALUE;
 
-    MyFreePool(Volumes);
-    Volumes = NULL;
-    VolumesCount = 0;
-    ForgetPartitionTables();
+    VolumesAreCurrent = FALSE;
 
     // get all filesystem handles
     Status = LibLocateHandle(ByProtocol, &BlockIoProtocol, NULL, &HandleCount, &Handles);
@@ -1131,12 +1572,51 @@ VOID ScanVolumes(VOID)
         return;
     UuidList = AllocateZeroPool(sizeof(EFI_GUID) * HandleCount);
 
+    // match the handles against the previous scan's volumes
+    Unchanged = (OldCount > 0) ? AllocateZeroPool(sizeof(REFIT_VOLUME *) * HandleCount) : NULL;
+    NewHandles = (Unchanged != NULL) ? AllocatePool(sizeof(EFI_HANDLE) * HandleCount) : NULL;
+    if (NewHandles == NULL) {
+        MyFreePool(Unchanged);
+        Unchanged = NULL;
+    }
+    for (i = 0; i < OldCount; i++) {
+        if (OldVolumes[i]->DeviceHandle != NULL)
+            OldHandleCount++;
+    } // for
+    for (HandleIndex = 0; (Unchanged != NULL) && (HandleIndex < HandleCount); HandleIndex++) {
+        Unchanged[HandleIndex] = FindUnchangedVolume(Handles[HandleIndex], OldVolumes, OldCount);
+        if (Unchanged[HandleIndex] != NULL)
+            UnchangedCount++;
+        else
+            NewHandles[NewHandleCount++] = Handles[HandleIndex];
+    } // for
+
+    // If a disk went away or changed, its GPT may be stale, so read them all again
+    if (UnchangedCount < OldHandleCount)
+        ForgetPartitionTables();
+
+    // start reading all the boot sectors at once, rather than one at a time
+    if (NewHandles != NULL)
+        PrefetchBootSectors(NewHandles, NewHandleCount);
+    else
+        PrefetchBootSectors(Handles, HandleCount);
+
     // first pass: collect information about all handles
     for (HandleIndex = 0; HandleIndex < HandleCount; HandleIndex++) {
-        Volume = AllocateZeroPool(sizeof(REFIT_VOLUME));
-        Volume->DeviceHandle = Handles[HandleIndex];
-        AddPartitionTable(Volume);
-        ScanVolume(Volume);
+        Volume = Unchanged ? Unchanged[HandleIndex] : NULL;
+        WasReadable = FALSE;
+        if (Volume == NULL) {
+            Volume = AllocateZeroPool(sizeof(REFIT_VOLUME));
+            Volume->DeviceHandle = Handles[HandleIndex];
+            ScanVolume(Volume);
+            AddPartitionTable(Volume);
+        } else {
+            if (UnchangedCount < OldHandleCount)
+                AddPartitionTable(Volume);
+            // readability is decided afresh, since a duplicate UUID may have come or gone
+            WasReadable = Volume->IsReadable;
+            Volume->IsReadable = (Volume->RootDir != NULL);
+        } // if/else
         if (UuidList) {
            UuidList[HandleIndex] = Volume->VolUuid;
            for (i = 0; i < HandleIndex; i++) {
@@ -1147,19 +1627,54 @@ VOID ScanVolumes(VOID)
            } // for
         } // if
 
+        // An unchanged volume whose readability changed gets a new copy, so that
+        // anything cached for the old one doesn't apply to it
+        if (Unchanged && (Unchanged[HandleIndex] != NULL) && (Volume->IsReadable != WasReadable)) {
+            OldVolume = Volume;
+            Volume = AllocatePool(sizeof(REFIT_VOLUME));
+            if (Volume != NULL) {
+                CopyMem(Volume, OldVolume, sizeof(REFIT_VOLUME));
+                OldVolume->IsReadable = WasReadable;
+                Unchanged[HandleIndex] = Volume;
+            } else {
+                Volume = OldVolume;
+            }
+        } // if
+
         AddListElement((VOID ***) &Volumes, &VolumesCount, Volume);
 
         if (Volume->DeviceHandle == SelfLoadedImage->DeviceHandle)
             SelfVolume = Volume;
     }
+    FinishAllPrefetches();
     MyFreePool(Handles);
+    MyFreePool(NewHandles);
+    MyFreePool(UuidList);
 
-    if (SelfVolume == NULL)
+    if (SelfVolume == NULL) {
         Print(L"WARNING: SelfVolume not found");
+        LOG_WARNING(L"The volume rEFInd was loaded from wasn't found");
+    }
 
     // second pass: relate partitions and whole disk devices
     for (VolumeIndex = 0; VolumeIndex < VolumesCount; VolumeIndex++) {
         Volume = Volumes[VolumeIndex];
+
+        // an unchanged volume keeps what was found the last time: its place in
+        // the MBR and, for a whole disk, its logical partitions
+        IsUnchanged = FALSE;
+        for (HandleIndex = 0; Unchanged && (HandleIndex < HandleCount) && !IsUnchanged; HandleIndex++)
+            IsUnchanged = (Unchanged[HandleIndex] == Volume);
+        if (IsUnchanged) {
+            for (i = 0; i < OldCount; i++) {
+                OldVolume = OldVolumes[i];
+                if ((OldVolume->DeviceHandle == NULL) && (OldVolume->BlockIOOffset != 0) &&
+                    (OldVolume->BlockIO == Volume->BlockIO))
+                    AddListElement((VOID ***) &Volumes, &VolumesCount, OldVolume);
+            } // for
+            continue;
+        } // if
+
         // check MBR partition table for extended partitions
         if (Volume->BlockIO != NULL && Volume->WholeDiskBlockIO != NULL &&
             Volume->BlockIO == Volume->WholeDiskBlockIO && Volume->BlockIOOffset == 0 &&
@@ -1200,9 +1715,7 @@ VOID ScanVolumes(VOID)
                                              Volume->BlockIOOffset, 512, SectorBuffer1);
                 if (EFI_ERROR(Status))
                     break;
-                Status = refit_call5_wrapper(Volume->WholeDiskBlockIO->ReadBlocks,
-                                             Volume->WholeDiskBlockIO, Volume->WholeDiskBlockIO->Media->MediaId,
-                                             MbrTable[PartitionIndex].StartLBA, 512, SectorBuffer2);
+                Status = ReadDiskBlocks(Volume->WholeDiskBlockIO, MbrTable[PartitionIndex].StartLBA, 512, SectorBuffer2);
                 if (EFI_ERROR(Status))
                     break;
                 if (CompareMem(SectorBuffer1, SectorBuffer2, 512) != 0)
@@ -1229,8 +1742,55 @@ VOID ScanVolumes(VOID)
             MyFreePool(SectorBuffer2);
         }
     } // for
+    MyFreePool(Unchanged);
+    ForgetDiskSectors();
+
+    IndexVolumes();
+    VolumesAreCurrent = TRUE;
+
+    LOG_INFO(L"Found %d volumes; scanned %d of %d Block I/O handles", VolumesCount, HandleCount - UnchangedCount, HandleCount);
+    for (VolumeIndex = 0; VolumeIndex < VolumesCount; VolumeIndex++) {
+        Volume = Volumes[VolumeIndex];
+        LOG_INFO(L"Volume %d: %s, file system%s%s", VolumeIndex, Volume->VolName ? Volume->VolName : L"(no name)",
+                 (Volume->FSType == FS_TYPE_UNKNOWN) ? L" unknown" : FSTypeName(Volume->FSType),
+                 Volume->IsReadable ? L"" : L", not readable");
+    } // for
+} /* static VOID ScanBlockIoHandles() */
+
+VOID ScanVolumes(VOID)
+{
+    TraceBegin(L"ScanVolumes");
+    MyFreePool(Volumes);
+    Volumes = NULL;
+    VolumesCount = 0;
+    ForgetPartitionTables();
+    ScanBlockIoHandles(NULL, 0);
+    TraceEnd(L"ScanVolumes");
 } /* VOID ScanVolumes() */
 
+// Bring Volumes up to date after drivers have been connected or media have
+// been inserted or removed. Handles that were present at the last scan keep
+// their REFIT_VOLUME structures (so pointers to them remain valid and still
+// describe the same volumes); only new or changed handles are scanned. Falls
+// back to ScanVolumes() if the last scan's results can't be built on.
+VOID RescanVolumes(VOID)
+{
+    REFIT_VOLUME **OldVolumes;
+    UINTN        OldCount;
+
+    if (!VolumesAreCurrent) {
+        ScanVolumes();
+        return;
+    }
+
+    OldVolumes = Volumes;
+    OldCount = VolumesCount;
+    Volumes = NULL;
+    VolumesCount = 0;
+    ScanBlockIoHandles(OldVolumes, OldCount);
+    MyFreePool(OldVolumes);
+} /* VOID RescanVolumes() */
+
 VOID SetVolumeIcons(VOID) {
     UINTN        VolumeIndex;
     REFIT_VOLUME *Volume;
@@ -1267,6 +1827,24 @@ BOOLEAN FileExists(IN EFI_FILE *BaseDir, IN CHAR16 *RelativePath)
     return FALSE;
 }
 
+// Reads Size bytes from FileHandle's current position into Buffer, in
+// FILE_READ_CHUNK_SIZE pieces, so that large files are read with a few big
+// Read() calls. Fails if the file ends before Size bytes have been read.
+EFI_STATUS ReadFileFully(IN EFI_FILE_HANDLE FileHandle, OUT VOID *Buffer, IN UINTN Size)
+{
+    EFI_STATUS  Status = EFI_SUCCESS;
+    UINTN       Done = 0, ChunkSize;
+
+    while (!EFI_ERROR(Status) && (Done < Size)) {
+        ChunkSize = (Size - Done > FILE_READ_CHUNK_SIZE) ? FILE_READ_CHUNK_SIZE : Size - Done;
+        Status = refit_call3_wrapper(FileHandle->Read, FileHandle, &ChunkSize, (UINT8 *) Buffer + Done);
+        if (!EFI_ERROR(Status) && (ChunkSize == 0))
+            Status = EFI_LOAD_ERROR;
+        Done += ChunkSize;
+    } // while
+    return Status;
+} // EFI_STATUS ReadFileFully()
+
 EFI_STATUS DirNextEntry(IN EFI_FILE *Directory, IN OUT EFI_FILE_INFO **DirEntry, IN UINTN FilterMode)
 {
     EFI_STATUS Status;
@@ -1341,60 +1919,14 @@ VOID DirIterOpen(IN EFI_FILE *BaseDir, IN CHAR16 *RelativePath OPTIONAL, OUT REF
         DirIter->CloseDirHandle = EFI_ERROR(DirIter->LastStatus) ? FALSE : TRUE;
     }
     DirIter->LastFileInfo = NULL;
+    DirIter->PatternSource = NULL;
+    SetMem(&(DirIter->Patterns), sizeof(GLOB_LIST), 0);
 }
 
-#ifndef __MAKEWITH_GNUEFI
-EFI_UNICODE_COLLATION_PROTOCOL *mUnicodeCollation = NULL;
-
-static EFI_STATUS
-InitializeUnicodeCollationProtocol (VOID)
-{
-   EFI_STATUS  Status;
-
-   if (mUnicodeCollation != NULL) {
-      return EFI_SUCCESS;
-   }
-
-   //
-   // BUGBUG: Proper impelmentation is to locate all Unicode Collation Protocol
-   // instances first and then select one which support English language.
-   // Current implementation just pick the first instance.
-   //
-   Status = gBS->LocateProtocol (
-                          &gEfiUnicodeCollation2ProtocolGuid,
-                          NULL,
-                          (VOID **) &mUnicodeCollation
-                          );
-  if (EFI_ERROR(Status)) {
-    Status = gBS->LocateProtocol (
-                  &gEfiUnicodeCollationProtocolGuid,
-                  NULL,
-                  (VOID **) &mUnicodeCollation
-                  );
-
-  }
-   return Status;
-}
-
-static BOOLEAN
-MetaiMatch (IN CHAR16 *String, IN CHAR16 *Pattern)
-{
-   if (!mUnicodeCollation) {
-      InitializeUnicodeCollationProtocol();
-   }
-   if (mUnicodeCollation)
-      return mUnicodeCollation->MetaiMatch (mUnicodeCollation, String, Pattern);
-   return FALSE; // Shouldn't happen
-}
-
-#endif
-
 BOOLEAN DirIterNext(IN OUT REFIT_DIR_ITER *DirIter, IN UINTN FilterMode, IN CHAR16 *FilePattern OPTIONAL,
                     OUT EFI_FILE_INFO **DirEntry)
 {
     BOOLEAN KeepGoing = TRUE;
-    UINTN   i;
-    CHAR16  *OnePattern;
 
     if (DirIter->LastFileInfo != NULL) {
        FreePool(DirIter->LastFileInfo);
@@ -1404,6 +1936,13 @@ BOOLEAN DirIterNext(IN OUT REFIT_DIR_ITER *DirIter, IN UINTN FilterMode, IN CHAR
     if (EFI_ERROR(DirIter->LastStatus))
         return FALSE;   // stop iteration
 
+    // Compile the patterns just once, rather than splitting them up anew for
+    // every directory entry....
+    if ((FilePattern != NULL) && (FilePattern != DirIter->PatternSource)) {
+        FreeGlobList(&(DirIter->Patterns));
+        DirIter->PatternSource = CompileGlobList(FilePattern, &(DirIter->Patterns)) ? FilePattern : NULL;
+    }
+
     do {
         DirIter->LastStatus = DirNextEntry(DirIter->DirHandle, &(DirIter->LastFileInfo), FilterMode);
         if (EFI_ERROR(DirIter->LastStatus))
@@ -1411,13 +1950,9 @@ BOOLEAN DirIterNext(IN OUT REFIT_DIR_ITER *DirIter, IN UINTN FilterMode, IN CHAR
         if (DirIter->LastFileInfo == NULL)  // end of listing
             return FALSE;
         if (FilePattern != NULL) {
-            if ((DirIter->LastFileInfo->Attribute & EFI_FILE_DIRECTORY))
+            if ((DirIter->LastFileInfo->Attribute & EFI_FILE_DIRECTORY) ||
+                GlobListMatch(&(DirIter->Patterns), DirIter->LastFileInfo->FileName))
                 KeepGoing = FALSE;
-            i = 0;
-            while (KeepGoing && (OnePattern = FindCommaDelimited(FilePattern, i++)) != NULL) {
-               if (MetaiMatch(DirIter->LastFileInfo->FileName, OnePattern))
-                   KeepGoing = FALSE;
-            } // while
             // else continue loop
         } else
             break;
@@ -1433,6 +1968,8 @@ EFI_STATUS DirIterClose(IN OUT REFIT_DIR_ITER *DirIter)
       FreePool(DirIter->LastFileInfo);
       DirIter->LastFileInfo = NULL;
    }
+   FreeGlobList(&(DirIter->Patterns));
+   DirIter->PatternSource = NULL;
    if ((DirIter->CloseDirHandle) && (DirIter->DirHandle->Close))
       refit_call1_wrapper(DirIter->DirHandle->Close, DirIter->DirHandle);
    return DirIter->LastStatus;
@@ -1680,69 +2217,396 @@ VOID SplitPathName(CHAR16 *InPath, CHAR16 **VolName, CHAR16 **Path, CHAR16 **Fil
     MyFreePool(Temp);
 } // VOID SplitPathName()
 
+// Number of hash buckets in the volume index; must be a power of 2
+#define VOLUME_INDEX_BUCKETS 64
+
+// A volume description from refind.conf -- a filesystem label, a partition
+// name, a partition GUID, or a filesystem UUID -- parsed just once, so that it
+// can be compared to any number of volumes without being parsed again.
+typedef struct {
+    CHAR16      *Name;
+    BOOLEAN     IsGuid;
+    EFI_GUID    Guid;   // Name as a partition GUID
+    EFI_GUID    Uuid;   // Name as a filesystem UUID, in on-disk byte order
+} VOLUME_DESCRIPTION;
+
+// One way of identifying a volume, in the volume index. Exactly one of Name
+// and Guid is set.
+typedef struct _volume_index_entry {
+    UINTN                        VolumeIndex;   // Index in Volumes[]
+    CHAR16                       *Name;         // Volume->VolName or Volume->PartName
+    EFI_GUID                     *Guid;         // &(Volume->PartGuid) or &(Volume->VolUuid)
+    BOOLEAN                      IsUuid;        // Is Guid a filesystem UUID?
+    struct _volume_index_entry   *Next;         // next entry in the same bucket
+} VOLUME_INDEX_ENTRY;
+
+// Index of Volumes[] by each volume's label, partition name, partition GUID,
+// and filesystem UUID, so that FindVolume() needn't test every volume in turn.
+// Built by IndexVolumes() once ScanVolumes() is done.
+static VOLUME_INDEX_ENTRY   *VolumeIndex[VOLUME_INDEX_BUCKETS];
+static VOLUME_INDEX_ENTRY   *VolumeIndexEntries = NULL;
+static REFIT_VOLUME         **IndexedVolumes = NULL;
+static UINTN                IndexedVolumesCount = 0;
+
+// Returns a hash of Name that ignores case the way MyStriCmp() does.
+static UINT32 FoldedNameHash(IN CHAR16 *Name) {
+    UINT32 Hash = 2166136261U;
+
+    while (*Name != L'\0')
+        Hash = (Hash ^ (*Name++ & ~0x20)) * 16777619;
+    return Hash;
+} // static UINT32 FoldedNameHash()
+
+static UINT32 GuidHash(IN EFI_GUID *Guid) {
+    UINT32 Hash = 2166136261U;
+    UINTN  i;
+
+    for (i = 0; i < sizeof(EFI_GUID); i++)
+        Hash = (Hash ^ ((UINT8 *) Guid)[i]) * 16777619;
+    return Hash;
+} // static UINT32 GuidHash()
+
+// Parse Description into *Parsed. Parsed->Name points to Description, so
+// Description must remain valid for as long as *Parsed is used.
+static VOID ParseVolumeDescription(IN CHAR16 *Description, OUT VOLUME_DESCRIPTION *Parsed) {
+    UINT8   *Bytes, *UuidBytes;
+    UINTN   i;
+    // A UUID as written by Linux tools has its first three fields in big-endian
+    // order; an EFI_GUID stores them little-endian....
+    static UINTN UuidOrder[16] = { 3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+    Parsed->Name = Description;
+    Parsed->IsGuid = IsGuid(Description);
+    if (Parsed->IsGuid) {
+        Parsed->Guid = StringAsGuid(Description);
+        Bytes = (UINT8 *) &(Parsed->Guid);
+        UuidBytes = (UINT8 *) &(Parsed->Uuid);
+        for (i = 0; i < sizeof(EFI_GUID); i++)
+            UuidBytes[i] = Bytes[UuidOrder[i]];
+    } // if
+} // static VOID ParseVolumeDescription()
+
+// Returns TRUE if the parsed description matches Volume's VolName or
+// PartName, or its PartGuid or (non-null) VolUuid, FALSE otherwise.
+static BOOLEAN VolumeMatchesParsed(IN REFIT_VOLUME *Volume, IN VOLUME_DESCRIPTION *Parsed) {
+    EFI_GUID NullGuid = NULL_GUID_VALUE;
+
+    if (Parsed->IsGuid) {
+        return (GuidsAreEqual(&(Parsed->Guid), &(Volume->PartGuid)) ||
+                (GuidsAreEqual(&(Parsed->Uuid), &(Volume->VolUuid)) && !GuidsAreEqual(&NullGuid, &(Volume->VolUuid))));
+    } else {
+        return (MyStriCmp(Parsed->Name, Volume->VolName) || MyStriCmp(Parsed->Name, Volume->PartName));
+    }
+} // static BOOLEAN VolumeMatchesParsed()
+
+static VOID AddVolumeIndexEntry(IN VOLUME_INDEX_ENTRY *Entry, IN UINT32 Hash) {
+    VOLUME_INDEX_ENTRY **Tail;
+
+    // Append, so that each bucket remains in Volumes[] order....
+    for (Tail = &VolumeIndex[Hash & (VOLUME_INDEX_BUCKETS - 1)]; *Tail != NULL; Tail = &((*Tail)->Next))
+        ;
+    Entry->Next = NULL;
+    *Tail = Entry;
+} // static VOID AddVolumeIndexEntry()
+
+// (Re)build the volume index from Volumes[]. Called by ScanVolumes(), and by
+// FindVolume() if Volumes[] has changed since the index was built.
+VOID IndexVolumes(VOID) {
+    VOLUME_INDEX_ENTRY  *Entry;
+    REFIT_VOLUME        *Volume;
+    UINTN               i;
+    EFI_GUID            NullGuid = NULL_GUID_VALUE;
+
+    MyFreePool(VolumeIndexEntries);
+    SetMem(VolumeIndex, sizeof(VolumeIndex), 0);
+    IndexedVolumes = Volumes;
+    IndexedVolumesCount = VolumesCount;
+    VolumeIndexEntries = AllocateZeroPool(4 * VolumesCount * sizeof(VOLUME_INDEX_ENTRY));
+    if (VolumeIndexEntries == NULL)
+        return;
+
+    Entry = VolumeIndexEntries;
+    for (i = 0; i < VolumesCount; i++) {
+        Volume = Volumes[i];
+        if (Volume->VolName != NULL) {
+            Entry->VolumeIndex = i;
+            Entry->Name = Volume->VolName;
+            AddVolumeIndexEntry(Entry++, FoldedNameHash(Volume->VolName));
+        }
+        if (Volume->PartName != NULL) {
+            Entry->VolumeIndex = i;
+            Entry->Name = Volume->PartName;
+            AddVolumeIndexEntry(Entry++, FoldedNameHash(Volume->PartName));
+        }
+        Entry->VolumeIndex = i;
+        Entry->Guid = &(Volume->PartGuid);
+        AddVolumeIndexEntry(Entry++, GuidHash(&(Volume->PartGuid)));
+        if (!GuidsAreEqual(&NullGuid, &(Volume->VolUuid))) {
+            Entry->VolumeIndex = i;
+            Entry->Guid = &(Volume->VolUuid);
+            Entry->IsUuid = TRUE;
+            AddVolumeIndexEntry(Entry++, GuidHash(&(Volume->VolUuid)));
+        }
+    } // for
+} // VOID IndexVolumes()
+
+// Returns the index in Volumes[] of the first entry in Entry's bucket that
+// matches Parsed (as a name, a partition GUID, or a filesystem UUID, as
+// specified), or VolumesCount if there's none.
+static UINTN FirstIndexedMatch(IN VOLUME_INDEX_ENTRY *Entry, IN VOLUME_DESCRIPTION *Parsed, IN BOOLEAN WantUuid) {
+    for (; Entry != NULL; Entry = Entry->Next) {
+        if (Parsed->IsGuid) {
+            if ((Entry->Guid != NULL) && (Entry->IsUuid == WantUuid) &&
+                GuidsAreEqual(Entry->Guid, WantUuid ? &(Parsed->Uuid) : &(Parsed->Guid))) {
+                return Entry->VolumeIndex;
+            }
+        } else if ((Entry->Name != NULL) && MyStriCmp(Entry->Name, Parsed->Name)) {
+            return Entry->VolumeIndex;
+        }
+    } // for
+    return VolumesCount;
+} // static UINTN FirstIndexedMatch()
+
 // Finds a volume with the specified Identifier (a filesystem label, a
-// partition name, or a partition GUID). If found, sets *Volume to point
-// to that volume. If not, leaves it unchanged.
+// partition name, a partition GUID, or a filesystem UUID). If found, sets
+// *Volume to point to that volume. If not, leaves it unchanged. If more than
+// one volume matches, the first one in Volumes[] is used.
 // Returns TRUE if a match was found, FALSE if not.
 BOOLEAN FindVolume(REFIT_VOLUME **Volume, CHAR16 *Identifier) {
-    UINTN     i = 0;
-    BOOLEAN   Found = FALSE;
+    VOLUME_DESCRIPTION  Parsed;
+    UINTN               Found, FoundUuid;
 
-    while ((i < VolumesCount) && (!Found)) {
-        if (VolumeMatchesDescription(Volumes[i], Identifier)) {
-            *Volume = Volumes[i];
-            Found = TRUE;
-        } // if
-        i++;
-    } // while()
-    return (Found);
+    if (Identifier == NULL)
+        return FALSE;
+    if ((IndexedVolumes != Volumes) || (IndexedVolumesCount != VolumesCount))
+        IndexVolumes();
+
+    ParseVolumeDescription(Identifier, &Parsed);
+    if (VolumeIndexEntries == NULL) { // out of memory; fall back on a linear search
+        for (Found = 0; (Found < VolumesCount) && !VolumeMatchesParsed(Volumes[Found], &Parsed); Found++)
+            ;
+    } else if (Parsed.IsGuid) {
+        Found = FirstIndexedMatch(VolumeIndex[GuidHash(&(Parsed.Guid)) & (VOLUME_INDEX_BUCKETS - 1)], &Parsed, FALSE);
+        FoundUuid = FirstIndexedMatch(VolumeIndex[GuidHash(&(Parsed.Uuid)) & (VOLUME_INDEX_BUCKETS - 1)], &Parsed, TRUE);
+        if (FoundUuid < Found)
+            Found = FoundUuid;
+    } else {
+        Found = FirstIndexedMatch(VolumeIndex[FoldedNameHash(Identifier) & (VOLUME_INDEX_BUCKETS - 1)], &Parsed, FALSE);
+    }
+
+    if (Found < VolumesCount) {
+        *Volume = Volumes[Found];
+        return TRUE;
+    }
+    return FALSE;
 } // static VOID FindVolume()
 
 // Returns TRUE if Description matches Volume's VolName, PartName, or (once
-// transformed) PartGuid fields, FALSE otherwise (or if either pointer is NULL)
+// transformed) PartGuid or VolUuid fields, FALSE otherwise (or if either
+// pointer is NULL)
 BOOLEAN VolumeMatchesDescription(REFIT_VOLUME *Volume, CHAR16 *Description) {
-    EFI_GUID TargetVolGuid = NULL_GUID_VALUE;
+    VOLUME_DESCRIPTION Parsed;
 
     if ((Volume == NULL) || (Description == NULL))
         return FALSE;
-    if (IsGuid(Description)) {
-        TargetVolGuid = StringAsGuid(Description);
-        return GuidsAreEqual(&TargetVolGuid, &(Volume->PartGuid));
-    } else {
-        return (MyStriCmp(Description, Volume->VolName) || MyStriCmp(Description, Volume->PartName));
-    }
+    ParseVolumeDescription(Description, &Parsed);
+    return VolumeMatchesParsed(Volume, &Parsed);
 } // BOOLEAN VolumeMatchesDescription()
 
+// Number of hash buckets in a COMPILED_PATH_LIST; must be a power of 2
+#define PATH_LIST_BUCKETS 64
+
+// One element of a comma-delimited list of paths (such as dont_scan_files or
+// dont_scan_dirs), split into its parts just once. As with SplitPathName(),
+// VolName, Path, and Filename are NULL when missing. FullPath is everything
+// but the volume, as used for directory comparisons. Element is the whole
+// element, for lists of volumes (such as dont_scan_volumes).
+typedef struct _compiled_path {
+    CHAR16                  *Element;
+    CHAR16                  *VolName;
+    CHAR16                  *Path;
+    CHAR16                  *Filename;
+    CHAR16                  *FullPath;
+    VOLUME_DESCRIPTION      Volume;     // VolName, parsed
+    VOLUME_DESCRIPTION      AsVolume;   // Element, parsed
+    struct _compiled_path   *Next;      // next element in the same bucket
+} COMPILED_PATH;
+
+// A comma-delimited list of paths, compiled so that FilenameIn() and
+// DirectoryIn() needn't split the list (and allocate memory) every time
+// they're called. Elements are hashed by filename, folding case the way
+// MyStriCmp() does; elements with no filename are kept apart, since they
+// may match any filename.
+typedef struct {
+    CHAR16          *Source;            // copy of the list as it was compiled
+    COMPILED_PATH   *Elements;
+    UINTN           ElementCount;
+    COMPILED_PATH   *Buckets[PATH_LIST_BUCKETS];
+    COMPILED_PATH   *NoFilename;
+} COMPILED_PATH_LIST;
+
+static COMPILED_PATH_LIST **CompiledLists = NULL;
+static UINTN              CompiledListCount = 0;
+
+static VOID FreeCompiledPathList(IN COMPILED_PATH_LIST *Compiled) {
+    UINTN i;
+
+    if (Compiled == NULL)
+        return;
+    for (i = 0; i < Compiled->ElementCount; i++) {
+        MyFreePool(Compiled->Elements[i].Element);
+        MyFreePool(Compiled->Elements[i].VolName);
+        MyFreePool(Compiled->Elements[i].Path);
+        MyFreePool(Compiled->Elements[i].Filename);
+        MyFreePool(Compiled->Elements[i].FullPath);
+    } // for
+    MyFreePool(Compiled->Elements);
+    MyFreePool(Compiled->Source);
+    FreePool(Compiled);
+} // static VOID FreeCompiledPathList()
+
+// Forget all the lists compiled by FilenameIn() and DirectoryIn(). Call this
+// whenever the lists may have changed (as at the start of a scan), or to
+// free the memory they use.
+VOID ForgetCompiledLists(VOID) {
+    UINTN i;
+
+    for (i = 0; i < CompiledListCount; i++)
+        FreeCompiledPathList(CompiledLists[i]);
+    MyFreePool(CompiledLists);
+    CompiledLists = NULL;
+    CompiledListCount = 0;
+} // VOID ForgetCompiledLists()
+
+// Returns a compiled version of List, compiling it if it hasn't been seen
+// before. Lists are recognized by their contents, not just their addresses,
+// so a list that's been freed and replaced can't be mistaken for another.
+// Returns NULL if List is NULL or if memory runs out.
+static COMPILED_PATH_LIST *GetCompiledPathList(IN CHAR16 *List) {
+    COMPILED_PATH_LIST  *Compiled;
+    COMPILED_PATH       *Element;
+    CHAR16              *OneElement, *VolName;
+    UINTN               i, Bucket;
+
+    if (List == NULL)
+        return NULL;
+    for (i = 0; i < CompiledListCount; i++) {
+        if (StrCmp(CompiledLists[i]->Source, List) == 0)
+            return CompiledLists[i];
+    } // for
+
+    Compiled = AllocateZeroPool(sizeof(COMPILED_PATH_LIST));
+    if (Compiled == NULL)
+        return NULL;
+    Compiled->Source = StrDuplicate(List);
+    Compiled->ElementCount = 1;
+    for (i = 0; List[i] != L'\0'; i++) {
+        if (List[i] == L',')
+            Compiled->ElementCount++;
+    } // for
+    Compiled->Elements = AllocateZeroPool(Compiled->ElementCount * sizeof(COMPILED_PATH));
+    if ((Compiled->Source == NULL) || (Compiled->Elements == NULL)) {
+        Compiled->ElementCount = 0;
+        FreeCompiledPathList(Compiled);
+        return NULL;
+    }
+
+    for (i = 0; i < Compiled->ElementCount; i++) {
+        Element = &(Compiled->Elements[i]);
+        OneElement = FindCommaDelimited(List, i);
+        if (OneElement == NULL)
+            continue;
+        Element->Element = StrDuplicate(OneElement);
+        ParseVolumeDescription(Element->Element, &(Element->AsVolume));
+        SplitPathName(OneElement, &(Element->VolName), &(Element->Path), &(Element->Filename));
+        if (Element->VolName != NULL)
+            ParseVolumeDescription(Element->VolName, &(Element->Volume));
+        VolName = NULL;
+        SplitVolumeAndFilename(&OneElement, &VolName);
+        CleanUpPathNameSlashes(OneElement);
+        Element->FullPath = OneElement;
+        MyFreePool(VolName);
+        if (Element->Filename != NULL) {
+            Bucket = FoldedNameHash(Element->Filename) & (PATH_LIST_BUCKETS - 1);
+            Element->Next = Compiled->Buckets[Bucket];
+            Compiled->Buckets[Bucket] = Element;
+        } else {
+            Element->Next = Compiled->NoFilename;
+            Compiled->NoFilename = Element;
+        }
+    } // for
+
+    AddListElement((VOID ***) &CompiledLists, &CompiledListCount, Compiled);
+    return Compiled;
+} // static COMPILED_PATH_LIST *GetCompiledPathList()
+
+// Returns TRUE if the compiled list Element matches Volume and Directory.
+static BOOLEAN PathElementMatches(IN COMPILED_PATH *Element, IN REFIT_VOLUME *Volume, IN CHAR16 *Directory) {
+    return (((Element->VolName == NULL) || VolumeMatchesParsed(Volume, &(Element->Volume))) &&
+            ((Element->Path == NULL) || MyStriCmp(Element->Path, Directory)));
+} // static BOOLEAN PathElementMatches()
+
 // Returns TRUE if specified Volume, Directory, and Filename correspond to an
 // element in the comma-delimited List, FALSE otherwise. Note that Directory and
 // Filename must *NOT* include a volume or path specification (that's part of
 // the Volume variable), but the List elements may. Performs comparison
 // case-insensitively.
 BOOLEAN FilenameIn(REFIT_VOLUME *Volume, CHAR16 *Directory, CHAR16 *Filename, CHAR16 *List) {
-    UINTN     i = 0;
-    BOOLEAN   Found = FALSE;
-    CHAR16    *OneElement;
-    CHAR16    *TargetVolName = NULL, *TargetPath = NULL, *TargetFilename = NULL;
+    COMPILED_PATH_LIST  *Compiled;
+    COMPILED_PATH       *Element;
 
-    if (Filename && List) {
-        while (!Found && (OneElement = FindCommaDelimited(List, i++))) {
-            Found = TRUE;
-            SplitPathName(OneElement, &TargetVolName, &TargetPath, &TargetFilename);
-            if (((TargetVolName != NULL) && (!VolumeMatchesDescription(Volume, TargetVolName))) ||
-                 ((TargetPath != NULL) && (!MyStriCmp(TargetPath, Directory))) ||
-                 ((TargetFilename != NULL) && (!MyStriCmp(TargetFilename, Filename)))) {
-                Found = FALSE;
-            } // if
-            MyFreePool(OneElement);
-        } // while
-        MyFreePool(TargetVolName);
-        MyFreePool(TargetPath);
-        MyFreePool(TargetFilename);
-    } // if
+    if ((Filename == NULL) || ((Compiled = GetCompiledPathList(List)) == NULL))
+        return FALSE;
 
-    return Found;
+    for (Element = Compiled->Buckets[FoldedNameHash(Filename) & (PATH_LIST_BUCKETS - 1)]; Element != NULL; Element = Element->Next) {
+        if (MyStriCmp(Element->Filename, Filename) && PathElementMatches(Element, Volume, Directory))
+            return TRUE;
+    } // for
+    for (Element = Compiled->NoFilename; Element != NULL; Element = Element->Next) {
+        if (PathElementMatches(Element, Volume, Directory))
+            return TRUE;
+    } // for
+    return FALSE;
 } // BOOLEAN FilenameIn()
 
+// Returns TRUE if Directory on Volume is named by an element in the
+// comma-delimited List, FALSE otherwise. List elements may include a volume
+// specification, in which case they match only that volume; otherwise they
+// match Directory on any volume. Directory must not include a volume
+// specification. Performs comparison case-insensitively.
+BOOLEAN DirectoryIn(IN REFIT_VOLUME *Volume, IN CHAR16 *Directory, IN CHAR16 *List) {
+    COMPILED_PATH_LIST  *Compiled;
+    UINTN               i;
+
+    if ((Directory == NULL) || ((Compiled = GetCompiledPathList(List)) == NULL))
+        return FALSE;
+
+    for (i = 0; i < Compiled->ElementCount; i++) {
+        if (MyStriCmp(Compiled->Elements[i].FullPath, Directory) &&
+            ((Compiled->Elements[i].VolName == NULL) || VolumeMatchesParsed(Volume, &(Compiled->Elements[i].Volume)))) {
+            return TRUE;
+        } // if
+    } // for
+    return FALSE;
+} // BOOLEAN DirectoryIn()
+
+// Returns TRUE if Volume is identified by an element in the comma-delimited
+// List, by its filesystem label, partition name, partition GUID, or
+// filesystem UUID; FALSE otherwise. Performs comparison case-insensitively.
+BOOLEAN VolumeIn(IN REFIT_VOLUME *Volume, IN CHAR16 *List) {
+    COMPILED_PATH_LIST  *Compiled;
+    UINTN               i;
+
+    if ((Volume == NULL) || ((Compiled = GetCompiledPathList(List)) == NULL))
+        return FALSE;
+
+    for (i = 0; i < Compiled->ElementCount; i++) {
+        if ((Compiled->Elements[i].Element != NULL) && VolumeMatchesParsed(Volume, &(Compiled->Elements[i].AsVolume)))
+            return TRUE;
+    } // for
+    return FALSE;
+} // BOOLEAN VolumeIn()
+
 // Implement FreePool the way it should have been done to begin with, so that
 // it doesn't throw an ASSERT message if fed a NULL pointer....
 VOID MyFreePool(IN VOID *Pointer) {
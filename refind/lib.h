@@ -56,6 +56,7 @@
 #include "global.h"
 
 #include "libeg.h"
+#include "simple_glob.h"
 
 //
 // lib module
@@ -68,8 +69,40 @@ typedef struct {
     EFI_FILE_HANDLE     DirHandle;
     BOOLEAN             CloseDirHandle;
     EFI_FILE_INFO       *LastFileInfo;
+    CHAR16              *PatternSource;  // FilePattern from which Patterns was compiled
+    GLOB_LIST           Patterns;
 } REFIT_DIR_ITER;
 
+// A memory arena: many small allocations carved out of a few large pool
+// blocks, so that scan-time temporaries needn't each go to the firmware's
+// AllocatePool(). Memory is never freed piecemeal; instead, ArenaRelease()
+// frees everything allocated since an ArenaMark(), and ArenaFree() frees it
+// all. Released blocks are kept for reuse until ArenaFree().
+typedef struct _mem_arena_block {
+    struct _mem_arena_block  *Next;
+    UINTN                    Size;    // bytes available for allocations
+    UINTN                    Used;
+} MEM_ARENA_BLOCK;
+
+typedef struct {
+    MEM_ARENA_BLOCK     *Blocks;      // blocks in use, newest first
+    MEM_ARENA_BLOCK     *Spares;      // released blocks, awaiting reuse
+} MEM_ARENA;
+
+typedef struct {
+    MEM_ARENA_BLOCK     *Block;
+    UINTN               Used;
+} MEM_ARENA_MARK;
+
+// Counts of allocations, to show how many AllocatePool() calls the arena
+// and geometric list growth save
+typedef struct {
+    UINTN               ArenaAllocations;  // allocations served by arenas
+    UINTN               ArenaBlocks;       // AllocatePool() calls made by arenas
+    UINTN               ListAllocations;   // AllocatePool()/ReallocatePool() calls made by AddListElement()
+    UINTN               ListAdditions;     // calls to AddListElement()
+} ALLOCATION_COUNTS;
+
 #define DISK_KIND_INTERNAL  (0)
 #define DISK_KIND_EXTERNAL  (1)
 #define DISK_KIND_OPTICAL   (2)
@@ -84,11 +117,17 @@ typedef struct {
 #define GPT_READ_ONLY     0x1000000000000000
 #define GPT_NO_AUTOMOUNT  0x8000000000000000
 
+// Size of each Read() call made by ReadFileFully()
+#define FILE_READ_CHUNK_SIZE (4 * 1024 * 1024)
+
 // Partition names to be ignored when setting volume name
 #define IGNORE_PARTITION_NAMES L"Microsoft basic data,Linux filesystem,Apple HFS/HFS+"
 
 extern EFI_GUID gFreedesktopRootGuid;
 
+extern MEM_ARENA ScanArena;
+extern ALLOCATION_COUNTS AllocationCounts;
+
 EFI_STATUS InitRefitLib(IN EFI_HANDLE ImageHandle);
 VOID UninitRefitLib(VOID);
 EFI_STATUS ReinitRefitLib(VOID);
@@ -101,11 +140,23 @@ VOID CreateList(OUT VOID ***ListPtr, OUT UINTN *ElementCount, IN UINTN InitialEl
 VOID AddListElement(IN OUT VOID ***ListPtr, IN OUT UINTN *ElementCount, IN VOID *NewElement);
 VOID FreeList(IN OUT VOID ***ListPtr, IN OUT UINTN *ElementCount);
 
+VOID *ArenaAlloc(IN OUT MEM_ARENA *Arena, IN UINTN Size);
+CHAR16 *ArenaStrDuplicate(IN OUT MEM_ARENA *Arena, IN CHAR16 *String);
+CHAR16 *ArenaMergeStrings(IN OUT MEM_ARENA *Arena, IN CHAR16 *First, IN CHAR16 *Second, IN CHAR16 AddChar);
+MEM_ARENA_MARK ArenaMark(IN MEM_ARENA *Arena);
+VOID ArenaRelease(IN OUT MEM_ARENA *Arena, IN MEM_ARENA_MARK Mark);
+VOID ArenaFree(IN OUT MEM_ARENA *Arena);
+
 VOID SetVolumeBadgeIcon(REFIT_VOLUME *Volume);
 VOID ScanVolumes(VOID);
+VOID RescanVolumes(VOID);
+EFI_STATUS ReadDiskBlocks(IN EFI_BLOCK_IO *BlockIO, IN EFI_LBA Lba, IN UINTN BufferSize, OUT VOID *Buffer);
+VOID ForgetDiskSectors(VOID);
+VOID IndexVolumes(VOID);
 VOID SetVolumeIcons(VOID);
 
 BOOLEAN FileExists(IN EFI_FILE *BaseDir, IN CHAR16 *RelativePath);
+EFI_STATUS ReadFileFully(IN EFI_FILE_HANDLE FileHandle, OUT VOID *Buffer, IN UINTN Size);
 
 EFI_STATUS DirNextEntry(IN EFI_FILE *Directory, IN OUT EFI_FILE_INFO **DirEntry, IN UINTN FilterMode);
 
@@ -128,6 +179,9 @@ VOID SplitPathName(CHAR16 *InPath, CHAR16 **VolName, CHAR16 **Path, CHAR16 **Fil
 BOOLEAN FindVolume(REFIT_VOLUME **Volume, CHAR16 *Identifier);
 BOOLEAN VolumeMatchesDescription(REFIT_VOLUME *Volume, CHAR16 *Description);
 BOOLEAN FilenameIn(IN REFIT_VOLUME *Volume, IN CHAR16 *Directory, IN CHAR16 *Filename, IN CHAR16 *List);
+BOOLEAN DirectoryIn(IN REFIT_VOLUME *Volume, IN CHAR16 *Directory, IN CHAR16 *List);
+BOOLEAN VolumeIn(IN REFIT_VOLUME *Volume, IN CHAR16 *List);
+VOID ForgetCompiledLists(VOID);
 VOID MyFreePool(IN OUT VOID *Pointer);
 
 BOOLEAN EjectMedia(VOID);
@@ -0,0 +1,198 @@
+/*
+ * refind/log.c
+ * Buffered logging to a file in rEFInd's directory
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Code in refind/ and libeg/ logs messages with the LOG_ERROR(),
+// LOG_WARNING(), LOG_INFO(), and LOG_DEBUG() macros (see log.h), which
+// take Print()-style arguments. Levels above LOG_MAX_LEVEL compile to
+// nothing. Messages are held in memory, in a ring of LOG_BUFFER_SIZE bytes,
+// and are written to LOG_FILENAME only when LogFlush() is called: after the
+// configuration file has been read, at the ends of the later start-up
+// phases, and as a program is launched or rEFInd exits, reboots, or shuts
+// down (or when the ring fills). Writing to a FAT volume is slow, and this
+// keeps logging from slowing down the loops that use it. The log_level
+// option sets the most detailed level written; until the configuration
+// file has been read, every message is held, and the first LogFlush()
+// writes only those at or below that level. With log_level 0 (the
+// default), messages are discarded as soon as the configuration has been
+// read, and later ones aren't even formatted. Each boot starts a new file.
+//
+// In the ring, each message is stored as a byte holding its level, then its
+// text in UTF-8, then a newline.
+
+#include "log.h"
+#include "lib.h"
+#include "mystrings.h"
+#include "../include/refit_call_wrapper.h"
+
+// Most characters in one message
+#define LOG_MESSAGE_SIZE    256
+
+static CHAR8    LogBuffer[LOG_BUFFER_SIZE];
+static UINTN    LogStart = 0;            // offset of the oldest message in LogBuffer
+static UINTN    LogLength = 0;           // bytes held
+static UINTN    LogDropped = 0;          // messages lost since the last write
+static BOOLEAN  LogConfigured = FALSE;   // TRUE once GlobalConfig.LogLevel is known
+static BOOLEAN  LogStarted = FALSE;      // TRUE once this boot's log file has been begun
+
+// Tags that begin each line of the log file, by level
+static CHAR16   *LevelNames[] = { L"", L"E ", L"W ", L"I ", L"D " };
+
+// Number of bytes Char takes up in UTF-8. (Each half of a surrogate pair is
+// encoded separately.)
+static UINTN Utf8Length(IN CHAR16 Char) {
+   if (Char < 0x80)
+      return 1;
+   else if (Char < 0x800)
+      return 2;
+   else
+      return 3;
+} // static UINTN Utf8Length()
+
+static VOID PutByte(IN CHAR8 Byte) {
+   LogBuffer[(LogStart + LogLength++) % LOG_BUFFER_SIZE] = Byte;
+} // static VOID PutByte()
+
+// Forget the oldest message in the ring.
+static VOID DropOldest(VOID) {
+   CHAR8 Byte = 0;
+
+   while ((LogLength > 0) && (Byte != '\n')) {
+      Byte = LogBuffer[LogStart];
+      LogStart = (LogStart + 1) % LOG_BUFFER_SIZE;
+      LogLength--;
+   }
+   LogDropped++;
+} // static VOID DropOldest()
+
+// Add Text, which is followed by Message, to the ring as one message at Level.
+static VOID AddMessage(IN UINTN Level, IN CHAR16 *Text, IN CHAR16 *Message) {
+   UINTN   Size = 2, TextLength, MessageLength, i;
+   CHAR16  Char;
+
+   // Line breaks at the end are dropped (each message gets one); any others
+   // become spaces.
+   MessageLength = StrLen(Message);
+   while ((MessageLength > 0) && ((Message[MessageLength - 1] == L'\n') || (Message[MessageLength - 1] == L'\r')))
+      MessageLength--;
+   TextLength = StrLen(Text);
+   for (i = 0; i < TextLength; i++)
+      Size += Utf8Length(Text[i]);
+   for (i = 0; i < MessageLength; i++)
+      Size += Utf8Length(Message[i]);
+
+   if ((LogLength + Size > LOG_BUFFER_SIZE) && LogConfigured && (GlobalConfig.LogLevel > 0))
+      LogFlush();
+   while (LogLength + Size > LOG_BUFFER_SIZE)
+      DropOldest();
+
+   PutByte((CHAR8) Level);
+   for (i = 0; i < TextLength + MessageLength; i++) {
+      Char = (i < TextLength) ? Text[i] : Message[i - TextLength];
+      if ((Char == L'\n') || (Char == L'\r'))
+         Char = L' ';
+      if (Char < 0x80) {
+         PutByte((CHAR8) Char);
+      } else if (Char < 0x800) {
+         PutByte((CHAR8) (0xC0 | (Char >> 6)));
+         PutByte((CHAR8) (0x80 | (Char & 0x3F)));
+      } else {
+         PutByte((CHAR8) (0xE0 | (Char >> 12)));
+         PutByte((CHAR8) (0x80 | ((Char >> 6) & 0x3F)));
+         PutByte((CHAR8) (0x80 | (Char & 0x3F)));
+      }
+   } // for
+   PutByte('\n');
+} // static VOID AddMessage()
+
+// Log a message at Level (one of the LOG_LEVEL_* values). Use the LOG_*()
+// macros rather than calling this directly, so that unwanted levels can be
+// compiled out.
+VOID LogPrint(IN UINTN Level, IN CHAR16 *Format, ...) {
+   va_list  Args;
+   CHAR16   Message[LOG_MESSAGE_SIZE];
+
+   if ((Level == 0) || (Level > LOG_LEVEL_DEBUG) || (LogConfigured && (Level > GlobalConfig.LogLevel)))
+      return;
+
+   va_start(Args, Format);
+   VSPrint(Message, LOG_MESSAGE_SIZE - 1, Format, Args);
+   va_end(Args);
+   AddMessage(Level, LevelNames[Level], Message);
+} // VOID LogPrint()
+
+// Write the messages held to LOG_FILENAME, if the log_level option calls for
+// any, and empty the ring. This must not be called until the configuration
+// file has been read.
+VOID LogFlush(VOID) {
+   EFI_STATUS       Status;
+   EFI_FILE_HANDLE  LogFile;
+   CHAR8            *Output, Byte;
+   CHAR16           Note[LOG_MESSAGE_SIZE];
+   UINTN            OutputLength = 0, i;
+   BOOLEAN          Keep = FALSE, AtStart = TRUE;
+
+   LogConfigured = TRUE;
+   if ((GlobalConfig.LogLevel == 0) || (SelfDir == NULL)) {
+      LogStart = LogLength = LogDropped = 0;
+      return;
+   }
+   if (LogLength == 0)
+      return;
+
+   Output = AllocatePool(LogLength + LOG_MESSAGE_SIZE);
+   if (Output == NULL)
+      return;
+   if (LogDropped > 0) {
+      SPrint(Note, LOG_MESSAGE_SIZE - 1, L"(%d earlier messages lost)\n", LogDropped);
+      for (i = 0; Note[i] != L'\0'; i++)
+         Output[OutputLength++] = (CHAR8) Note[i];
+   }
+   // Copy the messages at the levels wanted, without their level bytes....
+   for (i = 0; i < LogLength; i++) {
+      Byte = LogBuffer[(LogStart + i) % LOG_BUFFER_SIZE];
+      if (AtStart) {
+         Keep = ((UINTN) Byte <= GlobalConfig.LogLevel);
+         AtStart = FALSE;
+      } else {
+         if (Keep)
+            Output[OutputLength++] = Byte;
+         AtStart = (Byte == '\n');
+      }
+   } // for
+   LogStart = LogLength = LogDropped = 0;
+
+   if (OutputLength > 0) {
+      // Each boot's log replaces the last; egSaveFile() deletes a file when
+      // given no data.
+      if (!LogStarted) {
+         egSaveFile(SelfDir, LOG_FILENAME, NULL, 0);
+         LogStarted = TRUE;
+      }
+      Status = refit_call5_wrapper(SelfDir->Open, SelfDir, &LogFile, LOG_FILENAME,
+                                   EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, 0);
+      if (!EFI_ERROR(Status)) {
+         refit_call2_wrapper(LogFile->SetPosition, LogFile, 0xFFFFFFFFFFFFFFFFULL);
+         refit_call3_wrapper(LogFile->Write, LogFile, &OutputLength, Output);
+         refit_call1_wrapper(LogFile->Close, LogFile);
+      }
+   } // if
+   FreePool(Output);
+} // VOID LogFlush()
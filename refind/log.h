@@ -0,0 +1,74 @@
+/*
+ * refind/log.h
+ * Buffered logging to a file in rEFInd's directory
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __LOG_H_
+#define __LOG_H_
+
+#ifdef __MAKEWITH_GNUEFI
+#include "efi.h"
+#include "efilib.h"
+#else
+#include "../include/tiano_includes.h"
+#endif
+#include "global.h"
+
+// Message levels, from most to least serious; the log_level option sets
+// the most detailed level written to the log file
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_WARNING   2
+#define LOG_LEVEL_INFO      3
+#define LOG_LEVEL_DEBUG     4
+
+// Messages more detailed than this aren't compiled in at all
+#ifndef LOG_MAX_LEVEL
+#if REFIT_DEBUG > 0
+#define LOG_MAX_LEVEL       LOG_LEVEL_DEBUG
+#else
+#define LOG_MAX_LEVEL       LOG_LEVEL_INFO
+#endif
+#endif
+
+// Bytes of messages held in memory between writes to the log file
+#define LOG_BUFFER_SIZE     (64 * 1024)
+// Name of the log file in rEFInd's directory
+#define LOG_FILENAME        L"refind.log"
+
+#define LOG_ERROR(...)      LogPrint(LOG_LEVEL_ERROR, __VA_ARGS__)
+#if LOG_MAX_LEVEL >= LOG_LEVEL_WARNING
+#define LOG_WARNING(...)    LogPrint(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...)
+#endif
+#if LOG_MAX_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...)       LogPrint(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...)
+#endif
+#if LOG_MAX_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...)      LogPrint(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...)
+#endif
+
+VOID LogPrint(IN UINTN Level, IN CHAR16 *Format, ...);
+VOID LogFlush(VOID);
+
+#endif
@@ -70,6 +70,13 @@
 #include "security_policy.h"
 #include "driver_support.h"
 #include "hash.h"
+#include "scancache.h"
+#include "drivermanifest.h"
+#include "trace.h"
+#include "log.h"
+#include "crc32.h"
+#include "initrd.h"
+#include "prefetch.h"
 #include "../include/Handle.h"
 #include "../include/refit_call_wrapper.h"
 #include "../include/version.h"
@@ -174,6 +181,12 @@ REFIT_CONFIG GlobalConfig = { /* TextOnly = */ FALSE,
                               /* HiddenTags = */ TRUE,
                               /* UseNvram = */ TRUE,
                               /* ShutdownAfterTimeout = */ FALSE,
+                              /* ShadowFramebuffer = */ FALSE,
+                              /* ScanCache = */ FALSE,
+                              /* PreloadLoaders = */ FALSE,
+                              /* DriverManifest = */ FALSE,
+                              /* BootTrace = */ FALSE,
+                              /* ProgressiveMenu = */ FALSE,
                               /* RequestedScreenWidth = */ 0,
                               /* RequestedScreenHeight = */ 0,
                               /* BannerBottomEdge = */ 0,
@@ -186,6 +199,7 @@ REFIT_CONFIG GlobalConfig = { /* TextOnly = */ FALSE,
                               /* ScanDelay = */ 0,
                               /* ScreensaverTime = */ 0,
                               /* MouseSpeed = */ 4,
+                              /* LogLevel = */ 0,
                               /* IconSizes = */ { DEFAULT_BIG_ICON_SIZE / 4,
                                                   DEFAULT_SMALL_ICON_SIZE,
                                                   DEFAULT_BIG_ICON_SIZE,
@@ -222,6 +236,20 @@ EFI_GUID RefindGuid = REFIND_GUID_VALUE;
 
 GPT_DATA *gPartitions = NULL;
 
+// Number of bytes at the start of a file examined by HasLoaderHeader()
+#define LOADER_HEADER_SIZE 512
+
+// What ScanLoaderDir() knows about a candidate boot loader file, as found by
+// IsUsableLoader() with a single Open() call. Every check on the candidate
+// uses this rather than opening the file again.
+typedef struct {
+    UINT64      FileSize;
+    EFI_TIME    ModificationTime;
+    UINT32      HeaderCrc;  // CRC of the first LOADER_HEADER_SIZE bytes
+    BOOLEAN     IsSymLink;
+    BOOLEAN     IsLoader;
+} LOADER_INSPECTION;
+
 // Structure used to hold boot loader filenames and time stamps in
 // a linked list; used to sort entries within a directory.
 struct LOADER_LIST {
@@ -307,13 +335,29 @@ static VOID WarnSecureBootError(CHAR16 *Name, BOOLEAN Verbose) {
     } // if
 } // VOID WarnSecureBootError()
 
+// Returns TRUE if Header (the first Size bytes of a file) is that of a valid
+// EFI loader file of the proper ARCH
+static BOOLEAN HasLoaderHeader(CHAR8 *Header, UINTN Size) {
+    BOOLEAN         IsValid = TRUE;
+#if defined (EFIX64) | defined (EFI32) | defined (EFIAARCH64)
+    IsValid = Size == LOADER_HEADER_SIZE &&
+              ((Header[0] == 'M' && Header[1] == 'Z' &&
+               (Size = *(UINT32 *)&Header[0x3c]) < 0x180 &&
+               Header[Size] == 'P' && Header[Size+1] == 'E' &&
+               Header[Size+2] == 0 && Header[Size+3] == 0 &&
+               *(UINT16 *)&Header[Size+4] == EFI_STUB_ARCH) ||
+              (*(UINT32 *)&Header == FAT_ARCH));
+#endif
+    return IsValid;
+} // BOOLEAN HasLoaderHeader()
+
 // Returns TRUE if this file is a valid EFI loader file, and is proper ARCH
 static BOOLEAN IsValidLoader(EFI_FILE *RootDir, CHAR16 *FileName) {
     BOOLEAN         IsValid = TRUE;
 #if defined (EFIX64) | defined (EFI32) | defined (EFIAARCH64)
     EFI_STATUS      Status;
     EFI_FILE_HANDLE FileHandle;
-    CHAR8           Header[512];
+    CHAR8           Header[LOADER_HEADER_SIZE];
     UINTN           Size = sizeof(Header);
 
     if ((RootDir == NULL) || (FileName == NULL)) {
@@ -330,26 +374,78 @@ static BOOLEAN IsValidLoader(EFI_FILE *RootDir, CHAR16 *FileName) {
     Status = refit_call3_wrapper(FileHandle->Read, FileHandle, &Size, Header);
     refit_call1_wrapper(FileHandle->Close, FileHandle);
 
-    IsValid = !EFI_ERROR(Status) &&
-              Size == sizeof(Header) &&
-              ((Header[0] == 'M' && Header[1] == 'Z' &&
-               (Size = *(UINT32 *)&Header[0x3c]) < 0x180 &&
-               Header[Size] == 'P' && Header[Size+1] == 'E' &&
-               Header[Size+2] == 0 && Header[Size+3] == 0 &&
-               *(UINT16 *)&Header[Size+4] == EFI_STUB_ARCH) ||
-              (*(UINT32 *)&Header == FAT_ARCH));
+    IsValid = !EFI_ERROR(Status) && HasLoaderHeader(Header, Size);
 #endif
     return IsValid;
 } // BOOLEAN IsValidLoader()
 
-// Launch an EFI binary.
+// Largest boot loader that will be read into memory before launch
+#define PRELOAD_MAX_SIZE   (1024 * 1024 * 1024)
+
+// Reads FileName from Volume into memory, in large pieces (or takes it from
+// the files read ahead during the menu timeout), so that it can be passed to
+// LoadImage() as a SourceBuffer rather than having the firmware read it
+// again. On success, *ImageData (which the caller must free) holds the whole
+// file, and *ImageSize is its length.
+static EFI_STATUS PreloadImage(IN REFIT_VOLUME *Volume, IN CHAR16 *FileName,
+                               OUT VOID **ImageData, OUT UINTN *ImageSize) {
+    EFI_STATUS      Status;
+    EFI_FILE_HANDLE FileHandle;
+    EFI_FILE_INFO   *FileInfo;
+    UINT8           *Buffer;
+    UINTN           Size;
+
+    *ImageData = NULL;
+    *ImageSize = 0;
+    if ((Volume->RootDir == NULL) || (FileName == NULL))
+        return EFI_NOT_FOUND;
+    if (PrefetchTake(Volume, FileName, &Buffer, &Size)) {
+        *ImageData = Buffer;
+        *ImageSize = Size;
+        return EFI_SUCCESS;
+    }
+
+    Status = refit_call5_wrapper(Volume->RootDir->Open, Volume->RootDir, &FileHandle, FileName, EFI_FILE_MODE_READ, 0);
+    if (EFI_ERROR(Status))
+        return Status;
+
+    FileInfo = LibFileInfo(FileHandle);
+    if ((FileInfo == NULL) || (FileInfo->FileSize == 0) || (FileInfo->FileSize > PRELOAD_MAX_SIZE)) {
+        MyFreePool(FileInfo);
+        refit_call1_wrapper(FileHandle->Close, FileHandle);
+        return EFI_UNSUPPORTED;
+    }
+    Size = (UINTN) FileInfo->FileSize;
+    FreePool(FileInfo);
+
+    Buffer = AllocatePool(Size);
+    if (Buffer == NULL) {
+        refit_call1_wrapper(FileHandle->Close, FileHandle);
+        return EFI_OUT_OF_RESOURCES;
+    }
+
+    Status = ReadFileFully(FileHandle, Buffer, Size);
+    refit_call1_wrapper(FileHandle->Close, FileHandle);
+
+    if (EFI_ERROR(Status)) {
+        FreePool(Buffer);
+        return Status;
+    }
+    *ImageData = Buffer;
+    *ImageSize = Size;
+    return EFI_SUCCESS;
+} // static EFI_STATUS PreloadImage()
+
+// Launch an EFI binary. For a driver that starts successfully, its image
+// handle is returned in *NewImageHandle, if that's not NULL.
 EFI_STATUS StartEFIImage(IN REFIT_VOLUME *Volume,
                          IN CHAR16 *Filename,
                          IN CHAR16 *LoadOptions,
                          IN CHAR16 *ImageTitle,
                          IN CHAR8 OSType,
                          IN BOOLEAN Verbose,
-                         IN BOOLEAN IsDriver)
+                         IN BOOLEAN IsDriver,
+                         OUT EFI_HANDLE *NewImageHandle OPTIONAL)
 {
     EFI_STATUS              Status, ReturnStatus;
     EFI_HANDLE              ChildImageHandle, ChildImageHandle2;
@@ -358,6 +454,12 @@ EFI_STATUS StartEFIImage(IN REFIT_VOLUME *Volume,
     CHAR16                  ErrorInfo[256];
     CHAR16                  *FullLoadOptions = NULL;
     CHAR16                  *Temp;
+    VOID                    *ImageData = NULL;
+    UINTN                   ImageSize = 0;
+    BOOLEAN                 IsValid, Preloaded = FALSE;
+
+    if (NewImageHandle != NULL)
+        *NewImageHandle = NULL;
 
     // set load options
     if (LoadOptions != NULL) {
@@ -376,7 +478,21 @@ EFI_STATUS StartEFIImage(IN REFIT_VOLUME *Volume,
     // Some EFIs crash if attempting to load driver for invalid architecture, so
     // protect for this condition; but sometimes Volume comes back NULL, so provide
     // an exception. (TODO: Handle this special condition better.)
-    if (IsValidLoader(Volume->RootDir, Filename)) {
+    // When preload_loaders is set, the loader is read into memory here, in large
+    // pieces, and validated from there, so that it's opened only once. Apple
+    // "fat" binaries are still left to the firmware to read.
+    if (GlobalConfig.PreloadLoaders && !IsDriver &&
+        (PreloadImage(Volume, Filename, &ImageData, &ImageSize) == EFI_SUCCESS)) {
+        IsValid = HasLoaderHeader((CHAR8 *) ImageData, (ImageSize < LOADER_HEADER_SIZE) ? ImageSize : LOADER_HEADER_SIZE);
+        if ((ImageSize >= sizeof(UINT32)) && (*(UINT32 *) ImageData == FAT_ARCH)) {
+            MyFreePool(ImageData);
+            ImageData = NULL;
+            ImageSize = 0;
+        }
+    } else {
+        IsValid = IsValidLoader(Volume->RootDir, Filename);
+    }
+    if (IsValid) {
         if (Filename) {
             Temp = PoolPrint(L"\\%s %s", Filename, FullLoadOptions ? FullLoadOptions : L"");
             if (Temp != NULL) {
@@ -386,15 +502,24 @@ EFI_STATUS StartEFIImage(IN REFIT_VOLUME *Volume,
         } // if (Filename)
 
         DevicePath = FileDevicePath(Volume->DeviceHandle, Filename);
-        // NOTE: Below commented-out line could be more efficient if file were read ahead of
-        // time and passed as a pre-loaded image to LoadImage(), but it doesn't work on my
-        // 32-bit Mac Mini or my 64-bit Intel box when launching a Linux kernel; the
-        // kernel returns a "Failed to handle fs_proto" error message.
-        // TODO: Track down the cause of this error and fix it, if possible.
-        // ReturnStatus = Status = refit_call6_wrapper(BS->LoadImage, FALSE, SelfImageHandle, DevicePath,
-        //                                            ImageData, ImageSize, &ChildImageHandle);
+        // NOTE: When ImageData is NULL, the firmware reads the file itself. When it's
+        // a pre-loaded image, some firmware doesn't set the new image's DeviceHandle,
+        // which a Linux kernel needs to read its initrd (it fails with "Failed to
+        // handle fs_proto"); that's corrected below. If the firmware rejects the
+        // pre-loaded image for any reason other than Secure Boot, try the file.
         ReturnStatus = Status = refit_call6_wrapper(BS->LoadImage, FALSE, SelfImageHandle, DevicePath,
-                                                    NULL, 0, &ChildImageHandle);
+                                                    ImageData, ImageSize, &ChildImageHandle);
+        if ((ImageData != NULL) && EFI_ERROR(Status) &&
+            (Status != EFI_ACCESS_DENIED) && (Status != EFI_SECURITY_VIOLATION)) {
+            MyFreePool(ImageData);
+            ImageData = NULL;
+            ReturnStatus = Status = refit_call6_wrapper(BS->LoadImage, FALSE, SelfImageHandle, DevicePath,
+                                                        NULL, 0, &ChildImageHandle);
+        }
+        // The firmware has its own copy of the image now.
+        Preloaded = (ImageData != NULL);
+        MyFreePool(ImageData);
+        ImageData = NULL;
         if (secure_mode() && ShimLoaded()) {
             // Load ourself into memory. This is a trick to work around a bug in Shim 0.8,
             // which ties itself into the BS->LoadImage() and BS->StartImage() functions and
@@ -413,9 +538,11 @@ EFI_STATUS StartEFIImage(IN REFIT_VOLUME *Volume,
         }
     } else {
         Print(L"Invalid loader file!\n");
+        LOG_WARNING(L"%s isn't a valid EFI program for this computer", Filename);
         ReturnStatus = EFI_LOAD_ERROR;
     }
     if ((Status == EFI_ACCESS_DENIED) || (Status == EFI_SECURITY_VIOLATION)) {
+        LOG_WARNING(L"Secure Boot refused to load %s: %r", Filename, Status);
         WarnSecureBootError(ImageTitle, Verbose);
         goto bailout;
     }
@@ -429,12 +556,25 @@ EFI_STATUS StartEFIImage(IN REFIT_VOLUME *Volume,
     if (CheckError(Status, L"while getting a LoadedImageProtocol handle")) {
         goto bailout_unload;
     }
+    if (Preloaded && (Volume->DeviceHandle != NULL) &&
+        (ChildLoadedImage->DeviceHandle != Volume->DeviceHandle)) {
+        // Publish the volume and file the pre-loaded image came from, as the
+        // firmware would have done had it read the file itself.
+        ChildLoadedImage->DeviceHandle = Volume->DeviceHandle;
+        ChildLoadedImage->FilePath = FileDevicePath(NULL, Filename);
+    }
     ChildLoadedImage->LoadOptions = (VOID *)FullLoadOptions;
     ChildLoadedImage->LoadOptionsSize = FullLoadOptions ? ((UINT32)StrLen(FullLoadOptions) + 1) * sizeof(CHAR16) : 0;
     // turn control over to the image
     // TODO: (optionally) re-enable the EFI watchdog timer!
 
-    // close open file handles
+    // close open file handles, including any left from reading ahead
+    PrefetchForget();
+    if (!IsDriver) {
+        LOG_INFO(L"Starting %s (%s)", Filename, ImageTitle);
+        TraceSave();
+        LogFlush();
+    }
     UninitRefitLib();
     ReturnStatus = Status = refit_call3_wrapper(BS->StartImage, ChildImageHandle, NULL, NULL);
 
@@ -446,6 +586,8 @@ EFI_STATUS StartEFIImage(IN REFIT_VOLUME *Volume,
         // around bug with some EFIs that prevents filesystem drivers
         // from binding to partitions.
         ConnectFilesystemDriver(ChildImageHandle);
+        if ((NewImageHandle != NULL) && !EFI_ERROR(Status))
+            *NewImageHandle = ChildImageHandle;
     }
 
     // re-open file handles
@@ -457,6 +599,7 @@ bailout_unload:
         Status = refit_call1_wrapper(BS->UnloadImage, ChildImageHandle);
 
 bailout:
+    MyFreePool(ImageData);
     MyFreePool(FullLoadOptions);
     return ReturnStatus;
 } /* EFI_STATUS StartEFIImage() */
@@ -534,8 +677,14 @@ static VOID StartLoader(LOADER_ENTRY *Entry, CHAR16 *SelectionName)
 
     BeginExternalScreen(Entry->UseGraphicsMode, L"Booting OS");
     StoreLoaderName(SelectionName);
+    // ELILO reads its own "initrd=" files; anything else given one may be a
+    // Linux kernel that can take it from memory instead.
+    if (GlobalConfig.PreloadLoaders && (Entry->OSType != 'E') &&
+        (InitrdPreload(Entry->Volume, Entry->LoadOptions) == EFI_SUCCESS))
+        InitrdPublish();
     StartEFIImage(Entry->Volume, Entry->LoaderPath, Entry->LoadOptions,
-                  Basename(Entry->LoaderPath), Entry->OSType, !Entry->UseGraphicsMode, FALSE);
+                  Basename(Entry->LoaderPath), Entry->OSType, !Entry->UseGraphicsMode, FALSE, NULL);
+    InitrdWithdraw();
     FinishExternalScreen();
 }
 
@@ -707,12 +856,11 @@ LOADER_ENTRY *InitializeLoaderEntry(IN LOADER_ENTRY *Entry) {
 	  //add new entries, (in AddListElement) so we don't want do a
 	  //reallocate of size X in the subentry and size Y in the main
 	  //entry.
+	  //The copy is built with AddListElement() so that it has the
+	  //capacity AddListElement() expects when more are added later.
 	  if(Entry->HashPaths != NULL) {
-	    NewEntry->HashPaths       = AllocatePool((sizeof(CHAR16 *) * Entry->HashPathsCount));
-	    if(NewEntry->HashPaths != NULL) {
-	      CopyMem(NewEntry->HashPaths, Entry->HashPaths, sizeof(CHAR16 *) * Entry->HashPathsCount);
-	      NewEntry->HashPathsCount = Entry->HashPathsCount;
-	    }
+	    for(UINTN i = 0; i < Entry->HashPathsCount; i++)
+	      AddListElement((VOID ***)&(NewEntry->HashPaths), &(NewEntry->HashPathsCount), Entry->HashPaths[i]);
 	  }
 	
 	  NewEntry->LoaderPath      = (Entry->LoaderPath) ? StrDuplicate(Entry->LoaderPath) : NULL;
@@ -1191,13 +1339,11 @@ static VOID AddKernelToSubmenu(LOADER_ENTRY * TargetLoader, CHAR16 *FileName, RE
         SubScreen = TargetLoader->me.SubScreen;
         InitrdName = FindInitrd(FileName, Volume);
         KernelVersion = FindNumbers(FileName);
+        SplitPathName(FileName, &VolName, &Path, &SubmenuName);
         while ((TokenCount = ReadTokenLine(File, &TokenList)) > 1) {
             ReplaceSubstring(&(TokenList[1]), KERNEL_VERSION, KernelVersion);
             SubEntry = InitializeLoaderEntry(TargetLoader);
-            SplitPathName(FileName, &VolName, &Path, &SubmenuName);
-            MergeStrings(&SubmenuName, L": ", '\0');
-            MergeStrings(&SubmenuName, TokenList[0] ? StrDuplicate(TokenList[0]) : StrDuplicate(L"Boot Linux"), '\0');
-            Title = StrDuplicate(SubmenuName);
+            Title = PoolPrint(L"%s: %s", SubmenuName ? SubmenuName : L"", TokenList[0] ? TokenList[0] : L"Boot Linux");
             LimitStringLength(Title, MAX_LINE_LENGTH);
             SubEntry->me.Title = Title;
             MyFreePool(SubEntry->LoadOptions);
@@ -1270,36 +1416,17 @@ static struct LOADER_LIST * AddLoaderListEntry(struct LOADER_LIST *LoaderList, s
     return (LatestEntry);
 } // static VOID AddLoaderListEntry()
 
-// Delete the LOADER_LIST linked list
-static VOID CleanUpLoaderList(struct LOADER_LIST *LoaderList) {
-    struct LOADER_LIST *Temp;
-
-    while (LoaderList != NULL) {
-        Temp = LoaderList;
-        LoaderList = LoaderList->NextEntry;
-        MyFreePool(Temp->FileName);
-        MyFreePool(Temp);
-    } // while
-} // static VOID CleanUpLoaderList()
-
 // Returns FALSE if the specified file/volume matches the GlobalConfig.DontScanDirs
 // or GlobalConfig.DontScanVolumes specification, or if Path points to a volume
 // other than the one specified by Volume, or if the specified path is SelfDir.
 // Returns TRUE if none of these conditions is met -- that is, if the path is
 // eligible for scanning.
 static BOOLEAN ShouldScan(REFIT_VOLUME *Volume, CHAR16 *Path) {
-    CHAR16   *VolName = NULL, *DontScanDir, *PathCopy = NULL, *VolGuid = NULL;
-    UINTN    i = 0;
+    CHAR16   *VolName = NULL, *PathCopy = NULL;
     BOOLEAN  ScanIt = TRUE;
 
-    VolGuid = GuidAsString(&(Volume->PartGuid));
-    if ((IsIn(Volume->VolName, GlobalConfig.DontScanVolumes)) || (IsIn(Volume->PartName, GlobalConfig.DontScanVolumes)) ||
-        (IsIn(VolGuid, GlobalConfig.DontScanVolumes))) {
-        MyFreePool(VolGuid);
+    if (VolumeIn(Volume, GlobalConfig.DontScanVolumes))
         return FALSE;
-    } else {
-        MyFreePool(VolGuid);
-    } // if/else
 
     if (MyStriCmp(Path, SelfDirPath) && (Volume->DeviceHandle == SelfVolume->DeviceHandle))
         return FALSE;
@@ -1316,112 +1443,252 @@ static BOOLEAN ShouldScan(REFIT_VOLUME *Volume, CHAR16 *Path) {
     VolName = NULL;
 
     // See if Volume is in GlobalConfig.DontScanDirs....
-    while (ScanIt && (DontScanDir = FindCommaDelimited(GlobalConfig.DontScanDirs, i++))) {
-        SplitVolumeAndFilename(&DontScanDir, &VolName);
-        CleanUpPathNameSlashes(DontScanDir);
-        if (VolName != NULL) {
-            if (VolumeMatchesDescription(Volume, VolName) && MyStriCmp(DontScanDir, Path))
-                ScanIt = FALSE;
-        } else {
-            if (MyStriCmp(DontScanDir, Path))
-                ScanIt = FALSE;
-        }
-        MyFreePool(DontScanDir);
-        MyFreePool(VolName);
-        DontScanDir = NULL;
-        VolName = NULL;
-    } // while()
+    if (ScanIt && DirectoryIn(Volume, Path, GlobalConfig.DontScanDirs))
+        ScanIt = FALSE;
 
     return ScanIt;
 } // BOOLEAN ShouldScan()
 
-// Returns TRUE if the file is byte-for-byte identical with the fallback file
-// on the volume AND if the file is not itself the fallback file; returns
-// FALSE if the file is not identical to the fallback file OR if the file
-// IS the fallback file. Intended for use in excluding the fallback boot
-// loader when it's a duplicate of another boot loader.
-static BOOLEAN DuplicatesFallback(IN REFIT_VOLUME *Volume, IN CHAR16 *FileName) {
-    CHAR8           *FileContents, *FallbackContents;
-    EFI_FILE_HANDLE FileHandle, FallbackHandle;
-    EFI_FILE_INFO   *FileInfo, *FallbackInfo;
-    UINTN           FileSize = 0, FallbackSize = 0;
-    EFI_STATUS      Status;
-    BOOLEAN         AreIdentical = FALSE;
+// Reads the first LOADER_HEADER_SIZE bytes of the file open as FileHandle
+// into Header, setting *Size to the number read (0 if the read fails), and
+// returns their CRC. The scan cache checks this as well as the file's size
+// and time stamp, and files whose header CRCs differ can't be identical.
+static UINT32 ReadLoaderHeader(IN EFI_FILE_HANDLE FileHandle, OUT CHAR8 *Header, OUT UINTN *Size) {
+    EFI_STATUS Status;
 
-    if (!FileExists(Volume->RootDir, FileName) || !FileExists(Volume->RootDir, FALLBACK_FULLNAME))
-        return FALSE;
+    *Size = LOADER_HEADER_SIZE;
+    Status = refit_call3_wrapper(FileHandle->Read, FileHandle, Size, Header);
+    if (EFI_ERROR(Status))
+        *Size = 0;
+    return crc32(0x0, Header, *Size);
+} // UINT32 ReadLoaderHeader()
+
+// Size of the pieces in which DuplicatesFallback() reads files
+#define FALLBACK_CHUNK_SIZE 65536
+
+// What's known about one volume's fallback boot loader, so that its CRCs
+// need be computed only once, however many boot loaders on the volume are
+// compared to it. Forgotten at the start and end of each scan.
+typedef struct {
+    REFIT_VOLUME  *Volume;
+    BOOLEAN       Exists;
+    UINT64        FileSize;
+    EFI_TIME      ModificationTime;
+    UINT32        HeaderCrc;  // CRC of the first LOADER_HEADER_SIZE bytes
+    UINT32        *ChunkCrcs; // CRC of each FALLBACK_CHUNK_SIZE piece; NULL until needed
+} FALLBACK_DIGEST;
+
+static FALLBACK_DIGEST FallbackDigest;
+
+static VOID ForgetFallbackDigest(VOID) {
+    MyFreePool(FallbackDigest.ChunkCrcs);
+    SetMem(&FallbackDigest, sizeof(FALLBACK_DIGEST), 0);
+} // VOID ForgetFallbackDigest()
+
+// Reads FileSize bytes from FileHandle in FALLBACK_CHUNK_SIZE pieces and
+// computes the CRC of each piece. If FallbackHandle is NULL, the CRCs are
+// stored in ChunkCrcs. Otherwise they're compared to those in ChunkCrcs,
+// and when a piece's CRC matches, the same piece of the fallback boot
+// loader is read from FallbackHandle and the two are compared byte for
+// byte, so that the CRCs serve only to reject differing files quickly.
+// Reading stops at the first mismatch. Returns TRUE if the whole file was
+// read and (when comparing) every piece matched.
+static BOOLEAN StreamChunkCrcs(IN EFI_FILE_HANDLE FileHandle, IN UINT64 FileSize,
+                               IN OUT UINT32 *ChunkCrcs, IN EFI_FILE_HANDLE FallbackHandle OPTIONAL) {
+    UINT8       *Buffer, *FallbackBuffer = NULL;
+    UINTN       ChunkSize, ReadSize, i = 0;
+    UINT32      Crc;
+    EFI_STATUS  Status;
+    BOOLEAN     Result = TRUE;
+
+    Buffer = AllocatePool(FALLBACK_CHUNK_SIZE);
+    if (FallbackHandle != NULL)
+        FallbackBuffer = AllocatePool(FALLBACK_CHUNK_SIZE);
+    if ((Buffer == NULL) || ((FallbackHandle != NULL) && (FallbackBuffer == NULL)))
+        Result = FALSE;
+
+    while (Result && (FileSize > 0)) {
+        ChunkSize = (FileSize > FALLBACK_CHUNK_SIZE) ? FALLBACK_CHUNK_SIZE : (UINTN) FileSize;
+        ReadSize = ChunkSize;
+        Status = refit_call3_wrapper(FileHandle->Read, FileHandle, &ReadSize, Buffer);
+        if (EFI_ERROR(Status) || (ReadSize != ChunkSize)) {
+            Result = FALSE;
+        } else {
+            Crc = crc32(0x0, Buffer, ChunkSize);
+            if (FallbackHandle == NULL) {
+                ChunkCrcs[i] = Crc;
+            } else if (Crc != ChunkCrcs[i]) {
+                Result = FALSE;
+            } else {
+                ReadSize = ChunkSize;
+                Status = refit_call3_wrapper(FallbackHandle->Read, FallbackHandle, &ReadSize, FallbackBuffer);
+                Result = !EFI_ERROR(Status) && (ReadSize == ChunkSize) &&
+                         (CompareMem(Buffer, FallbackBuffer, ChunkSize) == 0);
+            } // if/else
+        } // if/else
+        FileSize -= ChunkSize;
+        i++;
+    } // while
 
-    CleanUpPathNameSlashes(FileName);
+    MyFreePool(Buffer);
+    MyFreePool(FallbackBuffer);
+    return Result;
+} // BOOLEAN StreamChunkCrcs()
+
+// Makes FallbackDigest describe Volume's fallback boot loader, opening it
+// only if FallbackDigest currently describes some other volume. Returns
+// TRUE if the volume has a fallback boot loader.
+static BOOLEAN GetFallbackInfo(IN REFIT_VOLUME *Volume) {
+    EFI_FILE_HANDLE FallbackHandle;
+    EFI_FILE_INFO   *FallbackInfo;
+    EFI_STATUS      Status;
+    CHAR8           Header[LOADER_HEADER_SIZE];
+    UINTN           Size;
 
-    if (MyStriCmp(FileName, FALLBACK_FULLNAME))
-        return FALSE; // identical filenames, so not a duplicate....
+    if (FallbackDigest.Volume == Volume)
+        return FallbackDigest.Exists;
 
-    Status = refit_call5_wrapper(Volume->RootDir->Open, Volume->RootDir, &FileHandle, FileName, EFI_FILE_MODE_READ, 0);
+    ForgetFallbackDigest();
+    FallbackDigest.Volume = Volume;
+    Status = refit_call5_wrapper(Volume->RootDir->Open, Volume->RootDir, &FallbackHandle, FALLBACK_FULLNAME, EFI_FILE_MODE_READ, 0);
     if (Status == EFI_SUCCESS) {
-        FileInfo = LibFileInfo(FileHandle);
-        FileSize = FileInfo->FileSize;
-    } else {
+        FallbackInfo = LibFileInfo(FallbackHandle);
+        if (FallbackInfo != NULL) {
+            FallbackDigest.Exists = TRUE;
+            FallbackDigest.FileSize = FallbackInfo->FileSize;
+            CopyMem(&FallbackDigest.ModificationTime, &FallbackInfo->ModificationTime, sizeof(EFI_TIME));
+            FallbackDigest.HeaderCrc = ReadLoaderHeader(FallbackHandle, Header, &Size);
+            MyFreePool(FallbackInfo);
+        }
+        refit_call1_wrapper(FallbackHandle->Close, FallbackHandle);
+    } // if
+    return FallbackDigest.Exists;
+} // BOOLEAN GetFallbackInfo()
+
+// Fills in FallbackDigest.ChunkCrcs for the volume last passed to
+// GetFallbackInfo(), reading the fallback boot loader if that hasn't been
+// done already. Returns TRUE if the CRCs are available.
+static BOOLEAN GetFallbackCrcs(VOID) {
+    EFI_FILE_HANDLE FallbackHandle;
+    EFI_STATUS      Status;
+    UINTN           ChunkCount;
+    REFIT_VOLUME    *Volume = FallbackDigest.Volume;
+
+    if (FallbackDigest.ChunkCrcs != NULL)
+        return TRUE;
+    if (!FallbackDigest.Exists)
         return FALSE;
-    }
 
     Status = refit_call5_wrapper(Volume->RootDir->Open, Volume->RootDir, &FallbackHandle, FALLBACK_FULLNAME, EFI_FILE_MODE_READ, 0);
-    if (Status == EFI_SUCCESS) {
-        FallbackInfo = LibFileInfo(FallbackHandle);
-        FallbackSize = FallbackInfo->FileSize;
-    } else {
-        refit_call1_wrapper(FileHandle->Close, FileHandle);
+    if (Status != EFI_SUCCESS)
         return FALSE;
+    ChunkCount = (UINTN) ((FallbackDigest.FileSize + FALLBACK_CHUNK_SIZE - 1) / FALLBACK_CHUNK_SIZE);
+    FallbackDigest.ChunkCrcs = AllocatePool(sizeof(UINT32) * (ChunkCount + 1));
+    if ((FallbackDigest.ChunkCrcs != NULL) &&
+        !StreamChunkCrcs(FallbackHandle, FallbackDigest.FileSize, FallbackDigest.ChunkCrcs, NULL)) {
+        MyFreePool(FallbackDigest.ChunkCrcs);
+        FallbackDigest.ChunkCrcs = NULL;
     }
+    refit_call1_wrapper(FallbackHandle->Close, FallbackHandle);
+    return (FallbackDigest.ChunkCrcs != NULL);
+} // BOOLEAN GetFallbackCrcs()
+
+// Returns TRUE if the file, which is FileSize bytes long, was last modified
+// at FileTime, and has a header CRC of HeaderCrc, is byte-for-byte identical
+// with the fallback file on the volume AND if the file is not itself the
+// fallback file. The file is opened only if its size and header CRC match
+// the fallback's, and is read only up to the first chunk that differs. Per-chunk CRCs of the fallback, read once
+// per volume, reject most differing chunks; the fallback itself is read
+// again only to check the bytes of chunks whose CRCs match.
+// CAUTION: *FileName MUST be properly cleaned up (via CleanUpPathNameSlashes())
+static BOOLEAN LoaderDuplicatesFallback(IN REFIT_VOLUME *Volume, IN CHAR16 *FileName,
+                                        IN UINT64 FileSize, IN EFI_TIME *FileTime, IN UINT32 HeaderCrc) {
+    EFI_FILE_HANDLE FileHandle, FallbackHandle;
+    EFI_STATUS      Status;
+    BOOLEAN         AreIdentical = FALSE;
 
-    if (FallbackSize == FileSize) { // could be identical; do full check....
-        FileContents = AllocatePool(FileSize);
-        FallbackContents = AllocatePool(FallbackSize);
-        if (FileContents && FallbackContents) {
-            Status = refit_call3_wrapper(FileHandle->Read, FileHandle, &FileSize, FileContents);
-            if (Status == EFI_SUCCESS) {
-                Status = refit_call3_wrapper(FallbackHandle->Read, FallbackHandle, &FallbackSize, FallbackContents);
-            }
+    if (MyStriCmp(FileName, FALLBACK_FULLNAME))
+        return FALSE; // identical filenames, so not a duplicate....
+
+    if (!GetFallbackInfo(Volume) || (FileSize != FallbackDigest.FileSize) || (HeaderCrc != FallbackDigest.HeaderCrc))
+        return FALSE;
+
+    // could be identical; do full check, unless neither file has changed since the last one....
+    if (!ScanCacheLookup(Volume, FileName, SCAN_CACHE_FALLBACK_DUP, FileSize, FileTime, HeaderCrc,
+                         FallbackDigest.FileSize, &FallbackDigest.ModificationTime, FallbackDigest.HeaderCrc,
+                         &AreIdentical) &&
+        GetFallbackCrcs()) {
+        Status = refit_call5_wrapper(Volume->RootDir->Open, Volume->RootDir, &FileHandle, FileName, EFI_FILE_MODE_READ, 0);
+        if (Status == EFI_SUCCESS) {
+            Status = refit_call5_wrapper(Volume->RootDir->Open, Volume->RootDir, &FallbackHandle, FALLBACK_FULLNAME,
+                                         EFI_FILE_MODE_READ, 0);
             if (Status == EFI_SUCCESS) {
-                AreIdentical = (CompareMem(FileContents, FallbackContents, FileSize) == 0);
+                AreIdentical = StreamChunkCrcs(FileHandle, FileSize, FallbackDigest.ChunkCrcs, FallbackHandle);
+                refit_call1_wrapper(FallbackHandle->Close, FallbackHandle);
+                ScanCacheStore(Volume, FileName, SCAN_CACHE_FALLBACK_DUP, FileSize, FileTime, HeaderCrc,
+                               FallbackDigest.FileSize, &FallbackDigest.ModificationTime, FallbackDigest.HeaderCrc,
+                               AreIdentical);
             } // if
+            refit_call1_wrapper(FileHandle->Close, FileHandle);
         } // if
-        MyFreePool(FileContents);
-        MyFreePool(FallbackContents);
-    } // if/else
+    } // if
 
-    // BUG ALERT: Some systems (e.g., DUET, some Macs with large displays) crash if the
-    // following two calls are reversed. Go figure....
-    refit_call1_wrapper(FileHandle->Close, FallbackHandle);
-    refit_call1_wrapper(FileHandle->Close, FileHandle);
     return AreIdentical;
-} // BOOLEAN DuplicatesFallback()
+} // BOOLEAN LoaderDuplicatesFallback()
 
-// Returns FALSE if two measures of file size are identical for a single file,
-// TRUE if not or if the file can't be opened and the other measure is non-0.
-// Despite the function's name, this isn't really a direct test of symbolic
-// link status, since EFI doesn't officially support symlinks. It does seem
-// to be a reliable indicator, though. (OTOH, some disk errors might cause a
-// file to fail to open, which would return a false positive -- but as I use
-// this function to exclude symbolic links from the list of boot loaders,
-// that would be fine, since such boot loaders wouldn't work.)
-// CAUTION: *FullName MUST be properly cleaned up (via CleanUpPathNameSlashes())
-static BOOLEAN IsSymbolicLink(REFIT_VOLUME *Volume, CHAR16 *FullName, EFI_FILE_INFO *DirEntry) {
+// Returns TRUE if the file is byte-for-byte identical with the fallback file
+// on the volume AND if the file is not itself the fallback file; returns
+// FALSE if the file is not identical to the fallback file OR if the file
+// IS the fallback file. Intended for use in excluding the fallback boot
+// loader when it's a duplicate of another boot loader.
+static BOOLEAN DuplicatesFallback(IN REFIT_VOLUME *Volume, IN CHAR16 *FileName) {
     EFI_FILE_HANDLE FileHandle;
     EFI_FILE_INFO   *FileInfo = NULL;
     EFI_STATUS      Status;
-    UINTN           FileSize2 = 0;
+    CHAR8           Header[LOADER_HEADER_SIZE];
+    UINTN           Size;
+    UINT32          HeaderCrc;
+    BOOLEAN         AreIdentical = FALSE;
 
-    Status = refit_call5_wrapper(Volume->RootDir->Open, Volume->RootDir, &FileHandle, FullName, EFI_FILE_MODE_READ, 0);
-    if (Status == EFI_SUCCESS) {
-        FileInfo = LibFileInfo(FileHandle);
-        if (FileInfo != NULL)
-            FileSize2 = FileInfo->FileSize;
-    }
+    CleanUpPathNameSlashes(FileName);
+
+    if (MyStriCmp(FileName, FALLBACK_FULLNAME) || !GetFallbackInfo(Volume))
+        return FALSE;
 
+    Status = refit_call5_wrapper(Volume->RootDir->Open, Volume->RootDir, &FileHandle, FileName, EFI_FILE_MODE_READ, 0);
+    if (Status != EFI_SUCCESS)
+        return FALSE;
+    FileInfo = LibFileInfo(FileHandle);
+    HeaderCrc = ReadLoaderHeader(FileHandle, Header, &Size);
+    refit_call1_wrapper(FileHandle->Close, FileHandle);
+
+    if (FileInfo != NULL)
+        AreIdentical = LoaderDuplicatesFallback(Volume, FileName, FileInfo->FileSize, &(FileInfo->ModificationTime),
+                                                HeaderCrc);
     MyFreePool(FileInfo);
+    return AreIdentical;
+} // BOOLEAN DuplicatesFallback()
 
-    return (DirEntry->FileSize != FileSize2);
-} // BOOLEAN IsSymbolicLink()
+// Fills in the rest of *Inspection for the file open as FileHandle, whose
+// first Size bytes are Header: its size and time stamp, whether it appears to
+// be a symbolic link, and whether it's a valid EFI loader. The symbolic link
+// test compares the size in the directory entry to the size reported for the
+// opened file. EFI doesn't officially support symlinks, but this does seem to
+// be a reliable indicator.
+static VOID InspectLoader(IN EFI_FILE_HANDLE FileHandle, IN EFI_FILE_INFO *DirEntry,
+                          IN CHAR8 *Header, IN UINTN Size, IN OUT LOADER_INSPECTION *Inspection) {
+    EFI_FILE_INFO   *FileInfo;
+
+    FileInfo = LibFileInfo(FileHandle);
+    if (FileInfo != NULL) {
+        Inspection->IsSymLink = (DirEntry->FileSize != FileInfo->FileSize);
+        Inspection->FileSize = FileInfo->FileSize;
+        Inspection->ModificationTime = FileInfo->ModificationTime;
+        MyFreePool(FileInfo);
+    }
+    if (!Inspection->IsSymLink)
+        Inspection->IsLoader = HasLoaderHeader(Header, Size);
+} // VOID InspectLoader()
 
 // Returns TRUE if a file with the same name as the original but with
 // ".efi.signed" is also present in the same directory. Ubuntu is using
@@ -1445,6 +1712,50 @@ static BOOLEAN HasSignedCounterpart(IN REFIT_VOLUME *Volume, IN CHAR16 *FullName
     return retval;
 } // BOOLEAN HasSignedCounterpart()
 
+// Returns TRUE if the file is a valid EFI loader and isn't a symbolic link,
+// filling in *Inspection for use by later checks. The file is opened once and
+// its header read; if the scan cache holds a result for the file (as
+// described by DirEntry) with the same size, time stamp, and header CRC, that
+// result is used rather than inspecting the file further. A failure to open
+// the file when the directory claims it's non-empty marks it as a symbolic
+// link. (OTOH, some disk errors might cause a file to fail to open, which
+// would give a false positive -- but as this is used to exclude symbolic
+// links from the list of boot loaders, that would be fine, since such boot
+// loaders wouldn't work.)
+// CAUTION: *FullName MUST be properly cleaned up (via CleanUpPathNameSlashes())
+static BOOLEAN IsUsableLoader(IN REFIT_VOLUME *Volume, IN CHAR16 *FullName, IN EFI_FILE_INFO *DirEntry,
+                              OUT LOADER_INSPECTION *Inspection) {
+    EFI_FILE_HANDLE FileHandle;
+    EFI_STATUS      Status;
+    CHAR8           Header[LOADER_HEADER_SIZE];
+    UINTN           Size;
+    BOOLEAN         Usable;
+
+    Inspection->FileSize = DirEntry->FileSize;
+    Inspection->ModificationTime = DirEntry->ModificationTime;
+    Inspection->HeaderCrc = 0;
+    Inspection->IsSymLink = (DirEntry->FileSize != 0);
+    Inspection->IsLoader = FALSE;
+
+    Status = refit_call5_wrapper(Volume->RootDir->Open, Volume->RootDir, &FileHandle, FullName, EFI_FILE_MODE_READ, 0);
+    if (Status != EFI_SUCCESS)
+        return FALSE;
+
+    Inspection->HeaderCrc = ReadLoaderHeader(FileHandle, Header, &Size);
+    if (ScanCacheLookup(Volume, FullName, SCAN_CACHE_VALID_LOADER, DirEntry->FileSize,
+                        &(DirEntry->ModificationTime), Inspection->HeaderCrc, 0, NULL, 0, &Usable)) {
+        Inspection->IsSymLink = FALSE;
+        Inspection->IsLoader = Usable;
+    } else {
+        InspectLoader(FileHandle, DirEntry, Header, Size, Inspection);
+        Usable = !Inspection->IsSymLink && Inspection->IsLoader;
+        ScanCacheStore(Volume, FullName, SCAN_CACHE_VALID_LOADER, DirEntry->FileSize,
+                       &(DirEntry->ModificationTime), Inspection->HeaderCrc, 0, NULL, 0, Usable);
+    }
+    refit_call1_wrapper(FileHandle->Close, FileHandle);
+    return Usable;
+} // BOOLEAN IsUsableLoader()
+
 // Scan an individual directory for EFI boot loader files and, if found,
 // add them to the list. Exception: Ignores FALLBACK_FULLNAME, which is picked
 // up in ScanEfiFiles(). Sorts the entries within the loader directory so that
@@ -1458,40 +1769,48 @@ static BOOLEAN ScanLoaderDir(IN REFIT_VOLUME *Volume, IN CHAR16 *Path, IN CHAR16
     CHAR16                  Message[256], *Extension, *FullName;
     struct LOADER_LIST      *LoaderList = NULL, *NewLoader;
     LOADER_ENTRY            *FirstKernel = NULL, *LatestEntry = NULL;
+    LOADER_INSPECTION       Inspection;
+    MEM_ARENA_MARK          DirMark, FileMark;
     BOOLEAN                 FoundFallbackDuplicate = FALSE, IsLinux = FALSE, InSelfPath;
 
     InSelfPath = MyStriCmp(Path, SelfDirPath);
     if ((!SelfDirPath || !Path || (InSelfPath && (Volume->DeviceHandle != SelfVolume->DeviceHandle)) ||
            (!InSelfPath)) && (ShouldScan(Volume, Path))) {
-       // look through contents of the directory
+       // look through contents of the directory; the names and the loader
+       // list are temporaries, so they come from ScanArena....
+       DirMark = ArenaMark(&ScanArena);
        DirIterOpen(Volume->RootDir, Path, &DirIter);
        while (DirIterNext(&DirIter, 2, Pattern, &DirEntry)) {
-          Extension = FindExtension(DirEntry->FileName);
-          FullName = StrDuplicate(Path);
-          MergeStrings(&FullName, DirEntry->FileName, L'\\');
+          FileMark = ArenaMark(&ScanArena);
+          Extension = DirEntry->FileName + StrLen(DirEntry->FileName);
+          while ((Extension > DirEntry->FileName) && (*Extension != L'.'))
+             Extension--;
+          FullName = ArenaMergeStrings(&ScanArena, Path, DirEntry->FileName, L'\\');
+          if (FullName == NULL)
+             continue;
           CleanUpPathNameSlashes(FullName);
           if (DirEntry->FileName[0] == '.' ||
               MyStriCmp(Extension, L".icns") ||
               MyStriCmp(Extension, L".png") ||
               (MyStriCmp(DirEntry->FileName, FALLBACK_BASENAME) && (MyStriCmp(Path, L"EFI\\BOOT"))) ||
               FilenameIn(Volume, Path, DirEntry->FileName, SHELL_NAMES) ||
-              IsSymbolicLink(Volume, FullName, DirEntry) || /* is symbolic link */
-              HasSignedCounterpart(Volume, FullName) || /* a file with same name plus ".efi.signed" is present */
               FilenameIn(Volume, Path, DirEntry->FileName, GlobalConfig.DontScanFiles) ||
-              !IsValidLoader(Volume->RootDir, FullName)) {
+              HasSignedCounterpart(Volume, FullName) || /* a file with same name plus ".efi.signed" is present */
+              !IsUsableLoader(Volume, FullName, DirEntry, &Inspection)) { /* is symbolic link or not a loader */
+                ArenaRelease(&ScanArena, FileMark);
                 continue;   // skip this
           }
 
-          NewLoader = AllocateZeroPool(sizeof(struct LOADER_LIST));
+          NewLoader = ArenaAlloc(&ScanArena, sizeof(struct LOADER_LIST));
           if (NewLoader != NULL) {
-             NewLoader->FileName = StrDuplicate(FullName);
-             NewLoader->TimeStamp = DirEntry->ModificationTime;
+             NewLoader->FileName = FullName;
+             NewLoader->TimeStamp = Inspection.ModificationTime;
+             NewLoader->NextEntry = NULL;
              LoaderList = AddLoaderListEntry(LoaderList, NewLoader);
-             if (DuplicatesFallback(Volume, FullName))
+             if (LoaderDuplicatesFallback(Volume, FullName, Inspection.FileSize, &Inspection.ModificationTime,
+                                          Inspection.HeaderCrc))
                 FoundFallbackDuplicate = TRUE;
           } // if
-          MyFreePool(Extension);
-          MyFreePool(FullName);
        } // while
 
        NewLoader = LoaderList;
@@ -1511,7 +1830,7 @@ static BOOLEAN ScanLoaderDir(IN REFIT_VOLUME *Volume, IN CHAR16 *Path, IN CHAR16
        if ((NewLoader != NULL) && (FirstKernel != NULL) && IsLinux && GlobalConfig.FoldLinuxKernels)
            AddMenuEntry(FirstKernel->me.SubScreen, &MenuEntryReturn);
 
-       CleanUpLoaderList(LoaderList);
+       ArenaRelease(&ScanArena, DirMark);
        Status = DirIterClose(&DirIter);
        // NOTE: EFI_INVALID_PARAMETER really is an error that should be reported;
        // but I've gotten reports from users who are getting this error occasionally
@@ -1699,43 +2018,131 @@ static VOID ScanEfiFiles(REFIT_VOLUME *Volume) {
         // for the fallback boot loader
         if (ScanFallbackLoader && FileExists(Volume->RootDir, FALLBACK_FULLNAME) && ShouldScan(Volume, L"EFI\\BOOT") &&
             !FilenameIn(Volume, L"EFI\\BOOT", FALLBACK_BASENAME, GlobalConfig.DontScanFiles)) {
-                AddLoaderEntry(FALLBACK_FULLNAME, L"Fallback boot loader", Volume, TRUE);
+                StrCpy(FileName, FALLBACK_FULLNAME); // AddLoaderEntry() cleans up the path in place
+                AddLoaderEntry(FileName, L"Fallback boot loader", Volume, TRUE);
         }
     } // if
 } // static VOID ScanEfiFiles()
 
-// Scan internal disks for valid EFI boot loaders....
-static VOID ScanInternal(VOID) {
-    UINTN                   VolumeIndex;
+// The boot loader entries that ScanEfiFiles() created for one volume. These
+// are kept between scans so that a rescan can re-use them for volumes that
+// RescanVolumes() carried over unchanged.
+typedef struct _volume_loaders {
+    REFIT_VOLUME            *Volume;
+    REFIT_MENU_ENTRY        **Entries;
+    UINTN                   EntryCount;
+    CHAR16                  *RecoveryFiles;   // what the scan added to GlobalConfig.MacOSRecoveryFiles
+    struct _volume_loaders  *Next;
+} VOLUME_LOADERS;
+
+// Loaders found by the current scan, those found by the previous one and not
+// (yet) re-used, and the settings under which they were found
+static VOLUME_LOADERS *LoadersByVolume = NULL;
+static VOLUME_LOADERS *PreviousLoaders = NULL;
+static CHAR16         *LoaderScanSettings = NULL;
+
+// Free a list of VOLUME_LOADERS, including the menu entries they hold
+static VOID FreeVolumeLoaders(IN OUT VOLUME_LOADERS **List) {
+    VOLUME_LOADERS *Next;
+
+    while (*List != NULL) {
+        Next = (*List)->Next;
+        FreeList((VOID ***) &((*List)->Entries), &((*List)->EntryCount));
+        MyFreePool((*List)->RecoveryFiles);
+        MyFreePool(*List);
+        *List = Next;
+    } // while
+} // static VOID FreeVolumeLoaders()
+
+// Returns the settings that affect what ScanEfiFiles() finds, as a string. If
+// they differ from one scan to the next, no loaders can be re-used. (Most
+// settings change only when refind.conf does, which can only happen while
+// another program runs, and that forces a full rescan anyway; but hidden
+// tags can be changed from within rEFInd.)
+static CHAR16 * GetLoaderScanSettings(VOID) {
+    return PoolPrint(L"%s|%s|%s|%s|%d|%d|%d",
+                     GlobalConfig.DontScanVolumes ? GlobalConfig.DontScanVolumes : L"",
+                     GlobalConfig.DontScanDirs ? GlobalConfig.DontScanDirs : L"",
+                     GlobalConfig.DontScanFiles ? GlobalConfig.DontScanFiles : L"",
+                     GlobalConfig.AlsoScan ? GlobalConfig.AlsoScan : L"",
+                     GlobalConfig.ScanAllLinux, GlobalConfig.FoldLinuxKernels, GlobalConfig.HideUIFlags);
+} // static CHAR16 * GetLoaderScanSettings()
+
+// Free the main menu's entries, except for boot loader entries held in
+// LoadersByVolume, which ScanForBootloaders() may re-use.
+static VOID FreeMainMenuEntries(VOID) {
+    VOLUME_LOADERS *Loaders;
+    BOOLEAN        Kept;
+    UINTN          i, j;
+
+    for (i = 0; i < MainMenu.EntryCount; i++) {
+        Kept = FALSE;
+        for (Loaders = LoadersByVolume; (Loaders != NULL) && !Kept; Loaders = Loaders->Next) {
+            for (j = 0; (j < Loaders->EntryCount) && !Kept; j++)
+                Kept = (Loaders->Entries[j] == MainMenu.Entries[i]);
+        } // for
+        if (!Kept)
+            MyFreePool(MainMenu.Entries[i]);
+    } // for
+    MyFreePool(MainMenu.Entries);
+    MainMenu.Entries = NULL;
+    MainMenu.EntryCount = 0;
+} // static VOID FreeMainMenuEntries()
+
+// Add the previous scan's entries for Volume to the main menu, if there are
+// any. Returns TRUE if so, FALSE if the volume must be scanned.
+static BOOLEAN ReuseVolumeLoaders(REFIT_VOLUME *Volume) {
+    VOLUME_LOADERS **Link, *Loaders;
+    CHAR16         *FileName;
+    UINTN          i = 0;
+
+    for (Link = &PreviousLoaders; (*Link != NULL) && ((*Link)->Volume != Volume); Link = &((*Link)->Next))
+        ;
+    Loaders = *Link;
+    if (Loaders == NULL)
+        return FALSE;
 
-    for (VolumeIndex = 0; VolumeIndex < VolumesCount; VolumeIndex++) {
-        if (Volumes[VolumeIndex]->DiskKind == DISK_KIND_INTERNAL) {
-            ScanEfiFiles(Volumes[VolumeIndex]);
-        }
+    *Link = Loaders->Next;
+    Loaders->Next = LoadersByVolume;
+    LoadersByVolume = Loaders;
+    for (i = 0; i < Loaders->EntryCount; i++) {
+        Loaders->Entries[i]->ShortcutDigit = 0;
+        AddMenuEntry(&MainMenu, Loaders->Entries[i]);
     } // for
-} // static VOID ScanInternal()
+    i = 0;
+    while ((FileName = FindCommaDelimited(Loaders->RecoveryFiles, i++)) != NULL) {
+        if (!StriSubCmp(FileName, GlobalConfig.MacOSRecoveryFiles))
+            MergeStrings(&GlobalConfig.MacOSRecoveryFiles, FileName, L',');
+        MyFreePool(FileName);
+    } // while
+    return TRUE;
+} // static BOOLEAN ReuseVolumeLoaders()
 
-// Scan external disks for valid EFI boot loaders....
-static VOID ScanExternal(VOID) {
-    UINTN                   VolumeIndex;
+// Scan a volume for boot loaders, unless the entries from the previous scan
+// can be re-used; and remember the entries for the next scan.
+static VOID ScanVolumeLoaders(REFIT_VOLUME *Volume) {
+    VOLUME_LOADERS *Loaders;
+    UINTN          FirstEntry, RecoveryLength, i;
 
-    for (VolumeIndex = 0; VolumeIndex < VolumesCount; VolumeIndex++) {
-        if (Volumes[VolumeIndex]->DiskKind == DISK_KIND_EXTERNAL) {
-            ScanEfiFiles(Volumes[VolumeIndex]);
-        }
-    } // for
-} // static VOID ScanExternal()
+    if (ReuseVolumeLoaders(Volume))
+        return;
 
-// Scan internal disks for valid EFI boot loaders....
-static VOID ScanOptical(VOID) {
-    UINTN                   VolumeIndex;
+    FirstEntry = MainMenu.EntryCount;
+    RecoveryLength = GlobalConfig.MacOSRecoveryFiles ? StrLen(GlobalConfig.MacOSRecoveryFiles) : 0;
+    ScanEfiFiles(Volume);
 
-    for (VolumeIndex = 0; VolumeIndex < VolumesCount; VolumeIndex++) {
-        if (Volumes[VolumeIndex]->DiskKind == DISK_KIND_OPTICAL) {
-            ScanEfiFiles(Volumes[VolumeIndex]);
-        }
-    } // for
-} // static VOID ScanOptical()
+    Loaders = AllocateZeroPool(sizeof(VOLUME_LOADERS));
+    if (Loaders == NULL)
+        return;
+    Loaders->Volume = Volume;
+    for (i = FirstEntry; i < MainMenu.EntryCount; i++)
+        AddListElement((VOID ***) &(Loaders->Entries), &(Loaders->EntryCount), MainMenu.Entries[i]);
+    if (GlobalConfig.MacOSRecoveryFiles && (StrLen(GlobalConfig.MacOSRecoveryFiles) > RecoveryLength)) {
+        Loaders->RecoveryFiles = StrDuplicate(&GlobalConfig.MacOSRecoveryFiles[RecoveryLength]);
+    }
+    Loaders->Next = LoadersByVolume;
+    LoadersByVolume = Loaders;
+} // static VOID ScanVolumeLoaders()
 
 // default volume badge icon based on disk kind
 EG_IMAGE * GetDiskBadge(IN UINTN DiskType) {
@@ -1764,7 +2171,7 @@ static VOID StartTool(IN LOADER_ENTRY *Entry)
     BeginExternalScreen(Entry->UseGraphicsMode, Entry->me.Title + 6);  // assumes "Start <title>" as assigned below
     StoreLoaderName(Entry->me.Title);
     StartEFIImage(Entry->Volume, Entry->LoaderPath, Entry->LoadOptions,
-                  Basename(Entry->LoaderPath), Entry->OSType, TRUE, FALSE);
+                  Basename(Entry->LoaderPath), Entry->OSType, TRUE, FALSE, NULL);
     FinishExternalScreen();
 } /* static VOID StartTool() */
 
@@ -1790,13 +2197,21 @@ static LOADER_ENTRY * AddToolEntry(REFIT_VOLUME *Volume,IN CHAR16 *LoaderPath, I
     return Entry;
 } /* static LOADER_ENTRY * AddToolEntry() */
 
-// Locates boot loaders. NOTE: This assumes that GlobalConfig.LegacyType is set correctly.
-static VOID ScanForBootloaders(BOOLEAN ShowMessage) {
+// Position of the boot loader scan: the scanfor option being acted on, and
+// the next volume to be scanned for it
+static UINTN ScanOptionIndex = NUM_SCAN_OPTIONS;
+static UINTN ScanVolumeIndex = 0;
+// TRUE while the main menu is shown before the boot loader scan is done
+static BOOLEAN ProgressiveScanPending = FALSE;
+
+// Prepares to scan for boot loaders, which ScanForBootloadersStep() does.
+// NOTE: This assumes that GlobalConfig.LegacyType is set correctly.
+static VOID BeginScanForBootloaders(BOOLEAN ShowMessage) {
     UINTN    i;
     CHAR8    s;
     BOOLEAN  ScanForLegacy = FALSE;
     EG_PIXEL BGColor = COLOR_LIGHTBLUE;
-    CHAR16   *HiddenTags;
+    CHAR16   *HiddenTags, *Settings;
 
     if (ShowMessage)
         egDisplayMessage(L"Scanning for boot loaders; please wait....", &BGColor, CENTER);
@@ -1824,39 +2239,116 @@ static VOID ScanForBootloaders(BOOLEAN ShowMessage) {
     }
     MyFreePool(HiddenTags);
 
-    // scan for loaders and tools, add them to the menu
-    for (i = 0; i < NUM_SCAN_OPTIONS; i++) {
-        switch(GlobalConfig.ScanFor[i]) {
-            case 'c': case 'C':
-                ScanLegacyDisc();
-                break;
-            case 'h': case 'H':
-                ScanLegacyInternal();
-                break;
-            case 'b': case 'B':
-                ScanLegacyExternal();
-                break;
-            case 'm': case 'M':
-                ScanUserConfigured(GlobalConfig.ConfigFilename);
-                break;
-            case 'e': case 'E':
-                ScanExternal();
-                break;
-            case 'i': case 'I':
-                ScanInternal();
-                break;
-            case 'o': case 'O':
-                ScanOptical();
-                break;
-            case 'n': case 'N':
-                ScanNetboot();
-                break;
-        } // switch()
-    } // for
+    // Loaders from the previous scan may be re-used only if nothing that
+    // affects what's found has changed
+    Settings = GetLoaderScanSettings();
+    if ((Settings == NULL) || (LoaderScanSettings == NULL) || (StrCmp(Settings, LoaderScanSettings) != 0))
+        FreeVolumeLoaders(&LoadersByVolume);
+    MyFreePool(LoaderScanSettings);
+    LoaderScanSettings = Settings;
+    // (any left from a scan that was cut short are no longer in the menu)
+    FreeVolumeLoaders(&PreviousLoaders);
+    PreviousLoaders = LoadersByVolume;
+    LoadersByVolume = NULL;
+
+    ScanCacheLoad();
+    ForgetFallbackDigest();
+    ForgetCompiledLists();
+
+    ScanOptionIndex = 0;
+    ScanVolumeIndex = 0;
+} // static VOID BeginScanForBootloaders()
+
+// Scan one volume, or do one of the scans that isn't by volume, adding any
+// boot loaders found to the main menu. Returns TRUE if there's more to scan.
+static BOOLEAN ScanForBootloadersStep(VOID) {
+    UINTN   DiskKind = DISK_KIND_INTERNAL;
+    BOOLEAN ByVolume = FALSE;
+
+    if (ScanOptionIndex >= NUM_SCAN_OPTIONS)
+        return FALSE;
+
+    switch(GlobalConfig.ScanFor[ScanOptionIndex]) {
+        case 'c': case 'C':
+            ScanLegacyDisc();
+            break;
+        case 'h': case 'H':
+            ScanLegacyInternal();
+            break;
+        case 'b': case 'B':
+            ScanLegacyExternal();
+            break;
+        case 'm': case 'M':
+            ScanUserConfigured(GlobalConfig.ConfigFilename);
+            break;
+        case 'e': case 'E':
+            DiskKind = DISK_KIND_EXTERNAL;
+            ByVolume = TRUE;
+            break;
+        case 'i': case 'I':
+            DiskKind = DISK_KIND_INTERNAL;
+            ByVolume = TRUE;
+            break;
+        case 'o': case 'O':
+            DiskKind = DISK_KIND_OPTICAL;
+            ByVolume = TRUE;
+            break;
+        case 'n': case 'N':
+            ScanNetboot();
+            break;
+    } // switch()
+
+    if (ByVolume) {
+        while ((ScanVolumeIndex < VolumesCount) && (Volumes[ScanVolumeIndex]->DiskKind != DiskKind))
+            ScanVolumeIndex++;
+        if (ScanVolumeIndex < VolumesCount) {
+            ScanVolumeLoaders(Volumes[ScanVolumeIndex++]);
+            return TRUE;
+        }
+    } // if
+
+    ScanOptionIndex++;
+    ScanVolumeIndex = 0;
+    return (ScanOptionIndex < NUM_SCAN_OPTIONS);
+} // static BOOLEAN ScanForBootloadersStep()
+
+// Give the first nine boot loader entries shortcut digits
+static VOID AssignShortcutDigits(VOID) {
+    UINTN i;
 
-    // assign shortcut keys
     for (i = 0; i < MainMenu.EntryCount && MainMenu.Entries[i]->Row == 0 && i < 9; i++)
         MainMenu.Entries[i]->ShortcutDigit = (CHAR16)('1' + i);
+} // static VOID AssignShortcutDigits()
+
+// Cleans up after ScanForBootloadersStep() has scanned everything.
+static VOID FinishScanForBootloaders(VOID) {
+    UINTN i;
+    EG_PNG_MEMORY_STATS PngStats;
+
+    LOG_INFO(L"Found %d boot loaders", MainMenu.EntryCount);
+    for (i = 0; i < MainMenu.EntryCount; i++)
+        LOG_INFO(L"Entry %d: %s", i, MainMenu.Entries[i]->Title);
+    ScanCacheSave();
+    ForgetFallbackDigest();
+    ForgetCompiledLists();
+    FreeVolumeLoaders(&PreviousLoaders);
+
+    LOG_DEBUG(L"Allocations so far: %d from arenas (in %d pool blocks); %d list additions, %d needing pool memory",
+              AllocationCounts.ArenaAllocations, AllocationCounts.ArenaBlocks,
+              AllocationCounts.ListAdditions, AllocationCounts.ListAllocations);
+    egGetPNGMemoryStats(&PngStats);
+    LOG_DEBUG(L"PNG decoding: %d images, %d allocations (%d more grown in place), peak %d bytes",
+              PngStats.Decodes, PngStats.Allocations, PngStats.GrownInPlace, PngStats.PeakBytes);
+
+    AssignShortcutDigits();
+} // static VOID FinishScanForBootloaders()
+
+// Locates boot loaders. NOTE: This assumes that GlobalConfig.LegacyType is set correctly.
+static VOID ScanForBootloaders(BOOLEAN ShowMessage) {
+    BeginScanForBootloaders(ShowMessage);
+    while (ScanForBootloadersStep())
+        ;
+    FinishScanForBootloaders();
 
     // wait for user ACK when there were errors
     FinishTextScreen(FALSE);
@@ -2084,17 +2576,28 @@ static VOID ScanForTools(VOID) {
     } // for
 } // static VOID ScanForTools
 
-// Rescan for boot loaders
+// Rescan for boot loaders. Volumes that haven't changed since the last scan
+// keep their boot loader entries (with their icons and identicon hashes);
+// only new or changed volumes are scanned again.
 VOID RescanAll(BOOLEAN DisplayMessage) {
-    FreeList((VOID ***) &(MainMenu.Entries), &MainMenu.EntryCount);
-    MainMenu.Entries = NULL;
-    MainMenu.EntryCount = 0;
+    if (ProgressiveScanPending) {
+        // abandon the scan that the main menu was doing, and any errors it reported
+        SetMenuGrowFunc(NULL, NULL);
+        ProgressiveScanPending = FALSE;
+        ResetErrorFlag();
+        TraceEnd(L"ScanForBootloaders");
+        TraceEnd(L"Startup");
+    }
+    PrefetchForget();
+    FreeMainMenuEntries();
+    ArenaFree(&ScanArena);
     ConnectAllDriversToAllControllers();
-    ScanVolumes();
+    RescanVolumes();
     ReadConfig(GlobalConfig.ConfigFilename);
     SetVolumeIcons();
     ScanForBootloaders(TRUE);
     ScanForTools();
+    LogFlush();
 } // VOID RescanAll()
 
 #ifdef __MAKEWITH_TIANO
@@ -2217,9 +2720,10 @@ VOID GenerateIdenticon(LOADER_ENTRY *Entry)
   Entry->me.IdenticonImage = egDrawIdenticon(GlobalConfig.IconSizes[ICON_SIZE_IDENTICON],Entry->HashLength,Entry->Hash);
 }
 
-VOID GenerateIdenticonsForMainMenu()
+//generates identicons for the main menu entries from FirstEntry on
+static VOID GenerateIdenticonsFrom(UINTN FirstEntry)
 {
-  for (int i = 0; i < MainMenu.EntryCount; i++) {
+  for (UINTN i = FirstEntry; i < MainMenu.EntryCount; i++) {
 
     //the entries are all cast as REFIT_MENU_ENTRY structures. Some of them are actually
     //LOADER_ENTRY structures, which is what we need, and are identified by "Tag"
@@ -2227,11 +2731,50 @@ VOID GenerateIdenticonsForMainMenu()
       continue;
   
     
-    GenerateHash((LOADER_ENTRY *)MainMenu.Entries[i]);
-    GenerateIdenticon((LOADER_ENTRY *)MainMenu.Entries[i]);
+    //entries kept over from an earlier scan already have theirs
+    if(((LOADER_ENTRY *)MainMenu.Entries[i])->Hash == NULL)
+      GenerateHash((LOADER_ENTRY *)MainMenu.Entries[i]);
+    if(MainMenu.Entries[i]->IdenticonImage == NULL)
+      GenerateIdenticon((LOADER_ENTRY *)MainMenu.Entries[i]);
   }
 }
 
+VOID GenerateIdenticonsForMainMenu()
+{
+  GenerateIdenticonsFrom(0);
+}
+
+// Scans a little more for boot loaders while the main menu is shown (see
+// SetMenuGrowFunc() and the progressive_menu option), giving the entries
+// found their identicons. Once the scan is done, adds the tools and finishes
+// start-up as efi_main() otherwise would, including waiting for a key if
+// errors were shown. Returns TRUE if there's more to scan.
+static BOOLEAN ProgressiveScanStep(VOID) {
+    UINTN FirstEntry = MainMenu.EntryCount;
+
+    if (ScanForBootloadersStep()) {
+        GenerateIdenticonsFrom(FirstEntry);
+        AssignShortcutDigits();
+        return TRUE;
+    }
+
+    FinishScanForBootloaders();
+    TraceEnd(L"ScanForBootloaders");
+    TraceBegin(L"ScanForTools");
+    ScanForTools();
+    TraceEnd(L"ScanForTools");
+    TraceBegin(L"GenerateIdenticons");
+    GenerateIdenticonsFrom(FirstEntry);
+    TraceEnd(L"GenerateIdenticons");
+    TraceEnd(L"Startup");
+    ProgressiveScanPending = FALSE;
+    LogFlush();
+
+    // wait for user ACK when there were errors; the menu is then painted afresh
+    FinishTextScreen(FALSE);
+    return FALSE;
+} // static BOOLEAN ProgressiveScanStep()
+
 //
 // main entry point
 //
@@ -2242,6 +2785,7 @@ efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
     EFI_STATUS         Status;
     BOOLEAN            MainLoopRunning = TRUE;
     BOOLEAN            MokProtocol;
+    BOOLEAN            Progressive = FALSE;
     REFIT_MENU_ENTRY   *ChosenEntry;
     UINTN              MenuExit, i;
     CHAR16             *SelectionName = NULL;
@@ -2252,6 +2796,7 @@ efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
     Status = InitRefitLib(ImageHandle);
     if (EFI_ERROR(Status))
         return Status;
+    TraceBegin(L"Startup");
 
     // read configuration
     CopyMem(GlobalConfig.ScanFor, "ieom      ", NUM_SCAN_OPTIONS);
@@ -2269,7 +2814,14 @@ efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
     ScanVolumes();
     if (LoadDrivers())
         ScanVolumes();
+    TraceBegin(L"ReadConfig");
     ReadConfig(GlobalConfig.ConfigFilename);
+    TraceEnd(L"ReadConfig");
+    // The driver manifest is used (or not) before the configuration is read;
+    // now that it has been, bring the manifest into line with driver_manifest.
+    DriverManifestSave();
+    // Messages held until now can be written (or discarded), as log_level says.
+    LogFlush();
     AdjustDefaultSelection();
 
     if (GlobalConfig.SpoofOSXVersion && GlobalConfig.SpoofOSXVersion[0] != L'\0')
@@ -2284,9 +2836,29 @@ efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
 
     // further bootstrap (now with config available)
     SetupScreen();
+    TraceBegin(L"SetVolumeIcons");
     SetVolumeIcons();
-    ScanForBootloaders(FALSE);
-    ScanForTools();
+    TraceEnd(L"SetVolumeIcons");
+    TraceBegin(L"ScanForBootloaders");
+    if (GlobalConfig.ProgressiveMenu && (GlobalConfig.ScanDelay == 0) && (GlobalConfig.Timeout != -1)) {
+        // Scan only until there's something to choose from; the main menu
+        // scans the rest as it's shown, and ProgressiveScanStep() finishes
+        // start-up.
+        BeginScanForBootloaders(FALSE);
+        ProgressiveScanPending = TRUE;
+        while ((MainMenu.EntryCount == 0) && ProgressiveScanStep())
+            ;
+        if (ProgressiveScanPending)
+            SetMenuGrowFunc(&MainMenu, ProgressiveScanStep);
+        Progressive = TRUE;
+    } else {
+        ScanForBootloaders(FALSE);
+        TraceEnd(L"ScanForBootloaders");
+        TraceBegin(L"ScanForTools");
+        ScanForTools();
+        TraceEnd(L"ScanForTools");
+        LogFlush();
+    }
     // SetupScreen() clears the screen; but ScanForBootloaders() may display a
     // message that must be deleted, so do so
     BltClearScreen(TRUE);
@@ -2306,8 +2878,14 @@ efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
     if (GlobalConfig.ShutdownAfterTimeout)
         MainMenu.TimeoutText = L"Shutdown";
 
-    GenerateIdenticonsForMainMenu();
-    
+    if (!Progressive) {
+        TraceBegin(L"GenerateIdenticons");
+        GenerateIdenticonsForMainMenu();
+        TraceEnd(L"GenerateIdenticons");
+        TraceEnd(L"Startup");
+        LogFlush();
+    }
+
     while (MainLoopRunning) {
         MenuExit = RunMainMenu(&MainMenu, &SelectionName, &ChosenEntry);
 
@@ -2326,12 +2904,16 @@ efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
         switch (ChosenEntry->Tag) {
 
             case TAG_REBOOT:    // Reboot
+                TraceSave();
+                LogFlush();
                 TerminateScreen();
                 refit_call4_wrapper(RT->ResetSystem, EfiResetCold, EFI_SUCCESS, 0, NULL);
                 MainLoopRunning = FALSE;   // just in case we get this far
                 break;
 
             case TAG_SHUTDOWN: // Shut Down
+                TraceSave();
+                LogFlush();
                 TerminateScreen();
                 refit_call4_wrapper(RT->ResetSystem, EfiResetShutdown, EFI_SUCCESS, 0, NULL);
                 MainLoopRunning = FALSE;   // just in case we get this far
@@ -2365,6 +2947,8 @@ efi_main (EFI_HANDLE ImageHandle, EFI_SYSTEM_TABLE *SystemTable)
                 if ((MokProtocol) && !SecureBootUninstall()) {
                    MainLoopRunning = FALSE;   // just in case we get this far
                 } else {
+                   TraceSave();
+                   LogFlush();
                    BeginTextScreen(L" ");
                    return EFI_SUCCESS;
                 }
@@ -65,6 +65,8 @@
 #include "line_edit.h"
 #include "mystrings.h"
 #include "icns.h"
+#include "prefetch.h"
+#include "trace.h"
 #include "../include/refit_call_wrapper.h"
 
 #include "../include/egemb_back_selected_small.h"
@@ -114,6 +116,15 @@ extern REFIT_MENU_ENTRY MenuEntryReturn;
 static REFIT_MENU_ENTRY MenuEntryYes = { L"Yes", TAG_RETURN, 1, 0, 0, NULL, NULL, NULL };
 static REFIT_MENU_ENTRY MenuEntryNo = { L"No", TAG_RETURN, 1, 0, 0, NULL, NULL, NULL };
 
+// Set once the first menu has been drawn; only that drawing is traced
+static BOOLEAN FirstPaintDone = FALSE;
+
+// The menu that's shown before all its entries have been found, if any, the
+// function that adds them, and the default selection to look for among them
+static REFIT_MENU_SCREEN *GrowingMenu = NULL;
+static MENU_GROW_FUNC    GrowFunc = NULL;
+static CHAR16            *GrowDefaultSelection = NULL;
+
 //
 // Graphics helper functions
 //
@@ -379,6 +390,72 @@ static VOID SaveScreen(VOID) {
    ReadAllKeyStrokes();
 } // VOID SaveScreen()
 
+// Waits up to Timeout milliseconds for input, as WaitForInput() does, but
+// spends the time reading ahead for the entry that the menu's timeout will
+// launch, checking for input between PrefetchStep() calls. Once there's
+// nothing left to read, it simply waits.
+static UINTN WaitForInputPrefetching(UINTN Timeout) {
+    UINTN Index, Input = INPUT_TIMEOUT;
+    EFI_EVENT TimerEvent;
+    EFI_STATUS Status;
+
+    egFlushScreen();
+    Status = refit_call5_wrapper(BS->CreateEvent, EVT_TIMER, 0, NULL, NULL, &TimerEvent);
+    if (EFI_ERROR(Status))
+        return WaitForInput(Timeout);
+    refit_call3_wrapper(BS->SetTimer, TimerEvent, TimerRelative, Timeout * 10000);
+
+    while ((Input == INPUT_TIMEOUT) && (refit_call1_wrapper(BS->CheckEvent, TimerEvent) == EFI_NOT_READY)) {
+        for (Index = 0; Index < WaitListLength - 1; Index++) {
+            if (refit_call1_wrapper(BS->CheckEvent, WaitList[Index]) == EFI_SUCCESS) {
+                Input = (Index == 0) ? INPUT_KEY : INPUT_POINTER;
+                break;
+            }
+        } // for
+        if ((Input == INPUT_TIMEOUT) && !PrefetchStep()) {
+            WaitList[WaitListLength - 1] = TimerEvent;
+            Status = refit_call3_wrapper(BS->WaitForEvent, WaitListLength, WaitList, &Index);
+            if (!EFI_ERROR(Status) && (Index < WaitListLength - 1))
+                Input = (Index == 0) ? INPUT_KEY : INPUT_POINTER;
+            break;
+        } // if
+    } // while
+
+    refit_call1_wrapper(BS->CloseEvent, TimerEvent);
+    return Input;
+} // static UINTN WaitForInputPrefetching()
+
+// Have NewGrowFunc add entries to Screen while Screen is shown, between checks
+// for input, until it returns FALSE. Until then, the menu doesn't time out.
+// Entries must be added to the end of Screen->Entries, so that those already
+// shown keep their places. A NULL NewGrowFunc stops this.
+VOID SetMenuGrowFunc(IN REFIT_MENU_SCREEN *Screen, IN MENU_GROW_FUNC NewGrowFunc) {
+    GrowingMenu = (NewGrowFunc != NULL) ? Screen : NULL;
+    GrowFunc = NewGrowFunc;
+} // VOID SetMenuGrowFunc()
+
+// Lay out the menu again after entries have been added to it, keeping the
+// current selection unless the user hasn't yet made one and the default
+// selection has now been found.
+static VOID RelayoutMenu(IN REFIT_MENU_SCREEN *Screen, IN MENU_STYLE_FUNC StyleFunc, IN OUT SCROLL_STATE *State,
+                         IN BOOLEAN UserActed) {
+    INTN Selection = State->CurrentSelection, DefaultIndex;
+
+    if (!UserActed && (GrowDefaultSelection != NULL)) {
+        DefaultIndex = FindMenuShortcutEntry(Screen, GrowDefaultSelection);
+        if (DefaultIndex >= 0)
+            Selection = DefaultIndex;
+    }
+    StyleFunc(Screen, State, MENU_FUNCTION_CLEANUP, NULL);
+    StyleFunc(Screen, State, MENU_FUNCTION_INIT, NULL);
+    IdentifyRows(State, Screen);
+    if ((Selection >= 0) && (Selection <= State->MaxIndex)) {
+        State->CurrentSelection = Selection;
+        if (GlobalConfig.ScreensaverTime != -1)
+            UpdateScroll(State, SCROLL_NONE);
+    }
+} // static VOID RelayoutMenu()
+
 //
 // generic menu function
 //
@@ -398,6 +475,9 @@ static UINTN RunGenericMenu(IN REFIT_MENU_SCREEN *Screen, IN MENU_STYLE_FUNC Sty
     UINTN MenuExit;
     EFI_STATUS PointerStatus = EFI_NOT_READY;
     UINTN Item;
+    BOOLEAN Growing = (Screen == GrowingMenu);
+    BOOLEAN UserActed = FALSE;
+    UINTN OldEntryCount;
 
     if (Screen->TimeoutSeconds > 0) {
         HaveTimeout = TRUE;
@@ -435,8 +515,14 @@ static UINTN RunGenericMenu(IN REFIT_MENU_SCREEN *Screen, IN MENU_STYLE_FUNC Sty
     if (GlobalConfig.ScreensaverTime != -1)
         State.PaintAll = TRUE;
 
+    // Read ahead for the entry that the timeout will launch (once it's known)
+    if (HaveTimeout && !Growing && !GlobalConfig.ShutdownAfterTimeout && (Screen->EntryCount > 0))
+        PrefetchStart((LOADER_ENTRY *) Screen->Entries[State.CurrentSelection]);
+
     while (!MenuExit) {
         // update the screen
+        if (!FirstPaintDone)
+            TraceBegin(L"FirstPaint");
         pdClear();
         if (State.PaintAll && (GlobalConfig.ScreensaverTime != -1)) {
             StyleFunc(Screen, &State, MENU_FUNCTION_PAINT_ALL, NULL);
@@ -446,6 +532,11 @@ static UINTN RunGenericMenu(IN REFIT_MENU_SCREEN *Screen, IN MENU_STYLE_FUNC Sty
             State.PaintSelection = FALSE;
         }
         pdDraw();
+        egFlushScreen();
+        if (!FirstPaintDone) {
+            TraceEnd(L"FirstPaint");
+            FirstPaintDone = TRUE;
+        }
 
         if (WaitForRelease) {
             Status = refit_call2_wrapper(ST->ConIn->ReadKeyStroke, ST->ConIn, &key);
@@ -480,6 +571,7 @@ static UINTN RunGenericMenu(IN REFIT_MENU_SCREEN *Screen, IN MENU_STYLE_FUNC Sty
             PointerActive = FALSE;
             DrawSelection = TRUE;
             TimeSinceKeystroke = 0;
+            UserActed = TRUE;
         } else if (PointerStatus == EFI_SUCCESS) {
             if (StyleFunc != MainMenuStyle && pdGetState().Press) {
                 // prevent user from getting stuck on submenus
@@ -490,15 +582,32 @@ static UINTN RunGenericMenu(IN REFIT_MENU_SCREEN *Screen, IN MENU_STYLE_FUNC Sty
 
             PointerActive = TRUE;
             TimeSinceKeystroke = 0;
+            UserActed = TRUE;
         } else {
-            if (HaveTimeout && TimeoutCountdown == 0) {
+            if (Growing) {
+                // Add whatever entries are ready, then check for input again.
+                // The timeout is held until all the entries have been found.
+                // The last call may have shown errors over the menu, so the
+                // menu is then laid out and painted afresh, whatever changed.
+                OldEntryCount = Screen->EntryCount;
+                Growing = GrowFunc();
+                if ((Screen->EntryCount != OldEntryCount) || !Growing) {
+                    RelayoutMenu(Screen, StyleFunc, &State, UserActed);
+                    PreviousTime = -1;
+                }
+                if (!Growing) {
+                    SetMenuGrowFunc(NULL, NULL);
+                    if (HaveTimeout && !GlobalConfig.ShutdownAfterTimeout && (Screen->EntryCount > 0))
+                        PrefetchStart((LOADER_ENTRY *) Screen->Entries[State.CurrentSelection]);
+                }
+            } else if (HaveTimeout && TimeoutCountdown == 0) {
                 // timeout expired
                 MenuExit = MENU_EXIT_TIMEOUT;
                 break;
             } else if (HaveTimeout || GlobalConfig.ScreensaverTime > 0) {
                 UINTN ElapsCount = 1;
 
-                UINTN Input = WaitForInput(1000); // 1s Timeout
+                UINTN Input = HaveTimeout ? WaitForInputPrefetching(1000) : WaitForInput(1000); // 1s Timeout
 
                 if (Input == INPUT_KEY || Input == INPUT_POINTER) {
                     continue;
@@ -974,6 +1083,8 @@ static VOID GraphicsMenuStyle(IN REFIT_MENU_SCREEN *Screen, IN SCROLL_STATE *Sta
 
             // initial painting
             SwitchToGraphicsAndClear();
+            // clearing the screen replaces the saved background
+            BackgroundPixel = &(GlobalConfig.ScreenBackground->PixelData[0]);
             Window = egCreateFilledImage(MenuWidth, MenuHeight, FALSE, BackgroundPixel);
             egDrawImage(Window, EntriesPosX, EntriesPosY);
             ItemWidth = egComputeTextWidth(Screen->Title);
@@ -1361,6 +1472,9 @@ UINTN WaitForInput(UINTN Timeout) {
     EFI_EVENT TimerEvent;
     EFI_STATUS Status;
 
+    // show anything drawn since the last update before blocking
+    egFlushScreen();
+
     if (Timeout == 0) {
         Length--;
     } else {
@@ -1751,6 +1865,7 @@ UINTN RunMainMenu(REFIT_MENU_SCREEN *Screen, CHAR16** DefaultSelection, REFIT_ME
     // Generate this now and keep it around forever, since it's likely to be
     // used after this function terminates....
     GenerateWaitList();
+    GrowDefaultSelection = (DefaultSelection != NULL) ? *DefaultSelection : NULL;
 
     while (!MenuExit) {
         MenuExit = RunGenericMenu(Screen, MainStyle, &DefaultEntryIndex, &TempChosenEntry);
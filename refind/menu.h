@@ -104,6 +104,10 @@ typedef struct {
 
 struct _refit_menu_screen;
 
+// Called by a menu, between checks for input, while it's still gaining
+// entries; adds any that are ready and returns TRUE if there may be more
+typedef BOOLEAN (*MENU_GROW_FUNC)(VOID);
+
 VOID AddMenuInfoLine(IN REFIT_MENU_SCREEN *Screen, IN CHAR16 *InfoLine);
 VOID AddMenuEntry(IN REFIT_MENU_SCREEN *Screen, IN REFIT_MENU_ENTRY *Entry);
 UINTN ComputeRow0PosY(VOID);
@@ -116,6 +120,7 @@ UINTN RunMainMenu(IN REFIT_MENU_SCREEN *Screen, IN CHAR16** DefaultSelection, OU
 UINTN FindMainMenuItem(IN REFIT_MENU_SCREEN *Screen, IN SCROLL_STATE *State, IN UINTN PosX, IN UINTN PosY);
 VOID GenerateWaitList();
 UINTN WaitForInput(IN UINTN Timeout);
+VOID SetMenuGrowFunc(IN REFIT_MENU_SCREEN *Screen, IN MENU_GROW_FUNC NewGrowFunc);
 
 #endif
 
@@ -0,0 +1,206 @@
+/*
+ * refind/prefetch.c
+ * Reading ahead of the default boot loader during the menu timeout
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// While the main menu counts down to launching its default entry, the disk
+// sits idle. When preload_loaders is set, the menu hands that entry to
+// PrefetchStart() and then, whenever it would otherwise wait for a key,
+// calls PrefetchStep() to read another piece of the entry's boot loader or
+// initrd files into memory. There are no threads in EFI, so the reading is
+// done between checks for input, a piece at a time; it stops as soon as the
+// user presses a key, which also cancels the timeout. When the entry is
+// launched, PreloadImage() and InitrdPreload() take the data with
+// PrefetchTake() (finishing any partly-read file) instead of reading the
+// files again. Anything not taken is freed when any program is launched or
+// when the volumes are rescanned.
+
+#include "prefetch.h"
+#include "initrd.h"
+#include "lib.h"
+#include "mystrings.h"
+#include "../include/refit_call_wrapper.h"
+
+// Size of each read made by PrefetchStep(); small enough that a keypress
+// isn't kept waiting long, even on slow media
+#define PREFETCH_CHUNK_SIZE (2 * 1024 * 1024)
+
+// States of a PREFETCH_FILE
+#define FILE_WAITING        0   // not yet opened
+#define FILE_READING        1   // open, and partly read into Data
+#define FILE_READ           2   // wholly read into Data
+#define FILE_DROPPED        3   // couldn't be read, or handed over by PrefetchTake()
+
+typedef struct {
+   CHAR16           *FileName;
+   UINTN            State;
+   EFI_FILE_HANDLE  FileHandle;  // open while State is FILE_READING
+   UINT8            *Data;
+   UINTN            Size;
+   UINTN            Done;        // bytes of Data read so far
+} PREFETCH_FILE;
+
+typedef struct {
+   LOADER_ENTRY     *Entry;
+   REFIT_VOLUME     *Volume;
+   UINTN            TotalSize;   // sum of the Sizes of files holding Data
+   UINTN            FileCount;
+   PREFETCH_FILE    Files[PREFETCH_MAX_FILES];
+} PREFETCH_STATE;
+
+static PREFETCH_STATE Prefetch;
+
+// Stops reading File, frees what's been read of it, and marks it as dropped.
+static VOID DropFile(IN OUT PREFETCH_FILE *File) {
+   if (File->FileHandle != NULL)
+      refit_call1_wrapper(File->FileHandle->Close, File->FileHandle);
+   if (File->Data != NULL) {
+      FreePool(File->Data);
+      Prefetch.TotalSize -= File->Size;
+   }
+   File->FileHandle = NULL;
+   File->Data = NULL;
+   File->State = FILE_DROPPED;
+} // static VOID DropFile()
+
+// Opens File and allocates a buffer for it, if it fits within PREFETCH_MAX_SIZE.
+static VOID OpenFile(IN OUT PREFETCH_FILE *File) {
+   EFI_STATUS     Status;
+   EFI_FILE_INFO  *FileInfo;
+   UINT64         FileSize = 0;
+
+   Status = refit_call5_wrapper(Prefetch.Volume->RootDir->Open, Prefetch.Volume->RootDir, &File->FileHandle,
+                                File->FileName, EFI_FILE_MODE_READ, 0);
+   if (EFI_ERROR(Status)) {
+      File->FileHandle = NULL;
+      DropFile(File);
+      return;
+   }
+   FileInfo = LibFileInfo(File->FileHandle);
+   if (FileInfo != NULL) {
+      FileSize = FileInfo->FileSize;
+      FreePool(FileInfo);
+   }
+   if ((FileSize > 0) && (FileSize <= PREFETCH_MAX_SIZE - Prefetch.TotalSize))
+      File->Data = AllocatePool((UINTN) FileSize);
+   if (File->Data == NULL) {
+      DropFile(File);
+   } else {
+      File->Size = (UINTN) FileSize;
+      Prefetch.TotalSize += File->Size;
+      File->State = FILE_READING;
+   }
+} // static VOID OpenFile()
+
+// Begins reading ahead for Entry, the menu's default entry, if preload_loaders
+// is set: its boot loader first, then any initrd files named in its options.
+// Does nothing if Entry is already being read.
+VOID PrefetchStart(IN LOADER_ENTRY *Entry) {
+   CHAR16  *Options, *Name;
+
+   if (!GlobalConfig.PreloadLoaders || (Entry == NULL) || (Entry == Prefetch.Entry) ||
+       (Entry->me.Tag != TAG_LOADER) || (Entry->LoaderPath == NULL) ||
+       (Entry->Volume == NULL) || (Entry->Volume->RootDir == NULL))
+      return;
+
+   PrefetchForget();
+   Prefetch.Entry = Entry;
+   Prefetch.Volume = Entry->Volume;
+   Prefetch.Files[Prefetch.FileCount++].FileName = StrDuplicate(Entry->LoaderPath);
+   // As in StartLoader(), ELILO's initrds are left for ELILO to read
+   if ((Entry->OSType != 'E') && (Entry->LoadOptions != NULL)) {
+      Options = Entry->LoadOptions;
+      while ((Prefetch.FileCount < PREFETCH_MAX_FILES) && ((Name = NextInitrdName(&Options)) != NULL))
+         Prefetch.Files[Prefetch.FileCount++].FileName = Name;
+   }
+} // VOID PrefetchStart()
+
+// Does one small piece of the reading begun by PrefetchStart(): opening a
+// file or reading PREFETCH_CHUNK_SIZE bytes of it. Returns FALSE if there
+// was nothing left to do.
+BOOLEAN PrefetchStep(VOID) {
+   PREFETCH_FILE  *File = NULL;
+   EFI_STATUS     Status;
+   UINTN          i, ChunkSize;
+
+   for (i = 0; (i < Prefetch.FileCount) && (File == NULL); i++) {
+      if ((Prefetch.Files[i].State == FILE_WAITING) || (Prefetch.Files[i].State == FILE_READING))
+         File = &Prefetch.Files[i];
+   }
+   if (File == NULL)
+      return FALSE;
+
+   if (File->State == FILE_WAITING) {
+      OpenFile(File);
+      return TRUE;
+   }
+
+   ChunkSize = (File->Size - File->Done > PREFETCH_CHUNK_SIZE) ? PREFETCH_CHUNK_SIZE : File->Size - File->Done;
+   Status = refit_call3_wrapper(File->FileHandle->Read, File->FileHandle, &ChunkSize, File->Data + File->Done);
+   if (EFI_ERROR(Status) || (ChunkSize == 0)) {
+      DropFile(File);
+   } else {
+      File->Done += ChunkSize;
+      if (File->Done == File->Size) {
+         refit_call1_wrapper(File->FileHandle->Close, File->FileHandle);
+         File->FileHandle = NULL;
+         File->State = FILE_READ;
+      }
+   } // if/else
+   return TRUE;
+} // BOOLEAN PrefetchStep()
+
+// If FileName on Volume has been (or is being) read ahead, finishes reading
+// it, hands its data to the caller (who must free it), and returns TRUE.
+BOOLEAN PrefetchTake(IN REFIT_VOLUME *Volume, IN CHAR16 *FileName, OUT UINT8 **Data, OUT UINTN *Size) {
+   PREFETCH_FILE  *File;
+   UINTN          i;
+
+   if ((Volume == NULL) || (Volume != Prefetch.Volume) || (FileName == NULL))
+      return FALSE;
+
+   for (i = 0; i < Prefetch.FileCount; i++) {
+      File = &Prefetch.Files[i];
+      if (((File->State == FILE_READING) || (File->State == FILE_READ)) && (StrCmp(File->FileName, FileName) == 0)) {
+         if ((File->State == FILE_READING) &&
+             EFI_ERROR(ReadFileFully(File->FileHandle, File->Data + File->Done, File->Size - File->Done))) {
+            DropFile(File);
+            return FALSE;
+         }
+         *Data = File->Data;
+         *Size = File->Size;
+         File->Data = NULL;
+         Prefetch.TotalSize -= File->Size;
+         DropFile(File);
+         return TRUE;
+      } // if
+   } // for
+   return FALSE;
+} // BOOLEAN PrefetchTake()
+
+// Stops any reading ahead and frees everything that's been read.
+VOID PrefetchForget(VOID) {
+   UINTN i;
+
+   for (i = 0; i < Prefetch.FileCount; i++) {
+      DropFile(&Prefetch.Files[i]);
+      MyFreePool(Prefetch.Files[i].FileName);
+   }
+   SetMem(&Prefetch, sizeof(PREFETCH_STATE), 0);
+} // VOID PrefetchForget()
@@ -0,0 +1,43 @@
+/*
+ * refind/prefetch.h
+ * Reading ahead of the default boot loader during the menu timeout
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __PREFETCH_H_
+#define __PREFETCH_H_
+
+#ifdef __MAKEWITH_GNUEFI
+#include "efi.h"
+#include "efilib.h"
+#else
+#include "../include/tiano_includes.h"
+#endif
+#include "global.h"
+
+// Most files (a boot loader and its initrds) read ahead for one entry
+#define PREFETCH_MAX_FILES  8
+// Most memory used for the files read ahead
+#define PREFETCH_MAX_SIZE   (512 * 1024 * 1024)
+
+VOID PrefetchStart(IN LOADER_ENTRY *Entry);
+BOOLEAN PrefetchStep(VOID);
+BOOLEAN PrefetchTake(IN REFIT_VOLUME *Volume, IN CHAR16 *FileName, OUT UINT8 **Data, OUT UINTN *Size);
+VOID PrefetchForget(VOID);
+
+#endif
@@ -0,0 +1,326 @@
+/*
+ * refind/scancache.c
+ * Persistent cache of boot loader scan results
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// Scanning for boot loaders opens and reads every candidate file on every
+// volume (to see if it's a valid EFI binary, if it's a symbolic link, if it
+// duplicates the fallback loader, and so on), and these probes dominate the
+// pre-menu time on systems with many disks. When the scan_cache option is
+// set, the results of the expensive probes are saved in the "vars"
+// subdirectory and reused on later boots. Each result is keyed by the
+// volume's partition GUID (or filesystem UUID), the filename, and the file's
+// size, modification time, and a CRC of its first few hundred bytes (plus
+// those of a second file, for comparisons), so a result is reused only if
+// nothing it depends on has changed; otherwise the probe is run again and
+// the new result replaces the old one. (The CRC catches files rewritten
+// without a change in size or time stamp, as by tools that preserve time
+// stamps, or within the 2-second resolution of FAT's.) Results that aren't
+// used in a scan are dropped when the cache is next saved.
+
+#include "scancache.h"
+#include "lib.h"
+#include "mystrings.h"
+#include "../include/refit_call_wrapper.h"
+
+#define SCAN_CACHE_MAGIC      "rEFIscn2"
+#define SCAN_CACHE_MAGIC_SIZE 8
+
+#pragma pack(1)
+typedef struct {
+   CHAR8     Magic[SCAN_CACHE_MAGIC_SIZE];
+   UINT32    EntryCount;
+   UINT32    Reserved;
+} SCAN_CACHE_HEADER;
+
+// On disk, each entry is followed by NameLength CHAR16s (no terminating NUL)
+typedef struct {
+   EFI_GUID  VolumeGuid;
+   UINT64    FileSize;
+   EFI_TIME  FileTime;
+   UINT32    FileCrc;
+   UINT64    AuxSize;
+   EFI_TIME  AuxTime;
+   UINT32    AuxCrc;
+   UINT8     Kind;
+   UINT8     Result;
+   UINT16    NameLength;
+} SCAN_CACHE_RECORD;
+#pragma pack(0)
+
+typedef struct SCAN_CACHE_ENTRY {
+   SCAN_CACHE_RECORD        Record;
+   CHAR16                   *FileName;
+   BOOLEAN                  Used;
+   struct SCAN_CACHE_ENTRY  *NextInBucket;
+} SCAN_CACHE_ENTRY;
+
+// Entries are listed in CacheEntries, in the order they're saved, and are
+// also chained from CacheBuckets by the hash of their volume, filename, and
+// kind, so that finding one doesn't mean comparing it with every other.
+#define SCAN_CACHE_BUCKETS    256
+
+static SCAN_CACHE_ENTRY  **CacheEntries = NULL;
+static UINTN             CacheEntryCount = 0;
+static SCAN_CACHE_ENTRY  *CacheBuckets[SCAN_CACHE_BUCKETS];
+static BOOLEAN           CacheLoaded = FALSE;
+static BOOLEAN           CacheChanged = FALSE;
+
+static EFI_GUID          NullGuid = { 0x00000000, 0x0000, 0x0000, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 } };
+
+// Sets *Guid to the GUID that identifies Volume across boots -- its partition
+// GUID if it has one, or its filesystem UUID if not. Returns FALSE if it has
+// neither, in which case its results aren't cached.
+static BOOLEAN GetVolumeKey(IN REFIT_VOLUME *Volume, OUT EFI_GUID *Guid) {
+   if (Volume == NULL)
+      return FALSE;
+   if (!GuidsAreEqual(&(Volume->PartGuid), &NullGuid)) {
+      *Guid = Volume->PartGuid;
+   } else if (!GuidsAreEqual(&(Volume->VolUuid), &NullGuid)) {
+      *Guid = Volume->VolUuid;
+   } else {
+      return FALSE;
+   }
+   return TRUE;
+} // static BOOLEAN GetVolumeKey()
+
+// Returns TRUE if the two times are identical, ignoring padding fields.
+static BOOLEAN TimesMatch(IN EFI_TIME *Time1, IN EFI_TIME *Time2) {
+   return ((Time1->Year == Time2->Year) && (Time1->Month == Time2->Month) && (Time1->Day == Time2->Day) &&
+           (Time1->Hour == Time2->Hour) && (Time1->Minute == Time2->Minute) &&
+           (Time1->Second == Time2->Second) && (Time1->Nanosecond == Time2->Nanosecond));
+} // static BOOLEAN TimesMatch()
+
+// Returns the bucket for the specified volume, file, and kind. Filenames are
+// hashed ignoring case the same way MyStriCmp() compares them.
+static UINTN CacheBucket(IN EFI_GUID *VolumeGuid, IN CHAR16 *FileName, IN UINTN Kind) {
+   UINT8   *GuidBytes = (UINT8 *) VolumeGuid;
+   UINT32  Hash = 2166136261U;
+   UINTN   i;
+
+   for (i = 0; i < sizeof(EFI_GUID); i++)
+      Hash = (Hash ^ GuidBytes[i]) * 16777619;
+   Hash = (Hash ^ (UINT32) Kind) * 16777619;
+   while (*FileName != L'\0')
+      Hash = (Hash ^ (*FileName++ & ~0x20)) * 16777619;
+   return (Hash >> 16) % SCAN_CACHE_BUCKETS;
+} // static UINTN CacheBucket()
+
+// Chain Entry from its bucket.
+static VOID HashCacheEntry(IN SCAN_CACHE_ENTRY *Entry) {
+   UINTN Bucket;
+
+   Bucket = CacheBucket(&(Entry->Record.VolumeGuid), Entry->FileName, Entry->Record.Kind);
+   Entry->NextInBucket = CacheBuckets[Bucket];
+   CacheBuckets[Bucket] = Entry;
+} // static VOID HashCacheEntry()
+
+// Returns the entry for the specified volume, file, and kind, or NULL if
+// there's none. The entry may hold a stale result; the caller must check
+// the sizes, times, and CRCs.
+static SCAN_CACHE_ENTRY * FindCacheEntry(IN EFI_GUID *VolumeGuid, IN CHAR16 *FileName, IN UINTN Kind) {
+   SCAN_CACHE_ENTRY *Entry;
+
+   for (Entry = CacheBuckets[CacheBucket(VolumeGuid, FileName, Kind)]; Entry != NULL; Entry = Entry->NextInBucket) {
+      if ((Entry->Record.Kind == Kind) &&
+          GuidsAreEqual(&(Entry->Record.VolumeGuid), VolumeGuid) &&
+          MyStriCmp(Entry->FileName, FileName))
+         return Entry;
+   }
+   return NULL;
+} // static SCAN_CACHE_ENTRY * FindCacheEntry()
+
+// Read the cache file, if the scan_cache option is set. If the cache has
+// already been read (as on a rescan), this just marks all its entries as
+// unused, so that entries that aren't used in the coming scan are dropped.
+VOID ScanCacheLoad(VOID) {
+   EFI_STATUS          Status;
+   EFI_FILE            *VarsDir = NULL;
+   UINT8               *Data = NULL, *Pos;
+   UINTN               DataLength = 0, i;
+   SCAN_CACHE_HEADER   *Header;
+   SCAN_CACHE_ENTRY    *Entry;
+
+   if (!GlobalConfig.ScanCache)
+      return;
+
+   if (CacheLoaded) {
+      for (i = 0; i < CacheEntryCount; i++)
+         CacheEntries[i]->Used = FALSE;
+      return;
+   }
+   CacheLoaded = TRUE;
+
+   Status = refit_call5_wrapper(SelfDir->Open, SelfDir, &VarsDir, L"vars", EFI_FILE_MODE_READ, EFI_FILE_DIRECTORY);
+   if (EFI_ERROR(Status))
+      return;
+   Status = egLoadFile(VarsDir, SCAN_CACHE_FILENAME, &Data, &DataLength);
+   refit_call1_wrapper(VarsDir->Close, VarsDir);
+   if (EFI_ERROR(Status))
+      return;
+
+   Header = (SCAN_CACHE_HEADER *) Data;
+   if ((DataLength >= sizeof(SCAN_CACHE_HEADER)) &&
+       (CompareMem(Header->Magic, SCAN_CACHE_MAGIC, SCAN_CACHE_MAGIC_SIZE) == 0)) {
+      Pos = Data + sizeof(SCAN_CACHE_HEADER);
+      for (i = 0; i < Header->EntryCount; i++) {
+         if ((Pos + sizeof(SCAN_CACHE_RECORD) > Data + DataLength) ||
+             (Pos + sizeof(SCAN_CACHE_RECORD) + ((SCAN_CACHE_RECORD *) Pos)->NameLength * sizeof(CHAR16) > Data + DataLength))
+            break; // truncated file; keep what we've got
+         Entry = AllocateZeroPool(sizeof(SCAN_CACHE_ENTRY));
+         if (Entry == NULL)
+            break;
+         CopyMem(&(Entry->Record), Pos, sizeof(SCAN_CACHE_RECORD));
+         Pos += sizeof(SCAN_CACHE_RECORD);
+         Entry->FileName = AllocateZeroPool((Entry->Record.NameLength + 1) * sizeof(CHAR16));
+         if (Entry->FileName == NULL) {
+            MyFreePool(Entry);
+            break;
+         }
+         CopyMem(Entry->FileName, Pos, Entry->Record.NameLength * sizeof(CHAR16));
+         Pos += Entry->Record.NameLength * sizeof(CHAR16);
+         AddListElement((VOID ***) &CacheEntries, &CacheEntryCount, Entry);
+         HashCacheEntry(Entry);
+      } // for
+   } // if
+   MyFreePool(Data);
+} // VOID ScanCacheLoad()
+
+// Forget entries not used since the last call to ScanCacheLoad() and, if
+// anything has changed, write the cache file.
+VOID ScanCacheSave(VOID) {
+   EFI_STATUS          Status;
+   EFI_FILE            *VarsDir = NULL;
+   UINT8               *Data, *Pos;
+   UINTN               DataLength, i, Kept = 0;
+   SCAN_CACHE_HEADER   *Header;
+
+   if (!GlobalConfig.ScanCache || !CacheLoaded)
+      return;
+
+   // Drop unused entries, and compute the file's size from the rest, which
+   // are chained afresh from the buckets....
+   DataLength = sizeof(SCAN_CACHE_HEADER);
+   SetMem(CacheBuckets, sizeof(CacheBuckets), 0);
+   for (i = 0; i < CacheEntryCount; i++) {
+      if (CacheEntries[i]->Used) {
+         DataLength += sizeof(SCAN_CACHE_RECORD) + CacheEntries[i]->Record.NameLength * sizeof(CHAR16);
+         CacheEntries[Kept++] = CacheEntries[i];
+         HashCacheEntry(CacheEntries[i]);
+      } else {
+         MyFreePool(CacheEntries[i]->FileName);
+         MyFreePool(CacheEntries[i]);
+         CacheChanged = TRUE;
+      }
+   } // for
+   CacheEntryCount = Kept;
+   if (!CacheChanged)
+      return;
+
+   Data = AllocateZeroPool(DataLength);
+   if (Data == NULL)
+      return;
+   Header = (SCAN_CACHE_HEADER *) Data;
+   CopyMem(Header->Magic, SCAN_CACHE_MAGIC, SCAN_CACHE_MAGIC_SIZE);
+   Pos = Data + sizeof(SCAN_CACHE_HEADER);
+   Header->EntryCount = (UINT32) CacheEntryCount;
+   for (i = 0; i < CacheEntryCount; i++) {
+      CopyMem(Pos, &(CacheEntries[i]->Record), sizeof(SCAN_CACHE_RECORD));
+      Pos += sizeof(SCAN_CACHE_RECORD);
+      CopyMem(Pos, CacheEntries[i]->FileName, CacheEntries[i]->Record.NameLength * sizeof(CHAR16));
+      Pos += CacheEntries[i]->Record.NameLength * sizeof(CHAR16);
+   } // for
+
+   Status = refit_call5_wrapper(SelfDir->Open, SelfDir, &VarsDir, L"vars",
+                                EFI_FILE_MODE_READ | EFI_FILE_MODE_WRITE | EFI_FILE_MODE_CREATE, EFI_FILE_DIRECTORY);
+   if (!EFI_ERROR(Status)) {
+      Status = egSaveFile(VarsDir, SCAN_CACHE_FILENAME, Data, DataLength);
+      refit_call1_wrapper(VarsDir->Close, VarsDir);
+   }
+   if (!EFI_ERROR(Status))
+      CacheChanged = FALSE;
+   MyFreePool(Data);
+} // VOID ScanCacheSave()
+
+// Look up a cached result for FileName on Volume. Returns TRUE and sets
+// *Result if one exists and the file's (and, where relevant, the second
+// file's) size, modification time, and header CRC still match; returns FALSE
+// if the caller must compute the result (and should then call
+// ScanCacheStore()).
+BOOLEAN ScanCacheLookup(IN REFIT_VOLUME *Volume, IN CHAR16 *FileName, IN UINTN Kind,
+                        IN UINT64 FileSize, IN EFI_TIME *FileTime, IN UINT32 FileCrc,
+                        IN UINT64 AuxSize, IN EFI_TIME *AuxTime, IN UINT32 AuxCrc, OUT BOOLEAN *Result) {
+   EFI_GUID          VolumeGuid;
+   SCAN_CACHE_ENTRY  *Entry;
+
+   if (!GlobalConfig.ScanCache || !CacheLoaded || (FileName == NULL) || !GetVolumeKey(Volume, &VolumeGuid))
+      return FALSE;
+
+   Entry = FindCacheEntry(&VolumeGuid, FileName, Kind);
+   if ((Entry == NULL) || (Entry->Record.FileSize != FileSize) || !TimesMatch(&(Entry->Record.FileTime), FileTime) ||
+       (Entry->Record.FileCrc != FileCrc))
+      return FALSE;
+   if (AuxTime && ((Entry->Record.AuxSize != AuxSize) || !TimesMatch(&(Entry->Record.AuxTime), AuxTime) ||
+                   (Entry->Record.AuxCrc != AuxCrc)))
+      return FALSE;
+
+   Entry->Used = TRUE;
+   *Result = (BOOLEAN) Entry->Record.Result;
+   return TRUE;
+} // BOOLEAN ScanCacheLookup()
+
+// Record a freshly computed result, replacing any stale one for the same
+// file, volume, and kind.
+VOID ScanCacheStore(IN REFIT_VOLUME *Volume, IN CHAR16 *FileName, IN UINTN Kind,
+                    IN UINT64 FileSize, IN EFI_TIME *FileTime, IN UINT32 FileCrc,
+                    IN UINT64 AuxSize, IN EFI_TIME *AuxTime, IN UINT32 AuxCrc, IN BOOLEAN Result) {
+   EFI_GUID          VolumeGuid;
+   SCAN_CACHE_ENTRY  *Entry;
+
+   if (!GlobalConfig.ScanCache || !CacheLoaded || (FileName == NULL) || !GetVolumeKey(Volume, &VolumeGuid))
+      return;
+
+   Entry = FindCacheEntry(&VolumeGuid, FileName, Kind);
+   if (Entry == NULL) {
+      Entry = AllocateZeroPool(sizeof(SCAN_CACHE_ENTRY));
+      if (Entry == NULL)
+         return;
+      Entry->FileName = StrDuplicate(FileName);
+      if (Entry->FileName == NULL) {
+         MyFreePool(Entry);
+         return;
+      }
+      Entry->Record.VolumeGuid = VolumeGuid;
+      Entry->Record.Kind = (UINT8) Kind;
+      Entry->Record.NameLength = (UINT16) StrLen(FileName);
+      AddListElement((VOID ***) &CacheEntries, &CacheEntryCount, Entry);
+      HashCacheEntry(Entry);
+   }
+   Entry->Record.FileSize = FileSize;
+   Entry->Record.FileTime = *FileTime;
+   Entry->Record.FileCrc = FileCrc;
+   if (AuxTime) {
+      Entry->Record.AuxSize = AuxSize;
+      Entry->Record.AuxTime = *AuxTime;
+      Entry->Record.AuxCrc = AuxCrc;
+   }
+   Entry->Record.Result = (UINT8) Result;
+   Entry->Used = TRUE;
+   CacheChanged = TRUE;
+} // VOID ScanCacheStore()
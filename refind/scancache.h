@@ -0,0 +1,52 @@
+/*
+ * refind/scancache.h
+ * Persistent cache of boot loader scan results
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __SCANCACHE_H_
+#define __SCANCACHE_H_
+
+#ifdef __MAKEWITH_GNUEFI
+#include "efi.h"
+#include "efilib.h"
+#else
+#include "../include/tiano_includes.h"
+#endif
+#include "global.h"
+
+// Kinds of results held in the cache....
+// Is the file a valid (non-symlinked) EFI loader for this architecture?
+#define SCAN_CACHE_VALID_LOADER     1
+// Is the file byte-for-byte identical to the fallback loader? (The "aux"
+// size, time, and CRC are those of the fallback loader.)
+#define SCAN_CACHE_FALLBACK_DUP     2
+
+// Name of the cache file in rEFInd's "vars" subdirectory
+#define SCAN_CACHE_FILENAME         L"ScanCache"
+
+VOID ScanCacheLoad(VOID);
+VOID ScanCacheSave(VOID);
+BOOLEAN ScanCacheLookup(IN REFIT_VOLUME *Volume, IN CHAR16 *FileName, IN UINTN Kind,
+                        IN UINT64 FileSize, IN EFI_TIME *FileTime, IN UINT32 FileCrc,
+                        IN UINT64 AuxSize, IN EFI_TIME *AuxTime, IN UINT32 AuxCrc, OUT BOOLEAN *Result);
+VOID ScanCacheStore(IN REFIT_VOLUME *Volume, IN CHAR16 *FileName, IN UINTN Kind,
+                    IN UINT64 FileSize, IN EFI_TIME *FileTime, IN UINT32 FileCrc,
+                    IN UINT64 AuxSize, IN EFI_TIME *AuxTime, IN UINT32 AuxCrc, IN BOOLEAN Result);
+
+#endif
@@ -63,6 +63,7 @@
 #include "menu.h"
 #include "mystrings.h"
 #include "../include/refit_call_wrapper.h"
+#include "log.h"
 
 #include "../include/egemb_refind_banner.h"
 
@@ -188,6 +189,7 @@ VOID SetupScreen(VOID)
             HaveResized = TRUE;
         } // if
         SwitchToGraphics();
+        egEnableShadowBuffer(GlobalConfig.ShadowFramebuffer);
         if (GlobalConfig.ScreensaverTime != -1) {
            BltClearScreen(TRUE);
         } else { // start with screen blanked
@@ -241,6 +243,13 @@ VOID FinishTextScreen(IN BOOLEAN WaitAlways)
     haveError = FALSE;
 }
 
+// Forget errors reported by work that's being abandoned, so that a later
+// FinishTextScreen() doesn't wait for a key on their account.
+VOID ResetErrorFlag(VOID)
+{
+    haveError = FALSE;
+}
+
 VOID BeginExternalScreen(IN BOOLEAN UseGraphicsMode, IN CHAR16 *Title)
 {
     if (!AllowGraphicsMode)
@@ -263,6 +272,7 @@ VOID FinishExternalScreen(VOID)
 {
     // make sure we clean up later
     GraphicsScreenDirty = TRUE;
+    egInvalidateShadowBuffer();
 
     if (haveError) {
         SwitchToText(FALSE);
@@ -416,6 +426,7 @@ BOOLEAN CheckFatalError(IN EFI_STATUS Status, IN CHAR16 *where)
     PrintUglyText(Temp, NEXTLINE);
     refit_call2_wrapper(ST->ConOut->SetAttribute, ST->ConOut, ATTR_BASIC);
     haveError = TRUE;
+    LOG_ERROR(L"%s", Temp);
     MyFreePool(Temp);
 
     return TRUE;
@@ -439,6 +450,7 @@ BOOLEAN CheckError(IN EFI_STATUS Status, IN CHAR16 *where)
     PrintUglyText(Temp, NEXTLINE);
     refit_call2_wrapper(ST->ConOut->SetAttribute, ST->ConOut, ATTR_BASIC);
     haveError = TRUE;
+    LOG_ERROR(L"%s", Temp);
     MyFreePool(Temp);
 
     return TRUE;
@@ -509,6 +521,7 @@ VOID BltClearScreen(BOOLEAN ShowBanner)
     }
 
     GraphicsScreenDirty = FALSE;
+    egFlushScreen();
     egFreeImage(GlobalConfig.ScreenBackground);
     GlobalConfig.ScreenBackground = egCopyScreen();
 } // VOID BltClearScreen()
@@ -87,6 +87,7 @@ VOID InitScreen(VOID);
 VOID SetupScreen(VOID);
 VOID BeginTextScreen(IN CHAR16 *Title);
 VOID FinishTextScreen(IN BOOLEAN WaitAlways);
+VOID ResetErrorFlag(VOID);
 VOID BeginExternalScreen(IN BOOLEAN UseGraphicsMode, IN CHAR16 *Title);
 VOID FinishExternalScreen(VOID);
 VOID TerminateScreen(VOID);
@@ -91,3 +91,232 @@ BOOLEAN CompareGlob(const CHAR16 *p, const CHAR16 *v)
     }
   } //while still trying to match (loop forever)
 }
+
+/* Compiled pattern lists. A list like "*.efi,vmlinuz*,shellx64.efi" is
+   split once into its literal entries, which go into a hash set, and its
+   wildcard entries, which are each compiled into an array of atoms. Besides
+   '*' and '?', wildcard entries may use "[abc]" and "[a-z]" sets, as
+   MetaiMatch() allows. Matching never allocates memory, needs no MAX_STARS
+   limit, and backtracks only to the most recent '*', so the time taken is
+   linear in the length of the value for typical patterns. */
+
+#define GLOB_ATOM_END   0
+#define GLOB_ATOM_CHAR  1
+#define GLOB_ATOM_ANY   2
+#define GLOB_ATOM_STAR  3
+#define GLOB_ATOM_SET   4
+#define GLOB_ATOM_RANGE 5
+
+#define GLOB_FOLD(c) ((((c) >= 'A') && ((c) <= 'Z')) ? (CHAR16) ((c) - 'A' + 'a') : (CHAR16) (c))
+
+static UINTN globHash(const CHAR16 *s, UINTN length)
+{
+  UINT32 hash = 2166136261U;
+
+  for(; length > 0; length--, s++)
+    hash = (hash ^ GLOB_FOLD(*s)) * 16777619;
+  return hash;
+}
+
+static BOOLEAN isWildcard(CHAR16 c)
+{
+  return (c == '*') || (c == '?') || (c == '[');
+}
+
+//compile the pattern of the given length into atoms; returns the number of atoms written
+static UINTN compileGlob(const CHAR16 *p, UINTN length, GLOB_ATOM *atoms)
+{
+  const CHAR16 *end = p + length;
+  UINTN n = 0, set;
+
+  while(p < end) {
+    atoms[n].lo = atoms[n].hi = 0;
+    switch(*p) {
+    case '*':
+      //several stars in a row are the same as one
+      if((n == 0) || (atoms[n-1].type != GLOB_ATOM_STAR))
+	atoms[n++].type = GLOB_ATOM_STAR;
+      p++;
+      break;
+    case '?':
+      atoms[n++].type = GLOB_ATOM_ANY;
+      p++;
+      break;
+    case '[':
+      set = n++;
+      atoms[set].type = GLOB_ATOM_SET;
+      for(p++; (p < end) && (*p != ']'); p++) {
+	atoms[n].type = GLOB_ATOM_RANGE;
+	atoms[n].lo = atoms[n].hi = GLOB_FOLD(*p);
+	if((p + 2 < end) && (p[1] == '-') && (p[2] != ']')) {
+	  atoms[n].hi = GLOB_FOLD(p[2]);
+	  p += 2;
+	}
+	atoms[set].hi++;
+	n++;
+      }
+      p++; //skip the ']'
+      break;
+    default:
+      atoms[n].type = GLOB_ATOM_CHAR;
+      atoms[n++].lo = GLOB_FOLD(*p);
+      p++;
+      break;
+    }
+  }
+  atoms[n].type = GLOB_ATOM_END;
+  atoms[n].lo = atoms[n].hi = 0;
+  return n + 1;
+}
+
+static BOOLEAN atomMatches(const GLOB_ATOM *a, CHAR16 c)
+{
+  UINTN i;
+
+  switch(a->type) {
+  case GLOB_ATOM_CHAR:
+    return a->lo == c;
+  case GLOB_ATOM_ANY:
+    return TRUE;
+  case GLOB_ATOM_SET:
+    for(i = 1; i <= a->hi; i++)
+      if((c >= a[i].lo) && (c <= a[i].hi))
+	return TRUE;
+    return FALSE;
+  }
+  return FALSE;
+}
+
+static const GLOB_ATOM *nextAtom(const GLOB_ATOM *a)
+{
+  return a + ((a->type == GLOB_ATOM_SET) ? a->hi + 1 : 1);
+}
+
+static BOOLEAN matchAtoms(const GLOB_ATOM *p, const CHAR16 *v)
+{
+  const GLOB_ATOM *starP = NULL; //atom after the most recent star
+  const CHAR16 *starV = NULL;    //first value character that star hasn't yet swallowed
+
+  for(;;) {
+    if(p->type == GLOB_ATOM_STAR) {
+      p++;
+      if(p->type == GLOB_ATOM_END) //a trailing star matches whatever is left
+	return TRUE;
+      starP = p;
+      starV = v;
+      continue;
+    }
+    if(*v == '\0')
+      return p->type == GLOB_ATOM_END;
+    if((p->type != GLOB_ATOM_END) && atomMatches(p, GLOB_FOLD(*v))) {
+      p = nextAtom(p);
+      v++;
+      continue;
+    }
+    //mismatch: let the last star swallow one more character, or give up
+    if(starP == NULL)
+      return FALSE;
+    p = starP;
+    v = ++starV;
+  }
+}
+
+VOID FreeGlobList(GLOB_LIST *globs)
+{
+  if(globs->atoms) FreePool(globs->atoms);
+  if(globs->globs) FreePool(globs->globs);
+  if(globs->text) FreePool(globs->text);
+  if(globs->literals) FreePool(globs->literals);
+  globs->atoms = NULL;
+  globs->globs = NULL;
+  globs->text = NULL;
+  globs->literals = NULL;
+  globs->globCount = globs->literalSlots = 0;
+}
+
+//compile the comma-delimited list into globs. Returns FALSE if out of memory.
+BOOLEAN CompileGlobList(const CHAR16 *list, GLOB_LIST *globs)
+{
+  const CHAR16 *start, *end;
+  UINTN length = 0, elements = 1, atomCount = 0, textUsed = 0, i, slot;
+  BOOLEAN wild;
+
+  globs->atoms = NULL;
+  globs->globs = NULL;
+  globs->text = NULL;
+  globs->literals = NULL;
+  globs->globCount = 0;
+  globs->literalSlots = 8;
+
+  for(end = list; *end; end++, length++)
+    if(*end == ',')
+      elements++;
+
+  //the atoms and the literal text each need at most one slot per character,
+  //plus one terminator per element
+  globs->atoms = AllocatePool((length + elements) * sizeof(GLOB_ATOM));
+  globs->globs = AllocatePool(elements * sizeof(UINTN));
+  globs->text = AllocatePool((length + elements) * sizeof(CHAR16));
+  while(globs->literalSlots < elements * 2)
+    globs->literalSlots *= 2;
+  globs->literals = AllocatePool(globs->literalSlots * sizeof(CHAR16 *));
+  if(!globs->atoms || !globs->globs || !globs->text || !globs->literals) {
+    FreeGlobList(globs);
+    return FALSE;
+  }
+  for(i = 0; i < globs->literalSlots; i++)
+    globs->literals[i] = NULL;
+
+  for(start = list; ; start = end + 1) {
+    wild = FALSE;
+    for(end = start; *end && *end != ','; end++)
+      wild |= isWildcard(*end);
+
+    if(end > start) {
+      if(wild) {
+	globs->globs[globs->globCount++] = atomCount;
+	atomCount += compileGlob(start, end - start, globs->atoms + atomCount);
+      } else {
+	for(i = 0; i < (UINTN) (end - start); i++)
+	  globs->text[textUsed + i] = GLOB_FOLD(start[i]);
+	globs->text[textUsed + i] = '\0';
+	slot = globHash(start, end - start) & (globs->literalSlots - 1);
+	while(globs->literals[slot] != NULL)
+	  slot = (slot + 1) & (globs->literalSlots - 1);
+	globs->literals[slot] = globs->text + textUsed;
+	textUsed += i + 1;
+      }
+    }
+
+    if(*end == '\0')
+      break;
+  }
+
+  return TRUE;
+}
+
+//returns TRUE if v matches any pattern in globs
+BOOLEAN GlobListMatch(const GLOB_LIST *globs, const CHAR16 *v)
+{
+  const CHAR16 *l, *w;
+  UINTN length = 0, slot, i;
+
+  if(globs->literals) {
+    for(w = v; *w; w++)
+      length++;
+    slot = globHash(v, length) & (globs->literalSlots - 1);
+    while((l = globs->literals[slot]) != NULL) {
+      for(w = v; *l && (*l == GLOB_FOLD(*w)); l++, w++)
+	;
+      if((*l == '\0') && (*w == '\0'))
+	return TRUE;
+      slot = (slot + 1) & (globs->literalSlots - 1);
+    }
+  }
+
+  for(i = 0; i < globs->globCount; i++)
+    if(matchAtoms(globs->atoms + globs->globs[i], v))
+      return TRUE;
+
+  return FALSE;
+}
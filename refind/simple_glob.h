@@ -5,4 +5,27 @@
 
 BOOLEAN CompareGlob(const CHAR16 *p, const CHAR16 *v);
 
+/* A comma-delimited list of patterns (as passed to DirIterNext()), compiled
+   once so that each match is allocation-free. Patterns without wildcards go
+   in a hash set; the rest are turned into arrays of GLOB_ATOMs. All matching
+   is case-insensitive. */
+
+typedef struct {
+  UINT16 type;
+  CHAR16 lo, hi; //character or range; for a set, hi is the number of ranges that follow
+} GLOB_ATOM;
+
+typedef struct {
+  GLOB_ATOM *atoms;      //all the wildcard patterns, each ended by a GLOB_ATOM_END atom
+  UINTN *globs;          //index in atoms of the start of each wildcard pattern
+  UINTN globCount;
+  CHAR16 *text;          //case-folded literal patterns, each '\0'-terminated
+  CHAR16 **literals;     //open-addressed hash set of the literal patterns
+  UINTN literalSlots;    //size of literals; a power of 2
+} GLOB_LIST;
+
+BOOLEAN CompileGlobList(const CHAR16 *list, GLOB_LIST *globs);
+BOOLEAN GlobListMatch(const GLOB_LIST *globs, const CHAR16 *v);
+VOID FreeGlobList(GLOB_LIST *globs);
+
 #endif
@@ -1,6 +1,20 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "simple_glob.h"
 
+//simple_glob.c allocates its compiled lists from the pool; on the host, the pool is malloc
+VOID *AllocatePool(UINTN size)
+{
+  return malloc(size);
+}
+
+VOID FreePool(VOID *p)
+{
+  free(p);
+}
+
 void charToChar16(CHAR16 *out, int maxLength, char *in)
 {
   int i;
@@ -12,11 +26,186 @@ void charToChar16(CHAR16 *out, int maxLength, char *in)
 }
     
 
+//the way lists were matched before they were compiled: split out each
+//element anew (allocating a copy, as FindCommaDelimited() does) for every value.
+//CompareGlob() is case-sensitive and has no [sets], so match counts can differ
+static BOOLEAN splitAndCompare(const CHAR16 *list, const CHAR16 *v)
+{
+  const CHAR16 *start, *end;
+  CHAR16 *one;
+  BOOLEAN match = FALSE;
+
+  for(start = list; !match; start = end + 1) {
+    for(end = start; *end && *end != ','; end++)
+      ;
+    one = malloc((end - start + 1) * sizeof(CHAR16));
+    memcpy(one, start, (end - start) * sizeof(CHAR16));
+    one[end - start] = 0;
+    match = CompareGlob(one, v);
+    free(one);
+    if(*end == '\0')
+      break;
+  }
+  return match;
+}
+
+static double secondsSince(clock_t start)
+{
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+//time matching count generated filenames against the comma-delimited list
+static int benchmark(char *list, long count)
+{
+  static const char *stems[] = { "grubx64", "shimx64", "vmlinuz-6.1.0-13-amd64", "bootmgfw",
+				 "mmx64", "fwupx64", "initrd.img-6.1.0-13-amd64", "loader" };
+  static const char *extensions[] = { ".efi", ".EFI", "", ".img", ".conf" };
+  CHAR16 pat[1024], (*vals)[64];
+  char name[64];
+  GLOB_LIST globs;
+  clock_t start;
+  long i, splitMatches = 0, compiledMatches = 0;
+  double splitTime, compiledTime;
+
+  charToChar16(pat, 1023, list);
+  vals = malloc(count * sizeof(*vals));
+  if(!vals)
+    return 1;
+  for(i = 0; i < count; i++) {
+    snprintf(name, sizeof(name), "%s%s%s", (i % 3) ? "" : "old-",
+	     stems[i % 8], extensions[(i / 8) % 5]);
+    charToChar16(vals[i], 64, name);
+  }
+
+  start = clock();
+  for(i = 0; i < count; i++)
+    splitMatches += splitAndCompare(pat, vals[i]);
+  splitTime = secondsSince(start);
+
+  start = clock();
+  if(!CompileGlobList(pat, &globs)) {
+    free(vals);
+    return 1;
+  }
+  for(i = 0; i < count; i++)
+    compiledMatches += GlobListMatch(&globs, vals[i]);
+  FreeGlobList(&globs);
+  compiledTime = secondsSince(start);
+
+  printf("%ld values against \"%s\"\n", count, list);
+  printf("  split + CompareGlob: %8.3f s, %ld matches\n", splitTime, splitMatches);
+  printf("  compiled GLOB_LIST:  %8.3f s, %ld matches\n", compiledTime, compiledMatches);
+
+  free(vals);
+  return 0;
+}
+
+//GlobListMatch() is case-insensitive and knows [sets]; in gnu-efi builds,
+//'[' was once a literal, so these pin down what the compiled lists accept
+static const struct {
+  const char *list, *value;
+  BOOLEAN match;
+} listCases[] = {
+  { "grubx64.efi", "grubx64.efi", TRUE },
+  { "grubx64.efi", "GRUBX64.EFI", TRUE },
+  { "grubx64.efi", "grubx64.ef", FALSE },
+  { "grubx64.efi", "grubx64.efix", FALSE },
+  { "*", "", TRUE },
+  { "*", "anything", TRUE },
+  { "*.efi", "shimx64.efi", TRUE },
+  { "*.efi", "shimx64.efi.bak", FALSE },
+  { "vmlinuz*", "vmlinuz-6.1.0-13-amd64", TRUE },
+  { "vmlinuz*", "initrd.img", FALSE },
+  { "*x64*", "fwupx64.efi", TRUE },
+  { "a*b*c", "abc", TRUE },
+  { "a*b*c", "aXXbYYc", TRUE },
+  { "a*b*c", "aXXbYY", FALSE },
+  { "grub?64.efi", "grubx64.efi", TRUE },
+  { "grub?64.efi", "grub64.efi", FALSE },
+  { "???", "abc", TRUE },
+  { "???", "abcd", FALSE },
+  { "boot[xa]64.efi", "bootx64.efi", TRUE },
+  { "boot[xa]64.efi", "BOOTA64.EFI", TRUE },
+  { "boot[xa]64.efi", "booti64.efi", FALSE },
+  { "vmlinuz-[0-9]*", "vmlinuz-6.1.0", TRUE },
+  { "vmlinuz-[0-9]*", "vmlinuz-linux", FALSE },
+  { "[a-c][0-9]", "B7", TRUE },
+  { "[a-c][0-9]", "d7", FALSE },
+  { "[]", "", FALSE },
+  { "[", "[", FALSE },
+  { "shim.efi,mm*.efi,fallback.efi", "shim.efi", TRUE },
+  { "shim.efi,mm*.efi,fallback.efi", "mmx64.efi", TRUE },
+  { "shim.efi,mm*.efi,fallback.efi", "fallback.efi", TRUE },
+  { "shim.efi,mm*.efi,fallback.efi", "shimx64.efi", FALSE },
+  { "a,,b", "b", TRUE },
+  { "a,,b", "", FALSE },
+  { "", "", FALSE },
+};
+
+static const struct {
+  const char *pattern, *value;
+  BOOLEAN match;
+} compareCases[] = {
+  { "*.efi", "grubx64.efi", TRUE },
+  { "*.efi", "grubx64.EFI", FALSE },
+  { "grub?64.efi", "grubx64.efi", TRUE },
+  { "grub?64.efi", "grub64.efi", FALSE },
+  { "a*b*c", "aXbXc", TRUE },
+  { "a*b*c", "aXbX", FALSE },
+};
+
+//run the cases above, reporting each one that fails
+static int test(void)
+{
+  CHAR16 pat[256], val[256];
+  GLOB_LIST globs;
+  BOOLEAN match;
+  int i, failures = 0;
+
+  for(i = 0; i < (int) (sizeof(listCases) / sizeof(listCases[0])); i++) {
+    charToChar16(pat, 255, (char *) listCases[i].list);
+    charToChar16(val, 255, (char *) listCases[i].value);
+    if(!CompileGlobList(pat, &globs)) {
+      printf("FAIL: couldn't compile \"%s\"\n", listCases[i].list);
+      failures++;
+      continue;
+    }
+    match = GlobListMatch(&globs, val);
+    FreeGlobList(&globs);
+    if(match != listCases[i].match) {
+      printf("FAIL: GlobListMatch(\"%s\", \"%s\") is %s\n", listCases[i].list,
+	     listCases[i].value, match ? "true" : "false");
+      failures++;
+    }
+  }
+
+  for(i = 0; i < (int) (sizeof(compareCases) / sizeof(compareCases[0])); i++) {
+    charToChar16(pat, 255, (char *) compareCases[i].pattern);
+    charToChar16(val, 255, (char *) compareCases[i].value);
+    match = CompareGlob(pat, val);
+    if(match != compareCases[i].match) {
+      printf("FAIL: CompareGlob(\"%s\", \"%s\") is %s\n", compareCases[i].pattern,
+	     compareCases[i].value, match ? "true" : "false");
+      failures++;
+    }
+  }
+
+  printf("%d failure%s\n", failures, failures == 1 ? "" : "s");
+  return failures ? 1 : 0;
+}
+
 
 int main(int argc, char ** argv)
 {
+  if(argc >= 3 && strcmp(argv[1], "-b") == 0)
+    return benchmark(argv[2], argc > 3 ? atol(argv[3]) : 1000000);
+  if(argc == 2 && strcmp(argv[1], "-t") == 0)
+    return test();
+
   if(argc < 2) {
     fprintf(stderr,"Usage: %s <glob> <value> [values..]\n",argv[0]);
+    fprintf(stderr,"       %s -b <comma-delimited globs> [count]\n",argv[0]);
+    fprintf(stderr,"       %s -t\n",argv[0]);
   }
 
   CHAR16 pat[256];
@@ -0,0 +1,187 @@
+/*
+ * refind/trace.c
+ * Timing of rEFInd's start-up phases
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+// The start-up phases (reading the configuration, loading drivers, scanning
+// volumes and boot loaders, loading icons, hashing for identicons, and
+// drawing the first menu) call TraceBegin() and TraceEnd(), which note the
+// CPU's timestamp counter in a fixed-size ring of events. That costs only a
+// few instructions, so it's always done: the configuration file that says
+// whether the trace is wanted is itself one of the things timed. When the
+// boot_trace option is set, TraceSave() measures the counter's rate against
+// the firmware's Stall() and writes the events to rEFInd's directory in the
+// Chrome trace-event format (JSON), which chrome://tracing, Perfetto, and
+// similar tools can display. This is done as a program is launched and as
+// rEFInd exits, reboots, or shuts down. Times are in microseconds from the
+// earliest event held. TraceDuration() reports how long a phase that has
+// just ended took, so that the log can say so too; the counter's rate is
+// measured once, the first time either function needs it.
+//
+// Without a timestamp counter (on architectures other than x86 and ARM64),
+// nothing is recorded.
+
+#include "trace.h"
+#include "lib.h"
+#include "mystrings.h"
+#include "../include/refit_call_wrapper.h"
+
+typedef struct {
+   CHAR16   *Name;
+   UINT64   Timestamp;
+   CHAR16   Phase;       // 'B' (begin) or 'E' (end), as in the trace-event format
+} TRACE_EVENT;
+
+static TRACE_EVENT  Events[TRACE_MAX_EVENTS];
+static UINTN        EventCount = 0;    // all events recorded; Events[] holds the latest
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+static UINT64 ReadTimestamp(VOID) {
+   UINT32 Low, High;
+
+   __asm__ volatile ("rdtsc" : "=a" (Low), "=d" (High));
+   return ((UINT64) High << 32) | Low;
+} // static UINT64 ReadTimestamp()
+
+#define HAVE_TIMESTAMP_COUNTER 1
+
+#elif defined(__GNUC__) && defined(__aarch64__)
+
+// The generic timer's virtual count; the isb keeps it from being read early.
+static UINT64 ReadTimestamp(VOID) {
+   UINT64 Count;
+
+   __asm__ volatile ("isb\n\tmrs %0, cntvct_el0" : "=r" (Count));
+   return Count;
+} // static UINT64 ReadTimestamp()
+
+#define HAVE_TIMESTAMP_COUNTER 1
+
+#endif
+
+static VOID AddEvent(IN CHAR16 *Name, IN CHAR16 Phase) {
+#ifdef HAVE_TIMESTAMP_COUNTER
+   TRACE_EVENT *Event = &Events[EventCount % TRACE_MAX_EVENTS];
+
+   Event->Name = Name;
+   Event->Phase = Phase;
+   Event->Timestamp = ReadTimestamp();
+   EventCount++;
+#endif
+} // static VOID AddEvent()
+
+// Mark the start of the phase called Name....
+VOID TraceBegin(IN CHAR16 *Name) {
+   AddEvent(Name, L'B');
+} // VOID TraceBegin()
+
+// ... and its end. Phases may nest, but each must end before any phase that
+// began before it.
+VOID TraceEnd(IN CHAR16 *Name) {
+   AddEvent(Name, L'E');
+} // VOID TraceEnd()
+
+#ifdef HAVE_TIMESTAMP_COUNTER
+static UINT64 TicksPerMs = 0;
+
+// The timestamp counter's rate, measured against the firmware's Stall() the
+// first time it's needed. Returns 0 if the counter doesn't seem to run.
+static UINT64 GetTicksPerMs(VOID) {
+   UINT64 Start;
+
+   if (TicksPerMs == 0) {
+      Start = ReadTimestamp();
+      refit_call1_wrapper(BS->Stall, TRACE_CALIBRATION_TIME);
+      TicksPerMs = (ReadTimestamp() - Start) * 1000 / TRACE_CALIBRATION_TIME;
+   }
+   return TicksPerMs;
+} // static UINT64 GetTicksPerMs()
+#endif
+
+// Returns how long the latest phase called Name that has ended took, in
+// microseconds, or 0 if no such phase is held.
+UINT64 TraceDuration(IN CHAR16 *Name) {
+#ifdef HAVE_TIMESTAMP_COUNTER
+   UINTN    First, i;
+   UINT64   End = 0;
+   BOOLEAN  Ended = FALSE;
+
+   First = (EventCount > TRACE_MAX_EVENTS) ? EventCount - TRACE_MAX_EVENTS : 0;
+   for (i = EventCount; i > First; i--) {
+      if (StrCmp(Events[(i - 1) % TRACE_MAX_EVENTS].Name, Name) != 0)
+         continue;
+      if (Events[(i - 1) % TRACE_MAX_EVENTS].Phase == L'E') {
+         End = Events[(i - 1) % TRACE_MAX_EVENTS].Timestamp;
+         Ended = TRUE;
+      } else if (Ended && (GetTicksPerMs() > 0)) {
+         return (End - Events[(i - 1) % TRACE_MAX_EVENTS].Timestamp) * 1000 / TicksPerMs;
+      }
+   } // for
+#endif
+   return 0;
+} // UINT64 TraceDuration()
+
+// Append String to Buffer (at *Length) as ASCII.
+static VOID AppendAscii(IN OUT CHAR8 *Buffer, IN OUT UINTN *Length, IN CHAR16 *String) {
+   while (*String != L'\0')
+      Buffer[(*Length)++] = (CHAR8) *String++;
+} // static VOID AppendAscii()
+
+// If the boot_trace option is set, write the events recorded so far to
+// TRACE_FILENAME, replacing any earlier trace.
+VOID TraceSave(VOID) {
+#ifdef HAVE_TIMESTAMP_COUNTER
+   UINTN        First, i, Length = 0, Size;
+   CHAR8        *Buffer;
+   CHAR16       Line[256];
+   TRACE_EVENT  *Event;
+
+   if (!GlobalConfig.BootTrace || (EventCount == 0) || (SelfDir == NULL))
+      return;
+
+   if (GetTicksPerMs() == 0)
+      return;
+
+   First = (EventCount > TRACE_MAX_EVENTS) ? EventCount - TRACE_MAX_EVENTS : 0;
+   // Each line holds its event's name plus fewer than 80 other characters.
+   Size = 256;
+   for (i = First; i < EventCount; i++)
+      Size += StrLen(Events[i % TRACE_MAX_EVENTS].Name) + 80;
+   Buffer = AllocatePool(Size);
+   if (Buffer == NULL)
+      return;
+
+   AppendAscii(Buffer, &Length, L"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+               L"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"rEFInd\"}}");
+   for (i = First; i < EventCount; i++) {
+      Event = &Events[i % TRACE_MAX_EVENTS];
+      SPrint(Line, 255, L",\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%ld,\"pid\":1,\"tid\":1}",
+             Event->Name, Event->Phase,
+             (Event->Timestamp - Events[First % TRACE_MAX_EVENTS].Timestamp) * 1000 / TicksPerMs);
+      AppendAscii(Buffer, &Length, Line);
+   } // for
+   AppendAscii(Buffer, &Length, L"\n]}\n");
+
+   // egSaveFile() doesn't truncate an existing file, so delete it first.
+   egSaveFile(SelfDir, TRACE_FILENAME, NULL, 0);
+   egSaveFile(SelfDir, TRACE_FILENAME, (UINT8 *) Buffer, Length);
+   FreePool(Buffer);
+#endif
+} // VOID TraceSave()
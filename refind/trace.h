@@ -0,0 +1,47 @@
+/*
+ * refind/trace.h
+ * Timing of rEFInd's start-up phases
+ *
+ * Copyright (c) 2026 by the rEFInd contributors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __TRACE_H_
+#define __TRACE_H_
+
+#ifdef __MAKEWITH_GNUEFI
+#include "efi.h"
+#include "efilib.h"
+#else
+#include "../include/tiano_includes.h"
+#endif
+#include "global.h"
+
+// Most events held; once this many have been recorded, each new one
+// replaces the oldest
+#define TRACE_MAX_EVENTS        1024
+// Time over which the timestamp counter's rate is measured, in microseconds
+#define TRACE_CALIBRATION_TIME  2000
+// Name of the trace file written to rEFInd's directory
+#define TRACE_FILENAME          L"boot_trace.json"
+
+// Event names aren't copied, so they must be string constants.
+VOID TraceBegin(IN CHAR16 *Name);
+VOID TraceEnd(IN CHAR16 *Name);
+UINT64 TraceDuration(IN CHAR16 *Name);
+VOID TraceSave(VOID);
+
+#endif